@@ -0,0 +1,295 @@
+#include "alsa_output.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+// 处理 underrun(-EPIPE) 和挂起(-ESTRPIPE)，恢复成功返回0
+static int xrun_recovery(alsa_output_t *out, int err) {
+    if (err == -EPIPE) {
+        fprintf(stderr, "[WARN] ALSA underrun, recovering\n");
+    } else if (err == -ESTRPIPE) {
+        fprintf(stderr, "[WARN] ALSA stream suspended, recovering\n");
+    }
+    err = snd_pcm_recover(out->pcm, err, 1);
+    if (err < 0) {
+        fprintf(stderr, "[ERROR] ALSA recovery failed: %s\n", snd_strerror(err));
+    }
+    return err;
+}
+
+int alsa_output_open(alsa_output_t *out, const char *device, snd_pcm_format_t format,
+                     unsigned int rate, int channels,
+                     unsigned int buffer_time, unsigned int period_time) {
+    snd_pcm_hw_params_t *hw;
+    snd_pcm_sw_params_t *sw;
+    unsigned int real_rate = rate;
+    int dir = 0;
+    int err;
+
+    memset(out, 0, sizeof(*out));
+
+    if ((err = snd_pcm_open(&out->pcm, device, SND_PCM_STREAM_PLAYBACK, 0)) < 0) {
+        fprintf(stderr, "[ERROR] snd_pcm_open('%s') failed: %s\n", device, snd_strerror(err));
+        out->pcm = NULL;
+        return err;
+    }
+
+    snd_pcm_hw_params_alloca(&hw);
+    snd_pcm_hw_params_any(out->pcm, hw);
+
+    // 优先 mmap，直接写硬件缓冲区
+    out->mmap = 1;
+    if (snd_pcm_hw_params_set_access(out->pcm, hw, SND_PCM_ACCESS_MMAP_INTERLEAVED) < 0) {
+        out->mmap = 0;
+        if ((err = snd_pcm_hw_params_set_access(out->pcm, hw, SND_PCM_ACCESS_RW_INTERLEAVED)) < 0) {
+            fprintf(stderr, "[ERROR] No usable access type: %s\n", snd_strerror(err));
+            goto fail;
+        }
+    }
+    if ((err = snd_pcm_hw_params_set_format(out->pcm, hw, format)) < 0) {
+        fprintf(stderr, "[ERROR] Sample format %s not available: %s\n",
+                snd_pcm_format_name(format), snd_strerror(err));
+        goto fail;
+    }
+    if ((err = snd_pcm_hw_params_set_channels(out->pcm, hw, channels)) < 0) {
+        fprintf(stderr, "[ERROR] Channel count %d not available: %s\n", channels, snd_strerror(err));
+        goto fail;
+    }
+    if ((err = snd_pcm_hw_params_set_rate_near(out->pcm, hw, &real_rate, &dir)) < 0) {
+        fprintf(stderr, "[ERROR] Rate %u Hz not available: %s\n", rate, snd_strerror(err));
+        goto fail;
+    }
+    if (real_rate != rate) {
+        fprintf(stderr, "[WARN] Rate %u Hz not supported, using %u Hz\n", rate, real_rate);
+    }
+    if (buffer_time > 0) {
+        dir = 0;
+        snd_pcm_hw_params_set_buffer_time_near(out->pcm, hw, &buffer_time, &dir);
+    }
+    if (period_time > 0) {
+        dir = 0;
+        snd_pcm_hw_params_set_period_time_near(out->pcm, hw, &period_time, &dir);
+    }
+    if ((err = snd_pcm_hw_params(out->pcm, hw)) < 0) {
+        fprintf(stderr, "[ERROR] snd_pcm_hw_params failed: %s\n", snd_strerror(err));
+        goto fail;
+    }
+
+    snd_pcm_hw_params_get_buffer_size(hw, &out->buffer_size);
+    snd_pcm_hw_params_get_period_size(hw, &out->period_size, &dir);
+    out->can_pause = snd_pcm_hw_params_can_pause(hw);
+
+    // 缓冲区写满才开始播放，声卡有一个周期的空间就唤醒
+    snd_pcm_sw_params_alloca(&sw);
+    snd_pcm_sw_params_current(out->pcm, sw);
+    snd_pcm_sw_params_set_start_threshold(out->pcm, sw, out->buffer_size);
+    snd_pcm_sw_params_set_avail_min(out->pcm, sw, out->period_size);
+    if ((err = snd_pcm_sw_params(out->pcm, sw)) < 0) {
+        fprintf(stderr, "[ERROR] snd_pcm_sw_params failed: %s\n", snd_strerror(err));
+        goto fail;
+    }
+
+    out->format = format;
+    out->rate = real_rate;
+    out->channels = channels;
+    out->frame_bytes = (size_t)snd_pcm_format_physical_width(format) / 8 * channels;
+
+    if (!out->mmap) {
+        out->bounce = malloc(out->period_size * out->frame_bytes);
+        if (!out->bounce) {
+            err = -ENOMEM;
+            goto fail;
+        }
+    }
+
+    printf("ALSA output: %s, %u Hz, %d ch, %s, buffer %lu frames, period %lu frames, %s\n",
+           device, out->rate, out->channels, snd_pcm_format_name(format),
+           (unsigned long)out->buffer_size, (unsigned long)out->period_size,
+           out->mmap ? "mmap" : "writei");
+    return 0;
+
+fail:
+    snd_pcm_close(out->pcm);
+    out->pcm = NULL;
+    return err;
+}
+
+void alsa_output_close(alsa_output_t *out) {
+    if (!out) return;
+    if (out->pcm) {
+        snd_pcm_drop(out->pcm);
+        snd_pcm_close(out->pcm);
+        out->pcm = NULL;
+    }
+    free(out->bounce);
+    out->bounce = NULL;
+}
+
+int alsa_output_begin(alsa_output_t *out, void **buf, snd_pcm_uframes_t *frames) {
+    snd_pcm_uframes_t want = *frames;
+    int err;
+
+    if (!out->mmap) {
+        if (want == 0 || want > out->period_size) want = out->period_size;
+        *buf = out->bounce;
+        *frames = want;
+        return 0;
+    }
+
+    for (;;) {
+        snd_pcm_sframes_t avail = snd_pcm_avail_update(out->pcm);
+        if (avail < 0) {
+            if ((err = xrun_recovery(out, (int)avail)) < 0) return err;
+            continue;
+        }
+
+        snd_pcm_uframes_t need = (want && want < out->period_size) ? want : out->period_size;
+        if ((snd_pcm_uframes_t)avail < need) {
+            // 缓冲区已满: 还没开始播放就启动，否则等声卡消耗一个周期
+            if (snd_pcm_state(out->pcm) == SND_PCM_STATE_PREPARED) {
+                err = snd_pcm_start(out->pcm);
+            } else {
+                err = snd_pcm_wait(out->pcm, 1000);
+            }
+            if (err < 0 && (err = xrun_recovery(out, err)) < 0) return err;
+            continue;
+        }
+
+        const snd_pcm_channel_area_t *areas;
+        snd_pcm_uframes_t offset;
+        snd_pcm_uframes_t size = (want && want < (snd_pcm_uframes_t)avail) ? want : (snd_pcm_uframes_t)avail;
+        if ((err = snd_pcm_mmap_begin(out->pcm, &areas, &offset, &size)) < 0) {
+            if ((err = xrun_recovery(out, err)) < 0) return err;
+            continue;
+        }
+
+        // 交织格式只有一块连续区域
+        out->mmap_offset = offset;
+        out->mmap_frames = size;
+        *buf = (unsigned char *)areas[0].addr + areas[0].first / 8 + offset * (areas[0].step / 8);
+        *frames = size;
+        return 0;
+    }
+}
+
+int alsa_output_commit(alsa_output_t *out, snd_pcm_uframes_t frames) {
+    if (frames == 0) return 0;
+
+    if (!out->mmap) {
+        unsigned char *p = out->bounce;
+        snd_pcm_uframes_t total = frames;
+        while (frames > 0) {
+            snd_pcm_sframes_t n = snd_pcm_writei(out->pcm, p, frames);
+            if (n < 0) {
+                int err = xrun_recovery(out, (int)n);
+                if (err < 0) return err;
+                continue;
+            }
+            p += n * out->frame_bytes;
+            frames -= n;
+        }
+        return (int)total;
+    }
+
+    snd_pcm_sframes_t res = snd_pcm_mmap_commit(out->pcm, out->mmap_offset, frames);
+    out->mmap_frames = 0;
+    if (res < 0 || (snd_pcm_uframes_t)res != frames) {
+        // 恢复成功时只有已提交的部分算数
+        int err = xrun_recovery(out, res >= 0 ? -EPIPE : (int)res);
+        if (err < 0) return err;
+        return res > 0 ? (int)res : 0;
+    }
+    return (int)frames;
+}
+
+int alsa_output_write(alsa_output_t *out, const void *data, snd_pcm_uframes_t frames) {
+    const unsigned char *src = data;
+    int err;
+
+    while (frames > 0) {
+        void *dst;
+        snd_pcm_uframes_t n = frames;
+        if ((err = alsa_output_begin(out, &dst, &n)) < 0) return err;
+        memcpy(dst, src, n * out->frame_bytes);
+        if ((err = alsa_output_commit(out, n)) < 0) return err;
+        // 没提交的部分下一轮重写
+        src += (size_t)err * out->frame_bytes;
+        frames -= (snd_pcm_uframes_t)err;
+    }
+    return 0;
+}
+
+int alsa_output_pause(alsa_output_t *out, int enable) {
+    snd_pcm_state_t state = snd_pcm_state(out->pcm);
+
+    if (enable) {
+        if (state != SND_PCM_STATE_RUNNING) return 0;
+        if (out->can_pause && snd_pcm_pause(out->pcm, 1) == 0) return 0;
+        // 不支持暂停: 丢弃已缓冲的数据，恢复时重新 prepare
+        return snd_pcm_drop(out->pcm);
+    }
+
+    if (state == SND_PCM_STATE_PAUSED) return snd_pcm_pause(out->pcm, 0);
+    if (state == SND_PCM_STATE_SETUP) return snd_pcm_prepare(out->pcm);
+    return 0;
+}
+
+int alsa_output_drain(alsa_output_t *out) {
+    int err = snd_pcm_drain(out->pcm);
+    if (err < 0) {
+        fprintf(stderr, "[WARN] snd_pcm_drain failed: %s\n", snd_strerror(err));
+    }
+    // drain 之后回到 SETUP 状态，prepare 后可以继续写入
+    snd_pcm_prepare(out->pcm);
+    return err;
+}
+
+snd_pcm_uframes_t alsa_output_buffer_size(alsa_output_t *out) {
+    return out->buffer_size;
+}
+
+snd_pcm_uframes_t alsa_output_period_size(alsa_output_t *out) {
+    return out->period_size;
+}
+
+int alsa_probe_open(alsa_probe_t *probe, const char *device) {
+    int err;
+
+    memset(probe, 0, sizeof(*probe));
+    // 非阻塞打开，设备被占用时立即返回
+    if ((err = snd_pcm_open(&probe->pcm, device, SND_PCM_STREAM_PLAYBACK, SND_PCM_NONBLOCK)) < 0) {
+        fprintf(stderr, "[WARN] Cannot probe '%s': %s\n", device, snd_strerror(err));
+        probe->pcm = NULL;
+        return err;
+    }
+    if ((err = snd_pcm_hw_params_malloc(&probe->hw)) < 0 ||
+        (err = snd_pcm_hw_params_any(probe->pcm, probe->hw)) < 0) {
+        alsa_probe_close(probe);
+        return err;
+    }
+    return 0;
+}
+
+void alsa_probe_close(alsa_probe_t *probe) {
+    if (probe->hw) {
+        snd_pcm_hw_params_free(probe->hw);
+        probe->hw = NULL;
+    }
+    if (probe->pcm) {
+        snd_pcm_close(probe->pcm);
+        probe->pcm = NULL;
+    }
+}
+
+int alsa_probe_format(alsa_probe_t *probe, snd_pcm_format_t format) {
+    return snd_pcm_hw_params_test_format(probe->pcm, probe->hw, format) == 0;
+}
+
+int alsa_probe_rate(alsa_probe_t *probe, unsigned int rate) {
+    return snd_pcm_hw_params_test_rate(probe->pcm, probe->hw, rate, 0) == 0;
+}
+
+int alsa_probe_channels(alsa_probe_t *probe, int channels) {
+    return snd_pcm_hw_params_test_channels(probe->pcm, probe->hw, channels) == 0;
+}
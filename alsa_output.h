@@ -0,0 +1,78 @@
+#ifndef ALSA_OUTPUT_H
+#define ALSA_OUTPUT_H
+
+#include <stddef.h>
+#include <alsa/asoundlib.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ALSA PCM 输出: 优先使用 mmap 访问，解码器可以直接写入声卡硬件缓冲区；
+// 设备不支持 mmap 时退回 snd_pcm_writei，接口不变
+typedef struct {
+    snd_pcm_t *pcm;
+    snd_pcm_format_t format;
+    unsigned int rate;
+    int channels;
+    size_t frame_bytes;                 // 每帧字节数(所有声道)
+    snd_pcm_uframes_t buffer_size;      // 硬件缓冲区大小(帧)
+    snd_pcm_uframes_t period_size;      // 周期大小(帧)
+    int mmap;                           // 是否使用 mmap 访问
+    int can_pause;                      // 硬件是否支持 snd_pcm_pause
+    // 当前 mmap 区域(alsa_output_begin 与 alsa_output_commit 之间有效)
+    snd_pcm_uframes_t mmap_offset;
+    snd_pcm_uframes_t mmap_frames;
+    // 非 mmap 模式下的中转缓冲区，大小为一个周期
+    unsigned char *bounce;
+} alsa_output_t;
+
+// 打开设备并配置硬件参数，buffer_time/period_time 单位为微秒，0 表示使用设备默认值
+int alsa_output_open(alsa_output_t *out, const char *device, snd_pcm_format_t format,
+                     unsigned int rate, int channels,
+                     unsigned int buffer_time, unsigned int period_time);
+
+void alsa_output_close(alsa_output_t *out);
+
+// 获取一块可直接写入的输出区域，最多 *frames 帧(0 表示不限)，返回时 *frames 为实际可写帧数；
+// 需要时会阻塞等待声卡腾出空间，并处理 xrun
+int alsa_output_begin(alsa_output_t *out, void **buf, snd_pcm_uframes_t *frames);
+
+// 提交 alsa_output_begin 返回的区域中实际写入的帧数，返回真正提交的帧数，
+// xrun 恢复后可能少于 frames；恢复失败返回负的错误码
+int alsa_output_commit(alsa_output_t *out, snd_pcm_uframes_t frames);
+
+// 拷贝写入，内部使用 begin/commit
+int alsa_output_write(alsa_output_t *out, const void *data, snd_pcm_uframes_t frames);
+
+// 暂停/恢复输出，硬件不支持暂停时丢弃缓冲数据
+int alsa_output_pause(alsa_output_t *out, int enable);
+
+// 播放完缓冲区中剩余数据
+int alsa_output_drain(alsa_output_t *out);
+
+snd_pcm_uframes_t alsa_output_buffer_size(alsa_output_t *out);
+
+snd_pcm_uframes_t alsa_output_period_size(alsa_output_t *out);
+
+// 设备能力探测: 在完整的硬件参数空间上逐项测试格式/采样率/声道是否原生支持
+typedef struct {
+    snd_pcm_t *pcm;
+    snd_pcm_hw_params_t *hw;
+} alsa_probe_t;
+
+int alsa_probe_open(alsa_probe_t *probe, const char *device);
+
+void alsa_probe_close(alsa_probe_t *probe);
+
+int alsa_probe_format(alsa_probe_t *probe, snd_pcm_format_t format);
+
+int alsa_probe_rate(alsa_probe_t *probe, unsigned int rate);
+
+int alsa_probe_channels(alsa_probe_t *probe, int channels);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // ALSA_OUTPUT_H
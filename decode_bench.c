@@ -0,0 +1,482 @@
+// 解码吞吐量测试: 用两个后端的解码路径把本地文件解码到空输出，尽可能快地跑完，不需要声卡和网络。
+// mpg123 与 mpg123 后端相同(mpg123_open + mpg123_read，-f 时走网络流使用的 feed 模式)；
+// gstreamer 使用 playbin，音频输出换成 sync=false 的 fakesink。
+// 每个文件、每个后端在单独的子进程中运行，峰值 RSS 互不影响；malloc 在本程序中被替换以统计分配次数。
+// 结果以 JSON 输出: 每次运行的实时倍数、每秒音频的 CPU 时间、峰值 RSS、分配次数，
+// 以及按后端、格式和平均码率汇总的结果
+// 编译: gcc -O2 -o decode_bench decode_bench.c
+//       $(pkg-config --cflags --libs gstreamer-1.0 libmpg123 glib-2.0)
+// 示例: ./decode_bench -r 3 ~/corpus
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+#include <errno.h>
+#include <stdatomic.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+#include <glib.h>
+#include <gst/gst.h>
+#include <mpg123.h>
+
+#define GST_PLAY_FLAG_AUDIO (1 << 1)
+#define DECODE_BUFFER (64 * 1024)
+#define FEED_CHUNK (16 * 1024)      // 和网络流每次送入解码器的数据量相当
+
+typedef enum {
+    BACKEND_MPG123,
+    BACKEND_GSTREAMER,
+    BACKEND_COUNT
+} backend_id_t;
+
+static const char *const backend_names[BACKEND_COUNT] = { "mpg123", "gstreamer" };
+
+// 子进程通过管道交回的结果
+typedef struct {
+    int ok;
+    char codec[64];             // 解码器报告的编码
+    double audio_sec;
+    double wall_sec;
+    double cpu_sec;
+    long max_rss_kb;
+    unsigned long allocs;
+    char error[128];
+} run_result_t;
+
+typedef struct {
+    backend_id_t backend;
+    gchar *format;              // 扩展名
+    int kbps;
+    int files;
+    double audio_sec, wall_sec, cpu_sec;
+    long max_rss_kb;
+    unsigned long allocs;
+} group_t;
+
+static int repeats = 1;
+static int feed_mode = 0;
+static int enabled[BACKEND_COUNT] = { 1, 1 };
+
+// 分配计数: 覆盖 glibc 的 malloc 入口，所有共享库(GLib、GStreamer 插件、mpg123)的分配都经过这里
+#ifdef __GLIBC__
+extern void *__libc_malloc(size_t);
+extern void *__libc_calloc(size_t, size_t);
+extern void *__libc_realloc(void *, size_t);
+extern void *__libc_memalign(size_t, size_t);
+
+static atomic_ulong alloc_count = 0;
+
+void *malloc(size_t size) {
+    atomic_fetch_add_explicit(&alloc_count, 1, memory_order_relaxed);
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t n, size_t size) {
+    atomic_fetch_add_explicit(&alloc_count, 1, memory_order_relaxed);
+    return __libc_calloc(n, size);
+}
+
+void *realloc(void *ptr, size_t size) {
+    atomic_fetch_add_explicit(&alloc_count, 1, memory_order_relaxed);
+    return __libc_realloc(ptr, size);
+}
+
+int posix_memalign(void **ptr, size_t alignment, size_t size) {
+    atomic_fetch_add_explicit(&alloc_count, 1, memory_order_relaxed);
+    *ptr = __libc_memalign(alignment, size);
+    return *ptr ? 0 : ENOMEM;
+}
+
+static unsigned long allocs_now(void) {
+    return atomic_load_explicit(&alloc_count, memory_order_relaxed);
+}
+#else
+static unsigned long allocs_now(void) {
+    return 0;
+}
+#endif
+
+static double wall_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// 进程内所有线程(包括 GStreamer 的流线程)的用户态和内核态时间
+static double cpu_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int decode_mpg123(const char *path, run_result_t *r) {
+    int err;
+    if (mpg123_init() != MPG123_OK) {
+        snprintf(r->error, sizeof(r->error), "mpg123_init failed");
+        return -1;
+    }
+    mpg123_handle *mh = mpg123_new(NULL, &err);
+    if (!mh) {
+        snprintf(r->error, sizeof(r->error), "%s", mpg123_plain_strerror(err));
+        return -1;
+    }
+
+    unsigned char *buf = g_malloc(DECODE_BUFFER);
+    unsigned char *in = g_malloc(FEED_CHUNK);
+    int fd = -1;
+    long rate = 0;
+    int channels = 0, encoding = 0;
+    off_t samples = 0;
+    int ret = -1;
+
+    double wall = wall_now();
+    double cpu = cpu_now();
+    unsigned long allocs = allocs_now();
+
+    if (feed_mode) {
+        // 网络流的路径: 文件内容分块送入解码器，解码器要数据时再读
+        mpg123_param(mh, MPG123_ADD_FLAGS, MPG123_FUZZY, 0.0);
+        mpg123_open_feed(mh);
+        fd = open(path, O_RDONLY);
+        if (fd < 0) {
+            snprintf(r->error, sizeof(r->error), "%s", strerror(errno));
+            goto out;
+        }
+    } else if (mpg123_open(mh, path) != MPG123_OK) {
+        snprintf(r->error, sizeof(r->error), "%s", mpg123_strerror(mh));
+        goto out;
+    }
+
+    for (;;) {
+        size_t done = 0;
+        err = mpg123_read(mh, buf, DECODE_BUFFER, &done);
+        if (done && channels) {
+            samples += done / (channels * mpg123_encsize(encoding));
+        }
+        if (err == MPG123_NEW_FORMAT) {
+            mpg123_getformat(mh, &rate, &channels, &encoding);
+        } else if (err == MPG123_NEED_MORE && feed_mode) {
+            ssize_t n = read(fd, in, FEED_CHUNK);
+            if (n <= 0) break;
+            if (mpg123_feed(mh, in, n) != MPG123_OK) {
+                snprintf(r->error, sizeof(r->error), "%s", mpg123_strerror(mh));
+                goto out;
+            }
+        } else if (err == MPG123_DONE) {
+            break;
+        } else if (err != MPG123_OK) {
+            snprintf(r->error, sizeof(r->error), "%s", mpg123_strerror(mh));
+            goto out;
+        }
+    }
+
+    r->wall_sec = wall_now() - wall;
+    r->cpu_sec = cpu_now() - cpu;
+    r->allocs = allocs_now() - allocs;
+    if (!rate || !samples) {
+        snprintf(r->error, sizeof(r->error), "no audio decoded");
+        goto out;
+    }
+    r->audio_sec = (double)samples / rate;
+
+    struct mpg123_frameinfo info;
+    if (mpg123_info(mh, &info) == MPG123_OK) {
+        static const char *const versions[] = { "MPEG-1", "MPEG-2", "MPEG-2.5" };
+        snprintf(r->codec, sizeof(r->codec), "%s Layer %d",
+                 info.version <= MPG123_2_5 ? versions[info.version] : "MPEG", info.layer);
+    }
+    ret = 0;
+
+out:
+    if (fd >= 0) close(fd);
+    mpg123_close(mh);
+    mpg123_delete(mh);
+    g_free(in);
+    g_free(buf);
+    return ret;
+}
+
+static int decode_gstreamer(const char *path, run_result_t *r) {
+    GError *error = NULL;
+    gst_init(NULL, NULL);
+
+    gchar *uri = gst_filename_to_uri(path, &error);
+    if (!uri) {
+        snprintf(r->error, sizeof(r->error), "%s", error->message);
+        g_error_free(error);
+        return -1;
+    }
+
+    // 和 GStreamer 后端相同的 playbin，只是输出不受时钟约束
+    GstElement *pipeline = gst_element_factory_make("playbin", "bench");
+    GstElement *audio_sink = gst_element_factory_make("fakesink", NULL);
+    if (!pipeline || !audio_sink) {
+        snprintf(r->error, sizeof(r->error), "playbin or fakesink missing");
+        g_free(uri);
+        return -1;
+    }
+    g_object_set(audio_sink, "sync", FALSE, NULL);
+    g_object_set(pipeline, "uri", uri, "audio-sink", audio_sink, "flags", GST_PLAY_FLAG_AUDIO, NULL);
+    g_free(uri);
+
+    GstBus *bus = gst_element_get_bus(pipeline);
+    int ret = -1;
+
+    double wall = wall_now();
+    double cpu = cpu_now();
+    unsigned long allocs = allocs_now();
+
+    gst_element_set_state(pipeline, GST_STATE_PLAYING);
+    for (;;) {
+        GstMessage *msg = gst_bus_timed_pop_filtered(bus, GST_CLOCK_TIME_NONE,
+            GST_MESSAGE_EOS | GST_MESSAGE_ERROR | GST_MESSAGE_TAG);
+        if (GST_MESSAGE_TYPE(msg) == GST_MESSAGE_TAG) {
+            GstTagList *tags = NULL;
+            gchar *codec = NULL;
+            gst_message_parse_tag(msg, &tags);
+            if (!r->codec[0] && gst_tag_list_get_string(tags, GST_TAG_AUDIO_CODEC, &codec)) {
+                snprintf(r->codec, sizeof(r->codec), "%s", codec);
+                g_free(codec);
+            }
+            gst_tag_list_unref(tags);
+        } else if (GST_MESSAGE_TYPE(msg) == GST_MESSAGE_ERROR) {
+            gchar *debug = NULL;
+            gst_message_parse_error(msg, &error, &debug);
+            snprintf(r->error, sizeof(r->error), "%s", error->message);
+            g_error_free(error);
+            g_free(debug);
+            gst_message_unref(msg);
+            break;
+        } else {
+            // EOS 时播放位置就是音频长度
+            gint64 pos = -1;
+            if (!gst_element_query_position(pipeline, GST_FORMAT_TIME, &pos) || pos <= 0) {
+                gst_element_query_duration(pipeline, GST_FORMAT_TIME, &pos);
+            }
+            r->wall_sec = wall_now() - wall;
+            r->cpu_sec = cpu_now() - cpu;
+            r->allocs = allocs_now() - allocs;
+            r->audio_sec = pos > 0 ? (double)pos / GST_SECOND : 0;
+            ret = r->audio_sec > 0 ? 0 : -1;
+            if (ret) snprintf(r->error, sizeof(r->error), "unknown audio length");
+            gst_message_unref(msg);
+            break;
+        }
+        gst_message_unref(msg);
+    }
+
+    gst_element_set_state(pipeline, GST_STATE_NULL);
+    gst_object_unref(bus);
+    gst_object_unref(pipeline);
+    return ret;
+}
+
+// 在子进程中解码一次；库只在子进程中初始化，父进程的 RSS 和分配不会混进来
+static int run_isolated(backend_id_t backend, const char *path, run_result_t *r) {
+    int fds[2];
+    memset(r, 0, sizeof(*r));
+    if (pipe(fds) != 0) {
+        snprintf(r->error, sizeof(r->error), "pipe: %s", strerror(errno));
+        return -1;
+    }
+
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid < 0) {
+        snprintf(r->error, sizeof(r->error), "fork: %s", strerror(errno));
+        close(fds[0]);
+        close(fds[1]);
+        return -1;
+    }
+    if (pid == 0) {
+        close(fds[0]);
+        int ret = backend == BACKEND_MPG123 ? decode_mpg123(path, r) : decode_gstreamer(path, r);
+        struct rusage usage;
+        getrusage(RUSAGE_SELF, &usage);
+        r->max_rss_kb = usage.ru_maxrss;
+        r->ok = (ret == 0);
+        if (write(fds[1], r, sizeof(*r)) != (ssize_t)sizeof(*r)) _exit(EXIT_FAILURE);
+        _exit(EXIT_SUCCESS);
+    }
+
+    close(fds[1]);
+    ssize_t n = read(fds[0], r, sizeof(*r));
+    close(fds[0]);
+    int status = 0;
+    waitpid(pid, &status, 0);
+    if (n != (ssize_t)sizeof(*r)) {
+        memset(r, 0, sizeof(*r));
+        snprintf(r->error, sizeof(r->error), "decoder process died (status %d)", status);
+        return -1;
+    }
+    return r->ok ? 0 : -1;
+}
+
+static gchar* file_format(const char *path) {
+    const char *dot = strrchr(path, '.');
+    const char *slash = strrchr(path, '/');
+    if (!dot || (slash && dot < slash)) return g_strdup("unknown");
+    return g_ascii_strdown(dot + 1, -1);
+}
+
+static void json_string(const char *s) {
+    putchar('"');
+    for (; *s; s++) {
+        if (*s == '"' || *s == '\\') printf("\\%c", *s);
+        else if ((unsigned char)*s < 0x20) printf("\\u%04x", *s);
+        else putchar(*s);
+    }
+    putchar('"');
+}
+
+static void print_metrics(double audio, double wall, double cpu, long rss, unsigned long allocs) {
+    printf("\"audio_sec\": %.3f, \"x_realtime\": %.1f, \"cpu_ms_per_audio_sec\": %.3f, "
+           "\"peak_rss_kb\": %ld, \"allocs\": %lu, \"allocs_per_audio_sec\": %.1f",
+           audio, wall > 0 ? audio / wall : 0.0, audio > 0 ? cpu * 1000 / audio : 0.0,
+           rss, allocs, audio > 0 ? allocs / audio : 0.0);
+}
+
+static group_t* find_group(GPtrArray *groups, backend_id_t backend, const char *format, int kbps) {
+    for (guint i = 0; i < groups->len; i++) {
+        group_t *g = g_ptr_array_index(groups, i);
+        if (g->backend == backend && g->kbps == kbps && strcmp(g->format, format) == 0) return g;
+    }
+    group_t *g = g_new0(group_t, 1);
+    g->backend = backend;
+    g->format = g_strdup(format);
+    g->kbps = kbps;
+    g_ptr_array_add(groups, g);
+    return g;
+}
+
+static void group_free(gpointer data) {
+    group_t *g = data;
+    g_free(g->format);
+    g_free(g);
+}
+
+// 每个文件的每个后端运行 repeats 次，取最快的一次
+static void bench_file(const char *path, GPtrArray *groups, int *first) {
+    struct stat st;
+    if (stat(path, &st) != 0 || !S_ISREG(st.st_mode)) return;
+    gchar *format = file_format(path);
+
+    for (int b = 0; b < BACKEND_COUNT; b++) {
+        if (!enabled[b]) continue;
+        run_result_t best = { 0 }, r;
+        for (int i = 0; i < repeats; i++) {
+            if (run_isolated((backend_id_t)b, path, &r) != 0) break;
+            if (!best.ok || r.wall_sec < best.wall_sec) best = r;
+        }
+
+        printf("%s    { \"file\": ", *first ? "" : ",\n");
+        json_string(path);
+        printf(", \"backend\": \"%s\", ", backend_names[b]);
+        *first = 0;
+        if (!best.ok) {
+            // mpg123 打不开的格式属于正常情况，只记录不汇总
+            printf("\"error\": ");
+            json_string(r.error);
+            printf(" }");
+            fprintf(stderr, "%s [%s]: %s\n", path, backend_names[b], r.error);
+            continue;
+        }
+
+        // 两个后端按同一个平均码率分组，结果可以直接对比
+        int kbps = (int)(st.st_size * 8 / best.audio_sec / 1000 + 0.5);
+        printf("\"format\": ");
+        json_string(format);
+        printf(", \"codec\": ");
+        json_string(best.codec);
+        printf(", \"kbps\": %d, ", kbps);
+        print_metrics(best.audio_sec, best.wall_sec, best.cpu_sec, best.max_rss_kb, best.allocs);
+        printf(" }");
+        fprintf(stderr, "%s [%s]: %.1fx realtime\n", path, backend_names[b],
+                best.audio_sec / best.wall_sec);
+
+        group_t *g = find_group(groups, (backend_id_t)b, format, kbps);
+        g->files++;
+        g->audio_sec += best.audio_sec;
+        g->wall_sec += best.wall_sec;
+        g->cpu_sec += best.cpu_sec;
+        g->allocs += best.allocs;
+        if (best.max_rss_kb > g->max_rss_kb) g->max_rss_kb = best.max_rss_kb;
+    }
+    g_free(format);
+}
+
+static gint compare_names(gconstpointer a, gconstpointer b) {
+    return strcmp(*(const gchar *const *)a, *(const gchar *const *)b);
+}
+
+static void bench_path(const char *path, GPtrArray *groups, int *first) {
+    GDir *dir = g_dir_open(path, 0, NULL);
+    if (!dir) {
+        bench_file(path, groups, first);
+        return;
+    }
+
+    // 按名字排序，两次运行的输出可以直接 diff
+    GPtrArray *names = g_ptr_array_new_with_free_func(g_free);
+    const gchar *name;
+    while ((name = g_dir_read_name(dir))) {
+        g_ptr_array_add(names, g_build_filename(path, name, NULL));
+    }
+    g_dir_close(dir);
+    g_ptr_array_sort(names, compare_names);
+    for (guint i = 0; i < names->len; i++) {
+        bench_path(g_ptr_array_index(names, i), groups, first);
+    }
+    g_ptr_array_free(names, TRUE);
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr,
+            "Usage: %s [-b mpg123|gstreamer|all] [-r repeats] [-f] FILE|DIR...\n"
+            "  -f  decode MP3 through mpg123 feed mode, as network streams do\n", prog);
+}
+
+int main(int argc, char *argv[]) {
+    int opt;
+    while ((opt = getopt(argc, argv, "b:r:fh")) != -1) {
+        switch (opt) {
+            case 'b':
+                enabled[BACKEND_MPG123] = !strcmp(optarg, "all") || !strcmp(optarg, "mpg123");
+                enabled[BACKEND_GSTREAMER] = !strcmp(optarg, "all") || !strcmp(optarg, "gstreamer");
+                break;
+            case 'r': repeats = atoi(optarg); break;
+            case 'f': feed_mode = 1; break;
+            default:
+                usage(argv[0]);
+                return opt == 'h' ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+    }
+    if (optind >= argc || repeats <= 0 || (!enabled[BACKEND_MPG123] && !enabled[BACKEND_GSTREAMER])) {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    GPtrArray *groups = g_ptr_array_new_with_free_func(group_free);
+    int first = 1;
+
+    printf("{\n  \"repeats\": %d,\n  \"mpg123_feed\": %s,\n  \"runs\": [\n", repeats, feed_mode ? "true" : "false");
+    for (int i = optind; i < argc; i++) {
+        bench_path(argv[i], groups, &first);
+    }
+    printf("\n  ],\n  \"groups\": [\n");
+    for (guint i = 0; i < groups->len; i++) {
+        group_t *g = g_ptr_array_index(groups, i);
+        printf("%s    { \"backend\": \"%s\", \"format\": ", i ? ",\n" : "", backend_names[g->backend]);
+        json_string(g->format);
+        printf(", \"kbps\": %d, \"files\": %d, ", g->kbps, g->files);
+        print_metrics(g->audio_sec, g->wall_sec, g->cpu_sec, g->max_rss_kb, g->allocs);
+        printf(" }");
+    }
+    printf("\n  ]\n}\n");
+
+    g_ptr_array_free(groups, TRUE);
+    return EXIT_SUCCESS;
+}
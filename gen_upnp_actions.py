@@ -0,0 +1,405 @@
+#!/usr/bin/env python3
+# 根据 service/*.xml(SCPD)生成动作分发表和参数结构体: upnp_actions.h / upnp_actions.c
+#
+#   python3 gen_upnp_actions.py [service 目录] [输出前缀]
+#
+# - 每个动作一个参数结构体，字段类型按 SCPD dataType 转换
+# - 每个动作一个处理函数声明 handle_<服务>_<动作>，由设备实现；SCPD 中新增的动作没有实现时链接失败
+# - 动作查找用完美哈希表，请求 DOM 只遍历一次取出全部参数，并按 allowedValueList/allowedValueRange 校验
+# 修改 SCPD 后重新运行并提交生成的文件
+
+import os
+import sys
+import xml.etree.ElementTree as ET
+
+NS = '{urn:schemas-upnp-org:service-1-0}'
+SERVICES = ['AVTransport', 'RenderingControl', 'ConnectionManager']
+
+# SCPD dataType -> (参数类型枚举, C 类型)
+TYPES = {
+    'string':  ('UPNP_ARG_STRING', 'const char *'),
+    'ui4':     ('UPNP_ARG_UI4', 'uint32_t '),
+    'i4':      ('UPNP_ARG_I4', 'int32_t '),
+    'ui2':     ('UPNP_ARG_UI2', 'uint16_t '),
+    'i2':      ('UPNP_ARG_I2', 'int16_t '),
+    'boolean': ('UPNP_ARG_BOOLEAN', 'int '),
+}
+
+# 没有 allowedValueRange 时按类型限制范围
+TYPE_RANGE = {
+    'ui4': (0, 4294967295), 'i4': (-2147483648, 2147483647),
+    'ui2': (0, 65535), 'i2': (-32768, 32767),
+}
+
+TABLE_SIZE = 64
+
+
+def text(elem, tag):
+    child = elem.find(NS + tag)
+    return child.text.strip() if child is not None and child.text else None
+
+
+def parse_scpd(service, path):
+    root = ET.parse(path).getroot()
+    variables = {}
+    for sv in root.iter(NS + 'stateVariable'):
+        var = {'type': text(sv, 'dataType'), 'allowed': None, 'range': None}
+        values = sv.find(NS + 'allowedValueList')
+        if values is not None:
+            var['allowed'] = [v.text.strip() for v in values.findall(NS + 'allowedValue')]
+        rng = sv.find(NS + 'allowedValueRange')
+        if rng is not None:
+            var['range'] = (int(text(rng, 'minimum')), int(text(rng, 'maximum')))
+        variables[text(sv, 'name')] = var
+
+    actions = []
+    for action in root.iter(NS + 'action'):
+        args = []
+        for arg in action.iter(NS + 'argument'):
+            if text(arg, 'direction') != 'in':
+                continue
+            var = variables[text(arg, 'relatedStateVariable')]
+            if var['type'] not in TYPES:
+                sys.exit('%s: unsupported dataType %s' % (path, var['type']))
+            args.append(dict(var, name=text(arg, 'name')))
+        actions.append({'service': service, 'name': text(action, 'name'), 'args': args})
+    return actions
+
+
+def fnv1a(seed, service_index, name):
+    h = (2166136261 ^ seed) & 0xffffffff
+    for c in bytes([service_index]) + name.encode():
+        h ^= c
+        h = (h * 16777619) & 0xffffffff
+    # 乘法只把低位扩散到高位，取模前把高位折回来
+    return h ^ (h >> 16)
+
+
+def find_seed(actions):
+    for seed in range(1 << 20):
+        slots = set()
+        for a in actions:
+            slot = fnv1a(seed, SERVICES.index(a['service']), a['name']) % TABLE_SIZE
+            if slot in slots:
+                break
+            slots.add(slot)
+        else:
+            return seed
+    sys.exit('no perfect hash seed found, enlarge TABLE_SIZE')
+
+
+def ident(a):
+    return '%s_%s' % (a['service'], a['name'])
+
+
+def c_string(s):
+    return '"%s"' % s.replace('\\', '\\\\').replace('"', '\\"')
+
+
+HEADER_PROLOGUE = '''\
+// 由 gen_upnp_actions.py 根据 service/*.xml 生成，不要手工修改
+#ifndef UPNP_ACTIONS_H
+#define UPNP_ACTIONS_H
+
+#include <stdint.h>
+#include <upnp/upnp.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+'''
+
+HEADER_EPILOGUE = '''\
+// 按 ServiceID/ActionName 查表，一次遍历取出并校验参数后调用处理函数。
+// 未知服务/动作、参数缺失或不合法时设置错误响应，返回 UPNP_E_SUCCESS。
+// cookie 原样传给处理函数(注册设备时的 cookie，用来区分同一进程中的多个设备)
+int upnp_dispatch_action(struct Upnp_Action_Request *request, void *cookie);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // UPNP_ACTIONS_H
+'''
+
+RUNTIME = r'''
+typedef enum {
+    UPNP_ARG_STRING = 0,
+    UPNP_ARG_UI4,
+    UPNP_ARG_I4,
+    UPNP_ARG_UI2,
+    UPNP_ARG_I2,
+    UPNP_ARG_BOOLEAN
+} upnp_arg_type_t;
+
+typedef struct {
+    const char *name;
+    upnp_arg_type_t type;
+    size_t offset;
+    const char *const *allowed;     // NULL 结尾，NULL 表示不限
+    long long min, max;             // 数值类型的取值范围
+} upnp_arg_desc_t;
+
+typedef struct {
+    int service;
+    const char *name;
+    const upnp_arg_desc_t *args;
+    int nargs;
+    int (*call)(void *cookie, struct Upnp_Action_Request *request, const void *args);
+} upnp_action_desc_t;
+
+static int action_error(struct Upnp_Action_Request *request, int code, const char *msg, const char *arg) {
+    UpnpActionRequest_set_ErrCode(request, code);
+    if (arg) {
+        snprintf(request->ErrStr, sizeof(request->ErrStr), "%s: %s", msg, arg);
+    } else {
+        snprintf(request->ErrStr, sizeof(request->ErrStr), "%s", msg);
+    }
+    LOG_ERROR("Action %s error [%d]: %s", request->ActionName, code, request->ErrStr);
+    return UPNP_E_SUCCESS;
+}
+
+// 参数错误，设置错误响应后返回-1
+static int arg_error(struct Upnp_Action_Request *request, int code, const char *msg, const char *arg) {
+    action_error(request, code, msg, arg);
+    return -1;
+}
+
+static uint32_t action_hash(uint32_t seed, int service, const char *name) {
+    uint32_t h = 2166136261u ^ seed;
+    h ^= (unsigned char)service;
+    h *= 16777619u;
+    for (const unsigned char *p = (const unsigned char *)name; *p; p++) {
+        h ^= *p;
+        h *= 16777619u;
+    }
+    return h ^ (h >> 16);
+}
+
+static int lookup_service(const char *service_id) {
+    for (int i = 0; i < UPNP_SERVICE_COUNT; i++) {
+        if (strcmp(service_id, service_ids[i]) == 0) return i;
+    }
+    return -1;
+}
+
+static const char* local_name(const char *name) {
+    const char *colon = strchr(name, ':');
+    return colon ? colon + 1 : name;
+}
+
+static int parse_bool(const char *s, int *out) {
+    if (strcmp(s, "1") == 0 || g_ascii_strcasecmp(s, "true") == 0 || g_ascii_strcasecmp(s, "yes") == 0) {
+        *out = 1;
+        return 0;
+    }
+    if (strcmp(s, "0") == 0 || g_ascii_strcasecmp(s, "false") == 0 || g_ascii_strcasecmp(s, "no") == 0) {
+        *out = 0;
+        return 0;
+    }
+    return -1;
+}
+
+// 遍历一次动作元素的子节点取出参数，再逐个转换和校验
+static int parse_args(struct Upnp_Action_Request *request, const upnp_action_desc_t *desc, void *args) {
+    const char *raw[UPNP_MAX_ARGS] = { NULL };
+    IXML_Node *action = ixmlNode_getFirstChild((IXML_Node *)request->ActionRequest);
+    while (action && ixmlNode_getNodeType(action) != eELEMENT_NODE) {
+        action = ixmlNode_getNextSibling(action);
+    }
+
+    for (IXML_Node *node = action ? ixmlNode_getFirstChild(action) : NULL; node;
+         node = ixmlNode_getNextSibling(node)) {
+        if (ixmlNode_getNodeType(node) != eELEMENT_NODE) continue;
+        const char *name = local_name(ixmlNode_getNodeName(node));
+        for (int i = 0; i < desc->nargs; i++) {
+            if (!raw[i] && strcmp(name, desc->args[i].name) == 0) {
+                IXML_Node *value = ixmlNode_getFirstChild(node);
+                raw[i] = value ? ixmlNode_getNodeValue(value) : "";
+                break;
+            }
+        }
+    }
+
+    for (int i = 0; i < desc->nargs; i++) {
+        const upnp_arg_desc_t *arg = &desc->args[i];
+        char *field = (char *)args + arg->offset;
+        const char *s = raw[i];
+
+        // UPnP 动作的输入参数都是必需的；元素存在但内容为空时按空串处理
+        if (!s) return arg_error(request, 402, "Invalid args", arg->name);
+        if (arg->type == UPNP_ARG_STRING) {
+            if (arg->allowed) {
+                const char *const *v = arg->allowed;
+                while (*v && strcmp(*v, s) != 0) v++;
+                if (!*v) return arg_error(request, 600, "Argument value invalid", arg->name);
+            }
+            *(const char **)field = s;
+            continue;
+        }
+
+        if (arg->type == UPNP_ARG_BOOLEAN) {
+            if (parse_bool(s, (int *)field) != 0) {
+                return arg_error(request, 600, "Argument value invalid", arg->name);
+            }
+            continue;
+        }
+
+        char *end = NULL;
+        long long v = strtoll(s, &end, 10);
+        if (end == s || *end != '\0') {
+            return arg_error(request, 600, "Argument value invalid", arg->name);
+        }
+        if (v < arg->min || v > arg->max) {
+            return arg_error(request, 601, "Argument value out of range", arg->name);
+        }
+        switch (arg->type) {
+            case UPNP_ARG_UI4: *(uint32_t *)field = (uint32_t)v; break;
+            case UPNP_ARG_I4:  *(int32_t *)field = (int32_t)v; break;
+            case UPNP_ARG_UI2: *(uint16_t *)field = (uint16_t)v; break;
+            case UPNP_ARG_I2:  *(int16_t *)field = (int16_t)v; break;
+            default: break;
+        }
+    }
+    return 0;
+}
+
+int upnp_dispatch_action(struct Upnp_Action_Request *request, void *cookie) {
+    int service = lookup_service(request->ServiceID);
+    if (service < 0) {
+        return action_error(request, 401, "Invalid action", request->ServiceID);
+    }
+
+    const upnp_action_desc_t *desc =
+        action_table[action_hash(ACTION_HASH_SEED, service, request->ActionName) % ACTION_TABLE_SIZE];
+    if (!desc || desc->service != service || strcmp(desc->name, request->ActionName) != 0) {
+        return action_error(request, 401, "Invalid action", request->ActionName);
+    }
+
+    union upnp_action_args args;
+    memset(&args, 0, sizeof(args));
+    if (parse_args(request, desc, &args) != 0) {
+        return UPNP_E_SUCCESS;
+    }
+    return desc->call(cookie, request, &args);
+}
+'''
+
+
+def generate(actions, seed):
+    h = [HEADER_PROLOGUE]
+    h.append('typedef enum {\n')
+    for s in SERVICES:
+        h.append('    UPNP_SERVICE_%s,\n' % s.upper())
+    h.append('    UPNP_SERVICE_COUNT\n} upnp_service_t;\n\n')
+
+    for a in actions:
+        if not a['args']:
+            continue
+        h.append('typedef struct {\n')
+        for arg in a['args']:
+            comment = ''
+            if arg['allowed']:
+                comment = '  // %s' % ' | '.join(arg['allowed'])
+            elif arg['range']:
+                comment = '  // %d ~ %d' % arg['range']
+            h.append('    %s%s;%s\n' % (TYPES[arg['type']][1], arg['name'], comment))
+        h.append('} %s_args_t;\n\n' % ident(a))
+
+    h.append('// 动作处理函数，由设备实现。调用时参数已按 SCPD 校验，字符串指向请求 DOM，只在本次调用内有效\n')
+    for a in actions:
+        if a['args']:
+            h.append('int handle_%s(void *cookie, struct Upnp_Action_Request *request, const %s_args_t *args);\n'
+                     % (ident(a), ident(a)))
+        else:
+            h.append('int handle_%s(void *cookie, struct Upnp_Action_Request *request);\n' % ident(a))
+    h.append('\n')
+    h.append(HEADER_EPILOGUE)
+
+    c = ['// 由 gen_upnp_actions.py 根据 service/*.xml 生成，不要手工修改\n',
+         '#include "upnp_actions.h"\n',
+         '#include "player.h"\n',
+         '#include <stddef.h>\n',
+         '#include <stdio.h>\n',
+         '#include <stdlib.h>\n',
+         '#include <string.h>\n',
+         '#include <glib.h>\n',
+         '#include <upnp/ixml.h>\n\n']
+    c.append('#define ACTION_TABLE_SIZE %d\n' % TABLE_SIZE)
+    c.append('#define ACTION_HASH_SEED %du\n' % seed)
+    c.append('#define UPNP_MAX_ARGS %d\n\n' % max(len(a['args']) for a in actions))
+
+    c.append('static const char *const service_ids[UPNP_SERVICE_COUNT] = {\n')
+    for s in SERVICES:
+        c.append('    "urn:upnp-org:serviceId:%s",\n' % s)
+    c.append('};\n\n')
+
+    c.append('union upnp_action_args {\n')
+    for a in actions:
+        if a['args']:
+            c.append('    %s_args_t %s;\n' % (ident(a), ident(a)))
+    c.append('};\n')
+    c.append(RUNTIME.split('static int action_error')[0])
+
+    for a in actions:
+        for arg in a['args']:
+            if arg['allowed']:
+                c.append('static const char *const allowed_%s_%s[] = { %s, NULL };\n'
+                         % (ident(a), arg['name'], ', '.join(c_string(v) for v in arg['allowed'])))
+    c.append('\n')
+
+    for a in actions:
+        if a['args']:
+            c.append('static const upnp_arg_desc_t args_%s[] = {\n' % ident(a))
+            for arg in a['args']:
+                lo, hi = arg['range'] or TYPE_RANGE.get(arg['type'], (0, 0))
+                allowed = 'allowed_%s_%s' % (ident(a), arg['name']) if arg['allowed'] else 'NULL'
+                c.append('    { "%s", %s, offsetof(%s_args_t, %s), %s, %dLL, %dLL },\n'
+                         % (arg['name'], TYPES[arg['type']][0], ident(a), arg['name'], allowed, lo, hi))
+            c.append('};\n\n')
+
+    for a in actions:
+        c.append('static int call_%s(void *cookie, struct Upnp_Action_Request *request, const void *args) {\n' % ident(a))
+        if a['args']:
+            c.append('    return handle_%s(cookie, request, args);\n' % ident(a))
+        else:
+            c.append('    (void)args;\n    return handle_%s(cookie, request);\n' % ident(a))
+        c.append('}\n\n')
+
+    for a in actions:
+        args = 'args_%s' % ident(a) if a['args'] else 'NULL'
+        c.append('static const upnp_action_desc_t desc_%s = {\n' % ident(a))
+        c.append('    UPNP_SERVICE_%s, "%s", %s, %d, call_%s\n};\n'
+                 % (a['service'].upper(), a['name'], args, len(a['args']), ident(a)))
+    c.append('\n')
+
+    slots = {}
+    for a in actions:
+        slots[fnv1a(seed, SERVICES.index(a['service']), a['name']) % TABLE_SIZE] = a
+    c.append('// 完美哈希表，由生成器选取的种子保证没有冲突\n')
+    c.append('static const upnp_action_desc_t *const action_table[ACTION_TABLE_SIZE] = {\n')
+    for i in sorted(slots):
+        c.append('    [%d] = &desc_%s,\n' % (i, ident(slots[i])))
+    c.append('};\n')
+    c.append('\nstatic int action_error' + RUNTIME.split('static int action_error', 1)[1])
+    return ''.join(h), ''.join(c)
+
+
+def main():
+    service_dir = sys.argv[1] if len(sys.argv) > 1 else 'service'
+    prefix = sys.argv[2] if len(sys.argv) > 2 else 'upnp_actions'
+    actions = []
+    for s in SERVICES:
+        actions += parse_scpd(s, os.path.join(service_dir, s + '.xml'))
+    seed = find_seed(actions)
+    header, source = generate(actions, seed)
+    with open(prefix + '.h', 'w') as f:
+        f.write(header)
+    with open(prefix + '.c', 'w') as f:
+        f.write(source)
+    print('%d actions, hash seed %d' % (len(actions), seed))
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,251 @@
+#include "http_engine.h"
+#include <glib.h>
+#include <glib-unix.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+
+#define HTTP_MAX_CONNECTS 8          // 连接池大小
+#define HTTP_CONNECT_TIMEOUT 10L     // 秒
+
+struct http_transfer {
+    CURL *easy;
+    struct curl_slist *headers;
+    http_done_cb done_cb;
+    void *userdata;
+    atomic_int refcount;
+    int added;          // 已加入 multi 句柄(只在主循环线程访问)
+    int finished;       // 已回调 done(只在主循环线程访问)
+};
+
+// 每个 socket 对应一个主循环 fd 源
+typedef struct {
+    curl_socket_t fd;
+    guint source_id;
+} http_socket_t;
+
+static CURLM *multi = NULL;
+static CURLSH *share = NULL;
+static GMutex share_locks[CURL_LOCK_DATA_LAST];    // 每类共享数据一把锁
+static guint timer_id = 0;
+
+static void finish_transfer(http_transfer_t *t, CURLcode result) {
+    if (t->finished) return;
+    t->finished = 1;
+    if (t->added) {
+        curl_multi_remove_handle(multi, t->easy);
+        t->added = 0;
+    }
+    if (t->done_cb) {
+        t->done_cb(t, result, t->userdata);
+    }
+    http_transfer_unref(t);  // multi 持有的引用
+}
+
+static void check_completed(void) {
+    CURLMsg *msg;
+    int left;
+    while ((msg = curl_multi_info_read(multi, &left)) != NULL) {
+        if (msg->msg != CURLMSG_DONE) continue;
+        http_transfer_t *t = NULL;
+        curl_easy_getinfo(msg->easy_handle, CURLINFO_PRIVATE, (char **)&t);
+        if (t) finish_transfer(t, msg->data.result);
+    }
+}
+
+static gboolean on_socket_ready(gint fd, GIOCondition cond, gpointer data) {
+    (void)data;
+    int running = 0;
+    int action = 0;
+    if (cond & (G_IO_IN | G_IO_PRI)) action |= CURL_CSELECT_IN;
+    if (cond & G_IO_OUT) action |= CURL_CSELECT_OUT;
+    if (cond & (G_IO_ERR | G_IO_HUP | G_IO_NVAL)) action |= CURL_CSELECT_ERR;
+    curl_multi_socket_action(multi, fd, action, &running);
+    check_completed();
+    return G_SOURCE_CONTINUE;
+}
+
+// curl 告诉我们需要关注哪些 socket 事件
+static int socket_callback(CURL *easy, curl_socket_t s, int what, void *userp, void *socketp) {
+    (void)easy; (void)userp;
+    http_socket_t *sock = socketp;
+
+    if (what == CURL_POLL_REMOVE) {
+        if (sock) {
+            if (sock->source_id) g_source_remove(sock->source_id);
+            g_free(sock);
+            curl_multi_assign(multi, s, NULL);
+        }
+        return 0;
+    }
+
+    if (!sock) {
+        sock = g_new0(http_socket_t, 1);
+        sock->fd = s;
+        curl_multi_assign(multi, s, sock);
+    } else if (sock->source_id) {
+        g_source_remove(sock->source_id);
+    }
+    GIOCondition cond = G_IO_ERR | G_IO_HUP;
+    if (what & CURL_POLL_IN) cond |= G_IO_IN | G_IO_PRI;
+    if (what & CURL_POLL_OUT) cond |= G_IO_OUT;
+    sock->source_id = g_unix_fd_add(s, cond, on_socket_ready, NULL);
+    return 0;
+}
+
+static gboolean on_timeout(gpointer data) {
+    (void)data;
+    int running = 0;
+    timer_id = 0;
+    curl_multi_socket_action(multi, CURL_SOCKET_TIMEOUT, 0, &running);
+    check_completed();
+    return G_SOURCE_REMOVE;
+}
+
+static int timer_callback(CURLM *m, long timeout_ms, void *userp) {
+    (void)m; (void)userp;
+    if (timer_id) {
+        g_source_remove(timer_id);
+        timer_id = 0;
+    }
+    if (timeout_ms >= 0) {
+        timer_id = g_timeout_add((guint)timeout_ms, on_timeout, NULL);
+    }
+    return 0;
+}
+
+// 共享句柄的使用者不只在主循环线程: 播放器执行线程可能释放最后一个引用(curl_easy_cleanup)
+static void share_lock(CURL *easy, curl_lock_data data, curl_lock_access access, void *userp) {
+    (void)easy; (void)access; (void)userp;
+    g_mutex_lock(&share_locks[data]);
+}
+
+static void share_unlock(CURL *easy, curl_lock_data data, void *userp) {
+    (void)easy; (void)userp;
+    g_mutex_unlock(&share_locks[data]);
+}
+
+int http_engine_init(void) {
+    if (multi) return 0;
+    if (curl_global_init(CURL_GLOBAL_DEFAULT) != CURLE_OK) {
+        fprintf(stderr, "curl_global_init failed\n");
+        return -1;
+    }
+
+    // 连接由唯一的 multi 句柄复用，这里只共享 DNS 和 TLS 会话缓存；
+    // 传输可能在其他线程中释放，需要加锁
+    share = curl_share_init();
+    curl_share_setopt(share, CURLSHOPT_LOCKFUNC, share_lock);
+    curl_share_setopt(share, CURLSHOPT_UNLOCKFUNC, share_unlock);
+    curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+    curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+
+    multi = curl_multi_init();
+    curl_multi_setopt(multi, CURLMOPT_SOCKETFUNCTION, socket_callback);
+    curl_multi_setopt(multi, CURLMOPT_TIMERFUNCTION, timer_callback);
+    curl_multi_setopt(multi, CURLMOPT_MAXCONNECTS, (long)HTTP_MAX_CONNECTS);
+    curl_multi_setopt(multi, CURLMOPT_PIPELINING, (long)CURLPIPE_MULTIPLEX);
+    return 0;
+}
+
+void http_engine_deinit(void) {
+    if (!multi) return;
+    if (timer_id) {
+        g_source_remove(timer_id);
+        timer_id = 0;
+    }
+    curl_multi_cleanup(multi);
+    multi = NULL;
+    curl_share_cleanup(share);
+    share = NULL;
+    curl_global_cleanup();
+}
+
+http_transfer_t* http_transfer_new(const char *url) {
+    http_transfer_t *t = g_new0(http_transfer_t, 1);
+    t->easy = curl_easy_init();
+    if (!t->easy) {
+        g_free(t);
+        return NULL;
+    }
+    atomic_init(&t->refcount, 1);
+    curl_easy_setopt(t->easy, CURLOPT_URL, url);
+    curl_easy_setopt(t->easy, CURLOPT_PRIVATE, t);
+    curl_easy_setopt(t->easy, CURLOPT_SHARE, share);
+    curl_easy_setopt(t->easy, CURLOPT_FOLLOWLOCATION, 1L);
+    curl_easy_setopt(t->easy, CURLOPT_TCP_KEEPALIVE, 1L);
+    curl_easy_setopt(t->easy, CURLOPT_CONNECTTIMEOUT, HTTP_CONNECT_TIMEOUT);
+    curl_easy_setopt(t->easy, CURLOPT_NOSIGNAL, 1L);
+    return t;
+}
+
+CURL* http_transfer_easy(http_transfer_t *t) {
+    return t->easy;
+}
+
+void http_transfer_set_headers(http_transfer_t *t, struct curl_slist *list) {
+    curl_slist_free_all(t->headers);
+    t->headers = list;
+    curl_easy_setopt(t->easy, CURLOPT_HTTPHEADER, list);
+}
+
+void http_transfer_ref(http_transfer_t *t) {
+    atomic_fetch_add(&t->refcount, 1);
+}
+
+void http_transfer_unref(http_transfer_t *t) {
+    if (!t || atomic_fetch_sub(&t->refcount, 1) != 1) return;
+    curl_easy_cleanup(t->easy);
+    curl_slist_free_all(t->headers);
+    g_free(t);
+}
+
+// 以下在主循环线程中执行；主循环没有运行时 g_main_context_invoke 直接在调用线程执行
+static gboolean do_start(gpointer data) {
+    http_transfer_t *t = data;
+    if (t->finished) return G_SOURCE_REMOVE;  // 还没开始就被取消
+    CURLMcode rc = curl_multi_add_handle(multi, t->easy);
+    if (rc != CURLM_OK) {
+        fprintf(stderr, "curl_multi_add_handle failed: %s\n", curl_multi_strerror(rc));
+        finish_transfer(t, CURLE_FAILED_INIT);
+    } else {
+        t->added = 1;
+    }
+    return G_SOURCE_REMOVE;
+}
+
+static gboolean do_cancel(gpointer data) {
+    http_transfer_t *t = data;
+    finish_transfer(t, CURLE_ABORTED_BY_CALLBACK);
+    http_transfer_unref(t);
+    return G_SOURCE_REMOVE;
+}
+
+static gboolean do_resume(gpointer data) {
+    http_transfer_t *t = data;
+    if (!t->finished) {
+        // 恢复时 curl 可能直接调用写回调
+        curl_easy_pause(t->easy, CURLPAUSE_CONT);
+        check_completed();
+    }
+    http_transfer_unref(t);
+    return G_SOURCE_REMOVE;
+}
+
+void http_transfer_start(http_transfer_t *t, http_done_cb cb, void *userdata) {
+    t->done_cb = cb;
+    t->userdata = userdata;
+    http_transfer_ref(t);  // multi 持有，finish_transfer 中释放
+    g_main_context_invoke(NULL, do_start, t);
+}
+
+void http_transfer_cancel(http_transfer_t *t) {
+    http_transfer_ref(t);
+    g_main_context_invoke(NULL, do_cancel, t);
+}
+
+void http_transfer_resume(http_transfer_t *t) {
+    http_transfer_ref(t);
+    g_main_context_invoke(NULL, do_resume, t);
+}
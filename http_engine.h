@@ -0,0 +1,49 @@
+#ifndef HTTP_ENGINE_H
+#define HTTP_ENGINE_H
+
+#include <curl/curl.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// HTTP 下载引擎: 一个 curl_multi 句柄挂在 GLib 默认主循环上，所有传输共享
+// 连接池、DNS 缓存和 TLS 会话(CURLSH)，连续播放同一服务器的曲目不必重新握手；
+// 多个传输并发进行，不需要每个传输一个线程。
+// curl 的回调都在主循环线程中执行，不能阻塞；其余接口可以在任意线程调用
+typedef struct http_transfer http_transfer_t;
+
+// 传输结束(完成、出错或取消)时在主循环线程中回调，之后不会再有该传输的回调
+typedef void (*http_done_cb)(http_transfer_t *t, CURLcode result, void *userdata);
+
+int http_engine_init(void);
+
+void http_engine_deinit(void);
+
+// 创建传输，返回的 easy 句柄已设置好共享、keep-alive 和重定向，
+// 调用者再设置 WRITEFUNCTION 等选项；引用计数为1
+http_transfer_t* http_transfer_new(const char *url);
+
+CURL* http_transfer_easy(http_transfer_t *t);
+
+// 附加请求头，传输持有 list，结束时释放
+void http_transfer_set_headers(http_transfer_t *t, struct curl_slist *list);
+
+// 加入 multi 句柄开始传输
+void http_transfer_start(http_transfer_t *t, http_done_cb cb, void *userdata);
+
+// 取消传输，done 回调的 result 为 CURLE_ABORTED_BY_CALLBACK
+void http_transfer_cancel(http_transfer_t *t);
+
+// 写回调返回 CURL_WRITEFUNC_PAUSE 暂停后，由消费者调用恢复
+void http_transfer_resume(http_transfer_t *t);
+
+void http_transfer_ref(http_transfer_t *t);
+
+void http_transfer_unref(http_transfer_t *t);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // HTTP_ENGINE_H
@@ -0,0 +1,455 @@
+#include "media_cache.h"
+#include "player.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/stat.h>
+
+#define INDEX_NAME "index"
+#define INDEX_TMP_NAME "index.tmp"
+#define INDEX_VERSION "media-cache 2"
+
+typedef struct {
+    gchar *key;             // URL 的 SHA1，同时是文件名
+    gchar *url;
+    gchar *etag;
+    gchar *last_modified;
+    gint64 size;
+    gint64 last_used;       // 最近一次播放(秒)
+    gint64 validated;       // 最近一次确认有效(秒)
+} cache_item_t;
+
+struct media_cache_writer {
+    gchar *key;
+    gchar *url;
+    gchar *etag;
+    gchar *last_modified;
+    gchar *part_path;
+    int fd;
+    gint64 length;          // 服务器给出的长度，-1 未知
+    gint64 written;
+};
+
+typedef struct {
+    const char* dir;        // 缓存目录，未设置时不启用缓存
+    int size_mb;            // 容量上限(MB)
+    int max_age;            // 多少秒内不需要重新校验
+} CacheOptions;
+
+static CacheOptions g_cache_options = {
+    .dir = NULL,
+    .size_mb = 1024,
+    .max_age = 24 * 3600
+};
+
+static GOptionEntry cache_option_entries[] = {
+    { "cache-dir", 0, 0, G_OPTION_ARG_STRING, &g_cache_options.dir,
+      "Cache network media in this directory (default: disabled)", "DIR" },
+    { "cache-size", 0, 0, G_OPTION_ARG_INT, &g_cache_options.size_mb,
+      "Media cache size limit in MB (default: 1024)", "MB" },
+    { "cache-max-age", 0, 0, G_OPTION_ARG_INT, &g_cache_options.max_age,
+      "Play cached media without revalidation for this many seconds (default: 86400)", "SEC" },
+    { NULL }
+};
+
+static GMutex cache_lock;
+static GHashTable *items = NULL;    // url -> cache_item_t
+static gint64 total_size = 0;
+static gint64 max_size = 0;
+static int index_dirty = 0;         // 只有 LRU 时间变化，退出时再写
+
+GOptionGroup* media_cache_get_option_group(void) {
+    GOptionGroup *group = g_option_group_new(
+        "cache",
+        "Media Cache Options",
+        "Show media cache options",
+        NULL,
+        NULL
+    );
+
+    g_option_group_add_entries(group, cache_option_entries);
+    return group;
+}
+
+static gint64 now_sec(void) {
+    return (gint64)time(NULL);
+}
+
+static gchar* item_path(const char *key, const char *suffix) {
+    gchar *name = g_strconcat(key, suffix, NULL);
+    gchar *path = g_build_filename(g_cache_options.dir, name, NULL);
+    g_free(name);
+    return path;
+}
+
+static void item_free(gpointer data) {
+    cache_item_t *item = data;
+    g_free(item->key);
+    g_free(item->url);
+    g_free(item->etag);
+    g_free(item->last_modified);
+    g_free(item);
+}
+
+// 索引中的字段用 \t 分隔，空字段表示没有；ETag 和 URL 来自服务器/控制点，
+// 可能含有 \t 或换行，写入前按 C 字符串转义，读出时还原
+static gchar* field_escape(const char *s) {
+    return g_strescape(s ? s : "", NULL);
+}
+
+// 来自网络的原始值，原样保存
+static gchar* field_or_null(const char *s) {
+    return (s && *s) ? g_strdup(s) : NULL;
+}
+
+// 从索引读出的字段: 还原转义，空字段表示没有
+static gchar* index_field_or_null(const char *s) {
+    return (s && *s) ? g_strcompress(s) : NULL;
+}
+
+// rename 只有在目录项落盘之后才算完成，否则掉电后可能还是旧索引或者没有索引
+static int sync_dir(const char *dir) {
+    int fd = open(dir, O_RDONLY | O_DIRECTORY);
+    if (fd < 0) return -1;
+    int ret = fsync(fd);
+    close(fd);
+    return ret;
+}
+
+// 写临时文件、fsync 后 rename 替换旧索引，任何时刻磁盘上都是一份完整的索引
+static int save_index_locked(void) {
+    gchar *tmp = g_build_filename(g_cache_options.dir, INDEX_TMP_NAME, NULL);
+    gchar *path = g_build_filename(g_cache_options.dir, INDEX_NAME, NULL);
+    int ret = -1;
+    FILE *fp = fopen(tmp, "w");
+
+    if (!fp) {
+        LOG_ERROR("Cannot write cache index %s: %s", tmp, strerror(errno));
+        goto out;
+    }
+    fprintf(fp, "%s\n", INDEX_VERSION);
+
+    GHashTableIter it;
+    gpointer value;
+    g_hash_table_iter_init(&it, items);
+    while (g_hash_table_iter_next(&it, NULL, &value)) {
+        cache_item_t *item = value;
+        gchar *etag = field_escape(item->etag);
+        gchar *last_modified = field_escape(item->last_modified);
+        gchar *url = field_escape(item->url);
+        fprintf(fp, "%s\t%" G_GINT64_FORMAT "\t%" G_GINT64_FORMAT "\t%" G_GINT64_FORMAT "\t%s\t%s\t%s\n",
+                item->key, item->size, item->last_used, item->validated,
+                etag, last_modified, url);
+        g_free(etag);
+        g_free(last_modified);
+        g_free(url);
+    }
+    if (fflush(fp) != 0 || fsync(fileno(fp)) != 0) {
+        LOG_ERROR("Cannot flush cache index: %s", strerror(errno));
+        fclose(fp);
+        unlink(tmp);
+        goto out;
+    }
+    fclose(fp);
+    if (rename(tmp, path) != 0) {
+        LOG_ERROR("Cannot replace cache index: %s", strerror(errno));
+        unlink(tmp);
+        goto out;
+    }
+    if (sync_dir(g_cache_options.dir) != 0) {
+        LOG_ERROR("Cannot sync cache directory: %s", strerror(errno));
+    }
+    index_dirty = 0;
+    ret = 0;
+out:
+    g_free(tmp);
+    g_free(path);
+    return ret;
+}
+
+static void remove_item_locked(cache_item_t *item) {
+    gchar *path = item_path(item->key, ".data");
+    unlink(path);
+    g_free(path);
+    total_size -= item->size;
+    g_hash_table_remove(items, item->url);
+}
+
+// 淘汰最久未使用的条目，直到能放下 need 字节
+static void evict_locked(gint64 need) {
+    while (total_size + need > max_size && g_hash_table_size(items) > 0) {
+        cache_item_t *oldest = NULL;
+        GHashTableIter it;
+        gpointer value;
+        g_hash_table_iter_init(&it, items);
+        while (g_hash_table_iter_next(&it, NULL, &value)) {
+            cache_item_t *item = value;
+            if (!oldest || item->last_used < oldest->last_used) oldest = item;
+        }
+        LOG_DEBUG("Cache evict %s (%" G_GINT64_FORMAT " bytes)", oldest->url, oldest->size);
+        remove_item_locked(oldest);
+    }
+}
+
+// 载入索引，丢弃数据文件缺失或大小不符的条目
+static void load_index_locked(void) {
+    gchar *path = g_build_filename(g_cache_options.dir, INDEX_NAME, NULL);
+    gchar *contents = NULL;
+
+    if (g_file_get_contents(path, &contents, NULL, NULL)) {
+        gchar **lines = g_strsplit(contents, "\n", -1);
+        if (lines[0] && strcmp(lines[0], INDEX_VERSION) == 0) {
+            for (int i = 1; lines[i]; i++) {
+                gchar **f = g_strsplit(lines[i], "\t", 7);
+                if (g_strv_length(f) == 7) {
+                    struct stat st;
+                    gchar *data = item_path(f[0], ".data");
+                    gint64 size = g_ascii_strtoll(f[1], NULL, 10);
+                    if (stat(data, &st) == 0 && st.st_size == size) {
+                        cache_item_t *item = g_new0(cache_item_t, 1);
+                        item->key = g_strdup(f[0]);
+                        item->size = size;
+                        item->last_used = g_ascii_strtoll(f[2], NULL, 10);
+                        item->validated = g_ascii_strtoll(f[3], NULL, 10);
+                        item->etag = index_field_or_null(f[4]);
+                        item->last_modified = index_field_or_null(f[5]);
+                        item->url = g_strcompress(f[6]);
+                        g_hash_table_replace(items, item->url, item);
+                        total_size += size;
+                    } else {
+                        index_dirty = 1;
+                    }
+                    g_free(data);
+                }
+                g_strfreev(f);
+            }
+        }
+        g_strfreev(lines);
+        g_free(contents);
+    }
+    g_free(path);
+}
+
+// 删除上次没写完的 .part 和索引里没有的数据文件
+static void remove_orphans_locked(void) {
+    GHashTable *keys = g_hash_table_new(g_str_hash, g_str_equal);
+    GHashTableIter it;
+    gpointer value;
+    g_hash_table_iter_init(&it, items);
+    while (g_hash_table_iter_next(&it, NULL, &value)) {
+        g_hash_table_add(keys, ((cache_item_t *)value)->key);
+    }
+
+    DIR *dir = opendir(g_cache_options.dir);
+    struct dirent *de;
+    while (dir && (de = readdir(dir)) != NULL) {
+        const char *dot = strrchr(de->d_name, '.');
+        if (!dot) continue;
+        int orphan = strcmp(dot, ".part") == 0 || strcmp(de->d_name, INDEX_TMP_NAME) == 0;
+        if (!orphan && strcmp(dot, ".data") == 0) {
+            gchar *key = g_strndup(de->d_name, dot - de->d_name);
+            orphan = !g_hash_table_contains(keys, key);
+            g_free(key);
+        }
+        if (orphan) {
+            gchar *path = g_build_filename(g_cache_options.dir, de->d_name, NULL);
+            unlink(path);
+            g_free(path);
+        }
+    }
+    if (dir) closedir(dir);
+    g_hash_table_unref(keys);
+}
+
+int media_cache_init(void) {
+    if (!g_cache_options.dir || !*g_cache_options.dir) {
+        return 0;
+    }
+    if (g_mkdir_with_parents(g_cache_options.dir, 0755) != 0) {
+        LOG_ERROR("Cannot create cache directory %s: %s", g_cache_options.dir, strerror(errno));
+        g_cache_options.dir = NULL;
+        return -1;
+    }
+
+    g_mutex_lock(&cache_lock);
+    items = g_hash_table_new_full(g_str_hash, g_str_equal, NULL, item_free);
+    total_size = 0;
+    max_size = (gint64)g_cache_options.size_mb * 1024 * 1024;
+    load_index_locked();
+    remove_orphans_locked();
+    evict_locked(0);
+    if (index_dirty) save_index_locked();
+    LOG_INFO("Media cache: %s, %u entries, %" G_GINT64_FORMAT " / %" G_GINT64_FORMAT " MB",
+             g_cache_options.dir, g_hash_table_size(items), total_size >> 20, max_size >> 20);
+    g_mutex_unlock(&cache_lock);
+    return 0;
+}
+
+void media_cache_deinit(void) {
+    if (!items) return;
+    g_mutex_lock(&cache_lock);
+    if (index_dirty) save_index_locked();
+    g_hash_table_destroy(items);
+    items = NULL;
+    g_mutex_unlock(&cache_lock);
+}
+
+int media_cache_enabled(void) {
+    return items != NULL;
+}
+
+int media_cache_lookup(const char *url, media_cache_entry_t *entry) {
+    int ret = -1;
+    memset(entry, 0, sizeof(*entry));
+    if (!items) return -1;
+
+    g_mutex_lock(&cache_lock);
+    cache_item_t *item = g_hash_table_lookup(items, url);
+    if (item) {
+        gint64 now = now_sec();
+        item->last_used = now;
+        index_dirty = 1;
+        entry->path = item_path(item->key, ".data");
+        entry->etag = g_strdup(item->etag);
+        entry->last_modified = g_strdup(item->last_modified);
+        entry->size = item->size;
+        entry->fresh = now - item->validated < g_cache_options.max_age;
+        ret = 0;
+    }
+    g_mutex_unlock(&cache_lock);
+    return ret;
+}
+
+void media_cache_entry_clear(media_cache_entry_t *entry) {
+    g_free(entry->path);
+    g_free(entry->etag);
+    g_free(entry->last_modified);
+    memset(entry, 0, sizeof(*entry));
+}
+
+void media_cache_revalidated(const char *url) {
+    if (!items) return;
+    g_mutex_lock(&cache_lock);
+    cache_item_t *item = g_hash_table_lookup(items, url);
+    if (item) {
+        item->validated = now_sec();
+        save_index_locked();
+    }
+    g_mutex_unlock(&cache_lock);
+}
+
+media_cache_writer_t* media_cache_begin(const char *url, const char *etag,
+                                        const char *last_modified, gint64 length) {
+    if (!items || !url) return NULL;
+    if (length > max_size) {
+        LOG_DEBUG("Not caching %s: %" G_GINT64_FORMAT " bytes exceeds cache size", url, length);
+        return NULL;
+    }
+
+    media_cache_writer_t *w = g_new0(media_cache_writer_t, 1);
+    w->key = g_compute_checksum_for_string(G_CHECKSUM_SHA1, url, -1);
+    w->url = g_strdup(url);
+    w->etag = field_or_null(etag);
+    w->last_modified = field_or_null(last_modified);
+    w->length = length;
+    // 同一个 URL 可能同时在写(例如 seek 后重新开始)，.part 名字加上指针避免冲突
+    gchar *suffix = g_strdup_printf(".%p.part", (void *)w);
+    w->part_path = item_path(w->key, suffix);
+    g_free(suffix);
+    w->fd = open(w->part_path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (w->fd < 0) {
+        LOG_ERROR("Cannot create cache file %s: %s", w->part_path, strerror(errno));
+        media_cache_abort(w);
+        return NULL;
+    }
+    return w;
+}
+
+int media_cache_write(media_cache_writer_t *w, const void *data, size_t len) {
+    const char *p = data;
+    if (!w || w->fd < 0) return -1;
+    if (w->written + (gint64)len > max_size) {
+        LOG_DEBUG("Cache entry for %s exceeds cache size, dropping", w->url);
+        close(w->fd);
+        w->fd = -1;
+        return -1;
+    }
+    while (len > 0) {
+        ssize_t n = write(w->fd, p, len);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            LOG_ERROR("Cache write failed: %s", strerror(errno));
+            close(w->fd);
+            w->fd = -1;
+            return -1;
+        }
+        p += n;
+        len -= n;
+        w->written += n;
+    }
+    return 0;
+}
+
+int media_cache_commit(media_cache_writer_t *w) {
+    int ret = -1;
+    if (!w) return -1;
+    if (w->fd < 0 || (w->length >= 0 && w->written != w->length) || w->written == 0) {
+        media_cache_abort(w);
+        return -1;
+    }
+    // 先把数据落盘再改名，索引里出现的条目一定是完整的
+    if (fsync(w->fd) != 0) {
+        media_cache_abort(w);
+        return -1;
+    }
+    close(w->fd);
+    w->fd = -1;
+
+    g_mutex_lock(&cache_lock);
+    if (items) {
+        cache_item_t *old = g_hash_table_lookup(items, w->url);
+        if (old) remove_item_locked(old);
+        evict_locked(w->written);
+
+        gchar *path = item_path(w->key, ".data");
+        if (rename(w->part_path, path) == 0) {
+            cache_item_t *item = g_new0(cache_item_t, 1);
+            item->key = w->key;
+            item->url = w->url;
+            item->etag = w->etag;
+            item->last_modified = w->last_modified;
+            item->size = w->written;
+            item->last_used = item->validated = now_sec();
+            w->key = w->url = w->etag = w->last_modified = NULL;
+            g_hash_table_replace(items, item->url, item);
+            total_size += item->size;
+            save_index_locked();
+            LOG_INFO("Cached %s (%" G_GINT64_FORMAT " bytes)", item->url, item->size);
+            ret = 0;
+        } else {
+            LOG_ERROR("Cannot rename cache file: %s", strerror(errno));
+        }
+        g_free(path);
+    }
+    g_mutex_unlock(&cache_lock);
+
+    media_cache_abort(w);
+    return ret;
+}
+
+void media_cache_abort(media_cache_writer_t *w) {
+    if (!w) return;
+    if (w->fd >= 0) close(w->fd);
+    if (w->part_path) unlink(w->part_path);
+    g_free(w->part_path);
+    g_free(w->key);
+    g_free(w->url);
+    g_free(w->etag);
+    g_free(w->last_modified);
+    g_free(w);
+}
@@ -0,0 +1,59 @@
+#ifndef MEDIA_CACHE_H
+#define MEDIA_CACHE_H
+
+#include <stddef.h>
+#include <glib.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// 网络媒体磁盘缓存: 以 URL 为键，保存 ETag/Last-Modified 校验信息，
+// 超出容量时按最近最少使用淘汰。数据先写到 .part 文件，完整后再改名登记；
+// 索引写临时文件后 rename 替换，进程崩溃不会留下损坏或不完整的条目
+typedef struct {
+    gchar *path;            // 缓存文件路径
+    gchar *etag;            // 可能为 NULL
+    gchar *last_modified;   // 可能为 NULL
+    gint64 size;
+    int fresh;              // 在 --cache-max-age 之内校验过，可以不经网络直接使用
+} media_cache_entry_t;
+
+typedef struct media_cache_writer media_cache_writer_t;
+
+// 缓存相关命令行选项(--cache-dir 等)
+GOptionGroup* media_cache_get_option_group(void);
+
+// 按命令行选项初始化，未指定缓存目录时缓存关闭，返回0
+int media_cache_init(void);
+
+void media_cache_deinit(void);
+
+int media_cache_enabled(void);
+
+// 查找完整的缓存条目，命中返回0并填充 entry(用 media_cache_entry_clear 释放)
+int media_cache_lookup(const char *url, media_cache_entry_t *entry);
+
+void media_cache_entry_clear(media_cache_entry_t *entry);
+
+// 服务器确认缓存仍然有效(304 或校验信息一致)，刷新校验时间
+void media_cache_revalidated(const char *url);
+
+// 开始写入新条目，length 为 -1 表示长度未知；缓存关闭或空间不够时返回 NULL
+media_cache_writer_t* media_cache_begin(const char *url, const char *etag,
+                                        const char *last_modified, gint64 length);
+
+// 追加数据，超出容量或写入失败时返回-1，之后只能 abort
+int media_cache_write(media_cache_writer_t *w, const void *data, size_t len);
+
+// 数据完整，登记到索引(必要时淘汰旧条目)
+int media_cache_commit(media_cache_writer_t *w);
+
+// 放弃写入(下载出错、中途 seek 等)
+void media_cache_abort(media_cache_writer_t *w);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MEDIA_CACHE_H
@@ -1,396 +1,1137 @@
-#include "player.h"
+#include "player_backend.h"
 #include <mpg123.h>
-#include <ao/ao.h>
 #include <pthread.h>
 #include <string.h>
 #include <unistd.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdatomic.h>
 #include <curl/curl.h>
+#include "ring_buffer.h"
+#include "alsa_output.h"
+#include "soft_volume.h"
+#include "media_cache.h"
+#include "http_engine.h"
 
-static mpg123_handle *mh = NULL;
-static ao_device *dev = NULL;
-static pthread_t play_thread;
-static volatile int playing = 0, paused = 0, stop_flag = 0;
-static long rate;
-static int channels, encoding;
-static off_t current_sample = 0, total_sample = 0;
-
-static snd_mixer_t *mixer_handle = NULL;
-static snd_mixer_elem_t *mixer_elem = NULL;
-static const char *mixer_name = "Master";  // 默认控制主音量
-static long int volume_min = 0;
-static long int volume_max = 100;
-static int current_volume = 50;  // 默认音量50%
-static unsigned char *g_decode_buffer;
-static size_t g_decode_buffer_size;
-
-int init_output_device() {
-
-    ao_sample_format format;
-    format.bits = mpg123_encsize(encoding) * 8;
-    format.rate = rate;
-    format.channels = channels;
-    format.byte_format = AO_FMT_NATIVE;
-    format.matrix = NULL;
-
-    ao_info **driver_info_list;
-    int driver_count = 0;
-    int alsa_driver = -1;
-    int default_driver = -1;
-
-    driver_info_list = ao_driver_info_list(&driver_count);
-    if (!driver_info_list) {
-        fprintf(stderr, "Failed to get AO driver info list.\n");
-        return -1;
+// 等待队列: 暂停、缓冲区空/满时线程阻塞在条件变量上，不做轮询
+// waiters 计数让唤醒方在没有人等待时跳过加锁，环形缓冲区的快速路径保持无锁
+typedef struct {
+    pthread_cond_t cond;
+    atomic_int waiters;
+} wait_queue_t;
+
+typedef struct {
+    const char* device;     // ALSA PCM 设备
+    int buffer_time;        // 硬件缓冲时间(微秒)
+    int period_time;        // 周期时间(微秒)
+    const char* sample_format; // 解码输出格式: auto/s16/s24/s32/float
+    int stream_buffer_kb;   // 网络流环形缓冲区大小(KB)
+    int low_watermark_kb;   // 低于此水位视为欠载，暂停解码重新缓冲(KB)
+    int high_watermark_kb;  // 开始/恢复解码前需要缓冲的数据量(KB)
+    gboolean soft_volume;   // 即使有硬件混音器也使用软件音量
+    gboolean dither;        // 软件音量对整数格式加 TPDF 抖动
+} PlayerOptions;
+
+// 命令行选项，所有实例共用；device/buffer_time 由公共选项(--device、--buffer-time)覆盖
+static PlayerOptions g_player_options = {
+    .device = "default",
+    .buffer_time = 200000,
+    .period_time = 10000,
+    .sample_format = "auto",
+    .stream_buffer_kb = 512,
+    .low_watermark_kb = 8,
+    .high_watermark_kb = 64,
+    .soft_volume = FALSE,
+    .dither = FALSE
+};
+
+static GOptionEntry player_option_entries[] = {
+    { "period-time", 'P', 0, G_OPTION_ARG_INT, &g_player_options.period_time,
+      "mpg123: ALSA period time in microseconds (default: 10000)", "TIME" },
+    { "sample-format", 'f', 0, G_OPTION_ARG_STRING, &g_player_options.sample_format,
+      "mpg123: Decoder output format: auto, s16, s24, s32, float (default: auto)", "FORMAT" },
+    { "stream-buffer", 0, 0, G_OPTION_ARG_INT, &g_player_options.stream_buffer_kb,
+      "mpg123: Network stream ring buffer size in KB (default: 512)", "KB" },
+    { "low-watermark", 0, 0, G_OPTION_ARG_INT, &g_player_options.low_watermark_kb,
+      "mpg123: Rebuffer when the stream buffer drops below this many KB (default: 8)", "KB" },
+    { "high-watermark", 0, 0, G_OPTION_ARG_INT, &g_player_options.high_watermark_kb,
+      "mpg123: Start decoding once this many KB are buffered (default: 64)", "KB" },
+    { "soft-volume", 0, 0, G_OPTION_ARG_NONE, &g_player_options.soft_volume,
+      "mpg123: Use software volume even if a hardware mixer is available", NULL },
+    { "dither", 0, 0, G_OPTION_ARG_NONE, &g_player_options.dither,
+      "mpg123: Apply TPDF dither after software volume (s16/s24 output)", NULL },
+    { NULL }
+};
+
+struct player_impl {
+    player_t *owner;
+    gchar *name;
+    gchar *device;
+    gchar *ctrl_card;
+    gchar *selem_name;
+    int buffer_time;
+
+    mpg123_handle *mh;
+    alsa_output_t output;
+    int output_opened;
+    // 声卡打开之前解出的数据，打开后先写出，不丢开头的样本
+    unsigned char pending_pcm[4096];
+    size_t pending_bytes;
+    pthread_t play_thread;
+    atomic_int playing, paused, stop_flag;
+
+    pthread_mutex_t wait_lock;
+    pthread_mutex_t mixer_lock;     // 混音器句柄和 current_volume，UPnP 线程池并发调用音量/静音
+    wait_queue_t state_wq;          // 恢复/停止/传输结束
+    wait_queue_t data_wq;           // 解码线程等待数据
+
+    long rate;
+    int channels, encoding;
+    off_t current_sample, total_sample;
+
+    snd_mixer_t *mixer_handle;
+    snd_mixer_elem_t *mixer_elem;
+    long int volume_min;
+    long int volume_max;
+    int current_volume;
+
+    // 软件音量: 没有硬件混音器或指定 --soft-volume 时，在解码之后、写入声卡之前做增益
+    soft_volume_t soft_volume;
+    int soft_volume_enabled;
+    atomic_int soft_volume_percent; // 控制线程写，播放线程读
+    atomic_int soft_mute;
+    unsigned char *gain_buffer;     // 增益处理前的解码数据
+    size_t gain_buffer_frames;
+
+    // mpg123 允许输出的格式，创建实例时根据声卡能力确定
+    int decoder_encoding;
+    int decoder_channels;
+    long decoder_rates[16];
+    size_t decoder_nrates;
+
+    // 网络流，见 start_stream_threads
+    atomic_int curl_running;
+    atomic_int curl_eof;            // 下载结束(正常结束或出错)，缓冲区中剩余数据需要播完
+    int stream_mode;                // 当前是否为网络流播放
+    pthread_t decode_thread;
+    char *stream_url;
+    http_transfer_t *transfer;
+    atomic_int transfer_paused;     // 缓冲区满，传输已暂停，等解码线程恢复
+    ring_buffer_t stream_ring;
+    atomic_size_t stream_need;      // 解码线程继续运行所需的缓冲数据量
+    atomic_llong stream_length;     // 资源总字节数(Content-Length)，未知为-1
+    off_t stream_offset;            // 本次传输的起始字节(Range)
+    off_t stream_skip;              // 服务器忽略 Range 时需要丢弃的字节数
+    int stream_first_write;
+    // 磁盘缓存: 过期条目的校验信息(用于条件请求)，以及本次下载的写入句柄
+    media_cache_entry_t stream_cached;
+    media_cache_writer_t *cache_writer;
+    atomic_int stream_revalidated;  // 服务器返回 304，改从缓存文件读取
+    atomic_int stream_buffering;    // 解码线程正在预缓冲/重新缓冲
+    char stream_etag[256];
+    char stream_last_modified[64];
+};
+
+// 阻塞直到 ready() 为真
+static void wait_queue_wait(player_impl_t *p, wait_queue_t *wq, int (*ready)(player_impl_t *)) {
+    pthread_mutex_lock(&p->wait_lock);
+    atomic_fetch_add(&wq->waiters, 1);
+    atomic_thread_fence(memory_order_seq_cst);
+    while (!ready(p)) {
+        pthread_cond_wait(&wq->cond, &p->wait_lock);
+    }
+    atomic_fetch_sub(&wq->waiters, 1);
+    pthread_mutex_unlock(&p->wait_lock);
+}
+
+// 状态修改之后调用；ready 不为空时，只有条件满足才真正唤醒，避免无效唤醒
+static void wait_queue_wake(player_impl_t *p, wait_queue_t *wq, int (*ready)(player_impl_t *)) {
+    atomic_thread_fence(memory_order_seq_cst);
+    if (atomic_load(&wq->waiters) == 0) return;
+    if (ready && !ready(p)) return;
+    pthread_mutex_lock(&p->wait_lock);
+    pthread_cond_broadcast(&wq->cond);
+    pthread_mutex_unlock(&p->wait_lock);
+}
+
+static int resume_ready(player_impl_t *p) {
+    return p->stop_flag || !p->paused;
+}
+
+static void emit_event(player_impl_t *p, player_event_t event) {
+    player_backend_emit_event(p->owner, p, event);
+}
+
+static snd_pcm_format_t mpg123_to_alsa_format(int enc) {
+    switch (enc) {
+        case MPG123_ENC_SIGNED_16: return SND_PCM_FORMAT_S16;
+        case MPG123_ENC_SIGNED_32: return SND_PCM_FORMAT_S32;
+        case MPG123_ENC_FLOAT_32: return SND_PCM_FORMAT_FLOAT;
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+        case MPG123_ENC_SIGNED_24: return SND_PCM_FORMAT_S24_3BE;
+#else
+        case MPG123_ENC_SIGNED_24: return SND_PCM_FORMAT_S24_3LE;
+#endif
+        default: return SND_PCM_FORMAT_UNKNOWN;
     }
+}
+
+static soft_volume_format_t mpg123_to_soft_format(int enc) {
+    switch (enc) {
+        case MPG123_ENC_SIGNED_24: return SOFT_VOLUME_S24_3;
+        case MPG123_ENC_SIGNED_32: return SOFT_VOLUME_S32;
+        case MPG123_ENC_FLOAT_32: return SOFT_VOLUME_FLOAT;
+        default: return SOFT_VOLUME_S16;
+    }
+}
+
+// auto 模式下按此顺序选择声卡原生支持的第一种格式
+static const struct {
+    const char *name;
+    int encoding;
+} sample_formats[] = {
+    { "s32",   MPG123_ENC_SIGNED_32 },
+    { "s24",   MPG123_ENC_SIGNED_24 },
+    { "float", MPG123_ENC_FLOAT_32 },
+    { "s16",   MPG123_ENC_SIGNED_16 },
+};
 
-    // 输出所有可用驱动
-    printf("Available libao drivers:\n");
-    for (int i = 0; i < driver_count; i++) {
-        ao_info *info = driver_info_list[i];
-        printf("  [%d] %s (%s)\n", i, info->short_name, info->name);
-        if (strcmp(info->short_name, "alsa") == 0) {
-            alsa_driver = i;
+
+// 探测声卡支持的编码/声道/采样率: 只让 mpg123 输出声卡原生支持的格式，
+// 采样率不支持时由 mpg123 在解码时重采样，而不是让 ALSA 再转换一次
+static void setup_decoder_formats(player_impl_t *p) {
+    const long *rates;
+    size_t nrates;
+    alsa_probe_t probe;
+    int probed = alsa_probe_open(&probe, p->device) == 0;
+    int is_auto = strcmp(g_player_options.sample_format, "auto") == 0;
+    const size_t max_rates = sizeof(p->decoder_rates) / sizeof(p->decoder_rates[0]);
+
+    p->decoder_encoding = 0;
+    for (size_t i = 0; i < sizeof(sample_formats) / sizeof(sample_formats[0]); i++) {
+        int enc = sample_formats[i].encoding;
+        if (is_auto) {
+            // 无法探测时只用最保险的 s16
+            if (!probed && enc != MPG123_ENC_SIGNED_16) continue;
+            if (probed && !alsa_probe_format(&probe, mpg123_to_alsa_format(enc))) continue;
+        } else if (strcmp(g_player_options.sample_format, sample_formats[i].name) != 0) {
+            continue;
         }
+        p->decoder_encoding = enc;
+        break;
+    }
+    if (!p->decoder_encoding) {
+        fprintf(stderr, "Unknown or unsupported sample format '%s', using s16\n", g_player_options.sample_format);
+        p->decoder_encoding = MPG123_ENC_SIGNED_16;
     }
 
-    // 如果找到alsa，则尝试用alsa打开
-    if (alsa_driver >= 0) {
-        printf("Trying to use ALSA driver...\n");
-        dev = ao_open_live(alsa_driver, &format, NULL);
-	printf("Format: rate=%d, bits=%d, channels=%d\n", format.rate, format.bits, format.channels);
-        if (dev) {
-            printf("Audio output initialized with ALSA.\n");
-            return 0;
-        }else {
-	     fprintf(stderr, "ALSA error: %s\n", strerror(errno));
-	 }
+    p->decoder_channels = 0;
+    if (!probed || alsa_probe_channels(&probe, 1)) p->decoder_channels |= MPG123_MONO;
+    if (!probed || alsa_probe_channels(&probe, 2)) p->decoder_channels |= MPG123_STEREO;
+    if (!p->decoder_channels) p->decoder_channels = MPG123_STEREO;
+
+    mpg123_rates(&rates, &nrates);
+    p->decoder_nrates = 0;
+    for (size_t i = 0; i < nrates && p->decoder_nrates < max_rates; i++) {
+        if (!probed || alsa_probe_rate(&probe, (unsigned int)rates[i])) {
+            p->decoder_rates[p->decoder_nrates++] = rates[i];
+        }
+    }
+    if (p->decoder_nrates == 0) {
+        for (size_t i = 0; i < nrates && i < max_rates; i++) {
+            p->decoder_rates[p->decoder_nrates++] = rates[i];
+        }
     }
 
-    // 如果alsa失败，则尝试默认驱动
-    default_driver = ao_default_driver_id();
-    if (default_driver < 0) {
-        fprintf(stderr, "No default AO driver available. %s\n",strerror(errno));
+    if (probed) {
+        alsa_probe_close(&probe);
+    }
+    printf("[%s] Decoder output: %d bits%s, %zu sample rates\n", p->name, mpg123_encsize(p->decoder_encoding) * 8,
+           p->decoder_encoding == MPG123_ENC_FLOAT_32 ? " float" : "", p->decoder_nrates);
+}
+
+// 每次打开新曲目前重新设置 mpg123 允许的输出格式
+static void apply_decoder_formats(player_impl_t *p) {
+    mpg123_format_none(p->mh);
+    for (size_t i = 0; i < p->decoder_nrates; i++) {
+        if (mpg123_format(p->mh, p->decoder_rates[i], p->decoder_channels, p->decoder_encoding) != MPG123_OK) {
+            // mpg123 编译时未包含该编码，退回 s16
+            fprintf(stderr, "mpg123 cannot output %d bits, falling back to s16\n",
+                    mpg123_encsize(p->decoder_encoding) * 8);
+            p->decoder_encoding = MPG123_ENC_SIGNED_16;
+            apply_decoder_formats(p);
+            return;
+        }
+    }
+}
+
+// 按当前 rate/channels/encoding 打开 ALSA 输出
+static int init_output_device(player_impl_t *p) {
+    snd_pcm_format_t format = mpg123_to_alsa_format(p->encoding);
+    if (format == SND_PCM_FORMAT_UNKNOWN) {
+        fprintf(stderr, "Unsupported mpg123 encoding: 0x%x\n", p->encoding);
         return -1;
     }
 
-    printf("Trying to use default driver: %s\n", driver_info_list[default_driver]->short_name);
-    dev = ao_open_live(default_driver, &format, NULL);
-    if (dev) {
-        printf("Audio output initialized with default driver.\n");
-        return 0;
-    } else {
-        fprintf(stderr, "Failed to open audio output device with default driver.\n");
+    if (p->output_opened) {
+        alsa_output_close(&p->output);
+        p->output_opened = 0;
+    }
+
+    printf("[%s] Format: rate=%ld, bits=%d, channels=%d\n", p->name, p->rate,
+           mpg123_encsize(p->encoding) * 8, p->channels);
+    if (alsa_output_open(&p->output, p->device, format, p->rate, p->channels,
+                         p->buffer_time, g_player_options.period_time) < 0) {
+        fprintf(stderr, "Failed to open audio output device %s\n", p->device);
         return -1;
     }
+    p->output_opened = 1;
+
+    if (p->soft_volume_enabled) {
+        // 增益处理需要一块与声卡缓冲区同样大的中转区
+        size_t frames = alsa_output_buffer_size(&p->output);
+        unsigned char *buf = realloc(p->gain_buffer, frames * p->output.frame_bytes);
+        if (!buf) {
+            fprintf(stderr, "Failed to allocate software volume buffer\n");
+            return -1;
+        }
+        p->gain_buffer = buf;
+        p->gain_buffer_frames = frames;
+        soft_volume_set_rate(&p->soft_volume, p->output.rate);
+    }
+    return 0;
+}
+
+static int handle_new_format(player_impl_t *p);
+
+// 解码一块数据，直接写入声卡缓冲区(mmap)，省去中间缓冲和一次拷贝；返回 mpg123_read 的结果
+static int decode_to_output(player_impl_t *p) {
+    void *buf;
+    snd_pcm_uframes_t frames = 0;
+    size_t done = 0;
+
+    if (!p->output_opened) {
+        // 输出格式还未确定，mpg123 通常在给出第一个样本前先返回 MPG123_NEW_FORMAT；
+        // 若已经解出了样本，先留着，按当前格式打开声卡后再写出
+        if (p->pending_bytes == 0) {
+            // 只读整数帧(S24_3 立体声每帧6字节)，不能把半帧留在解码器里
+            size_t len = sizeof(p->pending_pcm);
+            long rate;
+            int channels = 0, encoding = 0;
+            if (mpg123_getformat(p->mh, &rate, &channels, &encoding) == MPG123_OK &&
+                channels > 0 && mpg123_encsize(encoding) > 0) {
+                size_t frame = (size_t)channels * mpg123_encsize(encoding);
+                len = len / frame * frame;
+            }
+            int err = mpg123_read(p->mh, p->pending_pcm, len, &done);
+            p->pending_bytes = done;
+            if (done == 0) return err;
+        }
+        if (handle_new_format(p) < 0) return MPG123_ERR;
+    }
+
+    int gain = 0;
+    if (p->soft_volume_enabled && p->gain_buffer) {
+        soft_volume_set(&p->soft_volume, p->soft_mute ? 0.0f : soft_volume_percent_to_gain(p->soft_volume_percent));
+        gain = soft_volume_active(&p->soft_volume);
+    }
+    if (p->pending_bytes) {
+        snd_pcm_uframes_t pending = p->pending_bytes / p->output.frame_bytes;
+        p->pending_bytes = 0;
+        if (gain) {
+            soft_volume_apply(&p->soft_volume, p->pending_pcm, p->pending_pcm, pending,
+                              p->output.channels, mpg123_to_soft_format(p->encoding));
+        }
+        if (alsa_output_write(&p->output, p->pending_pcm, pending) < 0) {
+            return MPG123_ERR;
+        }
+        p->current_sample += pending;
+        return MPG123_OK;
+    }
+    if (gain) {
+        // 先解码到中转区，增益处理的同时写入声卡缓冲区，不多一次拷贝
+        frames = p->gain_buffer_frames;
+    }
+    if (alsa_output_begin(&p->output, &buf, &frames) < 0) {
+        return MPG123_ERR;
+    }
+    int err;
+    if (gain) {
+        err = mpg123_read(p->mh, p->gain_buffer, frames * p->output.frame_bytes, &done);
+        soft_volume_apply(&p->soft_volume, p->gain_buffer, buf, done / p->output.frame_bytes,
+                          p->output.channels, mpg123_to_soft_format(p->encoding));
+    } else {
+        err = mpg123_read(p->mh, buf, frames * p->output.frame_bytes, &done);
+    }
+    int committed = alsa_output_commit(&p->output, done / p->output.frame_bytes);
+    if (committed < 0) {
+        return MPG123_ERR;
+    }
+    // xrun 时没提交的样本已经丢了，播放位置只计真正送到声卡的
+    p->current_sample += committed;
+    return err;
 }
 
-// 新增全局变量，用于curl下载数据回调时使用
-static int curl_running = 0;
-static pthread_t curl_thread;
+// 解码格式确定或中途变化时(重新)打开输出设备
+static int handle_new_format(player_impl_t *p) {
+    long new_rate;
+    int new_channels, new_encoding;
+
+    mpg123_getformat(p->mh, &new_rate, &new_channels, &new_encoding);
+    if (p->output_opened && new_rate == p->rate && new_channels == p->channels && new_encoding == p->encoding) {
+        return 0;
+    }
+    printf("[INFO] New format: %ld Hz, %d channels, %d bits\n",
+           new_rate, new_channels, mpg123_encsize(new_encoding) * 8);
+
+    if (p->output_opened) {
+        // 先播完旧格式的数据
+        alsa_output_drain(&p->output);
+    }
+    // 播放位置以样本为单位，采样率变化时换算
+    if (p->rate > 0 && new_rate != p->rate) {
+        p->current_sample = p->current_sample * new_rate / p->rate;
+        p->total_sample = p->total_sample * new_rate / p->rate;
+    }
+    p->rate = new_rate;
+    p->channels = new_channels;
+    p->encoding = new_encoding;
+    return init_output_device(p);
+}
+
+// 暂停时让声卡也停下来，等待恢复
+static void wait_while_paused(player_impl_t *p) {
+    alsa_output_pause(&p->output, 1);
+    wait_queue_wait(p, &p->state_wq, resume_ready);
+    alsa_output_pause(&p->output, 0);
+}
+
+// 网络流: 下载由主循环中的 HTTP 引擎(curl_multi)完成，写回调只把数据放入环形缓冲区；
+// 解码/播放在独立线程中进行，声卡慢不会阻塞 TCP 接收，网络抖动也不会直接饿死声卡。
+// 所有实例的传输共用同一个 HTTP 引擎
 static void* playback_thread(void* arg);
 
+#define STREAM_FEED_CHUNK 4096       // 每次从环形缓冲区取出送入 mpg123 的字节数
+#define STREAM_MIN_BUFFER (4 * CURL_MAX_WRITE_SIZE)  // 暂停的数据块要能一次放进腾出的1/4空间
+
+static int stream_data_ready(player_impl_t *p) {
+    return p->stop_flag || p->curl_eof || ring_buffer_used(&p->stream_ring) >= p->stream_need;
+}
+
+static int transfer_done_ready(player_impl_t *p) {
+    return !p->curl_running;
+}
+
+// 记录响应头中的校验信息，重定向时每个响应重新开始
+static size_t my_curl_header_callback(char *buf, size_t size, size_t nitems, void *userdata) {
+    player_impl_t *p = userdata;
+    size_t len = size * nitems;
+    char *value = memchr(buf, ':', len);
+
+    if (len > 5 && strncmp(buf, "HTTP/", 5) == 0) {
+        p->stream_etag[0] = '\0';
+        p->stream_last_modified[0] = '\0';
+        return len;
+    }
+    if (!value) return len;
+
+    size_t name_len = value - buf;
+    char *target = NULL;
+    size_t target_size = 0;
+    if (name_len == 4 && g_ascii_strncasecmp(buf, "ETag", 4) == 0) {
+        target = p->stream_etag;
+        target_size = sizeof(p->stream_etag);
+    } else if (name_len == 13 && g_ascii_strncasecmp(buf, "Last-Modified", 13) == 0) {
+        target = p->stream_last_modified;
+        target_size = sizeof(p->stream_last_modified);
+    }
+    if (target) {
+        value++;
+        size_t n = len - (value - buf);
+        while (n > 0 && (*value == ' ' || *value == '\t')) { value++; n--; }
+        while (n > 0 && (value[n - 1] == '\r' || value[n - 1] == '\n' || value[n - 1] == ' ')) n--;
+        if (n < target_size) {
+            memcpy(target, value, n);
+            target[n] = '\0';
+        }
+    }
+    return len;
+}
+
+// 在主循环线程中调用，不能阻塞: 缓冲区放不下时暂停传输，curl 稍后会重新送来同一块数据
 static size_t my_curl_write_callback(void *ptr, size_t size, size_t nmemb, void *userdata) {
+    player_impl_t *p = userdata;
+    CURL *curl = http_transfer_easy(p->transfer);
     size_t bytes = size * nmemb;
-    int err;
-    size_t done = 0;
-    // 将下载的MP3数据送入解码器
-    err = mpg123_feed(mh, ptr, bytes);
-    if (err != MPG123_OK) {
-        fprintf(stderr, "[ERROR] mpg123_feed failed: %s\n", mpg123_strerror(mh));
-        return CURL_READFUNC_ABORT; // 正确通知 curl 终止下载
+    size_t skip = 0;
+
+    if (p->stop_flag) {
+        return 0; // 返回值与 bytes 不一致，curl 会终止传输
     }
 
-    // 从解码器中读取PCM数据并播放
-    while (!stop_flag) {
-        if (paused) {
-            usleep(10000);
-            continue;
+    // 第一块数据到达时响应头已经收完，检查 Range 是否生效
+    if (p->stream_first_write) {
+        long code = 0;
+        curl_off_t content_length = -1;
+        p->stream_first_write = 0;
+        curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &code);
+        curl_easy_getinfo(curl, CURLINFO_CONTENT_LENGTH_DOWNLOAD_T, &content_length);
+        if (p->stream_offset > 0 && code != 206) {
+            fprintf(stderr, "[WARN] Server ignored Range request (HTTP %ld), skipping %lld bytes\n",
+                    code, (long long)p->stream_offset);
+            p->stream_skip = p->stream_offset;
         }
+        if (content_length > 0) {
+            p->stream_length = (code == 206) ? p->stream_offset + content_length : content_length;
+        }
+        // 从头开始的完整响应才写入缓存
+        if (code == 200 && p->stream_offset == 0) {
+            p->cache_writer = media_cache_begin(p->stream_url, p->stream_etag, p->stream_last_modified,
+                                                content_length > 0 ? (gint64)content_length : -1);
+        }
+    }
 
-        err = mpg123_read(mh, g_decode_buffer, g_decode_buffer_size, &done);
+    if (p->stream_skip > 0) {
+        skip = (off_t)bytes < p->stream_skip ? bytes : (size_t)p->stream_skip;
+    }
+    if (ring_buffer_space(&p->stream_ring) < bytes - skip) {
+        p->transfer_paused = 1;
+        atomic_thread_fence(memory_order_seq_cst);
+        // 设置标志后再检查一次，解码线程可能刚好腾出空间而没有看到标志
+        if (ring_buffer_space(&p->stream_ring) < bytes - skip || !atomic_exchange(&p->transfer_paused, 0)) {
+            return CURL_WRITEFUNC_PAUSE;
+        }
+    }
 
-        if (err == MPG123_OK) {
-            ao_play(dev, (char *)g_decode_buffer, done);
-            current_sample += done / (channels * mpg123_encsize(encoding));
+    p->stream_skip -= skip;
+    if (p->cache_writer && media_cache_write(p->cache_writer, ptr, bytes) < 0) {
+        media_cache_abort(p->cache_writer);
+        p->cache_writer = NULL;
+    }
+    ring_buffer_write(&p->stream_ring, (const unsigned char *)ptr + skip, bytes - skip);
+    wait_queue_wake(p, &p->data_wq, stream_data_ready);
+    return bytes;
+}
+
+// 传输结束，在主循环线程中回调
+static void on_transfer_done(http_transfer_t *t, CURLcode res, void *userdata) {
+    player_impl_t *p = userdata;
+    long code = 0;
+    curl_easy_getinfo(http_transfer_easy(t), CURLINFO_RESPONSE_CODE, &code);
+    if (res != CURLE_OK && !p->stop_flag) {
+        fprintf(stderr, "HTTP transfer failed: %s\n", curl_easy_strerror(res));
+    } else if (res == CURLE_OK && code == 304 && p->stream_cached.path) {
+        fprintf(stderr, "[INFO] Cache revalidated, playing from %s\n", p->stream_cached.path);
+        media_cache_revalidated(p->stream_url);
+        p->stream_length = p->stream_cached.size;
+        p->stream_revalidated = 1;
+    }
+
+    if (p->cache_writer) {
+        if (res == CURLE_OK && !p->stop_flag) {
+            media_cache_commit(p->cache_writer);
+        } else {
+            media_cache_abort(p->cache_writer);
+        }
+        p->cache_writer = NULL;
+    }
+    p->curl_running = 0;
+    p->curl_eof = 1;
+    wait_queue_wake(p, &p->data_wq, NULL);
+    wait_queue_wake(p, &p->state_wq, NULL);
+}
 
+// 缓冲区腾出1/4空间后恢复暂停的传输，避免每读走一块就恢复一次
+static void stream_resume_transfer(player_impl_t *p) {
+    atomic_thread_fence(memory_order_seq_cst);
+    if (!p->transfer_paused || ring_buffer_space(&p->stream_ring) < p->stream_ring.size / 4) return;
+    if (atomic_exchange(&p->transfer_paused, 0)) {
+        http_transfer_resume(p->transfer);
+    }
+}
+
+// 从环形缓冲区取数据；服务器确认缓存有效(304)时直接读缓存文件
+static size_t stream_read(player_impl_t *p, FILE **cache_fp, unsigned char *buf, size_t len) {
+    if (!p->stream_revalidated) {
+        size_t n = ring_buffer_read(&p->stream_ring, buf, len);
+        if (n > 0) stream_resume_transfer(p);
+        return n;
+    }
+    if (!*cache_fp) {
+        *cache_fp = fopen(p->stream_cached.path, "rb");
+        if (!*cache_fp) {
+            fprintf(stderr, "[ERROR] Cannot open cached file %s\n", p->stream_cached.path);
+            return 0;
+        }
+        if (p->stream_offset > 0) {
+            fseeko(*cache_fp, p->stream_offset, SEEK_SET);
+        }
+    }
+    return fread(buf, 1, len, *cache_fp);
+}
+
+// 把已送入 mpg123 的数据全部解码播放
+// 返回 0 表示需要更多数据，1 表示流结束，-1 表示出错
+static int decode_fed_data(player_impl_t *p) {
+    int err;
+
+    while (!p->stop_flag) {
+        if (p->paused) {
+            wait_while_paused(p);
+            continue;
+        }
+
+        err = decode_to_output(p);
+        if (err == MPG123_OK) {
+            continue;
         } else if (err == MPG123_NEW_FORMAT) {
-            long rate;
-            int channels_local, encoding_local;
-            mpg123_getformat(mh, &rate, &channels_local, &encoding_local);
-            fprintf(stderr, "[WARN] New format detected: %ld Hz, %d channels\n", rate, channels_local);
-            // 可在此重新配置ao设备等
+            if (handle_new_format(p) < 0) {
+                return -1;
+            }
         } else if (err == MPG123_NEED_MORE) {
-            // 当前缓存数据不够解出完整帧，退出等待下一次 feed
-            break;
+            // 当前缓存数据不够解出完整帧，回去从环形缓冲区取数据
+            return 0;
         } else if (err == MPG123_DONE) {
-            fprintf(stderr, "[INFO] Stream finished: %s\n", mpg123_strerror(mh));
-            stop_flag = 1;
-            break;
+            fprintf(stderr, "[INFO] Stream finished: %s\n", mpg123_strerror(p->mh));
+            return 1;
         } else {
-            fprintf(stderr, "[ERROR] mpg123_read failed: %s\n", mpg123_strerror(mh));
-            stop_flag = 1;
+            fprintf(stderr, "[ERROR] mpg123_read failed: %s\n", mpg123_strerror(p->mh));
+            return -1;
+        }
+    }
+    return 1;
+}
+
+// 网络流解码/播放线程: 从环形缓冲区取数据送入 mpg123，按高低水位控制缓冲
+static void* stream_decode_thread(void* arg) {
+    player_impl_t *p = arg;
+    unsigned char feed_buf[STREAM_FEED_CHUNK];
+    FILE *cache_fp = NULL;
+    int buffering = 1;
+    int filesize_set = 0;
+
+    p->stream_buffering = 1;
+
+    while (!p->stop_flag) {
+        if (p->paused) {
+            wait_while_paused(p);
+            continue;
+        }
+
+        size_t avail = ring_buffer_used(&p->stream_ring);
+        int eof = p->curl_eof;
+
+        if (buffering) {
+            // 预缓冲/欠载后重新缓冲，直到达到高水位或下载结束
+            if (avail < p->stream_ring.high_watermark && !eof) {
+                p->stream_need = p->stream_ring.high_watermark;
+                wait_queue_wait(p, &p->data_wq, stream_data_ready);
+                continue;
+            }
+            buffering = 0;
+            p->stream_buffering = 0;
+            fprintf(stderr, "[INFO] [%s] Stream buffered: %zu bytes\n", p->name, avail);
+            // 缓冲期间被暂停时仍是暂停状态，不报告开始播放
+            if (!p->paused) emit_event(p, PLAYER_EVENT_PLAYING);
+        } else if (avail < p->stream_ring.low_watermark && !eof) {
+            fprintf(stderr, "[WARN] [%s] Stream buffer underrun (%zu bytes), rebuffering\n", p->name, avail);
+            buffering = 1;
+            p->stream_buffering = 1;
+            emit_event(p, PLAYER_EVENT_BUFFERING);
+            continue;
+        }
+
+        size_t n = stream_read(p, &cache_fp, feed_buf, sizeof(feed_buf));
+        if (n == 0) {
+            if (eof) {
+                fprintf(stderr, "[INFO] [%s] Stream finished\n", p->name);
+                alsa_output_drain(&p->output);
+                break;
+            }
+            p->stream_need = 1;
+            wait_queue_wait(p, &p->data_wq, stream_data_ready);
+            continue;
+        }
+
+        // 告诉 mpg123 文件大小，用于估算总时长和 feedseek 的字节偏移
+        if (!filesize_set && p->stream_length > 0) {
+            mpg123_set_filesize(p->mh, (off_t)p->stream_length);
+            filesize_set = 1;
+        }
+
+        if (mpg123_feed(p->mh, feed_buf, n) != MPG123_OK) {
+            fprintf(stderr, "[ERROR] mpg123_feed failed: %s\n", mpg123_strerror(p->mh));
+            break;
+        }
+
+        int ret = decode_fed_data(p);
+        if (ret == 1) {
+            alsa_output_drain(&p->output);
+        }
+        if (ret != 0) {
             break;
         }
+        if (filesize_set && p->total_sample <= 0) {
+            off_t len = mpg123_length(p->mh);
+            if (len > 0) p->total_sample = len;
+        }
     }
 
-    return bytes;
+    p->stream_buffering = 0;
+    if (cache_fp) {
+        fclose(cache_fp);
+    }
+    // 不是 stop/seek 引起的退出，说明播放结束或出错
+    int finished = !p->stop_flag;
+    // 解码结束，中止可能处于暂停状态的传输
+    p->stop_flag = 1;
+    http_transfer_cancel(p->transfer);
+    if (finished) {
+        emit_event(p, PLAYER_EVENT_STOPPED);
+    }
+    return NULL;
 }
 
-static void* curl_download_thread(void* arg) {
-    const char* url = (const char*)arg;
-    CURL *curl = curl_easy_init();
-    if (!curl) {
-        fprintf(stderr, "Failed to init curl\n");
-        return NULL;
-    }
+// 开始下载和解码，offset 为 HTTP Range 的起始字节
+static int start_stream_threads(player_impl_t *p, off_t offset) {
+    ring_buffer_reset(&p->stream_ring);
+    p->curl_eof = 0;
+    p->stop_flag = 0;
+    p->stream_offset = offset;
+    p->stream_skip = 0;
+    p->stream_first_write = 1;
+    p->stream_revalidated = 0;
+    p->transfer_paused = 0;
+    p->stream_etag[0] = '\0';
+    p->stream_last_modified[0] = '\0';
 
-    curl_running = 1;
-    curl_easy_setopt(curl, CURLOPT_URL, url);
+    http_transfer_t *t = http_transfer_new(p->stream_url);
+    if (!t) {
+        fprintf(stderr, "Failed to create HTTP transfer\n");
+        return -1;
+    }
+    CURL *curl = http_transfer_easy(t);
     curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, my_curl_write_callback);
-    curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, p);
+    curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, my_curl_header_callback);
+    curl_easy_setopt(curl, CURLOPT_HEADERDATA, p);
+    if (offset > 0) {
+        // 发送 Range: bytes=<offset>- 请求
+        curl_easy_setopt(curl, CURLOPT_RESUME_FROM_LARGE, (curl_off_t)offset);
+    }
+    if (p->stream_cached.path) {
+        // 缓存已过期，带上校验信息，未修改时服务器只返回 304
+        struct curl_slist *headers = NULL;
+        char line[320];
+        if (p->stream_cached.etag) {
+            snprintf(line, sizeof(line), "If-None-Match: %s", p->stream_cached.etag);
+            headers = curl_slist_append(headers, line);
+        }
+        if (p->stream_cached.last_modified) {
+            snprintf(line, sizeof(line), "If-Modified-Since: %s", p->stream_cached.last_modified);
+            headers = curl_slist_append(headers, line);
+        }
+        http_transfer_set_headers(t, headers);
+    }
+
+    p->transfer = t;
+    p->curl_running = 1;
+    http_transfer_start(t, on_transfer_done, p);
 
-    CURLcode res = curl_easy_perform(curl);
-    if (res != CURLE_OK) {
-        fprintf(stderr, "curl_easy_perform() failed: %s\n", curl_easy_strerror(res));
+    // 创建解码播放线程
+    if (pthread_create(&p->decode_thread, NULL, stream_decode_thread, p) != 0) {
+        fprintf(stderr, "Failed to create decode thread\n");
+        p->stop_flag = 1;
+        http_transfer_cancel(p->transfer);
+        wait_queue_wait(p, &p->state_wq, transfer_done_ready);
+        http_transfer_unref(p->transfer);
+        p->transfer = NULL;
+        return -1;
     }
+    return 0;
+}
 
-    curl_easy_cleanup(curl);
-    curl_running = 0;
-    return NULL;
+// 中止当前传输，等待传输结束回调和解码线程退出
+static void stop_stream_threads(player_impl_t *p) {
+    p->stop_flag = 1;
+    wait_queue_wake(p, &p->state_wq, NULL);
+    wait_queue_wake(p, &p->data_wq, NULL);
+    pthread_join(p->decode_thread, NULL);
+    if (p->transfer) {
+        http_transfer_cancel(p->transfer);
+        wait_queue_wait(p, &p->state_wq, transfer_done_ready);
+        http_transfer_unref(p->transfer);
+        p->transfer = NULL;
+    }
+}
+
+// 本地文件(或已缓存的网络资源)播放
+static int play_local_file(player_impl_t *p, const char* path) {
+    mpg123_param(p->mh, MPG123_REMOVE_FLAGS, MPG123_FUZZY, 0.0);
+    apply_decoder_formats(p);
+    if (mpg123_open(p->mh, path) != MPG123_OK) {
+        fprintf(stderr, "Failed to open URI: %s\n", path);
+        return -1;
+    }
+    mpg123_getformat(p->mh, &p->rate, &p->channels, &p->encoding);
+
+    p->total_sample = mpg123_length(p->mh);
+    p->stream_mode = 0;
+
+    if (init_output_device(p) < 0) {
+        fprintf(stderr, "[%s] local Failed to open audio output device\n",__func__);
+        return -1;
+    }
+
+    p->playing = 1;
+    pthread_create(&p->play_thread, NULL, playback_thread, p);
+    return 0;
 }
 
-int player_play(const char* uri) {
-    stop_flag = 0;
-    paused = 0;
-    current_sample = 0;
+static int mpg_play(player_impl_t *p, const char* uri) {
+    p->stop_flag = 0;
+    p->paused = 0;
+    p->current_sample = 0;
+    p->pending_bytes = 0;
+    media_cache_entry_clear(&p->stream_cached);
 
     // 判断是否是http网络流
     if (strncmp(uri, "http://", 7) == 0 || strncmp(uri, "https://", 8) == 0) {
-        // 初始化mpg123 feed模式
-        mpg123_open_feed(mh);
-
-        // 初始化音频输出格式，固定为mp3常见格式（可根据需求更灵活）
-        rate = 48000;
-        channels = 2;
-        encoding = MPG123_ENC_SIGNED_16;
-        if (init_output_device() < 0) {
-            fprintf(stderr, "[%s] https Failed to open audio output device\n",__func__);
-            return -1;
+        media_cache_entry_t cached;
+        if (media_cache_lookup(uri, &cached) == 0) {
+            if (cached.fresh) {
+                printf("Playing %s from cache\n", uri);
+                int ret = play_local_file(p, cached.path);
+                media_cache_entry_clear(&cached);
+                return ret;
+            }
+            // 过期条目: 下载线程发条件请求
+            p->stream_cached = cached;
         }
 
-        playing = 1;
+        // 初始化mpg123 feed模式，允许在帧索引之外按文件大小估算 seek 位置
+        mpg123_param(p->mh, MPG123_ADD_FLAGS, MPG123_FUZZY, 0.0);
+        apply_decoder_formats(p);
+        mpg123_open_feed(p->mh);
+        // 输出设备在解码线程拿到实际格式(MPG123_NEW_FORMAT)后再打开
 
-        // 创建curl下载线程
-        if (pthread_create(&curl_thread, NULL, curl_download_thread, (void*)uri) != 0) {
-            fprintf(stderr, "Failed to create curl thread\n");
+        // uri 由调用者持有，可能在播放过程中被改写，这里保存一份
+        free(p->stream_url);
+        p->stream_url = strdup(uri);
+        p->stream_length = -1;
+        p->total_sample = 0;
+        p->stream_mode = 1;
+        p->playing = 1;
+
+        if (start_stream_threads(p, 0) != 0) {
+            p->playing = 0;
             return -1;
         }
         return 0;
     } else {
         // 本地文件播放，维持原逻辑
-        if (mpg123_open(mh, uri) != MPG123_OK) {
-            fprintf(stderr, "Failed to open URI: %s\n", uri);
-            return -1;
-        }
-        mpg123_getformat(mh, &rate, &channels, &encoding);
-        mpg123_format_none(mh);
-        mpg123_format(mh, rate, channels, encoding);
-
-        total_sample = mpg123_length(mh);
-
-        if (init_output_device() < 0) {
-            fprintf(stderr, "[%s] local Failed to open audio output device\n",__func__);
-            return -1;
-        }
-
-        playing = 1;
-        pthread_create(&play_thread, NULL, playback_thread, NULL);
-        return 0;
+        return play_local_file(p, uri);
     }
 }
 
-int player_stop(void) {
-    if (!playing) return -1;
+static int mpg_stop(player_impl_t *p) {
+    if (!p->playing) return -1;
 
-    stop_flag = 1;
-
-    if (curl_running) {
-        // 等待curl下载线程结束
-        pthread_join(curl_thread, NULL);
+    if (p->stream_mode) {
+        // 等待curl下载线程和解码线程结束
+        stop_stream_threads(p);
     } else {
         // 等待本地文件播放线程结束
-        pthread_join(play_thread, NULL);
+        p->stop_flag = 1;
+        wait_queue_wake(p, &p->state_wq, NULL);
+        pthread_join(p->play_thread, NULL);
     }
 
-    if (mh) {
-        mpg123_close(mh);
+    if (p->mh) {
+        mpg123_close(p->mh);
     }
-    if (dev) {
-        ao_close(dev);
-        dev = NULL;
+    if (p->output_opened) {
+        alsa_output_close(&p->output);
+        p->output_opened = 0;
     }
-    playing = 0;
+    p->playing = 0;
     return 0;
 }
 
 static void* playback_thread(void* arg) {
-    unsigned char *buffer;
-    size_t buffer_size;
-    size_t done;
-
-    buffer_size = mpg123_outblock(mh);
-    buffer = malloc(buffer_size);
-    if (!buffer) {
-        perror("malloc");
-        return NULL;
-    }
-
-    if (init_output_device() < 0) {
-        fprintf(stderr, "Failed to open audio output.\n");
-        free(buffer);
-        return NULL;
-    }
-
-    while (!stop_flag) {
-        if (paused) {
-            usleep(10000);
+    player_impl_t *p = arg;
+    while (!p->stop_flag) {
+        if (p->paused) {
+            wait_while_paused(p);
             continue;
         }
 
-        int err = mpg123_read(mh, buffer, buffer_size, &done);
+        int err = decode_to_output(p);
         if (err == MPG123_OK) {
-            ao_play(dev, (char *)buffer, done);
-            current_sample += done / (channels * mpg123_encsize(encoding));
+            continue;
+        } else if (err == MPG123_NEW_FORMAT) {
+            if (handle_new_format(p) < 0) break;
         } else if (err == MPG123_DONE) {
+            alsa_output_drain(&p->output);
             break;
         } else {
-            fprintf(stderr, "mpg123_read() error: %s\n", mpg123_strerror(mh));
+            fprintf(stderr, "mpg123_read() error: %s\n", mpg123_strerror(p->mh));
             break;
         }
     }
 
-    free(buffer);
-    ao_close(dev);
-    ao_shutdown();
+    // 播完或出错退出(player_stop 会先置 stop_flag)
+    if (!p->stop_flag) {
+        emit_event(p, PLAYER_EVENT_STOPPED);
+    }
     return NULL;
 }
 
-int player_init(void) {
-    ao_initialize();
+// mpg123 库和 HTTP 引擎在进程内只初始化一次，所有实例共用
+static int mpg_init(void) {
     if (mpg123_init() != MPG123_OK) {
         fprintf(stderr, "Failed to initialize mpg123\n");
         return -1;
     }
-
-    mh = mpg123_new(NULL, NULL);
-    if (!mh) {
-        fprintf(stderr, "Failed to create mpg123 handle\n");
-        return -1;
-    }
-    g_decode_buffer_size = mpg123_outblock(mh);
-    g_decode_buffer = malloc(g_decode_buffer_size);
-    if (!g_decode_buffer) {
-        perror("malloc");
+    if (http_engine_init() != 0) {
         return -1;
     }
+    return 0;
+}
+
+static void open_mixer(player_impl_t *p) {
     // 初始化ALSA混音器
-    if (snd_mixer_open(&mixer_handle, 0) < 0) {
+    if (snd_mixer_open(&p->mixer_handle, 0) < 0) {
         fprintf(stderr, "Failed to open ALSA mixer\n");
-        mixer_handle = NULL;
-    } else if (snd_mixer_attach(mixer_handle, "default") < 0) {
-        fprintf(stderr, "Failed to attach mixer to default device\n");
-        snd_mixer_close(mixer_handle);
-        mixer_handle = NULL;
-    } else if (snd_mixer_selem_register(mixer_handle, NULL, NULL) < 0) {
+        p->mixer_handle = NULL;
+    } else if (snd_mixer_attach(p->mixer_handle, p->ctrl_card) < 0) {
+        fprintf(stderr, "Failed to attach mixer to %s device\n", p->ctrl_card);
+        snd_mixer_close(p->mixer_handle);
+        p->mixer_handle = NULL;
+    } else if (snd_mixer_selem_register(p->mixer_handle, NULL, NULL) < 0) {
         fprintf(stderr, "Failed to register mixer simple element\n");
-        snd_mixer_close(mixer_handle);
-        mixer_handle = NULL;
-    } else if (snd_mixer_load(mixer_handle) < 0) {
+        snd_mixer_close(p->mixer_handle);
+        p->mixer_handle = NULL;
+    } else if (snd_mixer_load(p->mixer_handle) < 0) {
         fprintf(stderr, "Failed to load mixer controls\n");
-        snd_mixer_close(mixer_handle);
-        mixer_handle = NULL;
+        snd_mixer_close(p->mixer_handle);
+        p->mixer_handle = NULL;
     } else {
         // 查找主音量控制
         snd_mixer_selem_id_t *sid;
         snd_mixer_selem_id_alloca(&sid);
         snd_mixer_selem_id_set_index(sid, 0);
-        snd_mixer_selem_id_set_name(sid, mixer_name);
-        mixer_elem = snd_mixer_find_selem(mixer_handle, sid);
-        
-        if (mixer_elem) {
-            snd_mixer_selem_get_playback_volume_range(mixer_elem, &volume_min, &volume_max);
+        snd_mixer_selem_id_set_name(sid, p->selem_name);
+        p->mixer_elem = snd_mixer_find_selem(p->mixer_handle, sid);
+
+        if (p->mixer_elem) {
+            snd_mixer_selem_get_playback_volume_range(p->mixer_elem, &p->volume_min, &p->volume_max);
         } else {
-            fprintf(stderr, "Failed to find mixer control '%s'\n", mixer_name);
+            fprintf(stderr, "Failed to find mixer control '%s'\n", p->selem_name);
         }
     }
+}
 
-    return 0;
+static void mpg_destroy(player_impl_t *p);
+
+static player_impl_t* mpg_create(player_t *owner, const player_config_t *config) {
+    player_impl_t *p = g_new0(player_impl_t, 1);
+    p->owner = owner;
+    p->name = g_strdup(config && config->name ? config->name : "default");
+    p->device = g_strdup(config && config->device ? config->device : g_player_options.device);
+    // 默认控制主音量
+    p->ctrl_card = g_strdup(config && config->ctrl_card ? config->ctrl_card : "default");
+    p->selem_name = g_strdup(config && config->selem_name ? config->selem_name : "Master");
+    p->current_volume = config && config->initial_volume ? config->initial_volume : 50;  // 默认音量50%
+    p->buffer_time = config && config->buffer_time ? config->buffer_time : g_player_options.buffer_time;
+    p->volume_max = 100;
+    pthread_mutex_init(&p->wait_lock, NULL);
+    pthread_mutex_init(&p->mixer_lock, NULL);
+    pthread_cond_init(&p->state_wq.cond, NULL);
+    pthread_cond_init(&p->data_wq.cond, NULL);
+    atomic_init(&p->stream_need, 1);
+    atomic_init(&p->stream_length, -1);
+
+    p->mh = mpg123_new(NULL, NULL);
+    if (!p->mh) {
+        fprintf(stderr, "Failed to create mpg123 handle\n");
+        mpg_destroy(p);
+        return NULL;
+    }
+    setup_decoder_formats(p);
+    // 网络流环形缓冲区
+    size_t stream_buffer = (size_t)g_player_options.stream_buffer_kb * 1024;
+    if (stream_buffer < STREAM_MIN_BUFFER) {
+        stream_buffer = STREAM_MIN_BUFFER;
+    }
+    if (ring_buffer_init(&p->stream_ring, stream_buffer,
+                         (size_t)g_player_options.low_watermark_kb * 1024,
+                         (size_t)g_player_options.high_watermark_kb * 1024) != 0) {
+        fprintf(stderr, "Failed to allocate stream ring buffer\n");
+        mpg_destroy(p);
+        return NULL;
+    }
+    // 写回调要么整块写入要么暂停传输，而预缓冲期间解码线程不读数据、传输也不会恢复:
+    // 高水位必须给一整块 curl 数据留出空间，否则缓冲区永远到不了高水位
+    if (p->stream_ring.high_watermark > p->stream_ring.size - CURL_MAX_WRITE_SIZE) {
+        p->stream_ring.high_watermark = p->stream_ring.size - CURL_MAX_WRITE_SIZE;
+        if (p->stream_ring.low_watermark >= p->stream_ring.high_watermark) {
+            p->stream_ring.low_watermark = p->stream_ring.high_watermark / 8;
+        }
+        fprintf(stderr, "[%s] High watermark clamped to %zu bytes (ring buffer %zu bytes)\n",
+                p->name, p->stream_ring.high_watermark, p->stream_ring.size);
+    }
+    printf("[%s] Stream buffer: %zu bytes (low %zu, high %zu)\n", p->name,
+           p->stream_ring.size, p->stream_ring.low_watermark, p->stream_ring.high_watermark);
+    open_mixer(p);
+
+    p->soft_volume_enabled = g_player_options.soft_volume || !p->mixer_elem;
+    soft_volume_init(&p->soft_volume, g_player_options.dither);
+    p->soft_volume_percent = p->current_volume;
+    soft_volume_set(&p->soft_volume, soft_volume_percent_to_gain(p->current_volume));
+    if (p->soft_volume_enabled) {
+        printf("[%s] Software volume enabled%s\n", p->name, g_player_options.dither ? " (TPDF dither)" : "");
+    }
+
+    return p;
+}
+
+static void mpg_destroy(player_impl_t *p) {
+    if (!p) return;
+    mpg_stop(p);
+    if (p->mh) {
+        mpg123_delete(p->mh);
+    }
+    if (p->mixer_handle) {
+        snd_mixer_close(p->mixer_handle);
+        p->mixer_handle = NULL;
+        p->mixer_elem = NULL;
+    }
+    ring_buffer_free(&p->stream_ring);
+    free(p->stream_url);
+    free(p->gain_buffer);
+    media_cache_entry_clear(&p->stream_cached);
+    pthread_cond_destroy(&p->state_wq.cond);
+    pthread_cond_destroy(&p->data_wq.cond);
+    pthread_mutex_destroy(&p->wait_lock);
+    pthread_mutex_destroy(&p->mixer_lock);
+    g_free(p->name);
+    g_free(p->device);
+    g_free(p->ctrl_card);
+    g_free(p->selem_name);
+    g_free(p);
 }
 
-int player_pause(void) {
-    if (playing) {
-        paused = 1;
+static int mpg_pause(player_impl_t *p) {
+    if (p->playing) {
+        p->paused = 1;
         return 0;
     }
     return -1;
 }
 
-int player_resume(void) {
-    if (playing && paused) {
-        paused = 0;
+static int mpg_resume(player_impl_t *p) {
+    if (p->playing && p->paused) {
+        p->paused = 0;
+        wait_queue_wake(p, &p->state_wq, NULL);
         return 0;
     }
     return -1;
 }
 
-int player_seek(int seconds) {
-    if (!playing) return -1;
-    off_t target_sample = (off_t)(seconds * rate);
-    if (mpg123_seek(mh, target_sample, SEEK_SET) >= 0) {
-        current_sample = target_sample;
+static int mpg_seek(player_impl_t *p, int seconds) {
+    if (!p->playing) return -1;
+    off_t target_sample = (off_t)(seconds * p->rate);
+
+    if (p->stream_mode) {
+        // feed 模式下 mpg123_seek 无效: 中止当前传输，由 mpg123_feedseek 算出
+        // 目标位置对应的字节偏移，再用 Range 请求从该偏移重新下载
+        off_t input_offset = 0;
+        stop_stream_threads(p);
+        p->pending_bytes = 0;
+
+        off_t res = mpg123_feedseek(p->mh, target_sample, SEEK_SET, &input_offset);
+        if (res < 0) {
+            fprintf(stderr, "mpg123_feedseek() failed: %s\n", mpg123_strerror(p->mh));
+            // 回到当前位置继续播放
+            res = mpg123_feedseek(p->mh, p->current_sample, SEEK_SET, &input_offset);
+            if (res < 0 || start_stream_threads(p, input_offset) != 0) {
+                p->playing = 0;
+            }
+            return -1;
+        }
+
+        printf("Stream seek to sample %lld, byte offset %lld\n", (long long)res, (long long)input_offset);
+        p->current_sample = res;
+        if (start_stream_threads(p, input_offset) != 0) {
+            p->playing = 0;
+            return -1;
+        }
+        return 0;
+    }
+
+    if (mpg123_seek(p->mh, target_sample, SEEK_SET) >= 0) {
+        p->current_sample = target_sample;
         return 0;
     }
     return -1;
 }
 
-int player_get_position(int* current_sec, int* total_sec) {
-    if (current_sec) *current_sec = current_sample / rate;
-    if (total_sec) *total_sec = total_sample / rate;
+static int mpg_get_position(player_impl_t *p, int* current_sec, int* total_sec) {
+    if (p->rate <= 0) {
+        if (current_sec) *current_sec = 0;
+        if (total_sec) *total_sec = 0;
+        return 0;
+    }
+    if (current_sec) *current_sec = p->current_sample / p->rate;
+    if (total_sec) *total_sec = p->total_sample / p->rate;
     return 0;
 }
 
-int player_get_volume(void) {
-    if (!mixer_handle || !mixer_elem) {
-        return current_volume;  // 返回软件保存的音量值
+// 硬件没有静音开关时，静音靠把混音器音量调到最小实现，此时混音器上的值不是用户音量
+static int mixer_volume_muted(player_impl_t *p) {
+    return p->soft_mute && !snd_mixer_selem_has_playback_switch(p->mixer_elem);
+}
+
+static int get_volume_locked(player_impl_t *p) {
+    if (p->soft_volume_enabled || !p->mixer_handle || !p->mixer_elem || mixer_volume_muted(p)) {
+        return p->current_volume;  // 返回软件保存的音量值
     }
 
     long alsa_vol;
-    if (snd_mixer_selem_get_playback_volume(mixer_elem, SND_MIXER_SCHN_FRONT_LEFT, &alsa_vol) < 0) {
-        return current_volume;
+    if (snd_mixer_selem_get_playback_volume(p->mixer_elem, SND_MIXER_SCHN_FRONT_LEFT, &alsa_vol) < 0) {
+        return p->current_volume;
     }
 
     // 将ALSA音量值转换为百分比
-    current_volume = (int)(100 * (alsa_vol - volume_min) / (volume_max - volume_min));
-    return current_volume;
+    p->current_volume = (int)(100 * (alsa_vol - p->volume_min) / (p->volume_max - p->volume_min));
+    return p->current_volume;
 }
 
-int player_set_volume(int volume) {
+static int set_volume_locked(player_impl_t *p, int volume) {
     if (volume < 0) volume = 0;
     if (volume > 100) volume = 100;
-    
-    current_volume = volume;
 
-    if (!mixer_handle || !mixer_elem) {
-        return 0;  // 没有硬件控制，只保存软件值
+    p->current_volume = volume;
+
+    if (p->soft_volume_enabled) {
+        // 播放线程在下一块数据处理前读取，并从当前增益渐变过去
+        p->soft_volume_percent = volume;
+        return 0;
+    }
+    if (!p->mixer_handle || !p->mixer_elem) {
+        return 0;
+    }
+    if (mixer_volume_muted(p)) {
+        // 静音期间只记下音量，取消静音时再写入混音器
+        return 0;
     }
 
     // 将百分比转换为ALSA音量值
-    long alsa_vol = volume_min + (volume * (volume_max - volume_min) / 100);
-    
+    long alsa_vol = p->volume_min + (volume * (p->volume_max - p->volume_min) / 100);
+
     // 设置左右声道音量
-    if (snd_mixer_selem_set_playback_volume_all(mixer_elem, alsa_vol) < 0) {
+    if (snd_mixer_selem_set_playback_volume_all(p->mixer_elem, alsa_vol) < 0) {
         fprintf(stderr, "Failed to set playback volume\n");
         return -1;
     }
@@ -398,20 +1139,105 @@ int player_set_volume(int volume) {
     return 0;
 }
 
-int player_is_playing(void) {
-    return playing && !paused;
+static int set_mute_locked(player_impl_t *p, int mute) {
+    if (p->soft_volume_enabled || !p->mixer_elem) {
+        p->soft_mute = mute ? 1 : 0;
+        return 0;
+    }
+    if (snd_mixer_selem_has_playback_switch(p->mixer_elem)) {
+        return snd_mixer_selem_set_playback_switch_all(p->mixer_elem, !mute) < 0 ? -1 : 0;
+    }
+    // 硬件没有静音开关，把音量调到最小，取消静音时恢复
+    p->soft_mute = mute ? 1 : 0;
+    long alsa_vol = mute ? p->volume_min : p->volume_min + (p->current_volume * (p->volume_max - p->volume_min) / 100);
+    return snd_mixer_selem_set_playback_volume_all(p->mixer_elem, alsa_vol) < 0 ? -1 : 0;
 }
 
-int player_deinit(void) {
-    mpg123_delete(mh);
+static int get_mute_locked(player_impl_t *p, int *mute) {
+    if (!mute) return -1;
+    if (!p->soft_volume_enabled && p->mixer_elem && snd_mixer_selem_has_playback_switch(p->mixer_elem)) {
+        int on = 1;
+        if (snd_mixer_selem_get_playback_switch(p->mixer_elem, SND_MIXER_SCHN_FRONT_LEFT, &on) < 0) {
+            return -1;
+        }
+        *mute = !on;
+        return 0;
+    }
+    *mute = p->soft_mute;
+    return 0;
+}
+
+// 音量/静音由 UPnP 线程池直接调用(不经过命令执行线程)，snd_mixer_t 不是线程安全的
+static int mpg_get_volume(player_impl_t *p) {
+    pthread_mutex_lock(&p->mixer_lock);
+    int ret = get_volume_locked(p);
+    pthread_mutex_unlock(&p->mixer_lock);
+    return ret;
+}
+
+static int mpg_set_volume(player_impl_t *p, int volume) {
+    pthread_mutex_lock(&p->mixer_lock);
+    int ret = set_volume_locked(p, volume);
+    pthread_mutex_unlock(&p->mixer_lock);
+    return ret;
+}
+
+static int mpg_set_mute(player_impl_t *p, int mute) {
+    pthread_mutex_lock(&p->mixer_lock);
+    int ret = set_mute_locked(p, mute);
+    pthread_mutex_unlock(&p->mixer_lock);
+    return ret;
+}
+
+static int mpg_get_mute(player_impl_t *p, int *mute) {
+    pthread_mutex_lock(&p->mixer_lock);
+    int ret = get_mute_locked(p, mute);
+    pthread_mutex_unlock(&p->mixer_lock);
+    return ret;
+}
+
+static int mpg_is_playing(player_impl_t *p) {
+    return p->playing && !p->paused;
+}
+
+static int mpg_is_buffering(player_impl_t *p) {
+    return p->playing && p->stream_buffering;
+}
+
+// mpg123 后端不支持无缝切换: 清除总是成功，设置下一首返回错误，
+// 控制点收到 SetNextAVTransportURI 的错误后自己在播完时发 Play
+static int mpg_set_next_uri(player_impl_t *p, const char* uri) {
+    if (!uri || !*uri) return 0;
+    fprintf(stderr, "[%s] Gapless next track not supported by mpg123 backend: %s\n", p->name, uri);
+    return -1;
+}
+
+// 所有实例释放之后调用
+static int mpg_deinit(void) {
     mpg123_exit();
-    ao_shutdown();
-    if (mixer_handle) {
-        snd_mixer_close(mixer_handle);
-        mixer_handle = NULL;
-        mixer_elem = NULL;
-    }
-    if(g_decode_buffer)
-	free(g_decode_buffer);
+    http_engine_deinit();
     return 0;
 }
+
+const player_backend_t player_backend_mpg123 = {
+    .name = "mpg123",
+    .caps = PLAYER_CAP_LIGHTWEIGHT,
+    .options = player_option_entries,
+    .init = mpg_init,
+    .deinit = mpg_deinit,
+    .create = mpg_create,
+    .destroy = mpg_destroy,
+    .play = mpg_play,
+    .pause = mpg_pause,
+    .resume = mpg_resume,
+    .stop = mpg_stop,
+    .seek = mpg_seek,
+    .get_position = mpg_get_position,
+    .get_volume = mpg_get_volume,
+    .set_volume = mpg_set_volume,
+    .get_mute = mpg_get_mute,
+    .set_mute = mpg_set_mute,
+    .is_playing = mpg_is_playing,
+    .is_buffering = mpg_is_buffering,
+    .set_next_uri = mpg_set_next_uri,
+};
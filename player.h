@@ -41,38 +41,93 @@ extern int CURRENT_LOG_LEVEL;
             printf("[DEBUG] " fmt "\n", ##__VA_ARGS__); \
     } while (0)
 
+// 一个播放器实例驱动一路输出(一个区域)，实例之间互不共享状态，可以在同一进程中同时播放。
+// 实际解码由后端(mpg123 或 GStreamer)完成，见 player_backend.h；--backend=auto 时按 uri 选择
+typedef struct player player_t;
+
+// 实例的输出配置，字符串在 player_new 中复制；为 NULL 或 0 的项使用命令行选项的值
+typedef struct {
+    const char* name;           // 区域名，用于日志
+    const char* device;         // ALSA PCM 设备
+    const char* ctrl_card;      // 混音器所在的声卡控制接口
+    const char* selem_name;     // 混音器元素
+    int initial_volume;         // 初始音量(0-100)
+    int buffer_time;            // ALSA 缓冲时间(微秒)
+} player_config_t;
+
+// 进程级初始化(选中后端的解码库、HTTP 引擎、磁盘缓存)，在创建实例之前调用一次
 int player_init(void);
 
-int player_play(const char* uri);
+player_t* player_new(const player_config_t* config);
 
-int player_pause(void);
+// 停止播放并释放实例
+void player_free(player_t* p);
 
-int player_resume(void);
+const char* player_get_name(player_t* p);
 
-int player_stop(void);
+int player_play(player_t* p, const char* uri);
 
-int player_seek(int seconds);
+int player_pause(player_t* p);
 
-int player_get_position(int* current_sec, int* total_sec);
+int player_resume(player_t* p);
 
-int player_get_volume(void);
+int player_stop(player_t* p);
 
-int player_set_mute(int mute);
+int player_seek(player_t* p, int seconds);
 
-int player_get_mute(int *mute);
+int player_get_position(player_t* p, int* current_sec, int* total_sec);
 
-int player_set_volume(int volume);
+int player_get_volume(player_t* p);
 
-int player_is_playing(void);
+int player_set_mute(player_t* p, int mute);
 
-int player_deinit(void);
+int player_get_mute(player_t* p, int *mute);
 
-int run_main_loop(void);
+int player_set_volume(player_t* p, int volume);
+
+int player_is_playing(player_t* p);
+
+// 网络流正在缓冲(预缓冲或欠载后重新缓冲)，GetTransportInfo 报告 TRANSITIONING
+int player_is_buffering(player_t* p);
 
-int set_hw_volume_from_gst(double volume, const char *card, const char *selem_name);
+// 设置下一首(SetNextAVTransportURI)，当前曲目播完后无缝切换；uri 为 NULL 或空串时清除。
+// 当前后端不支持无缝切换时返回-1
+int player_set_next_uri(player_t* p, const char* uri);
+
+// 自动切换到下一首时的回调，参数为新的当前 uri
+typedef void (*player_track_changed_cb)(player_t* p, const char* uri, void* userdata);
+
+void player_set_track_changed_callback(player_t* p, player_track_changed_cb cb, void* userdata);
+
+// 播放器自身引起的状态变化(播放结束、缓冲、外部修改音量等)，用于 GENA 事件
+typedef enum {
+    PLAYER_EVENT_STOPPED = 0,   // 播放结束或出错
+    PLAYER_EVENT_PLAYING,
+    PLAYER_EVENT_PAUSED,
+    PLAYER_EVENT_BUFFERING,
+    PLAYER_EVENT_VOLUME         // 音量或静音变化
+} player_event_t;
 
-void list_mixer_controls(const char *card);
+// 回调在播放器内部线程中调用，调用时播放器不持有锁
+typedef void (*player_event_cb)(player_t* p, player_event_t event, void* userdata);
+
+void player_set_event_callback(player_t* p, player_event_cb cb, void* userdata);
+
+// 后端自己发起的播放状态变化(如多房间同步中组长发来的命令)也要交给改变播放状态的唯一线程执行。
+// 执行器把 fn(data) 排进该线程，不能等待它执行完；没有注册执行器时 fn 直接在调用线程执行
+typedef void (*player_task_fn)(void* data);
+typedef void (*player_executor_cb)(player_task_fn fn, void* data, void* userdata);
+
+// exec 为 NULL 时注销，返回后不会再有任务交给原来的执行器
+void player_set_executor(player_t* p, player_executor_cb exec, void* userdata);
+
+// 所有实例释放之后调用
+int player_deinit(void);
+
+// 所有实例共用的 GLib 主循环
+int run_main_loop(void);
 
+// 公共选项(--backend、--device 等)和所有后端各自的选项
 GOptionGroup* player_get_option_group(void);
 #ifdef __cplusplus
 }
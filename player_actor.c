@@ -0,0 +1,178 @@
+#include "player_actor.h"
+#include "player.h"
+#include <stdatomic.h>
+#include <semaphore.h>
+
+#define CMD_QUIT ((player_cmd_type_t)-1)   // 内部使用，让执行线程退出
+#define CMD_TASK ((player_cmd_type_t)-2)   // 内部使用，后端通过执行器提交的任务
+
+struct player_future {
+    atomic_int refcount;    // 提交者和执行线程各持有一个
+    int result;
+    sem_t done;
+};
+
+typedef struct player_cmd {
+    struct player_cmd *next;
+    player_cmd_type_t type;
+    gchar *uri;
+    int arg;
+    player_task_fn task;
+    void *task_data;
+    player_cmd_done_cb cb;
+    void *userdata;
+    player_future_t *future;
+} player_cmd_t;
+
+// 多生产者单消费者邮箱: 生产者用 CAS 压栈，执行线程一次取走整个栈再反转成提交顺序
+struct player_actor {
+    player_t *player;
+    _Atomic(player_cmd_t*) mailbox;
+    sem_t mailbox_sem;              // 每提交一条命令 post 一次
+    pthread_t thread;
+};
+
+static void future_unref(player_future_t *f) {
+    if (atomic_fetch_sub(&f->refcount, 1) != 1) return;
+    sem_destroy(&f->done);
+    g_free(f);
+}
+
+static int execute(player_t *p, player_cmd_t *cmd) {
+    if (cmd->type == CMD_TASK) {
+        cmd->task(cmd->task_data);
+        return 0;
+    }
+    switch (cmd->type) {
+        case PLAYER_CMD_PLAY:         return player_play(p, cmd->uri);
+        case PLAYER_CMD_PAUSE:        return player_pause(p);
+        case PLAYER_CMD_RESUME:       return player_resume(p);
+        case PLAYER_CMD_STOP:         return player_stop(p);
+        case PLAYER_CMD_SEEK:         return player_seek(p, cmd->arg);
+        case PLAYER_CMD_SET_NEXT_URI: return player_set_next_uri(p, cmd->uri);
+        default:                      return 0;
+    }
+}
+
+static void complete(player_t *p, player_cmd_t *cmd) {
+    int result = execute(p, cmd);
+    if (cmd->cb) {
+        cmd->cb(cmd->type, result, cmd->userdata);
+    }
+    cmd->future->result = result;
+    sem_post(&cmd->future->done);
+    future_unref(cmd->future);
+    g_free(cmd->uri);
+    g_free(cmd);
+}
+
+static void* actor_loop(void *arg) {
+    player_actor_t *actor = arg;
+    int quit = 0;
+
+    while (!quit) {
+        while (sem_wait(&actor->mailbox_sem) != 0) ;   // EINTR
+
+        // 前面的批次可能已经取走了这次 post 对应的命令
+        player_cmd_t *list = atomic_exchange(&actor->mailbox, NULL);
+        player_cmd_t *ordered = NULL;
+        while (list) {
+            player_cmd_t *next = list->next;
+            list->next = ordered;
+            ordered = list;
+            list = next;
+        }
+
+        while (ordered) {
+            player_cmd_t *cmd = ordered;
+            ordered = cmd->next;
+            if (cmd->type == CMD_QUIT) quit = 1;  // 同一批中排在后面的命令照常执行
+            complete(actor->player, cmd);
+        }
+    }
+    return NULL;
+}
+
+static void push(player_actor_t *actor, player_cmd_t *cmd) {
+    player_cmd_t *head = atomic_load_explicit(&actor->mailbox, memory_order_relaxed);
+    do {
+        cmd->next = head;
+    } while (!atomic_compare_exchange_weak_explicit(&actor->mailbox, &head, cmd,
+                                                    memory_order_release, memory_order_relaxed));
+    sem_post(&actor->mailbox_sem);
+}
+
+static player_cmd_t* new_cmd(player_cmd_type_t type, const char *uri, int arg,
+                             player_cmd_done_cb cb, void *userdata) {
+    player_future_t *f = g_new0(player_future_t, 1);
+    atomic_init(&f->refcount, 2);
+    sem_init(&f->done, 0, 0);
+
+    player_cmd_t *cmd = g_new0(player_cmd_t, 1);
+    cmd->type = type;
+    cmd->uri = g_strdup(uri);
+    cmd->arg = arg;
+    cmd->cb = cb;
+    cmd->userdata = userdata;
+    cmd->future = f;
+    return cmd;
+}
+
+// 播放器执行器: 后端任务和命令排在同一个邮箱里，按提交顺序执行
+static void run_task(player_task_fn fn, void *data, void *userdata) {
+    player_actor_t *actor = userdata;
+    player_cmd_t *cmd = new_cmd(CMD_TASK, NULL, 0, NULL, NULL);
+    player_future_t *f = cmd->future;
+    cmd->task = fn;
+    cmd->task_data = data;
+    push(actor, cmd);
+    player_future_release(f);
+}
+
+player_actor_t* player_actor_start(player_t *player) {
+    player_actor_t *actor = g_new0(player_actor_t, 1);
+    actor->player = player;
+    atomic_init(&actor->mailbox, NULL);
+    sem_init(&actor->mailbox_sem, 0, 0);
+    if (pthread_create(&actor->thread, NULL, actor_loop, actor) != 0) {
+        sem_destroy(&actor->mailbox_sem);
+        g_free(actor);
+        LOG_ERROR("Failed to create player actor thread");
+        return NULL;
+    }
+    player_set_executor(player, run_task, actor);
+    return actor;
+}
+
+// 调用前应先停止该区域的 UPnP 设备，之后不能再向 actor 提交命令
+void player_actor_stop(player_actor_t *actor) {
+    if (!actor) return;
+    // 之后后端的任务直接在发起线程中执行
+    player_set_executor(actor->player, NULL, NULL);
+    player_cmd_t *quit = new_cmd(CMD_QUIT, NULL, 0, NULL, NULL);
+    player_future_t *f = quit->future;
+    push(actor, quit);
+    player_future_release(f);
+    pthread_join(actor->thread, NULL);
+    sem_destroy(&actor->mailbox_sem);
+    g_free(actor);
+}
+
+player_future_t* player_actor_submit(player_actor_t *actor, player_cmd_type_t type, const char *uri, int arg,
+                                     player_cmd_done_cb cb, void *userdata) {
+    player_cmd_t *cmd = new_cmd(type, uri, arg, cb, userdata);
+    player_future_t *f = cmd->future;
+    push(actor, cmd);
+    return f;
+}
+
+int player_future_wait(player_future_t *f) {
+    while (sem_wait(&f->done) != 0) ;   // EINTR
+    int result = f->result;
+    future_unref(f);
+    return result;
+}
+
+void player_future_release(player_future_t *f) {
+    future_unref(f);
+}
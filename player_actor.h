@@ -0,0 +1,53 @@
+#ifndef PLAYER_ACTOR_H
+#define PLAYER_ACTOR_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// 播放器命令执行线程: 所有改变播放状态的调用(play/pause/resume/stop/seek/next)都投递到一个
+// 无锁邮箱，由唯一的执行线程按提交顺序调用 player_*。执行线程同时注册为播放器的执行器
+// (player_set_executor)，后端自己发起的状态变化(多房间同步的组员命令)也在这里执行。每个播放器实例有自己的执行线程，
+// 一个区域的 Play 卡住不影响其他区域。慢的 Play(网络打开、管道状态切换)只占用
+// 执行线程，UPnP 线程池中的音量设置和状态查询不需要等它。
+// 音量/静音不经过执行线程: 两个后端的实现本身不阻塞，也不依赖传输状态；
+// 它们会被 UPnP 线程池并发调用，后端自己保证线程安全(mpg123 用 mixer_lock)
+typedef enum {
+    PLAYER_CMD_PLAY = 0,        // uri
+    PLAYER_CMD_PAUSE,
+    PLAYER_CMD_RESUME,
+    PLAYER_CMD_STOP,
+    PLAYER_CMD_SEEK,            // arg 为秒
+    PLAYER_CMD_SET_NEXT_URI     // uri，NULL 或空串清除
+} player_cmd_type_t;
+
+// 命令执行完后在执行线程中回调，result 为 player_* 的返回值。
+// 回调按命令的执行顺序发生，用来更新上层状态；回调中不能等待其他命令
+typedef void (*player_cmd_done_cb)(player_cmd_type_t type, int result, void *userdata);
+
+typedef struct player_future player_future_t;
+
+typedef struct player_actor player_actor_t;
+
+struct player;
+
+// 在 player_new 之后启动，player_free 之前停止(停止前会执行完已提交的命令)
+player_actor_t* player_actor_start(struct player *player);
+
+void player_actor_stop(player_actor_t *actor);
+
+// 提交命令，uri 会被复制。返回的 future 必须用 player_future_wait 或 player_future_release 释放
+player_future_t* player_actor_submit(player_actor_t *actor, player_cmd_type_t type, const char *uri, int arg,
+                                     player_cmd_done_cb cb, void *userdata);
+
+// 等待命令执行完并释放 future，返回命令结果
+int player_future_wait(player_future_t *f);
+
+// 不关心结果时释放 future，命令照常执行
+void player_future_release(player_future_t *f);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // PLAYER_ACTOR_H
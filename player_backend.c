@@ -0,0 +1,425 @@
+#include "player_backend.h"
+#include <stdatomic.h>
+#include <signal.h>
+#include "media_cache.h"
+
+static GMainLoop *main_loop = NULL;
+
+// 链接进来的全部后端，auto 模式下按顺序挑选
+static const player_backend_t *const backends[] = {
+    &player_backend_mpg123,
+    &player_backend_gstreamer,
+};
+#define BACKEND_COUNT (int)(sizeof(backends) / sizeof(backends[0]))
+
+typedef struct {
+    const char* backend;        // auto 或后端名
+    const char* device;         // 以下为 NULL/0 时使用后端自己的默认值
+    const char* ctrl_card;
+    const char* selem_name;
+    int buffer_time;
+    int initial_volume;
+} PlayerOptions;
+
+static PlayerOptions g_player_options = {
+    .backend = "auto",
+    .device = NULL,
+    .ctrl_card = NULL,
+    .selem_name = NULL,
+    .buffer_time = 0,
+    .initial_volume = 0
+};
+
+static GOptionEntry player_option_entries[] = {
+    { "backend", 'b', 0, G_OPTION_ARG_STRING, &g_player_options.backend,
+      "Player backend: auto (mpg123 for MP3, GStreamer otherwise and for gapless queues), mpg123, gstreamer (default: auto)", "NAME" },
+    { "device", 'd', 0, G_OPTION_ARG_STRING, &g_player_options.device,
+      "ALSA sound card device(e.g., hw:0,0)", "CARD DEVICE" },
+    { "ctrl", 'c', 0, G_OPTION_ARG_STRING, &g_player_options.ctrl_card,
+      "ALSA sound ctrl card (e.g., hw:0)", "CTRL CARD" },
+    { "selem-name", 's', 0, G_OPTION_ARG_STRING, &g_player_options.selem_name,
+      "ALSA element name (e.g., DAC volume)", "SELEM" },
+    { "buffer-time", 'B', 0, G_OPTION_ARG_INT, &g_player_options.buffer_time,
+      "ALSA buffer time in microseconds (default: 200000)", "TIME" },
+    { "volume", 'V', 0, G_OPTION_ARG_INT, &g_player_options.initial_volume,
+      "Initial volume level (0-100, default: backend default)", "VOLUME" },
+    { NULL }
+};
+
+// --backend 指定的后端，auto 时为 NULL；player_init 中确定
+static const player_backend_t *forced_backend = NULL;
+
+struct player {
+    gchar *name;
+    gchar *device;
+    gchar *ctrl_card;
+    gchar *selem_name;
+    int initial_volume;
+    int buffer_time;
+
+    // 后端实例按需创建，创建后一直保留到 player_free；切换时旧实例只停止不释放，
+    // 查询线程即使读到刚被换下的实例也是安全的
+    player_impl_t *impls[BACKEND_COUNT];
+    pthread_mutex_t create_lock;
+    atomic_int active;              // 当前使用的后端下标
+    atomic_int want_gapless;        // 控制点用过 SetNextAVTransportURI，auto 模式之后只用能无缝切换的后端
+
+    player_track_changed_cb track_changed_cb;
+    void *track_changed_data;
+    player_event_cb event_cb;
+    void *event_data;
+
+    pthread_mutex_t exec_lock;      // 保护 executor，注销后不再向旧执行器提交
+    player_executor_cb executor;
+    void *executor_data;
+};
+
+// 获取播放器选项组: 公共选项加上所有后端各自的选项
+GOptionGroup* player_get_option_group(void) {
+    GOptionGroup *group = g_option_group_new(
+        "player",
+        "Player Options",
+        "Show player configuration options",
+        NULL,
+        NULL
+    );
+
+    g_option_group_add_entries(group, player_option_entries);
+    for (int i = 0; i < BACKEND_COUNT; i++) {
+        if (backends[i]->options) {
+            g_option_group_add_entries(group, backends[i]->options);
+        }
+    }
+    return group;
+}
+
+static int backend_enabled(int i) {
+    return !forced_backend || backends[i] == forced_backend;
+}
+
+// 只初始化会用到的后端，--backend=mpg123 时不加载 GStreamer 插件注册表
+int player_init(void) {
+    if (g_strcmp0(g_player_options.backend, "auto") != 0) {
+        for (int i = 0; i < BACKEND_COUNT; i++) {
+            if (g_strcmp0(g_player_options.backend, backends[i]->name) == 0) {
+                forced_backend = backends[i];
+            }
+        }
+        if (!forced_backend) {
+            LOG_ERROR("Unknown player backend: %s", g_player_options.backend);
+            return -1;
+        }
+    }
+
+    // 网络媒体磁盘缓存，两个后端共用
+    media_cache_init();
+    for (int i = 0; i < BACKEND_COUNT; i++) {
+        if (!backend_enabled(i)) continue;
+        if (backends[i]->init() != 0) {
+            LOG_ERROR("Failed to initialize %s backend", backends[i]->name);
+            while (--i >= 0) {
+                if (backend_enabled(i)) backends[i]->deinit();
+            }
+            media_cache_deinit();
+            return -1;
+        }
+    }
+    LOG_INFO("Player backend: %s", forced_backend ? forced_backend->name : "auto");
+    return 0;
+}
+
+int player_deinit(void) {
+    for (int i = BACKEND_COUNT - 1; i >= 0; i--) {
+        if (backend_enabled(i)) backends[i]->deinit();
+    }
+    media_cache_deinit();
+    return 0;
+}
+
+static player_impl_t* active_impl(player_t *p, const player_backend_t **backend) {
+    int i = atomic_load_explicit(&p->active, memory_order_acquire);
+    if (backend) *backend = backends[i];
+    return p->impls[i];
+}
+
+// 取得后端实例，不存在时创建；新实例沿用当前的音量和静音
+static player_impl_t* get_impl(player_t *p, int i) {
+    pthread_mutex_lock(&p->create_lock);
+    if (!p->impls[i]) {
+        const player_backend_t *current;
+        player_impl_t *impl = active_impl(p, &current);
+        player_config_t config = { p->name, p->device, p->ctrl_card, p->selem_name,
+                                   p->initial_volume, p->buffer_time };
+        int mute = 0;
+
+        if (impl) {
+            config.initial_volume = current->get_volume(impl);
+            current->get_mute(impl, &mute);
+        }
+        LOG_INFO("[%s] Creating %s backend", p->name, backends[i]->name);
+        p->impls[i] = backends[i]->create(p, &config);
+        if (p->impls[i] && mute) {
+            backends[i]->set_mute(p->impls[i], 1);
+        }
+    }
+    pthread_mutex_unlock(&p->create_lock);
+    return p->impls[i];
+}
+
+// 没有查询串和片段的路径以 .mp3 结尾
+static int is_plain_mp3(const char *uri) {
+    size_t len = strcspn(uri, "?#");
+    return len >= 4 && g_ascii_strncasecmp(uri + len - 4, ".mp3", 4) == 0;
+}
+
+// 已启用的、支持无缝切换的后端，没有时返回-1
+static int gapless_backend(void) {
+    for (int i = 0; i < BACKEND_COUNT; i++) {
+        if (backend_enabled(i) && (backends[i]->caps & PLAYER_CAP_GAPLESS)) return i;
+    }
+    return -1;
+}
+
+// 按 uri 选择后端: 轻量后端能处理(MP3，或它本身支持全部格式)时优先，否则用支持全部格式的后端；
+// 控制点在排队播放时不能交给没有无缝切换能力的后端
+static int choose_backend(player_t *p, const char *uri) {
+    int fallback = -1;
+    for (int i = 0; i < BACKEND_COUNT; i++) {
+        if (backend_enabled(i) && backends[i]->preferred && backends[i]->preferred()) {
+            return i;
+        }
+    }
+    if (p->want_gapless && gapless_backend() >= 0) {
+        return gapless_backend();
+    }
+    for (int i = 0; i < BACKEND_COUNT; i++) {
+        if (!backend_enabled(i)) continue;
+        unsigned int caps = backends[i]->caps;
+        if (forced_backend) return i;
+        if ((caps & PLAYER_CAP_LIGHTWEIGHT) && (is_plain_mp3(uri) || (caps & PLAYER_CAP_ALL_FORMATS))) {
+            return i;
+        }
+        if (fallback < 0 && (caps & PLAYER_CAP_ALL_FORMATS)) {
+            fallback = i;
+        }
+    }
+    return fallback >= 0 ? fallback : 0;
+}
+
+player_t* player_new(const player_config_t *config) {
+    player_t *p = g_new0(player_t, 1);
+    p->name = g_strdup(config && config->name ? config->name : "default");
+    p->device = g_strdup(config && config->device ? config->device : g_player_options.device);
+    p->ctrl_card = g_strdup(config && config->ctrl_card ? config->ctrl_card : g_player_options.ctrl_card);
+    p->selem_name = g_strdup(config && config->selem_name ? config->selem_name : g_player_options.selem_name);
+    p->initial_volume = config && config->initial_volume ? config->initial_volume : g_player_options.initial_volume;
+    p->buffer_time = config && config->buffer_time ? config->buffer_time : g_player_options.buffer_time;
+    pthread_mutex_init(&p->create_lock, NULL);
+    pthread_mutex_init(&p->exec_lock, NULL);
+
+    // 先创建默认后端(auto 时为轻量后端)，其他后端等到第一次需要时再创建
+    int first = choose_backend(p, "default.mp3");
+    atomic_init(&p->active, first);
+    atomic_init(&p->want_gapless, 0);
+    if (!get_impl(p, first)) {
+        LOG_ERROR("[%s] Failed to create %s backend", p->name, backends[first]->name);
+        player_free(p);
+        return NULL;
+    }
+    return p;
+}
+
+void player_free(player_t *p) {
+    if (!p) return;
+    for (int i = 0; i < BACKEND_COUNT; i++) {
+        if (p->impls[i]) backends[i]->destroy(p->impls[i]);
+    }
+    pthread_mutex_destroy(&p->create_lock);
+    pthread_mutex_destroy(&p->exec_lock);
+    g_free(p->name);
+    g_free(p->device);
+    g_free(p->ctrl_card);
+    g_free(p->selem_name);
+    g_free(p);
+}
+
+const char* player_get_name(player_t *p) {
+    return p->name;
+}
+
+// 改变播放状态的调用都来自同一个执行线程(player_actor)，切换后端不会和 play/stop 并发
+int player_play(player_t *p, const char* uri) {
+    const player_backend_t *current;
+    player_impl_t *old = active_impl(p, &current);
+    int i = choose_backend(p, uri);
+
+    if (backends[i] != current) {
+        // 两个后端打开的是同一个 ALSA 设备，先让旧后端释放
+        current->stop(old);
+        player_impl_t *impl = get_impl(p, i);
+        if (!impl) {
+            LOG_ERROR("[%s] %s backend unavailable for %s", p->name, backends[i]->name, uri);
+            return -1;
+        }
+        LOG_INFO("[%s] Switching to %s backend", p->name, backends[i]->name);
+        atomic_store_explicit(&p->active, i, memory_order_release);
+    }
+    return backends[i]->play(p->impls[i], uri);
+}
+
+int player_pause(player_t *p) {
+    const player_backend_t *b;
+    player_impl_t *impl = active_impl(p, &b);
+    return b->pause(impl);
+}
+
+int player_resume(player_t *p) {
+    const player_backend_t *b;
+    player_impl_t *impl = active_impl(p, &b);
+    return b->resume(impl);
+}
+
+int player_stop(player_t *p) {
+    const player_backend_t *b;
+    player_impl_t *impl = active_impl(p, &b);
+    return b->stop(impl);
+}
+
+int player_seek(player_t *p, int seconds) {
+    const player_backend_t *b;
+    player_impl_t *impl = active_impl(p, &b);
+    return b->seek(impl, seconds);
+}
+
+int player_get_position(player_t *p, int* current_sec, int* total_sec) {
+    const player_backend_t *b;
+    player_impl_t *impl = active_impl(p, &b);
+    return b->get_position(impl, current_sec, total_sec);
+}
+
+int player_get_volume(player_t *p) {
+    const player_backend_t *b;
+    player_impl_t *impl = active_impl(p, &b);
+    return b->get_volume(impl);
+}
+
+// 音量和静音同时设置到所有已创建的实例，切换后端后保持一致。
+// 持有 create_lock: 执行线程可能正在 get_impl 中创建实例，新实例要么在这里被设置，
+// 要么创建时就读到设置后的值
+int player_set_volume(player_t *p, int volume) {
+    pthread_mutex_lock(&p->create_lock);
+    const player_backend_t *b;
+    player_impl_t *impl = active_impl(p, &b);
+    int ret = b->set_volume(impl, volume);
+    for (int i = 0; i < BACKEND_COUNT; i++) {
+        if (p->impls[i] && p->impls[i] != impl) backends[i]->set_volume(p->impls[i], volume);
+    }
+    pthread_mutex_unlock(&p->create_lock);
+    return ret;
+}
+
+int player_set_mute(player_t *p, int mute) {
+    pthread_mutex_lock(&p->create_lock);
+    const player_backend_t *b;
+    player_impl_t *impl = active_impl(p, &b);
+    int ret = b->set_mute(impl, mute);
+    for (int i = 0; i < BACKEND_COUNT; i++) {
+        if (p->impls[i] && p->impls[i] != impl) backends[i]->set_mute(p->impls[i], mute);
+    }
+    pthread_mutex_unlock(&p->create_lock);
+    return ret;
+}
+
+int player_get_mute(player_t *p, int *mute) {
+    const player_backend_t *b;
+    player_impl_t *impl = active_impl(p, &b);
+    return b->get_mute(impl, mute);
+}
+
+int player_is_playing(player_t *p) {
+    const player_backend_t *b;
+    player_impl_t *impl = active_impl(p, &b);
+    return b->is_playing(impl);
+}
+
+int player_is_buffering(player_t *p) {
+    const player_backend_t *b;
+    player_impl_t *impl = active_impl(p, &b);
+    return b->is_buffering(impl);
+}
+
+// 下一首交给当前后端。当前后端不能无缝切换时返回错误(控制点收到 716，播完后自己发 Play)，
+// auto 模式下记住控制点在排队，之后的 Play 改用支持无缝切换的后端
+int player_set_next_uri(player_t *p, const char* uri) {
+    const player_backend_t *b;
+    player_impl_t *impl = active_impl(p, &b);
+    if (uri && *uri && !(b->caps & PLAYER_CAP_GAPLESS)) {
+        if (!forced_backend && gapless_backend() >= 0 && !atomic_exchange(&p->want_gapless, 1)) {
+            LOG_INFO("[%s] Next track queued, using %s backend from the next Play",
+                     p->name, backends[gapless_backend()]->name);
+        }
+        LOG_ERROR("[%s] %s backend cannot play a next track gaplessly", p->name, b->name);
+        return -1;
+    }
+    return b->set_next_uri(impl, uri);
+}
+
+void player_set_track_changed_callback(player_t *p, player_track_changed_cb cb, void *userdata) {
+    p->track_changed_cb = cb;
+    p->track_changed_data = userdata;
+}
+
+void player_set_event_callback(player_t *p, player_event_cb cb, void *userdata) {
+    p->event_cb = cb;
+    p->event_data = userdata;
+}
+
+void player_set_executor(player_t *p, player_executor_cb exec, void *userdata) {
+    pthread_mutex_lock(&p->exec_lock);
+    p->executor = exec;
+    p->executor_data = userdata;
+    pthread_mutex_unlock(&p->exec_lock);
+}
+
+void player_backend_run(player_t *owner, player_task_fn fn, void *data) {
+    pthread_mutex_lock(&owner->exec_lock);
+    if (owner->executor) {
+        // 执行器只把任务放进邮箱，持锁调用不会阻塞
+        owner->executor(fn, data, owner->executor_data);
+        pthread_mutex_unlock(&owner->exec_lock);
+        return;
+    }
+    pthread_mutex_unlock(&owner->exec_lock);
+    fn(data);
+}
+
+void player_backend_emit_event(player_t *owner, player_impl_t *from, player_event_t event) {
+    if (from != active_impl(owner, NULL)) return;
+    if (owner->event_cb) owner->event_cb(owner, event, owner->event_data);
+}
+
+void player_backend_emit_track_changed(player_t *owner, player_impl_t *from, const char *uri) {
+    if (from != active_impl(owner, NULL)) return;
+    if (owner->track_changed_cb) owner->track_changed_cb(owner, uri, owner->track_changed_data);
+}
+
+static void exit_loop_sighandler(int sig) {
+    (void)sig;
+    if (main_loop) {
+        g_main_loop_quit(main_loop);
+    }
+}
+
+// 所有实例的总线、进度定时器、混音器事件和 HTTP 传输都挂在默认主循环上
+int run_main_loop(void) {
+    LOG_DEBUG("Starting GLib main loop");
+    main_loop = g_main_loop_new(NULL, FALSE);
+
+    signal(SIGINT, &exit_loop_sighandler);
+    signal(SIGTERM, &exit_loop_sighandler);
+
+    g_main_loop_run(main_loop);
+    g_main_loop_unref(main_loop);
+    main_loop = NULL;
+    return 0;
+}
@@ -0,0 +1,64 @@
+#ifndef PLAYER_BACKEND_H
+#define PLAYER_BACKEND_H
+
+#include "player.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// 播放后端接口: mpg123(player.c) 和 GStreamer(player_gstreamer.c) 各实现一份，同时链接进程序。
+// player_backend.c 实现 player.h，按 --backend 选定后端，或在 auto 模式下按 uri 选择:
+// 普通 MP3 走资源占用小的 mpg123，其余格式交给 GStreamer
+typedef struct player_impl player_impl_t;   // 后端实例，各后端自己定义
+
+#define PLAYER_CAP_GAPLESS      (1u << 0)   // set_next_uri 在当前曲目结束时无缝切换
+#define PLAYER_CAP_ALL_FORMATS  (1u << 1)   // 能解码 MP3 以外的格式
+#define PLAYER_CAP_LIGHTWEIGHT  (1u << 2)   // 内存和 CPU 占用小，能处理的 uri 优先使用
+
+typedef struct {
+    const char *name;
+    unsigned int caps;
+    GOptionEntry *options;      // 后端自己的命令行选项，合并到 player 选项组
+
+    int (*init)(void);
+    int (*deinit)(void);
+    // 可以为 NULL；init 之后返回非 0 时 auto 模式下所有 uri 都交给该后端
+    int (*preferred)(void);
+
+    // config 中为 NULL/0 的项使用后端默认值；owner 用于报告事件
+    player_impl_t* (*create)(player_t *owner, const player_config_t *config);
+    void (*destroy)(player_impl_t *impl);
+
+    int (*play)(player_impl_t *impl, const char *uri);
+    int (*pause)(player_impl_t *impl);
+    int (*resume)(player_impl_t *impl);
+    int (*stop)(player_impl_t *impl);
+    int (*seek)(player_impl_t *impl, int seconds);
+    int (*get_position)(player_impl_t *impl, int *current_sec, int *total_sec);
+    int (*get_volume)(player_impl_t *impl);
+    int (*set_volume)(player_impl_t *impl, int volume);
+    int (*get_mute)(player_impl_t *impl, int *mute);
+    int (*set_mute)(player_impl_t *impl, int mute);
+    int (*is_playing)(player_impl_t *impl);
+    int (*is_buffering)(player_impl_t *impl);
+    int (*set_next_uri)(player_impl_t *impl, const char *uri);
+} player_backend_t;
+
+extern const player_backend_t player_backend_mpg123;
+extern const player_backend_t player_backend_gstreamer;
+
+// 后端报告状态变化和自动切换曲目，可以在任意线程调用，调用时不能持有后端的锁。
+// from 不是当前使用的后端时(切换后端后旧实例的迟到消息)事件被丢弃
+void player_backend_emit_event(player_t *owner, player_impl_t *from, player_event_t event);
+
+void player_backend_emit_track_changed(player_t *owner, player_impl_t *from, const char *uri);
+
+// 在 owner 的执行器中运行 fn(data)，见 player_set_executor
+void player_backend_run(player_t *owner, player_task_fn fn, void *data);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // PLAYER_BACKEND_H
@@ -1,22 +1,35 @@
-#include "player.h"
+#include "player_backend.h"
 #include <gst/gst.h>
 #include <pthread.h>
 #include <string.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdatomic.h>
 #include <glib.h>
+#include <gio/gio.h>
+#include <glib-unix.h>
 #include <alsa/asoundlib.h>
+#include "media_cache.h"
+#include "player_sync.h"
 
-static GstElement *pipeline = NULL;
-static volatile int playing = 0;
-static volatile int paused = 0;
-static gint64 duration_ns = 0;
-static gint64 position_ns = 0;
-static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
-static GMainLoop *main_loop = NULL;
-static int g_running = 0;
-static pthread_t progress_thread;
-static int g_volume_changed_by_controller = 0;//音量改变标致，同步到对应硬件
+// 网络缓冲: 缓冲队列低于低水位时暂停管道，回到高水位后恢复。target_state 是控制点要求的状态，
+// 缓冲引起的暂停不改变它；缓冲期间收到 Pause 时，缓冲完成后也不会自动恢复播放
+#define GST_PLAY_FLAG_DOWNLOAD  (1 << 7)
+#define GST_PLAY_FLAG_BUFFERING (1 << 8)
+
+// 查询用的状态字: 持有 lock 修改 playing/paused/buffering/target_state 后重新发布，
+// player_is_playing/player_is_buffering 不加锁读取，不会被正在切换状态的调用挡住
+#define STATUS_PLAYING   (1 << 0)
+#define STATUS_BUFFERING (1 << 1)
+
+// 硬件混音器: 启动时打开一次并常驻，poll fd 挂到 GLib 主循环，外部修改音量(alsamixer、硬件旋钮)
+// 通过事件同步过来；控制点连续的 SetVolume 合并成一次硬件写入。混音器只在主循环线程中访问
+#define MIXER_COALESCE_MS 50
+
+// 同步播放: 所有房间的管道使用相同的固定延迟，播放位置相对共享时钟的偏移才可以比较；
+// 跳转用 ACCURATE 保证各房间从同一个采样开始
+#define SYNC_LATENCY (100 * GST_MSECOND)
+#define SYNC_PREROLL_TIMEOUT (5 * GST_SECOND)
 
 typedef struct {
     const char* device;//播放设备
@@ -25,68 +38,306 @@ typedef struct {
     int buffer_time;//缓冲时间
     int latency_time;//延迟时间
     int initial_volume;//初始音量(未设置的话会读取默认硬件音量)
+    gboolean adaptive_buffer;//根据欠载情况在曲目之间自动调整缓冲
+    int buffer_min;//自适应缓冲时间下限(微秒)
+    int buffer_max;//自适应缓冲时间上限(微秒)
+    int buffer_low;//网络缓冲低水位(百分比)，低于它时暂停
+    int buffer_high;//网络缓冲高水位(百分比)，达到后恢复播放
+    int buffer_duration;//网络缓冲时长(毫秒)，0 使用 playbin 默认值
+    int buffer_size;//网络缓冲大小(KB)，0 使用 playbin 默认值
+    gboolean download;//渐进式下载到临时文件，适合慢速网络
 } PlayerOptions;
 
+// 命令行选项，所有实例共用；device/ctrl_card/selem_name/buffer_time/initial_volume 是实例配置的默认值，
+// 由公共选项(--device、--ctrl 等)覆盖
 static PlayerOptions g_player_options = {
     .device = "hw:0,0",
     .ctrl_card = "hw:0",
     .selem_name = "DAC volume",
     .buffer_time = 200000,
     .latency_time = 10000,
-    .initial_volume = 0
+    .initial_volume = 0,
+    .adaptive_buffer = FALSE,
+    .buffer_min = 40000,
+    .buffer_max = 1000000,
+    .buffer_low = 10,
+    .buffer_high = 99,
+    .buffer_duration = 0,
+    .buffer_size = 0,
+    .download = FALSE
 };
 
 static GOptionEntry player_option_entries[] = {
-    { "device", 'd', 0, G_OPTION_ARG_STRING, &g_player_options.device,
-      "ALSA sound card device(e.g., hw:0,0)", "CARD DEVICE" },
-    { "ctrl", 'c', 0, G_OPTION_ARG_STRING, &g_player_options.ctrl_card,
-      "ALSA sound ctrl card (e.g., hw:0)", "CTRL CARD" },
-    { "selem-name", 's', 0, G_OPTION_ARG_STRING, &g_player_options.selem_name,
-      "ALSA element name (e.g., DAC volume)", "SELEM" },
-    { "buffer-time", 'B', 0, G_OPTION_ARG_INT, &g_player_options.buffer_time,
-      "GStreamer buffer time in microseconds (default: 200000)", "TIME" },
     { "latency-time", 'L', 0, G_OPTION_ARG_INT, &g_player_options.latency_time,
       "GStreamer latency time in microseconds (default: 10000)", "TIME" },
-    { "volume", 'V', 0, G_OPTION_ARG_INT, &g_player_options.initial_volume,
-      "Initial volume level (0-100, default: 0)", "VOLUME" },
+    { "adaptive-buffer", 'A', 0, G_OPTION_ARG_NONE, &g_player_options.adaptive_buffer,
+      "Tune buffer/latency time between tracks from underrun feedback", NULL },
+    { "buffer-min", 0, 0, G_OPTION_ARG_INT, &g_player_options.buffer_min,
+      "Adaptive buffer time lower bound in microseconds (default: 40000)", "TIME" },
+    { "buffer-max", 0, 0, G_OPTION_ARG_INT, &g_player_options.buffer_max,
+      "Adaptive buffer time upper bound in microseconds (default: 1000000)", "TIME" },
+    { "buffer-low", 0, 0, G_OPTION_ARG_INT, &g_player_options.buffer_low,
+      "Network buffer low watermark in percent, pause below it (default: 10)", "PERCENT" },
+    { "buffer-high", 0, 0, G_OPTION_ARG_INT, &g_player_options.buffer_high,
+      "Network buffer high watermark in percent, resume at it (default: 99)", "PERCENT" },
+    { "buffer-duration", 0, 0, G_OPTION_ARG_INT, &g_player_options.buffer_duration,
+      "Network buffer duration in milliseconds (default: playbin default)", "MS" },
+    { "buffer-size", 0, 0, G_OPTION_ARG_INT, &g_player_options.buffer_size,
+      "Network buffer size in KB (default: playbin default)", "KB" },
+    { "download", 0, 0, G_OPTION_ARG_NONE, &g_player_options.download,
+      "Progressively download network streams to a temporary file", NULL },
     { NULL }
 };
 
-// 获取播放器选项组
-GOptionGroup* player_get_option_group(void) {
-    GOptionGroup *group = g_option_group_new(
-        "player",
-        "Player Options",
-        "Show player configuration options",
-        NULL,
-        NULL
-    );
-    
-    g_option_group_add_entries(group, player_option_entries);
-    return group;
+// 自适应缓冲: 播放中统计欠载(音频时钟停滞、alsasink 丢弃迟到数据的 QoS 消息)和时钟漂移，
+// 在下一首开始前(管道处于 READY，alsasink 还没申请环形缓冲区)放大或缩小 buffer-time/latency-time
+#define ADAPT_GROW_NUM 3            // 有欠载时放大到 3/2
+#define ADAPT_GROW_DEN 2
+#define ADAPT_SHRINK_NUM 4          // 连续若干首没有欠载时缩小到 4/5
+#define ADAPT_SHRINK_DEN 5
+#define ADAPT_CLEAN_TRACKS 3        // 连续多少首没有欠载才缩小
+#define ADAPT_DRIFT_PPM 1000        // 时钟漂移超过此值也视为缓冲不足
+#define ADAPT_MIN_LATENCY 1000      // latency-time 下限(微秒)
+
+typedef struct {
+    int buffer_time;                // 当前使用的值(微秒)
+    int latency_time;
+    int periods;                    // buffer_time / latency_time，调整时保持不变
+    atomic_int underruns;           // 本首曲目的欠载次数
+    int clean_tracks;               // 连续没有欠载的曲目数
+    gint64 last_pos;                // 上一次采样的播放位置(ns)，0 表示需要重新取基准
+    gint64 last_wall;               // 上一次采样的单调时钟(us)
+    double drift_ppm;               // 播放位置相对单调时钟的漂移(指数平均)
+} adapt_state_t;
+
+// 播放位置快照(seqlock): 进度定时器、总线回调以及 stop/seek 发布，写者之间用 write_lock 互斥；
+// 读者不加锁，序号为奇数或前后不一致时重试。PLAYING 状态下读者按单调时钟从取样时刻往后插值，
+// 控制点轮询 GetPositionInfo 不必查询管道，也不会和 Play/Seek 抢锁
+#define SNAPSHOT_KEEP (-2)   // 写入时保留原值
+
+typedef struct {
+    atomic_uint seq;
+    atomic_llong position_ns;   // -1 表示未知
+    atomic_llong duration_ns;   // -1 表示未知
+    atomic_int state;           // GstState
+    atomic_llong stamp_us;      // 取样时的单调时钟
+    pthread_mutex_t write_lock;
+} snapshot_t;
+
+struct player_impl {
+    player_t *owner;
+    gchar *name;
+    gchar *device;
+    gchar *ctrl_card;
+    gchar *selem_name;
+    int buffer_time;
+
+    GstElement *pipeline;
+    volatile int playing;
+    volatile int paused;
+    pthread_mutex_t lock;
+    guint progress_source_id;       // 播放进度定时器，只在 PLAYING 状态下存在
+    guint bus_watch_id;
+
+    // 无缝播放: about-to-finish 在流线程中回调，使用单独的锁，不和状态切换(持有 lock)互相等待
+    pthread_mutex_t next_lock;
+    gchar *next_uri;                // SetNextAVTransportURI 设置的下一首
+    gchar *switched_uri;            // 已在 about-to-finish 中切换，等待 stream-start 确认
+
+    GstState target_state;          // 由 lock 保护
+    int buffering;                  // 由 lock 保护
+    int is_live;                    // 直播源不能暂停等待缓冲
+    atomic_int published_status;
+
+    int volume;                     // 当前音量(0-100)，由 lock 保护
+
+    snd_mixer_t *mixer_handle;
+    snd_mixer_elem_t *mixer_elem;   // 由 lock 保护
+    long mixer_min, mixer_max;
+    long mixer_last_raw;            // 最近一次写入的硬件值，用来忽略自己引起的事件
+    int mixer_has_switch;           // 元素是否带静音开关
+    guint *mixer_watch_ids;
+    int mixer_nwatches;
+    guint mixer_flush_id;           // 合并写入定时器，由 lock 保护
+    int mixer_pending_volume;       // 待写入的音量(0-100)，-1 表示没有
+    int mixer_pending_mute;         // 待写入的静音状态，-1 表示没有
+    int mixer_muted;
+
+    adapt_state_t adapt;
+    snapshot_t snapshot;
+
+    player_sync_member_t *sync;     // 未启用同步时为 NULL
+    gchar *sync_uri;                // 当前曲目的原始 uri，由 next_lock 保护
+};
+
+// 不能在持有 lock 时调用
+static void emit_event(player_impl_t *p, player_event_t event) {
+    player_backend_emit_event(p->owner, p, event);
 }
 
-// 实时获取播放进度线程
-static void* update_track_time_thread(void* arg) {
-    GstFormat fmt = GST_FORMAT_TIME;
-    gint64 pos = 0;
-    LOG_DEBUG("-----[%s] starting-----",__func__);
+// 调用者持有 lock
+static void publish_status(player_impl_t *p) {
+    int status = 0;
+    // 缓冲引起的暂停对控制点来说仍是播放中
+    if (p->playing && (!p->paused || (p->buffering && p->target_state == GST_STATE_PLAYING))) {
+        status |= STATUS_PLAYING;
+    }
+    if (p->buffering && p->target_state == GST_STATE_PLAYING) {
+        status |= STATUS_BUFFERING;
+    }
+    atomic_store_explicit(&p->published_status, status, memory_order_release);
+}
 
-    while (g_running) {
-	if(paused){
-	   g_usleep(1000000);
-	   continue;
-	};
-	if(playing){
-           if (gst_element_query_position(pipeline, fmt, &pos)) {
-               LOG_INFO("Current position: %" GST_TIME_FORMAT, GST_TIME_ARGS(pos));
-           }
-	}
-        g_usleep(1000000); // 1秒刷新一次
+// 每秒采样一次: 位置前进明显慢于实际时间说明音频时钟停了(欠载)，否则累计漂移
+static void adaptive_buffer_sample(player_impl_t *p, gint64 pos) {
+    adapt_state_t *adapt = &p->adapt;
+    gint64 wall = g_get_monotonic_time();
+    if (adapt->last_pos > 0 && pos > adapt->last_pos) {
+        gint64 d_pos = pos - adapt->last_pos;
+        gint64 d_wall = (wall - adapt->last_wall) * GST_USECOND;
+        gint64 stall = d_wall - d_pos;
+        if (stall > GST_SECOND / 2 || stall < -GST_SECOND / 2) {
+            // 位置跳变(seek、缓冲)，不计入统计
+        } else if (stall > 2 * (gint64)adapt->latency_time * GST_USECOND) {
+            adapt->underruns++;
+            LOG_DEBUG("Audio clock stalled %" G_GINT64_FORMAT " us, counting underrun", stall / GST_USECOND);
+        } else if (d_wall > 0) {
+            double ppm = (double)(d_pos - d_wall) * 1e6 / (double)d_wall;
+            adapt->drift_ppm = adapt->drift_ppm * 0.9 + ppm * 0.1;
+        }
     }
-    LOG_DEBUG("-----[%s] end-----",__func__);
+    adapt->last_pos = pos;
+    adapt->last_wall = wall;
+}
+
+// 在 READY 状态下调用，根据上一首的统计结果决定新的缓冲参数
+static void adaptive_buffer_apply(player_impl_t *p) {
+    adapt_state_t *adapt = &p->adapt;
+    if (!g_player_options.adaptive_buffer) return;
+
+    int underruns = atomic_exchange(&adapt->underruns, 0);
+    int buffer_time = adapt->buffer_time;
+    int drifting = adapt->drift_ppm > ADAPT_DRIFT_PPM || adapt->drift_ppm < -ADAPT_DRIFT_PPM;
+
+    if (underruns > 0 || drifting) {
+        buffer_time = buffer_time * ADAPT_GROW_NUM / ADAPT_GROW_DEN;
+        adapt->clean_tracks = 0;
+    } else if (++adapt->clean_tracks >= ADAPT_CLEAN_TRACKS) {
+        buffer_time = buffer_time * ADAPT_SHRINK_NUM / ADAPT_SHRINK_DEN;
+        adapt->clean_tracks = 0;
+    }
+    if (buffer_time > g_player_options.buffer_max) buffer_time = g_player_options.buffer_max;
+    if (buffer_time < g_player_options.buffer_min) buffer_time = g_player_options.buffer_min;
+    adapt->drift_ppm = 0;
+    adapt->last_pos = 0;
+    if (buffer_time == adapt->buffer_time) return;
 
-    return NULL;
+    int latency_time = buffer_time / adapt->periods;
+    if (latency_time < ADAPT_MIN_LATENCY) latency_time = ADAPT_MIN_LATENCY;
+
+    GstElement *audio_sink = NULL;
+    g_object_get(p->pipeline, "audio-sink", &audio_sink, NULL);
+    if (!audio_sink) return;
+    g_object_set(audio_sink, "buffer-time", (gint64)buffer_time, "latency-time", (gint64)latency_time, NULL);
+    gst_object_unref(audio_sink);
+
+    LOG_INFO("[%s] Adaptive buffer: %d underruns, drift %.0f ppm -> buffer-time %d us, latency-time %d us",
+             p->name, underruns, drifting ? adapt->drift_ppm : 0.0, buffer_time, latency_time);
+    adapt->buffer_time = buffer_time;
+    adapt->latency_time = latency_time;
+}
+
+static void adaptive_buffer_init(player_impl_t *p) {
+    adapt_state_t *adapt = &p->adapt;
+    adapt->buffer_time = p->buffer_time;
+    adapt->latency_time = g_player_options.latency_time > 0 ? g_player_options.latency_time : ADAPT_MIN_LATENCY;
+    adapt->periods = adapt->buffer_time / adapt->latency_time;
+    if (adapt->periods < 2) adapt->periods = 2;
+    atomic_init(&adapt->underruns, 0);
+}
+
+static void snapshot_store(player_impl_t *p, gint64 pos, gint64 dur, int state) {
+    snapshot_t *snapshot = &p->snapshot;
+    pthread_mutex_lock(&snapshot->write_lock);
+    unsigned int seq = atomic_load_explicit(&snapshot->seq, memory_order_relaxed);
+    atomic_store_explicit(&snapshot->seq, seq + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    if (pos != SNAPSHOT_KEEP) {
+        atomic_store_explicit(&snapshot->position_ns, pos, memory_order_relaxed);
+    }
+    if (dur != SNAPSHOT_KEEP) {
+        atomic_store_explicit(&snapshot->duration_ns, dur, memory_order_relaxed);
+    }
+    if (state != SNAPSHOT_KEEP) {
+        atomic_store_explicit(&snapshot->state, state, memory_order_relaxed);
+    }
+    atomic_store_explicit(&snapshot->stamp_us, g_get_monotonic_time(), memory_order_relaxed);
+
+    atomic_store_explicit(&snapshot->seq, seq + 2, memory_order_release);
+    pthread_mutex_unlock(&snapshot->write_lock);
+}
+
+static void snapshot_load(player_impl_t *p, gint64 *pos, gint64 *dur, int *state, gint64 *stamp) {
+    snapshot_t *snapshot = &p->snapshot;
+    for (;;) {
+        unsigned int seq = atomic_load_explicit(&snapshot->seq, memory_order_acquire);
+        if (seq & 1) continue;  // 正在写入
+        *pos = atomic_load_explicit(&snapshot->position_ns, memory_order_relaxed);
+        *dur = atomic_load_explicit(&snapshot->duration_ns, memory_order_relaxed);
+        *state = atomic_load_explicit(&snapshot->state, memory_order_relaxed);
+        *stamp = atomic_load_explicit(&snapshot->stamp_us, memory_order_relaxed);
+        atomic_thread_fence(memory_order_acquire);
+        if (atomic_load_explicit(&snapshot->seq, memory_order_relaxed) == seq) return;
+    }
+}
+
+// 查询管道并发布快照，只在主循环线程调用；查询失败(seek、切换中)时保留上一次的值
+static void snapshot_update(player_impl_t *p, int state) {
+    gint64 pos = SNAPSHOT_KEEP, dur = SNAPSHOT_KEEP;
+    if (state == SNAPSHOT_KEEP) {
+        state = atomic_load(&p->snapshot.state);
+    }
+    if (state >= GST_STATE_PAUSED) {
+        gint64 v;
+        if (gst_element_query_position(p->pipeline, GST_FORMAT_TIME, &v)) pos = v;
+        if (gst_element_query_duration(p->pipeline, GST_FORMAT_TIME, &v)) dur = v;
+    } else {
+        pos = -1;
+        dur = -1;
+    }
+    snapshot_store(p, pos, dur, state);
+}
+
+// 实时获取播放进度，1秒刷新一次，两次之间由读者插值
+static gboolean update_track_time(gpointer data) {
+    player_impl_t *p = data;
+    snapshot_update(p, GST_STATE_PLAYING);
+    gint64 pos = atomic_load(&p->snapshot.position_ns);
+    if (pos >= 0) {
+        LOG_INFO("[%s] Current position: %" GST_TIME_FORMAT, p->name, GST_TIME_ARGS(pos));
+        if (g_player_options.adaptive_buffer) {
+            adaptive_buffer_sample(p, pos);
+        }
+        if (p->sync) {
+            // 播放位置减去管道运行时间，各房间对齐时这个值相同
+            GstClockTime now = gst_clock_get_time(player_sync_get_clock());
+            GstClockTime base_time = gst_element_get_base_time(p->pipeline);
+            player_sync_report(p->sync, pos - (gint64)(now - base_time));
+        }
+    }
+    return G_SOURCE_CONTINUE;
+}
+
+// 进入 PLAYING 时挂上定时器，离开时移除，暂停/停止状态下主循环不会被唤醒
+static void set_progress_timer(player_impl_t *p, gboolean enable) {
+    p->adapt.last_pos = 0;  // 暂停/恢复后重新取采样基准
+    if (enable && !p->progress_source_id) {
+        p->progress_source_id = g_timeout_add_seconds(1, update_track_time, p);
+    } else if (!enable && p->progress_source_id) {
+        g_source_remove(p->progress_source_id);
+        p->progress_source_id = 0;
+    }
 }
 
 static void query_audio_stream_info(GstElement *pipeline) {
@@ -158,16 +409,20 @@ static void query_audio_stream_info(GstElement *pipeline) {
     gst_object_unref(audio_sink);
 }
 
-// 总线回调
+// 总线回调，每个实例的管道各有一条总线
 static gboolean bus_callback(GstBus *bus, GstMessage *msg, gpointer data) {
-    (void)bus; (void)data;
+    (void)bus;
+    player_impl_t *p = data;
 
     switch (GST_MESSAGE_TYPE(msg)) {
     	case GST_MESSAGE_EOS:
-    	    LOG_DEBUG("[%s] End of stream reached",__func__);
-    	    pthread_mutex_lock(&lock);
-    	    playing = 0;
-    	    pthread_mutex_unlock(&lock);
+    	    LOG_DEBUG("[%s] End of stream reached", p->name);
+    	    pthread_mutex_lock(&p->lock);
+    	    p->playing = 0;
+    	    publish_status(p);
+    	    pthread_mutex_unlock(&p->lock);
+    	    snapshot_update(p, GST_STATE_PAUSED);  // 停在结尾，不再插值
+    	    emit_event(p, PLAYER_EVENT_STOPPED);
     	    break;
 
     	case GST_MESSAGE_ERROR: {
@@ -176,8 +431,8 @@ static gboolean bus_callback(GstBus *bus, GstMessage *msg, gpointer data) {
     	    gst_message_parse_error(msg, &err, &debug);
 
     	    // 添加详细的错误诊断
-    	    LOG_ERROR("GStreamer error: %s (domain: %d, code: %d)",
-    	              err->message, err->domain, err->code);
+    	    LOG_ERROR("[%s] GStreamer error: %s (domain: %d, code: %d)",
+    	              p->name, err->message, err->domain, err->code);
 
     	    // 检查特定错误类型
     	    if (err->domain == GST_RESOURCE_ERROR) {
@@ -200,53 +455,108 @@ static gboolean bus_callback(GstBus *bus, GstMessage *msg, gpointer data) {
     	    g_error_free(err);
     	    g_free(debug);
 
-    	    pthread_mutex_lock(&lock);
-    	    playing = 0;
-    	    pthread_mutex_unlock(&lock);
+    	    pthread_mutex_lock(&p->lock);
+    	    p->playing = 0;
+    	    publish_status(p);
+    	    pthread_mutex_unlock(&p->lock);
+    	    snapshot_store(p, -1, -1, GST_STATE_NULL);
+    	    emit_event(p, PLAYER_EVENT_STOPPED);
     	    break;
     	}
     	//pipeline状态变化
     	case GST_MESSAGE_STATE_CHANGED:
-    	    if (GST_MESSAGE_SRC(msg) == GST_OBJECT(pipeline)) {
+    	    if (GST_MESSAGE_SRC(msg) == GST_OBJECT(p->pipeline)) {
     	        GstState old_state, new_state, pending;
     	        gst_message_parse_state_changed(msg, &old_state, &new_state, &pending);
-    	        LOG_DEBUG("State changed: %s -> %s (pending: %s)",
+    	        LOG_DEBUG("[%s] State changed: %s -> %s (pending: %s)", p->name,
     	                  gst_element_state_get_name(old_state),
     	                  gst_element_state_get_name(new_state),
     	                  gst_element_state_get_name(pending));
 
-    	        pthread_mutex_lock(&lock);
+    	        int event = -1;
+    	        pthread_mutex_lock(&p->lock);
     	        if (new_state == GST_STATE_PLAYING) {
-		    query_audio_stream_info(pipeline);
-    	            playing = 1;
-    	            paused = 0;
+		    query_audio_stream_info(p->pipeline);
+    	            p->playing = 1;
+    	            p->paused = 0;
+    	            event = PLAYER_EVENT_PLAYING;
     	        } else if (new_state == GST_STATE_PAUSED) {
-    	            paused = 1;
+    	            p->paused = 1;
+    	            // 预卷和缓冲引起的 PAUSED 不算暂停
+    	            if (p->target_state == GST_STATE_PAUSED) event = PLAYER_EVENT_PAUSED;
     	        } else if (new_state == GST_STATE_READY) {
     	        } else if (new_state == GST_STATE_NULL) {
-    	            playing = 0;
+    	            p->playing = 0;
     	        }
-    	        pthread_mutex_unlock(&lock);
+    	        publish_status(p);
+    	        pthread_mutex_unlock(&p->lock);
+    	        snapshot_update(p, new_state);
+    	        set_progress_timer(p, new_state == GST_STATE_PLAYING);
+    	        if (event >= 0) emit_event(p, (player_event_t)event);
     	    }
     	    break;
 
+    	case GST_MESSAGE_ASYNC_DONE:
+    	case GST_MESSAGE_DURATION_CHANGED:
+    	    // seek 完成、时长确定后重新取样
+    	    snapshot_update(p, SNAPSHOT_KEEP);
+    	    break;
+
     	case GST_MESSAGE_BUFFERING: {
     	    gint percent = 0;
     	    gst_message_parse_buffering(msg, &percent);
-    	    LOG_DEBUG("Buffering: %d%%", percent);
-
-    	//    // 处理网络流缓冲
-    	//    if (percent < 10) {
-    	//        gst_element_set_state(pipeline, GST_STATE_PAUSED);
-    	//    } else {
-    	//        gst_element_set_state(pipeline, GST_STATE_PLAYING);
-    	//    }
-    	//    break;
+    	    LOG_DEBUG("[%s] Buffering: %d%%", p->name, percent);
+
+    	    // 缓冲队列在低于低水位后发出 <100%，到达高水位时发出 100%
+    	    int started = 0;
+    	    pthread_mutex_lock(&p->lock);
+    	    if (!p->is_live) {
+    	        if (percent < 100 && !p->buffering) {
+    	            p->buffering = 1;
+    	            started = (p->target_state == GST_STATE_PLAYING);
+    	            LOG_INFO("[%s] Buffer underflow, pausing to rebuffer", p->name);
+    	            if (p->target_state == GST_STATE_PLAYING) {
+    	                gst_element_set_state(p->pipeline, GST_STATE_PAUSED);
+    	            }
+    	        } else if (percent >= 100 && p->buffering) {
+    	            p->buffering = 0;
+    	            LOG_INFO("[%s] Buffer refilled", p->name);
+    	            if (p->target_state == GST_STATE_PLAYING) {
+    	                gst_element_set_state(p->pipeline, GST_STATE_PLAYING);
+    	            }
+    	        }
+    	    }
+    	    publish_status(p);
+    	    pthread_mutex_unlock(&p->lock);
+    	    if (started) emit_event(p, PLAYER_EVENT_BUFFERING);
+    	    break;
     	}
 
-    	case GST_MESSAGE_STREAM_START:
-    	    LOG_DEBUG("Stream started");
+    	case GST_MESSAGE_QOS: {
+    	    // 音频 sink 丢弃迟到数据时发出 QoS 消息，说明缓冲区已经见底
+    	    if (g_player_options.adaptive_buffer &&
+    	        g_strcmp0(GST_OBJECT_NAME(GST_MESSAGE_SRC(msg)), "audio-output") == 0) {
+    	        p->adapt.underruns++;
+    	        LOG_DEBUG("QoS from audio sink, counting underrun");
+    	    }
     	    break;
+    	}
+
+    	case GST_MESSAGE_STREAM_START: {
+    	    LOG_DEBUG("[%s] Stream started", p->name);
+    	    snapshot_update(p, SNAPSHOT_KEEP);
+    	    // 无缝切换后，新曲目的 stream-start 到达时才算真正切换，通知上层更新当前 uri
+    	    pthread_mutex_lock(&p->next_lock);
+    	    gchar *uri = p->switched_uri;
+    	    p->switched_uri = NULL;
+    	    pthread_mutex_unlock(&p->next_lock);
+    	    if (uri) {
+    	        LOG_INFO("[%s] Gapless switch to: %s", p->name, uri);
+    	        player_backend_emit_track_changed(p->owner, p, uri);
+    	        g_free(uri);
+    	    }
+    	    break;
+    	}
 
     	default:
     	    //LOG_DEBUG("Received %s message", GST_MESSAGE_TYPE_NAME(msg));
@@ -255,28 +565,361 @@ static gboolean bus_callback(GstBus *bus, GstMessage *msg, gpointer data) {
     return TRUE;
 }
 
-static GstState get_current_player_state() {
+// 磁盘缓存填充: 在 HTTP 源的输出 pad 上挂探针，数据原样流过的同时写入缓存，不改动管道
+typedef struct {
+    gchar *url;
+    media_cache_writer_t *writer;
+    gchar *cached_etag;     // 已有(过期)条目的 ETag，用于判断内容是否变化
+    guint64 written;
+    gboolean done;          // 已提交、已放弃或不需要缓存
+} cache_fill_t;
+
+static void cache_fill_free(gpointer data) {
+    cache_fill_t *fill = data;
+    // 管道销毁时还没写完(停止、出错)，丢弃
+    media_cache_abort(fill->writer);
+    g_free(fill->url);
+    g_free(fill->cached_etag);
+    g_free(fill);
+}
+
+static void cache_fill_stop(cache_fill_t *fill) {
+    media_cache_abort(fill->writer);
+    fill->writer = NULL;
+    fill->done = TRUE;
+}
+
+typedef struct {
+    const gchar *etag;
+    const gchar *last_modified;
+    gint64 length;
+} http_validators_t;
+
+static gboolean find_validator(GQuark field, const GValue *value, gpointer data) {
+    http_validators_t *v = data;
+    const gchar *name = g_quark_to_string(field);
+    if (!G_VALUE_HOLDS_STRING(value)) return TRUE;
+    if (g_ascii_strcasecmp(name, "ETag") == 0) {
+        v->etag = g_value_get_string(value);
+    } else if (g_ascii_strcasecmp(name, "Last-Modified") == 0) {
+        v->last_modified = g_value_get_string(value);
+    } else if (g_ascii_strcasecmp(name, "Content-Length") == 0) {
+        v->length = g_ascii_strtoll(g_value_get_string(value), NULL, 10);
+    }
+    return TRUE;
+}
+
+// souphttpsrc 在第一个缓冲区之前发出 http-headers 粘性事件，带有完整的响应头
+static void cache_fill_start(cache_fill_t *fill, const GstStructure *headers) {
+    http_validators_t v = { NULL, NULL, -1 };
+    const GstStructure *resp = NULL;
+
+    if (headers && gst_structure_has_field_typed(headers, "response-headers", GST_TYPE_STRUCTURE)) {
+        resp = gst_value_get_structure(gst_structure_get_value(headers, "response-headers"));
+        gst_structure_foreach(resp, find_validator, &v);
+    }
+    if (fill->cached_etag && v.etag && strcmp(fill->cached_etag, v.etag) == 0) {
+        // 内容没有变化，只刷新校验时间，不必重新写入
+        media_cache_revalidated(fill->url);
+        fill->done = TRUE;
+        return;
+    }
+    fill->writer = media_cache_begin(fill->url, v.etag, v.last_modified, v.length);
+    if (!fill->writer) fill->done = TRUE;
+}
+
+static GstPadProbeReturn cache_fill_probe(GstPad *pad, GstPadProbeInfo *info, gpointer data) {
+    (void)pad;
+    cache_fill_t *fill = data;
+    if (fill->done) return GST_PAD_PROBE_OK;
+
+    if (info->type & GST_PAD_PROBE_TYPE_BUFFER) {
+        GstBuffer *buf = GST_PAD_PROBE_INFO_BUFFER(info);
+        if (!fill->writer) {
+            // 没有收到 http-headers 事件(旧版本 souphttpsrc)，不带校验信息写入
+            if (GST_BUFFER_OFFSET(buf) != 0) {
+                fill->done = TRUE;
+                return GST_PAD_PROBE_OK;
+            }
+            cache_fill_start(fill, NULL);
+            if (fill->done) return GST_PAD_PROBE_OK;
+        }
+        // 只缓存从头开始的连续数据，中途 seek 后放弃
+        if (GST_BUFFER_OFFSET_IS_VALID(buf) && GST_BUFFER_OFFSET(buf) != fill->written) {
+            cache_fill_stop(fill);
+            return GST_PAD_PROBE_OK;
+        }
+        GstMapInfo map;
+        if (gst_buffer_map(buf, &map, GST_MAP_READ)) {
+            if (media_cache_write(fill->writer, map.data, map.size) < 0) {
+                cache_fill_stop(fill);
+            }
+            fill->written += map.size;
+            gst_buffer_unmap(buf, &map);
+        }
+    } else if (info->type & GST_PAD_PROBE_TYPE_EVENT_DOWNSTREAM) {
+        GstEvent *event = GST_PAD_PROBE_INFO_EVENT(info);
+        switch (GST_EVENT_TYPE(event)) {
+        case GST_EVENT_CUSTOM_DOWNSTREAM_STICKY:
+            if (!fill->writer && gst_event_has_name(event, "http-headers")) {
+                cache_fill_start(fill, gst_event_get_structure(event));
+            }
+            break;
+        case GST_EVENT_FLUSH_START:
+            cache_fill_stop(fill);
+            break;
+        case GST_EVENT_EOS:
+            media_cache_commit(fill->writer);
+            fill->writer = NULL;
+            fill->done = TRUE;
+            break;
+        default:
+            break;
+        }
+    }
+    return GST_PAD_PROBE_OK;
+}
+
+// playbin 创建源元素时回调(包括无缝切换到下一首)
+static void on_source_setup(GstElement *playbin, GstElement *source, gpointer data) {
+    (void)playbin; (void)data;
+    gchar *location = NULL;
+    media_cache_entry_t cached;
+
+    if (!media_cache_enabled() || !g_object_class_find_property(G_OBJECT_GET_CLASS(source), "location")) {
+        return;
+    }
+    g_object_get(source, "location", &location, NULL);
+    if (!location || (strncmp(location, "http://", 7) != 0 && strncmp(location, "https://", 8) != 0)) {
+        g_free(location);
+        return;
+    }
+
+    cache_fill_t *fill = g_new0(cache_fill_t, 1);
+    fill->url = location;
+    if (media_cache_lookup(location, &cached) == 0) {
+        fill->cached_etag = g_strdup(cached.etag);
+        media_cache_entry_clear(&cached);
+    }
+    GstPad *pad = gst_element_get_static_pad(source, "src");
+    gst_pad_add_probe(pad, GST_PAD_PROBE_TYPE_BUFFER | GST_PAD_PROBE_TYPE_EVENT_DOWNSTREAM,
+                      cache_fill_probe, fill, cache_fill_free);
+    gst_object_unref(pad);
+}
+
+// 缓存中有未过期的条目时改为播放本地文件，返回新分配的 uri，否则返回 NULL
+static gchar* cached_uri(const char *uri) {
+    media_cache_entry_t cached;
+    gchar *file_uri = NULL;
+
+    if (media_cache_lookup(uri, &cached) == 0) {
+        if (cached.fresh) {
+            file_uri = gst_filename_to_uri(cached.path, NULL);
+            LOG_INFO("Playing %s from cache", uri);
+        }
+        media_cache_entry_clear(&cached);
+    }
+    return file_uri;
+}
+
+// playbin 把当前曲目的数据全部送完时在流线程中回调，
+// 此时设置新 uri，playbin 会在同一个 pipeline 内预先打开下一首并无缝衔接，不经过 READY 状态
+static void on_about_to_finish(GstElement *playbin, gpointer data) {
+    player_impl_t *p = data;
+    pthread_mutex_lock(&p->next_lock);
+    if (p->next_uri) {
+        LOG_INFO("[%s] About to finish, queue next uri: %s", p->name, p->next_uri);
+        gchar *file_uri = cached_uri(p->next_uri);
+        g_object_set(playbin, "uri", file_uri ? file_uri : p->next_uri, NULL);
+        g_free(file_uri);
+        g_free(p->switched_uri);
+        p->switched_uri = p->next_uri;
+        p->next_uri = NULL;
+    }
+    pthread_mutex_unlock(&p->next_lock);
+}
+
+static void on_next_host_resolved(GObject *source, GAsyncResult *res, gpointer data) {
+    gchar *host = data;
+    GError *err = NULL;
+    GList *addrs = g_resolver_lookup_by_name_finish(G_RESOLVER(source), res, &err);
+    if (addrs) {
+        LOG_DEBUG("Pre-resolved next host: %s", host);
+        g_resolver_free_addresses(addrs);
+    } else {
+        LOG_ERROR("Failed to resolve next host %s: %s", host, err ? err->message : "unknown");
+        g_clear_error(&err);
+    }
+    g_free(host);
+}
+
+static int playbin_set_next_uri(player_impl_t *p, const char* uri) {
+    gchar *new_uri = NULL;
+
+    if (uri && *uri) {
+        // 提前检查 uri 和协议，避免到 about-to-finish 时才发现无法播放
+        if (!gst_uri_is_valid(uri)) {
+            LOG_ERROR("Invalid next uri: %s", uri);
+            return -1;
+        }
+        gchar *protocol = gst_uri_get_protocol(uri);
+        gboolean supported = gst_uri_protocol_is_supported(GST_URI_SRC, protocol);
+        g_free(protocol);
+        if (!supported) {
+            LOG_ERROR("Unsupported next uri protocol: %s", uri);
+            return -1;
+        }
+        new_uri = g_strdup(uri);
+
+        // 预先解析主机名，切换时 souphttpsrc 连接不必再等 DNS
+        GstUri *parsed = gst_uri_from_string(uri);
+        const gchar *host = parsed ? gst_uri_get_host(parsed) : NULL;
+        if (host && *host) {
+            GResolver *resolver = g_resolver_get_default();
+            g_resolver_lookup_by_name_async(resolver, host, NULL,
+                                            on_next_host_resolved, g_strdup(host));
+            g_object_unref(resolver);
+        }
+        if (parsed) gst_uri_unref(parsed);
+    }
+
+    pthread_mutex_lock(&p->next_lock);
+    g_free(p->next_uri);
+    p->next_uri = new_uri;
+    pthread_mutex_unlock(&p->next_lock);
+    // 组员各自在同一个运行时间点无缝切换，保持对齐
+    player_sync_announce(p->sync, SYNC_CMD_NEXT, uri, 0, 0);
+
+    LOG_DEBUG("[%s] Next uri: %s", p->name, new_uri ? new_uri : "(none)");
+    return 0;
+}
+
+// 为 uridecodebin 插入的缓冲队列设置水位
+static void on_deep_element_added(GstBin *bin, GstBin *sub_bin, GstElement *element, gpointer data) {
+    (void)bin; (void)sub_bin; (void)data;
+    GstElementFactory *factory = gst_element_get_factory(element);
+    if (!factory || g_strcmp0(GST_OBJECT_NAME(factory), "queue2") != 0) {
+        return;
+    }
+    GObjectClass *klass = G_OBJECT_GET_CLASS(element);
+    if (g_object_class_find_property(klass, "low-watermark")) {
+        g_object_set(element,
+            "low-watermark", g_player_options.buffer_low / 100.0,
+            "high-watermark", g_player_options.buffer_high / 100.0,
+            NULL);
+    } else {
+        // GStreamer 1.10 之前的属性
+        g_object_set(element,
+            "low-percent", g_player_options.buffer_low,
+            "high-percent", g_player_options.buffer_high,
+            NULL);
+    }
+    LOG_DEBUG("Buffer watermarks: %d%% - %d%%", g_player_options.buffer_low, g_player_options.buffer_high);
+}
+
+static void buffering_init(player_impl_t *p) {
+    guint flags = 0;
+    g_object_get(p->pipeline, "flags", &flags, NULL);
+    flags |= GST_PLAY_FLAG_BUFFERING;
+    if (g_player_options.download) {
+        flags |= GST_PLAY_FLAG_DOWNLOAD;
+    }
+    g_object_set(p->pipeline, "flags", flags, NULL);
+
+    if (g_player_options.buffer_duration > 0) {
+        g_object_set(p->pipeline, "buffer-duration",
+                     (gint64)g_player_options.buffer_duration * GST_MSECOND, NULL);
+    }
+    if (g_player_options.buffer_size > 0) {
+        g_object_set(p->pipeline, "buffer-size", g_player_options.buffer_size * 1024, NULL);
+    }
+    g_signal_connect(p->pipeline, "deep-element-added", G_CALLBACK(on_deep_element_added), NULL);
+}
+
+static GstState get_current_player_state(player_impl_t *p) {
     GstState state = GST_STATE_PLAYING;
     GstState pending = GST_STATE_NULL;
-    gst_element_get_state(pipeline, &state, &pending, 0);
+    gst_element_get_state(p->pipeline, &state, &pending, 0);
     return state;
 }
 
-int player_play(const char* uri) {
+// 进入 PLAYING。同步模式下管道先预卷(position >= 0 时跳到该位置)，
+// 再以 base_time 为基准开始，运行时间 0 对应共享时钟的 base_time
+static int start_pipeline(player_impl_t *p, gint64 position, GstClockTime base_time) {
+    // 状态切换可能很慢(打开网络源)，不持有 lock，查询和总线回调不用等它；
+    // 改变播放状态的调用都在播放器命令执行线程中，彼此不会并发
+    pthread_mutex_lock(&p->lock);
+    p->target_state = GST_STATE_PLAYING;
+    p->buffering = 0;
+    p->is_live = 0;
+    publish_status(p);
+    pthread_mutex_unlock(&p->lock);
+
+    GstStateChangeReturn ret;
+    int is_live = 0;
+    if (p->sync) {
+        ret = gst_element_set_state(p->pipeline, GST_STATE_PAUSED);
+        is_live = (ret == GST_STATE_CHANGE_NO_PREROLL);
+        if (ret != GST_STATE_CHANGE_FAILURE && !is_live && position >= 0) {
+            gst_element_get_state(p->pipeline, NULL, NULL, SYNC_PREROLL_TIMEOUT);
+            if (!gst_element_seek_simple(p->pipeline, GST_FORMAT_TIME,
+                                         GST_SEEK_FLAG_FLUSH | GST_SEEK_FLAG_ACCURATE, position)) {
+                LOG_ERROR("[%s] Sync seek to %" GST_TIME_FORMAT " failed", p->name, GST_TIME_ARGS(position));
+            }
+            snapshot_store(p, position, SNAPSHOT_KEEP, SNAPSHOT_KEEP);
+        }
+        if (ret != GST_STATE_CHANGE_FAILURE) {
+            gst_element_set_base_time(p->pipeline, base_time);
+            ret = gst_element_set_state(p->pipeline, GST_STATE_PLAYING);
+        }
+    } else {
+        ret = gst_element_set_state(p->pipeline, GST_STATE_PLAYING);
+        is_live = (ret == GST_STATE_CHANGE_NO_PREROLL);
+    }
+    pthread_mutex_lock(&p->lock);
+    p->is_live = is_live;
+    pthread_mutex_unlock(&p->lock);
+    if (ret == GST_STATE_CHANGE_FAILURE) {
+        LOG_ERROR("setting play state failed (2)");
+        return -1;
+    }
+    return 0;
+}
+
+static int playbin_pause(player_impl_t *p);
+static int playbin_stop(player_impl_t *p);
+
+static int playbin_play(player_impl_t *p, const char* uri) {
 
     LOG_DEBUG("-----[%s] starting-----",__func__);
 
-    if (get_current_player_state() != GST_STATE_PAUSED) {
-        if (gst_element_set_state(pipeline, GST_STATE_READY) ==
+    // 显式播放新曲目，丢弃尚未确认的无缝切换
+    pthread_mutex_lock(&p->next_lock);
+    g_free(p->switched_uri);
+    p->switched_uri = NULL;
+    pthread_mutex_unlock(&p->next_lock);
+
+    if (get_current_player_state(p) != GST_STATE_PAUSED) {
+        if (gst_element_set_state(p->pipeline, GST_STATE_READY) ==
             GST_STATE_CHANGE_FAILURE) {
             LOG_ERROR("setting play state failed (1)");
             // Error, but continue; can't get worse :)
         }
-        g_object_set(G_OBJECT(pipeline), "uri", uri, NULL);
+        adaptive_buffer_apply(p);
+        gchar *file_uri = cached_uri(uri);
+        g_object_set(G_OBJECT(p->pipeline), "uri", file_uri ? file_uri : uri, NULL);
+        g_free(file_uri);
     }
-    if (gst_element_set_state(pipeline, GST_STATE_PLAYING) ==
-        GST_STATE_CHANGE_FAILURE) {
-        LOG_ERROR("setting play state failed (2)");
+    GstClockTime base_time = GST_CLOCK_TIME_NONE;
+    if (p->sync) {
+        pthread_mutex_lock(&p->next_lock);
+        g_free(p->sync_uri);
+        p->sync_uri = g_strdup(uri);
+        pthread_mutex_unlock(&p->next_lock);
+        base_time = player_sync_start_time();
+        player_sync_announce(p->sync, SYNC_CMD_START, uri, 0, base_time);
+    }
+    if (start_pipeline(p, -1, base_time) != 0) {
         return -1;
     }
 
@@ -284,77 +927,205 @@ int player_play(const char* uri) {
     return 0;
 }
 
-int player_stop(void) {
+// 同步模式下恢复或跳转: 从 position(-1 为当前位置)在新的开始时刻重新开始，组长同时通知组员
+static int sync_restart(player_impl_t *p, gint64 position) {
+    if (position < 0 && !gst_element_query_position(p->pipeline, GST_FORMAT_TIME, &position)) {
+        LOG_ERROR("[%s] Cannot query position to restart in sync", p->name);
+        return -1;
+    }
+    GstClockTime base_time = player_sync_start_time();
+    pthread_mutex_lock(&p->next_lock);
+    player_sync_announce(p->sync, SYNC_CMD_START, p->sync_uri, position, base_time);
+    pthread_mutex_unlock(&p->next_lock);
+    return start_pipeline(p, position, base_time);
+}
+
+// 组员执行组长的 START: 开始时刻已经过去(后加入或预卷太慢)时把开始时刻和位置一起往后推，
+// 从当前应在的位置开始，而不是让 alsasink 丢弃迟到的数据追上去
+static int sync_follow_start(player_impl_t *p, const char *uri, gint64 position, GstClockTime base_time) {
+    if (!player_sync_wait_clock()) {
+        LOG_ERROR("[%s] Network clock not synchronized, starting anyway", p->name);
+    }
+    GstClockTime earliest = player_sync_start_time();
+    if (base_time < earliest) {
+        position += earliest - base_time;
+        base_time = earliest;
+    }
+
+    pthread_mutex_lock(&p->next_lock);
+    int changed = g_strcmp0(p->sync_uri, uri) != 0;
+    if (changed) {
+        g_free(p->sync_uri);
+        p->sync_uri = g_strdup(uri);
+    }
+    g_free(p->switched_uri);
+    p->switched_uri = NULL;
+    pthread_mutex_unlock(&p->next_lock);
+
+    if (changed || get_current_player_state(p) < GST_STATE_PAUSED) {
+        gst_element_set_state(p->pipeline, GST_STATE_READY);
+        adaptive_buffer_apply(p);
+        gchar *file_uri = cached_uri(uri);
+        g_object_set(G_OBJECT(p->pipeline), "uri", file_uri ? file_uri : uri, NULL);
+        g_free(file_uri);
+    }
+    if (changed) {
+        player_backend_emit_track_changed(p->owner, p, uri);
+    }
+    return start_pipeline(p, position, base_time);
+}
+
+// 组长的一条命令，从同步接收线程交给播放器的执行线程
+typedef struct {
+    player_impl_t *impl;
+    sync_msg_t msg;         // msg.text 指向 text
+    gchar *text;
+} sync_task_t;
+
+// 在播放器的执行线程中运行，和控制点的 Play/Stop/Seek 排在同一个队列里，不会并发。
+// 实例在执行线程停止之后才释放，任务执行时一定有效。
+// 这些状态变化不是控制点发起的，上层不知道，通过事件报告(停止时管道进入 NULL，总线上没有消息)
+static void run_sync_command(void *data) {
+    sync_task_t *task = data;
+    player_impl_t *p = task->impl;
+    const sync_msg_t *msg = &task->msg;
+    switch (msg->cmd) {
+        case SYNC_CMD_START:
+            if (sync_follow_start(p, msg->text, msg->position, msg->base_time) == 0) {
+                emit_event(p, PLAYER_EVENT_PLAYING);
+            }
+            break;
+        case SYNC_CMD_PAUSE:
+            if (playbin_pause(p) == 0) {
+                emit_event(p, PLAYER_EVENT_PAUSED);
+            }
+            break;
+        case SYNC_CMD_STOP:
+            playbin_stop(p);
+            emit_event(p, PLAYER_EVENT_STOPPED);
+            break;
+        case SYNC_CMD_NEXT:
+            playbin_set_next_uri(p, msg->text);
+            break;
+        default:
+            break;
+    }
+    g_free(task->text);
+    g_free(task);
+}
+
+// 组长的命令，在同步接收线程中回调，复制一份后交给执行线程
+static void on_sync_command(const sync_msg_t *msg, void *userdata) {
+    player_impl_t *p = userdata;
+    sync_task_t *task = g_new0(sync_task_t, 1);
+    task->impl = p;
+    task->msg = *msg;
+    task->text = g_strdup(msg->text);
+    task->msg.text = task->text;
+    player_backend_run(p->owner, run_sync_command, task);
+}
+
+static int playbin_stop(player_impl_t *p) {
 
     LOG_DEBUG("-----[%s] starting-----",__func__);
-    pthread_mutex_lock(&lock);
-    if (pipeline) {
+    // 先撤销目标状态，总线回调不会再因为缓冲完成恢复播放；等待流线程退出时不持有 lock
+    pthread_mutex_lock(&p->lock);
+    p->playing = 0;
+    p->target_state = GST_STATE_NULL;
+    p->buffering = 0;
+    publish_status(p);
+    pthread_mutex_unlock(&p->lock);
+
+    if (p->pipeline) {
         LOG_DEBUG("Setting pipeline to NULL state");
-        gst_element_set_state(pipeline, GST_STATE_NULL);
+        gst_element_set_state(p->pipeline, GST_STATE_NULL);
     } else {
         LOG_DEBUG("No active pipeline to stop");
     }
-
-    playing = 0;
-    pthread_mutex_unlock(&lock);
+    // 进入 NULL 时总线被清空，收不到状态变化消息
+    snapshot_store(p, -1, -1, GST_STATE_NULL);
+    player_sync_announce(p->sync, SYNC_CMD_STOP, NULL, 0, 0);
 
     LOG_DEBUG("-----[%s] end-----",__func__);
     return 0;
 }
 
-int player_pause(void) {
+static int playbin_pause(player_impl_t *p) {
 
     LOG_DEBUG("-----[%s] starting-----",__func__);
 
-    pthread_mutex_lock(&lock);
-    if (pipeline && playing) {
+    pthread_mutex_lock(&p->lock);
+    if (p->pipeline && p->playing) {
         LOG_DEBUG("Setting pipeline to PAUSED state");
-        gst_element_set_state(pipeline, GST_STATE_PAUSED);
-        pthread_mutex_unlock(&lock);
+        p->target_state = GST_STATE_PAUSED;
+        publish_status(p);
+        // 状态切换可能要等流线程，不持有 lock，音量/静音和混音器回调不用等它
+        pthread_mutex_unlock(&p->lock);
+        gst_element_set_state(p->pipeline, GST_STATE_PAUSED);
+        player_sync_announce(p->sync, SYNC_CMD_PAUSE, NULL, 0, 0);
     	LOG_DEBUG("-----[%s] end-----",__func__);
         return 0;
     }
-    pthread_mutex_unlock(&lock);
+    pthread_mutex_unlock(&p->lock);
 
     LOG_ERROR("Cannot pause - no active pipeline or not playing");
     return -1;
 }
 
-int player_resume(void) {
+static int playbin_resume(player_impl_t *p) {
     LOG_DEBUG("-----[%s] starting-----",__func__);
-    pthread_mutex_lock(&lock);
+    pthread_mutex_lock(&p->lock);
 
-    if (pipeline && paused) {
-        LOG_DEBUG("Setting pipeline to PLAYING state");
-        gst_element_set_state(pipeline, GST_STATE_PLAYING);
-        pthread_mutex_unlock(&lock);
+    if (p->sync && p->pipeline && p->paused && !p->buffering) {
+        // 同步模式下暂停期间共享时钟继续走，需要重新约定开始时刻
+        pthread_mutex_unlock(&p->lock);
+        return sync_restart(p, -1);
+    }
+    if (p->pipeline && p->paused) {
+        p->target_state = GST_STATE_PLAYING;
+        publish_status(p);
+        int buffering = p->buffering;
+        pthread_mutex_unlock(&p->lock);
+        if (buffering) {
+            // 缓冲完成后由总线回调恢复
+            LOG_DEBUG("Still buffering, resume when refilled");
+        } else {
+            LOG_DEBUG("Setting pipeline to PLAYING state");
+            gst_element_set_state(p->pipeline, GST_STATE_PLAYING);
+        }
     	LOG_DEBUG("-----[%s] end-----",__func__);
         return 0;
     }
 
-    pthread_mutex_unlock(&lock);
+    pthread_mutex_unlock(&p->lock);
     LOG_ERROR("Cannot resume - no active pipeline or not paused");
     return -1;
 }
 
-int player_seek(int seconds) {
-    pthread_mutex_lock(&lock);
+static int playbin_seek(player_impl_t *p, int seconds) {
+    pthread_mutex_lock(&p->lock);
 
-    if (!pipeline || !playing) {
-        pthread_mutex_unlock(&lock);
+    if (!p->pipeline || !p->playing) {
+        pthread_mutex_unlock(&p->lock);
         LOG_ERROR("Cannot seek - no active pipeline or not playing");
         return -1;
     }
+    int restart = p->sync && p->target_state == GST_STATE_PLAYING;
+    pthread_mutex_unlock(&p->lock);
 
+    // flush seek 要等流线程停下，不持有 lock
     gint64 seek_pos = seconds * GST_SECOND;
+    if (restart) {
+        // 所有房间从同一个位置、同一时刻重新开始；暂停中的跳转只在本地生效，恢复时再同步
+        return sync_restart(p, seek_pos);
+    }
 
     gboolean seek_result = gst_element_seek_simple(
-        pipeline,
+        p->pipeline,
         GST_FORMAT_TIME,
         GST_SEEK_FLAG_FLUSH | GST_SEEK_FLAG_KEY_UNIT,
         seek_pos
     );
-    pthread_mutex_unlock(&lock);
 
     if (!seek_result) {
         LOG_ERROR("Seek failed");
@@ -362,110 +1133,44 @@ int player_seek(int seconds) {
     }
 
     LOG_DEBUG("Seeking to position: %" GST_TIME_FORMAT, GST_TIME_ARGS(seek_pos));
+    // 先发布目标位置，seek 完成(ASYNC_DONE)后再按实际位置校正
+    snapshot_store(p, seek_pos, SNAPSHOT_KEEP, SNAPSHOT_KEEP);
 
     return 0;
 }
 
-int player_get_position(int* current_sec, int* total_sec) {
-    //LOG_DEBUG("-----[%s] starting-----",__func__);
-    pthread_mutex_lock(&lock);
+// 不加锁，不查询管道
+static int playbin_get_position(player_impl_t *p, int* current_sec, int* total_sec) {
+    gint64 pos, dur, stamp;
+    int state;
+    snapshot_load(p, &pos, &dur, &state, &stamp);
 
-    if (!pipeline) {
-        pthread_mutex_unlock(&lock);
-        LOG_DEBUG("Position query - no active pipeline");
-        return -1;
+    if (state == GST_STATE_PLAYING && pos >= 0) {
+        pos += (g_get_monotonic_time() - stamp) * GST_USECOND;
+        if (dur > 0 && pos > dur) pos = dur;
     }
 
-    gboolean duration_success = gst_element_query_duration(
-        pipeline, GST_FORMAT_TIME, &duration_ns);
-    gboolean position_success = gst_element_query_position(
-        pipeline, GST_FORMAT_TIME, &position_ns);
-
-    if (duration_success && total_sec) {
-        *total_sec = (int)(duration_ns / GST_SECOND);
-        //LOG_DEBUG("Duration: %d sec", *total_sec);
-    } else if (total_sec) {
-        *total_sec = -1;
+    if (total_sec) {
+        *total_sec = dur >= 0 ? (int)(dur / GST_SECOND) : -1;
     }
-
-    if (position_success && current_sec) {
-        *current_sec = (int)(position_ns / GST_SECOND);
-        //LOG_DEBUG("Position: %d sec", *current_sec);
-    } else if (current_sec) {
-        *current_sec = -1;
+    if (current_sec) {
+        *current_sec = pos >= 0 ? (int)(pos / GST_SECOND) : -1;
     }
-
-    pthread_mutex_unlock(&lock);
-    //LOG_DEBUG("-----[%s] end-----",__func__);
-    return (duration_success && position_success) ? 0 : -1;
-}
-
-int player_get_volume(void) {
-    LOG_DEBUG("Getting volume: %d%%", g_player_options.initial_volume);
-    return g_player_options.initial_volume;
+    return (pos >= 0 && dur >= 0) ? 0 : -1;
 }
 
-int player_set_volume(int volume) {
-    LOG_DEBUG("Setting volume: %d%%", volume);
-
-    if (volume < 0) volume = 0;
-    if (volume > 100) volume = 100;
-
-    pthread_mutex_lock(&lock);
-    g_player_options.initial_volume = volume;
-    g_object_set(pipeline, "volume", (double)volume/100.0, NULL);
-    player_set_mute(g_player_options.initial_volume == 0);
-    g_volume_changed_by_controller = 1;
-    pthread_mutex_unlock(&lock);
+static int playbin_is_playing(player_impl_t *p) {
+    int status = (atomic_load_explicit(&p->published_status, memory_order_acquire) & STATUS_PLAYING) != 0;
 
-    return 0;
-}
-
-int player_get_mute(int *mute){
-    gboolean val;
-    g_object_get(pipeline, "mute", &val, NULL);
-    *mute = val ? 1 : 0;
-    return 0;
-}
-
-int player_set_mute(int mute){
-    LOG_INFO("Set mute to %s", mute ? "on" : "off");
-    g_object_set(pipeline, "mute", mute, NULL);
-    return 0;
-}
-
-int player_is_playing(void) {
-    pthread_mutex_lock(&lock);
-    int status = playing && !paused;
-    pthread_mutex_unlock(&lock);
-
-    LOG_DEBUG("Playing status: %s", status ? "PLAYING" : "NOT PLAYING");
+    LOG_DEBUG("[%s] Playing status: %s", p->name, status ? "PLAYING" : "NOT PLAYING");
     return status;
 }
 
-static void exit_loop_sighandler(int sig) {
-    if (main_loop) {
-        // TODO(hzeller): revisit - this is not safe to do.
-	LOG_DEBUG("Quit main_loop");
-        g_main_loop_quit(main_loop);
-    }
-}
-
-int run_main_loop(void){
-   LOG_DEBUG("Starting GLib main loop");
-   main_loop = g_main_loop_new(NULL, FALSE);
-
-   signal(SIGINT, &exit_loop_sighandler);
-   signal(SIGTERM, &exit_loop_sighandler);
-
-   g_main_loop_run(main_loop);
-   g_main_loop_unref(main_loop);
-   main_loop = NULL;
-
-   return 0;
+static int playbin_is_buffering(player_impl_t *p) {
+    return (atomic_load_explicit(&p->published_status, memory_order_acquire) & STATUS_BUFFERING) != 0;
 }
 
-void list_mixer_controls(const char *ctrl_card) {
+static void list_mixer_controls(const char *ctrl_card) {
     snd_mixer_t *handle;
     snd_mixer_elem_t *elem;
 
@@ -487,120 +1192,258 @@ void list_mixer_controls(const char *ctrl_card) {
     snd_mixer_close(handle);
 }
 
-int get_hw_volume(long *out_vol, long *min_out, long *max_out) {
-    snd_mixer_t *handle = NULL;
-    snd_mixer_selem_id_t *sid = NULL;
-    int err = 0;
-    list_mixer_controls(g_player_options.ctrl_card);
-    if ((err = snd_mixer_open(&handle, 0)) < 0) {
-        LOG_ERROR("snd_mixer_open failed: %s", snd_strerror(err));
+static long mixer_percent_to_raw(player_impl_t *p, int percent) {
+    return p->mixer_min + ((long)percent * (p->mixer_max - p->mixer_min) + 50) / 100;
+}
+
+static int mixer_raw_to_percent(player_impl_t *p, long raw) {
+    if (p->mixer_max <= p->mixer_min) return 0;
+    return (int)((100 * (raw - p->mixer_min) + (p->mixer_max - p->mixer_min) / 2) / (p->mixer_max - p->mixer_min));
+}
+
+static int mixer_write_volume(player_impl_t *p, int percent) {
+    long raw = mixer_percent_to_raw(p, percent);
+    int err;
+    if (!p->mixer_elem) return -1;
+    if ((err = snd_mixer_selem_set_playback_volume_all(p->mixer_elem, raw)) < 0) {
+        LOG_ERROR("set_playback_volume_all failed: %s", snd_strerror(err));
         return err;
     }
+    p->mixer_last_raw = raw;
+    LOG_DEBUG("[%s] volume %d%%, hw_vol: %ld", p->name, percent, raw);
+    return 0;
+}
 
-    if ((err = snd_mixer_attach(handle, g_player_options.ctrl_card)) < 0) {
-        LOG_ERROR("snd_mixer_attach('%s') failed: %s", g_player_options.ctrl_card, snd_strerror(err));
-        goto error;
+// 合并写入: 定时器到期时只写最后一次设置的值
+static gboolean mixer_flush(gpointer data) {
+    player_impl_t *p = data;
+    pthread_mutex_lock(&p->lock);
+    int volume = p->mixer_pending_volume;
+    int mute = p->mixer_pending_mute;
+    p->mixer_pending_volume = -1;
+    p->mixer_pending_mute = -1;
+    p->mixer_flush_id = 0;
+    pthread_mutex_unlock(&p->lock);
+
+    if (volume >= 0) {
+        mixer_write_volume(p, volume);
     }
-
-    if ((err = snd_mixer_selem_register(handle, NULL, NULL)) < 0) {
-        LOG_ERROR("snd_mixer_selem_register failed: %s", snd_strerror(err));
-        goto error;
+    if (mute >= 0 && p->mixer_elem && p->mixer_has_switch) {
+        snd_mixer_selem_set_playback_switch_all(p->mixer_elem, !mute);
     }
+    return G_SOURCE_REMOVE;
+}
 
-    if ((err = snd_mixer_load(handle)) < 0) {
-        LOG_ERROR("snd_mixer_load failed: %s", snd_strerror(err));
-        goto error;
+// 调用时需持有 lock，可以在任意线程调用，写入在主循环线程中完成
+static void mixer_schedule_flush(player_impl_t *p) {
+    if (!p->mixer_flush_id) {
+        p->mixer_flush_id = g_timeout_add(MIXER_COALESCE_MS, mixer_flush, p);
     }
+}
 
-    snd_mixer_selem_id_malloc(&sid);
-    snd_mixer_selem_id_set_index(sid, 0);
-    snd_mixer_selem_id_set_name(sid, g_player_options.selem_name);
-
-    snd_mixer_elem_t *elem = snd_mixer_find_selem(handle, sid);
-    if (!elem) {
-        LOG_ERROR("snd_mixer_find_selem('%s') failed",g_player_options.selem_name);
-        err = -1;
-        goto error;
+// 元素值变化(包括外部修改)时在 snd_mixer_handle_events 中回调，实例挂在元素的私有数据上
+static int mixer_elem_callback(snd_mixer_elem_t *elem, unsigned int mask) {
+    player_impl_t *p = snd_mixer_elem_get_callback_private(elem);
+    if (mask == SND_CTL_EVENT_MASK_REMOVE) {
+        LOG_ERROR("Mixer control '%s' removed", p->selem_name);
+        pthread_mutex_lock(&p->lock);
+        p->mixer_elem = NULL;
+        pthread_mutex_unlock(&p->lock);
+        return 0;
     }
+    if (!(mask & SND_CTL_EVENT_MASK_VALUE)) return 0;
 
-    long min = 0, max = 0, vol = 0;
-    snd_mixer_selem_get_playback_volume_range(elem, &min, &max);
-    snd_mixer_selem_get_playback_volume(elem, SND_MIXER_SCHN_FRONT_LEFT, &vol);
-
-    if (out_vol) *out_vol = vol;
-    if (min_out) *min_out = min;
-    if (max_out) *max_out = max;
+    long raw = 0;
+    int on = 1;
+    if (snd_mixer_selem_get_playback_volume(elem, SND_MIXER_SCHN_FRONT_LEFT, &raw) < 0) return 0;
+    if (p->mixer_has_switch) {
+        snd_mixer_selem_get_playback_switch(elem, SND_MIXER_SCHN_FRONT_LEFT, &on);
+    }
 
-    snd_mixer_close(handle);
-    snd_mixer_selem_id_free(sid);
+    int changed = 0;
+    pthread_mutex_lock(&p->lock);
+    // 还有控制点的写入在排队时以控制点为准
+    if (raw != p->mixer_last_raw && p->mixer_pending_volume < 0) {
+        int percent = mixer_raw_to_percent(p, raw);
+        if (percent != p->volume) {
+            LOG_INFO("[%s] Hardware volume changed externally: %d%%", p->name, percent);
+            p->volume = percent;
+            changed = 1;
+        }
+        p->mixer_last_raw = raw;
+    }
+    if (p->mixer_has_switch && p->mixer_pending_mute < 0 && p->mixer_muted != !on) {
+        p->mixer_muted = !on;
+        changed = 1;
+    }
+    pthread_mutex_unlock(&p->lock);
+    if (changed) emit_event(p, PLAYER_EVENT_VOLUME);
     return 0;
-
-error:
-    if (handle) snd_mixer_close(handle);
-    if (sid) snd_mixer_selem_id_free(sid);
-    return err;
 }
 
-// 同步软件音量到硬件音量,参数 volume 范围为 0.0 到 1.0
-int set_hw_volume_from_gst(double volume, const char *ctrl_card, const char *selem_name) {
-    LOG_DEBUG("[%s] volume: %f",__func__,volume);
-    if (volume < 0.0) volume = 0.0;
-    if (volume > 1.0) volume = 1.0;
+static void mixer_close(player_impl_t *p);
 
-    snd_mixer_t *handle = NULL;
-    snd_mixer_selem_id_t *sid = NULL;
-    snd_mixer_elem_t *elem = NULL;
-    long minv = 0, maxv = 0;
-    long hw_vol = 0;
+static gboolean on_mixer_event(gint fd, GIOCondition cond, gpointer data) {
+    (void)fd;
+    player_impl_t *p = data;
+    if (cond & (G_IO_ERR | G_IO_HUP | G_IO_NVAL)) {
+        // 声卡被拔出等情况，之后退回软件音量
+        LOG_ERROR("Mixer device '%s' lost", p->ctrl_card);
+        mixer_close(p);
+        return G_SOURCE_CONTINUE;  // 已在 mixer_close 中移除
+    }
+    snd_mixer_handle_events(p->mixer_handle);
+    return G_SOURCE_CONTINUE;
+}
+
+static int mixer_open(player_impl_t *p) {
+    snd_mixer_selem_id_t *sid;
     int err;
 
-    // 打开 mixer
-    if ((err = snd_mixer_open(&handle, 0)) < 0) {
-        LOG_ERROR("snd_mixer_open failed: %s\n", snd_strerror(err));
+    if ((err = snd_mixer_open(&p->mixer_handle, 0)) < 0) {
+        LOG_ERROR("snd_mixer_open failed: %s", snd_strerror(err));
+        p->mixer_handle = NULL;
         return err;
     }
-    if ((err = snd_mixer_attach(handle, ctrl_card)) < 0) {
-        LOG_ERROR("snd_mixer_attach('%s') failed: %s\n", ctrl_card, snd_strerror(err));
+    if ((err = snd_mixer_attach(p->mixer_handle, p->ctrl_card)) < 0) {
+        LOG_ERROR("snd_mixer_attach('%s') failed: %s", p->ctrl_card, snd_strerror(err));
         goto fail;
     }
-    if ((err = snd_mixer_selem_register(handle, NULL, NULL)) < 0) {
-        LOG_ERROR("snd_mixer_selem_register failed: %s\n", snd_strerror(err));
+    if ((err = snd_mixer_selem_register(p->mixer_handle, NULL, NULL)) < 0) {
+        LOG_ERROR("snd_mixer_selem_register failed: %s", snd_strerror(err));
         goto fail;
     }
-    if ((err = snd_mixer_load(handle)) < 0) {
-        LOG_ERROR("snd_mixer_load failed: %s\n", snd_strerror(err));
+    if ((err = snd_mixer_load(p->mixer_handle)) < 0) {
+        LOG_ERROR("snd_mixer_load failed: %s", snd_strerror(err));
         goto fail;
     }
-    snd_mixer_selem_id_malloc(&sid);
+
+    snd_mixer_selem_id_alloca(&sid);
     snd_mixer_selem_id_set_index(sid, 0);
-    snd_mixer_selem_id_set_name(sid, selem_name);
-    elem = snd_mixer_find_selem(handle, sid);
-    if (!elem) {
-        LOG_ERROR("snd_mixer_find_selem('%s') failed\n", selem_name);
+    snd_mixer_selem_id_set_name(sid, p->selem_name);
+    p->mixer_elem = snd_mixer_find_selem(p->mixer_handle, sid);
+    if (!p->mixer_elem || !snd_mixer_selem_has_playback_volume(p->mixer_elem)) {
+        LOG_ERROR("snd_mixer_find_selem('%s') failed", p->selem_name);
+        list_mixer_controls(p->ctrl_card);
+        p->mixer_elem = NULL;
         err = -1;
         goto fail;
     }
-    snd_mixer_selem_get_playback_volume_range(elem, &minv, &maxv);
-    hw_vol = minv + volume * (maxv - minv);
-    LOG_DEBUG("[%s] hw_vol: %ld",__func__,hw_vol);
-
-    if ((err = snd_mixer_selem_set_playback_volume_all(elem, hw_vol)) < 0) {
-        LOG_ERROR("set_playback_volume_all failed: %s\n", snd_strerror(err));
-        goto fail;
+    snd_mixer_selem_get_playback_volume_range(p->mixer_elem, &p->mixer_min, &p->mixer_max);
+    p->mixer_has_switch = snd_mixer_selem_has_playback_switch(p->mixer_elem);
+    snd_mixer_elem_set_callback_private(p->mixer_elem, p);
+    snd_mixer_elem_set_callback(p->mixer_elem, mixer_elem_callback);
+
+    // 把混音器的 poll fd 挂到主循环，有事件时才唤醒
+    int count = snd_mixer_poll_descriptors_count(p->mixer_handle);
+    if (count > 0) {
+        struct pollfd *pfds = g_new0(struct pollfd, count);
+        count = snd_mixer_poll_descriptors(p->mixer_handle, pfds, count);
+        p->mixer_watch_ids = g_new0(guint, count > 0 ? count : 1);
+        for (int i = 0; i < count; i++) {
+            p->mixer_watch_ids[p->mixer_nwatches++] =
+                g_unix_fd_add(pfds[i].fd, G_IO_IN | G_IO_ERR | G_IO_HUP, on_mixer_event, p);
+        }
+        g_free(pfds);
     }
-    //snd_mixer_selem_set_playback_volume(elem, SND_MIXER_SCHN_FRONT_LEFT, hw_vol);
-    //snd_mixer_selem_set_playback_volume(elem, SND_MIXER_SCHN_FRONT_RIGHT, hw_vol);
-    snd_mixer_selem_id_free(sid);
-    snd_mixer_close(handle);
+
+    LOG_INFO("[%s] Hardware mixer: %s '%s' (range %ld ~ %ld)%s", p->name, p->ctrl_card,
+             p->selem_name, p->mixer_min, p->mixer_max, p->mixer_has_switch ? ", switch" : "");
     return 0;
 
 fail:
-    if (sid) snd_mixer_selem_id_free(sid);
-    if (handle) snd_mixer_close(handle);
+    snd_mixer_close(p->mixer_handle);
+    p->mixer_handle = NULL;
     return err;
 }
 
-int player_init(void) {
+static void mixer_close(player_impl_t *p) {
+    for (int i = 0; i < p->mixer_nwatches; i++) {
+        g_source_remove(p->mixer_watch_ids[i]);
+    }
+    g_free(p->mixer_watch_ids);
+    p->mixer_watch_ids = NULL;
+    p->mixer_nwatches = 0;
+
+    pthread_mutex_lock(&p->lock);
+    if (p->mixer_flush_id) {
+        g_source_remove(p->mixer_flush_id);
+        p->mixer_flush_id = 0;
+    }
+    p->mixer_elem = NULL;
+    p->mixer_pending_volume = -1;
+    p->mixer_pending_mute = -1;
+    pthread_mutex_unlock(&p->lock);
+
+    if (p->mixer_handle) {
+        snd_mixer_close(p->mixer_handle);
+        p->mixer_handle = NULL;
+    }
+}
+
+static int playbin_get_volume(player_impl_t *p) {
+    pthread_mutex_lock(&p->lock);
+    int volume = p->volume;
+    pthread_mutex_unlock(&p->lock);
+    LOG_DEBUG("[%s] Getting volume: %d%%", p->name, volume);
+    return volume;
+}
+
+static int playbin_set_mute(player_impl_t *p, int mute);
+
+static int playbin_set_volume(player_impl_t *p, int volume) {
+    LOG_DEBUG("[%s] Setting volume: %d%%", p->name, volume);
+
+    if (volume < 0) volume = 0;
+    if (volume > 100) volume = 100;
+
+    pthread_mutex_lock(&p->lock);
+    p->volume = volume;
+    if (p->mixer_elem) {
+        // 硬件音量: 软件音量保持 1.0，不在降低位深后的数据上做衰减
+        p->mixer_pending_volume = volume;
+        mixer_schedule_flush(p);
+    } else {
+        g_object_set(p->pipeline, "volume", (double)volume/100.0, NULL);
+    }
+    pthread_mutex_unlock(&p->lock);
+
+    playbin_set_mute(p, volume == 0);
+    return 0;
+}
+
+static int playbin_get_mute(player_impl_t *p, int *mute){
+    pthread_mutex_lock(&p->lock);
+    if (p->mixer_elem && p->mixer_has_switch) {
+        *mute = p->mixer_pending_mute >= 0 ? p->mixer_pending_mute : p->mixer_muted;
+        pthread_mutex_unlock(&p->lock);
+        return 0;
+    }
+    pthread_mutex_unlock(&p->lock);
+
+    gboolean val;
+    g_object_get(p->pipeline, "mute", &val, NULL);
+    *mute = val ? 1 : 0;
+    return 0;
+}
+
+static int playbin_set_mute(player_impl_t *p, int mute){
+    LOG_INFO("[%s] Set mute to %s", p->name, mute ? "on" : "off");
+    pthread_mutex_lock(&p->lock);
+    if (p->mixer_elem && p->mixer_has_switch) {
+        p->mixer_pending_mute = mute ? 1 : 0;
+        p->mixer_muted = p->mixer_pending_mute;
+        mixer_schedule_flush(p);
+        pthread_mutex_unlock(&p->lock);
+        return 0;
+    }
+    pthread_mutex_unlock(&p->lock);
+    g_object_set(p->pipeline, "mute", mute, NULL);
+    return 0;
+}
+
+// GStreamer 在进程内只初始化一次，所有实例共用同一个插件注册表
+static int playbin_init(void) {
     LOG_INFO("Initializing player");
     if (!gst_is_initialized()) {
         LOG_DEBUG("Initializing GStreamer");
@@ -611,66 +1454,143 @@ int player_init(void) {
         gst_version(&major, &minor, &micro, &nano);
         LOG_INFO("GStreamer version: %u.%u.%u.%u", major, minor, micro, nano);
     }
-    //创建一个名为player的playbin元素
-    pipeline = gst_element_factory_make("playbin", "player");
-    if (!pipeline) {
-        LOG_ERROR("Failed to create playbin pipeline");
+
+    if (g_player_options.buffer_min > g_player_options.buffer_max) {
+        g_player_options.buffer_min = g_player_options.buffer_max;
+    }
+    if (g_player_options.adaptive_buffer) {
+        LOG_INFO("Adaptive buffer enabled: %d ~ %d us",
+                 g_player_options.buffer_min, g_player_options.buffer_max);
+    }
+    if (g_player_options.buffer_low < 0) g_player_options.buffer_low = 0;
+    if (g_player_options.buffer_high > 100) g_player_options.buffer_high = 100;
+    if (g_player_options.buffer_low >= g_player_options.buffer_high) {
+        LOG_ERROR("Invalid buffer watermarks %d%% - %d%%, using defaults",
+                  g_player_options.buffer_low, g_player_options.buffer_high);
+        g_player_options.buffer_low = 10;
+        g_player_options.buffer_high = 99;
+    }
+
+    if (player_sync_init() != 0) {
         return -1;
     }
+    return 0;
+}
+
+// 启用同步播放时所有曲目都由 GStreamer 播放，mpg123 没有可以共享的时钟
+static int playbin_preferred(void) {
+    return player_sync_get_clock() != NULL;
+}
+
+static void playbin_destroy(player_impl_t *p);
+
+static player_impl_t* playbin_create(player_t *owner, const player_config_t *config) {
+    player_impl_t *p = g_new0(player_impl_t, 1);
+    p->owner = owner;
+    p->name = g_strdup(config && config->name ? config->name : "default");
+    p->device = g_strdup(config && config->device ? config->device : g_player_options.device);
+    p->ctrl_card = g_strdup(config && config->ctrl_card ? config->ctrl_card : g_player_options.ctrl_card);
+    p->selem_name = g_strdup(config && config->selem_name ? config->selem_name : g_player_options.selem_name);
+    p->volume = config && config->initial_volume ? config->initial_volume : g_player_options.initial_volume;
+    p->buffer_time = config && config->buffer_time ? config->buffer_time : g_player_options.buffer_time;
+    pthread_mutex_init(&p->lock, NULL);
+    pthread_mutex_init(&p->next_lock, NULL);
+    pthread_mutex_init(&p->snapshot.write_lock, NULL);
+    p->target_state = GST_STATE_NULL;
+    p->mixer_last_raw = -1;
+    p->mixer_pending_volume = -1;
+    p->mixer_pending_mute = -1;
+    atomic_init(&p->published_status, 0);
+
+    LOG_INFO("[%s] Creating player on %s", p->name, p->device);
+    //创建一个 playbin 元素，每个实例一条独立的管道
+    p->pipeline = gst_element_factory_make("playbin", "player");
+    if (!p->pipeline) {
+        LOG_ERROR("Failed to create playbin pipeline");
+        playbin_destroy(p);
+        return NULL;
+    }
     // 配置音频输出
     GstElement *audio_sink = gst_element_factory_make("alsasink", "audio-output");
     if (audio_sink) {
         g_object_set(audio_sink,
-            "device", g_player_options.device,
-            "buffer-time", g_player_options.buffer_time,
+            "device", p->device,
+            "buffer-time", p->buffer_time,
             "latency-time", g_player_options.latency_time,
             NULL);
 	gst_object_ref(audio_sink);  // 增加引用给 playbin 使用
-        g_object_set(pipeline, "audio-sink", audio_sink, NULL);//将alsasink绑定到管道，playbin会自动连接音频流到我们指定的sink
+        g_object_set(p->pipeline, "audio-sink", audio_sink, NULL);//将alsasink绑定到管道，playbin会自动连接音频流到我们指定的sink
 	gst_object_unref(audio_sink);  // 释放引用
 	audio_sink = NULL;
     }
 
+    adaptive_buffer_init(p);
+    buffering_init(p);
+    snapshot_store(p, -1, -1, GST_STATE_NULL);
+
     // 忽略视频
-    g_object_set(pipeline, "video-sink", gst_element_factory_make("fakesink", NULL), NULL);
-
-    if(!g_player_options.initial_volume){ //没有指定音量，就根据硬件音量设置软件音量
-        long hw_vol = 0, vol_min = 0, vol_max = 0;
-        if (get_hw_volume(&hw_vol, &vol_min, &vol_max) == 0) {
-            g_player_options.initial_volume = (double)(hw_vol - vol_min) / (vol_max - vol_min)*100.0;
-            LOG_DEBUG("Current hardware volume: %ld (range: %ld ~ %ld), software volume: %d%%", hw_vol, vol_min, vol_max, g_player_options.initial_volume);
-            g_object_set(pipeline, "volume", (double)g_player_options.initial_volume/100.0, NULL);	
+    g_object_set(p->pipeline, "video-sink", gst_element_factory_make("fakesink", NULL), NULL);
+
+    // 无缝播放下一首
+    g_signal_connect(p->pipeline, "about-to-finish", G_CALLBACK(on_about_to_finish), p);
+
+    // 网络媒体磁盘缓存
+    g_signal_connect(p->pipeline, "source-setup", G_CALLBACK(on_source_setup), NULL);
+
+    // 同步播放: 使用共享时钟，base_time 由 start_pipeline 设置，缓冲恢复时保持不变，
+    // alsasink 丢弃缓冲期间迟到的数据后仍然和其他房间对齐
+    GstClock *clock = player_sync_get_clock();
+    if (clock) {
+        gst_pipeline_use_clock(GST_PIPELINE(p->pipeline), clock);
+        gst_element_set_start_time(p->pipeline, GST_CLOCK_TIME_NONE);
+        gst_pipeline_set_latency(GST_PIPELINE(p->pipeline), SYNC_LATENCY);
+        p->sync = player_sync_join(p->name, on_sync_command, p);
+    }
+
+    if (mixer_open(p) == 0) {
+        if (!p->volume) { //没有指定音量，就读取当前硬件音量
+            long hw_vol = 0;
+            snd_mixer_selem_get_playback_volume(p->mixer_elem, SND_MIXER_SCHN_FRONT_LEFT, &hw_vol);
+            p->volume = mixer_raw_to_percent(p, hw_vol);
+            p->mixer_last_raw = hw_vol;
+            LOG_DEBUG("Current hardware volume: %ld (range: %ld ~ %ld), %d%%", hw_vol, p->mixer_min, p->mixer_max, p->volume);
         } else {
-            LOG_ERROR("Failed to get hardware volume");
+            mixer_write_volume(p, p->volume);
+        }
+        if (p->mixer_has_switch) {
+            int on = 1;
+            snd_mixer_selem_get_playback_switch(p->mixer_elem, SND_MIXER_SCHN_FRONT_LEFT, &on);
+            p->mixer_muted = !on;
+        }
+    } else {
+        // 没有可用的硬件音量控制，退回 playbin 的软件音量
+        if (!p->volume) {
+            p->volume = 100;
         }
-    }else if(g_player_options.initial_volume){
-	    LOG_DEBUG("Current software volume: %d%%",g_player_options.initial_volume);
-            g_object_set(pipeline, "volume", (double)g_player_options.initial_volume/100.0, NULL);	
-	    g_volume_changed_by_controller = 1; //保存当前音量到硬件
+        LOG_INFO("[%s] No hardware mixer, using software volume: %d%%", p->name, p->volume);
+        g_object_set(p->pipeline, "volume", (double)p->volume/100.0, NULL);
     }
 
     // 设置总线监听
-    GstBus *bus = gst_pipeline_get_bus(GST_PIPELINE(pipeline));
-    gst_bus_add_watch(bus, bus_callback, NULL);//非阻塞，消息作为事件源挂到GLib主循环
+    GstBus *bus = gst_pipeline_get_bus(GST_PIPELINE(p->pipeline));
+    p->bus_watch_id = gst_bus_add_watch(bus, bus_callback, p);//非阻塞，消息作为事件源挂到GLib主循环
     gst_object_unref(bus);
-
-    //创建获取播放信息线程,循环读取播放进度
-    g_running = 1;
-    pthread_create(&progress_thread, NULL, update_track_time_thread, NULL);
-    return 0;
+    return p;
 }
 
-int player_deinit(void) {
-    LOG_INFO("Deinitializing player");
-    player_stop();
-    g_running = 0;
-    if (pthread_join(progress_thread, NULL) != 0) {
-        perror("pthread_join failed");
-        return -1;
+static void playbin_destroy(player_impl_t *p) {
+    if (!p) return;
+    LOG_INFO("[%s] Releasing player", p->name);
+    // 先离开同步组，接收线程不会再回调
+    player_sync_leave(p->sync);
+    p->sync = NULL;
+    if (p->pipeline) {
+        playbin_stop(p);
     }
-    if (pipeline) {
+    set_progress_timer(p, FALSE);
+    if (p->pipeline) {
         GstElement *audio_sink = NULL;
-        g_object_get(pipeline, "audio-sink", &audio_sink, NULL);
+        g_object_get(p->pipeline, "audio-sink", &audio_sink, NULL);
     	if (audio_sink) {
     	    if (GST_IS_ELEMENT(audio_sink)) {
     	        gst_element_set_state(audio_sink, GST_STATE_NULL);
@@ -679,19 +1599,62 @@ int player_deinit(void) {
     	    audio_sink = NULL;
     	}
 
-        GstBus *bus = gst_pipeline_get_bus(GST_PIPELINE(pipeline));
-        gst_bus_remove_watch(bus);  // 移除监视器
-        gst_object_unref(bus);
-        gst_object_unref(pipeline);
+        if (p->bus_watch_id) {
+            g_source_remove(p->bus_watch_id);  // 移除监视器
+        }
+        gst_object_unref(p->pipeline);
 	LOG_DEBUG("remove bus,unref pipeline");
     }
-    gst_deinit();
-    pthread_mutex_lock(&lock);  // 先获取锁
-    if (g_volume_changed_by_controller) {
-        set_hw_volume_from_gst((double)g_player_options.initial_volume / 100.0, g_player_options.ctrl_card, g_player_options.selem_name);
+    // 还没写入的音量立即写入硬件
+    pthread_mutex_lock(&p->lock);
+    if (p->mixer_flush_id) {
+        g_source_remove(p->mixer_flush_id);
+        p->mixer_flush_id = 0;
     }
-    pthread_mutex_unlock(&lock);  // 再释放
-    pthread_mutex_destroy(&lock);//销毁锁
+    pthread_mutex_unlock(&p->lock);
+    mixer_flush(p);
+    mixer_close(p);
+
+    pthread_mutex_destroy(&p->lock);//销毁锁
+    pthread_mutex_destroy(&p->next_lock);
+    pthread_mutex_destroy(&p->snapshot.write_lock);
+    g_free(p->next_uri);
+    g_free(p->switched_uri);
+    g_free(p->sync_uri);
+    g_free(p->name);
+    g_free(p->device);
+    g_free(p->ctrl_card);
+    g_free(p->selem_name);
+    g_free(p);
+}
 
+static int playbin_deinit(void) {
+    LOG_INFO("Deinitializing GStreamer");
+    player_sync_deinit();
+    gst_deinit();
     return 0;
 }
+
+const player_backend_t player_backend_gstreamer = {
+    .name = "gstreamer",
+    .caps = PLAYER_CAP_GAPLESS | PLAYER_CAP_ALL_FORMATS,
+    .options = player_option_entries,
+    .init = playbin_init,
+    .deinit = playbin_deinit,
+    .preferred = playbin_preferred,
+    .create = playbin_create,
+    .destroy = playbin_destroy,
+    .play = playbin_play,
+    .pause = playbin_pause,
+    .resume = playbin_resume,
+    .stop = playbin_stop,
+    .seek = playbin_seek,
+    .get_position = playbin_get_position,
+    .get_volume = playbin_get_volume,
+    .set_volume = playbin_set_volume,
+    .get_mute = playbin_get_mute,
+    .set_mute = playbin_set_mute,
+    .is_playing = playbin_is_playing,
+    .is_buffering = playbin_is_buffering,
+    .set_next_uri = playbin_set_next_uri,
+};
@@ -0,0 +1,465 @@
+#include "player_sync.h"
+#include "player.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <unistd.h>
+#include <gio/gio.h>
+#include <gst/net/net.h>
+
+#define SYNC_MAGIC "DLNASYNC1"
+#define SYNC_MAX_MSG 2048
+#define SYNC_HEARTBEAT_SEC 2                    // 组长重发最近状态的间隔
+#define SYNC_REPORT_SEC 5                       // 组员上报偏移的间隔
+#define SYNC_CLOCK_TIMEOUT (5 * GST_SECOND)     // 等待网络时钟对齐的时间
+#define SYNC_TOLERANCE (GST_MSECOND)            // 漂移超过此值记为错误
+
+typedef struct {
+    const char* mode;       // none/master/slave
+    const char* master;     // 从机连接的主机地址
+    int clock_port;         // 网络时钟端口
+    const char* address;    // 命令组播地址
+    int port;               // 命令组播端口
+    int delay_ms;           // 开始时刻比当前时间晚多少，给所有房间预卷的时间
+} SyncOptions;
+
+static SyncOptions g_sync_options = {
+    .mode = "none",
+    .master = "127.0.0.1",
+    .clock_port = 8555,
+    .address = "239.255.85.55",
+    .port = 8556,
+    .delay_ms = 500
+};
+
+static GOptionEntry sync_option_entries[] = {
+    { "sync", 0, 0, G_OPTION_ARG_STRING, &g_sync_options.mode,
+      "Synchronized playback role: none, master, slave (GStreamer backend, default: none)", "MODE" },
+    { "sync-master", 0, 0, G_OPTION_ARG_STRING, &g_sync_options.master,
+      "Address of the sync master clock (default: 127.0.0.1)", "HOST" },
+    { "sync-clock-port", 0, 0, G_OPTION_ARG_INT, &g_sync_options.clock_port,
+      "Network clock UDP port (default: 8555)", "PORT" },
+    { "sync-address", 0, 0, G_OPTION_ARG_STRING, &g_sync_options.address,
+      "Multicast address for sync commands (default: 239.255.85.55)", "ADDR" },
+    { "sync-port", 0, 0, G_OPTION_ARG_INT, &g_sync_options.port,
+      "Multicast port for sync commands (default: 8556)", "PORT" },
+    { "sync-delay", 0, 0, G_OPTION_ARG_INT, &g_sync_options.delay_ms,
+      "Start playback this many milliseconds in the future (default: 500)", "MS" },
+    { NULL }
+};
+
+struct player_sync_member {
+    gchar *id;              // 进程号.序号，用来忽略自己发出的消息
+    gchar *name;
+    int leader;
+    player_sync_cb cb;
+    void *userdata;
+    gchar *last_sender;     // 最近一次执行的组长命令，心跳重发的旧命令不再执行
+    guint32 last_seq;
+    gint64 last_report;     // 最近一次上报的单调时钟(us)，只在主循环中访问
+};
+
+static GstClock *sync_clock = NULL;
+static GstNetTimeProvider *provider = NULL;
+static GSocket *sync_socket = NULL;
+static GSocketAddress *group_address = NULL;
+static GThread *receive_thread = NULL;
+static GCancellable *cancellable = NULL;
+static guint heartbeat_id = 0;
+static int is_master = 0;
+static guint member_counter = 0;
+
+static GMutex members_lock;         // 保护 members 和 leader，只在查找和修改时短暂持有
+static GList *members = NULL;
+static player_sync_member_t *leader = NULL;
+// 接收线程回调期间持有，player_sync_leave 用它等待正在进行的回调结束
+static GMutex dispatch_lock;
+
+static GMutex announce_lock;        // 保护 seq、last_announce 和 last_next
+static guint32 seq = 0;
+static gchar *last_announce = NULL; // 最近一次 START/PAUSE/STOP，心跳时重发
+static guint32 last_announce_seq = 0;
+static gchar *last_next = NULL;     // 最近一次 NEXT，心跳时按序号顺序和 last_announce 一起重发
+static guint32 last_next_seq = 0;
+static atomic_llong leader_offset = 0;
+
+static const char *const cmd_names[] = { "START", "PAUSE", "STOP", "NEXT", "REPORT" };
+
+GOptionGroup* player_sync_get_option_group(void) {
+    GOptionGroup *group = g_option_group_new(
+        "sync",
+        "Synchronized Playback Options",
+        "Show synchronized playback options",
+        NULL,
+        NULL
+    );
+
+    g_option_group_add_entries(group, sync_option_entries);
+    return group;
+}
+
+static void send_message(const char *buf, gsize len) {
+    GError *err = NULL;
+    if (g_socket_send_to(sync_socket, group_address, buf, len, NULL, &err) < 0) {
+        LOG_ERROR("Failed to send sync message: %s", err->message);
+        g_error_free(err);
+    }
+}
+
+// SYNC_MAGIC 命令 发送者 序号 base_time 位置 偏移 文本；文本放在最后，uri 中不会有空格
+static gchar* format_message(const char *sender, sync_cmd_t cmd, guint32 n, GstClockTime base_time,
+                             gint64 position, gint64 offset, const char *text) {
+    return g_strdup_printf(SYNC_MAGIC " %s %s %u %" G_GUINT64_FORMAT " %" G_GINT64_FORMAT
+                           " %" G_GINT64_FORMAT " %s",
+                           cmd_names[cmd], sender, n, (guint64)base_time, position, offset,
+                           text && *text ? text : "-");
+}
+
+static int parse_message(char *buf, sync_msg_t *msg, char *sender, size_t sender_len) {
+    char cmd[16];
+    char fmt[128];
+    unsigned int n;
+    guint64 base_time;
+    gint64 position, offset;
+    int text_pos = 0;
+
+    g_snprintf(fmt, sizeof(fmt), SYNC_MAGIC " %%15s %%%zus %%u %%" G_GUINT64_FORMAT
+               " %%" G_GINT64_FORMAT " %%" G_GINT64_FORMAT " %%n", sender_len - 1);
+    if (sscanf(buf, fmt, cmd, sender, &n, &base_time, &position, &offset, &text_pos) < 6 || !text_pos) {
+        return -1;
+    }
+    for (size_t i = 0; i < G_N_ELEMENTS(cmd_names); i++) {
+        if (strcmp(cmd, cmd_names[i]) == 0) {
+            g_strchomp(buf + text_pos);
+            msg->cmd = (sync_cmd_t)i;
+            msg->seq = n;
+            msg->base_time = base_time;
+            msg->position = position;
+            msg->offset = offset;
+            msg->text = strcmp(buf + text_pos, "-") == 0 ? "" : buf + text_pos;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+// 组员的偏移减去组长的偏移就是两个房间之间的差
+static void log_report(const sync_msg_t *msg, const char *sender) {
+    g_mutex_lock(&members_lock);
+    if (leader) {
+        gint64 drift = msg->offset - atomic_load(&leader_offset);
+        if (drift > (gint64)SYNC_TOLERANCE || drift < -(gint64)SYNC_TOLERANCE) {
+            LOG_ERROR("[%s] Sync drift of %s (%s): %+.3f ms", leader->name, msg->text, sender,
+                      (double)drift / GST_MSECOND);
+        } else {
+            LOG_INFO("[%s] Sync drift of %s (%s): %+.3f ms", leader->name, msg->text, sender,
+                     (double)drift / GST_MSECOND);
+        }
+    }
+    g_mutex_unlock(&members_lock);
+}
+
+// 在 members_lock 下挑出要执行的成员，释放后再回调，回调慢也不影响加入/离开和偏移统计；
+// dispatch_lock 保证回调期间成员不会被 player_sync_leave 释放
+static void dispatch(const sync_msg_t *msg, const char *sender) {
+    GPtrArray *targets = g_ptr_array_new();
+
+    g_mutex_lock(&dispatch_lock);
+    g_mutex_lock(&members_lock);
+    for (GList *l = members; l; l = l->next) {
+        player_sync_member_t *m = l->data;
+        if (m->leader || strcmp(m->id, sender) == 0) continue;
+        if (g_strcmp0(m->last_sender, sender) == 0 && msg->seq <= m->last_seq) continue;
+        g_free(m->last_sender);
+        m->last_sender = g_strdup(sender);
+        m->last_seq = msg->seq;
+        g_ptr_array_add(targets, m);
+    }
+    g_mutex_unlock(&members_lock);
+
+    for (guint i = 0; i < targets->len; i++) {
+        player_sync_member_t *m = g_ptr_array_index(targets, i);
+        LOG_DEBUG("[%s] Sync %s from %s (seq %u)", m->name, cmd_names[msg->cmd], sender, msg->seq);
+        m->cb(msg, m->userdata);
+    }
+    g_mutex_unlock(&dispatch_lock);
+    g_ptr_array_free(targets, TRUE);
+}
+
+// 组播接收线程: 组员执行组长的命令(可能要等待预卷)，组长收集组员的偏移
+static gpointer receive_loop(gpointer data) {
+    (void)data;
+    char buf[SYNC_MAX_MSG];
+    char sender[64];
+
+    while (!g_cancellable_is_cancelled(cancellable)) {
+        GError *err = NULL;
+        gssize n = g_socket_receive(sync_socket, buf, sizeof(buf) - 1, cancellable, &err);
+        if (n < 0) {
+            if (!g_error_matches(err, G_IO_ERROR, G_IO_ERROR_CANCELLED)) {
+                LOG_ERROR("Failed to receive sync message: %s", err->message);
+            }
+            g_error_free(err);
+            continue;
+        }
+        buf[n] = '\0';
+
+        sync_msg_t msg;
+        if (parse_message(buf, &msg, sender, sizeof(sender)) != 0) {
+            LOG_DEBUG("Ignoring malformed sync message");
+            continue;
+        }
+        if (msg.cmd == SYNC_CMD_REPORT) {
+            log_report(&msg, sender);
+        } else {
+            dispatch(&msg, sender);
+        }
+    }
+    return NULL;
+}
+
+// 组员按序号去重，先发序号小的，后加入的组员两条都会执行
+static gboolean heartbeat(gpointer data) {
+    (void)data;
+    g_mutex_lock(&announce_lock);
+    const char *first = last_announce, *second = last_next;
+    if (first && second && last_next_seq < last_announce_seq) {
+        first = last_next;
+        second = last_announce;
+    }
+    if (first) send_message(first, strlen(first));
+    if (second) send_message(second, strlen(second));
+    g_mutex_unlock(&announce_lock);
+    return G_SOURCE_CONTINUE;
+}
+
+static int open_socket(void) {
+    GError *err = NULL;
+    GInetAddress *group = g_inet_address_new_from_string(g_sync_options.address);
+    if (!group || !g_inet_address_get_is_multicast(group)) {
+        LOG_ERROR("Invalid sync multicast address: %s", g_sync_options.address);
+        if (group) g_object_unref(group);
+        return -1;
+    }
+
+    sync_socket = g_socket_new(g_inet_address_get_family(group), G_SOCKET_TYPE_DATAGRAM,
+                               G_SOCKET_PROTOCOL_UDP, &err);
+    if (!sync_socket) {
+        LOG_ERROR("Failed to create sync socket: %s", err->message);
+        g_error_free(err);
+        g_object_unref(group);
+        return -1;
+    }
+
+    // 同一台机器上的多个进程绑定同一个端口，组播回环让它们都能收到
+    GInetAddress *any = g_inet_address_new_any(g_inet_address_get_family(group));
+    GSocketAddress *bind_address = g_inet_socket_address_new(any, g_sync_options.port);
+    gboolean ok = g_socket_bind(sync_socket, bind_address, TRUE, &err) &&
+                  g_socket_join_multicast_group(sync_socket, group, FALSE, NULL, &err);
+    g_object_unref(bind_address);
+    g_object_unref(any);
+    if (!ok) {
+        LOG_ERROR("Failed to join sync group %s:%d: %s", g_sync_options.address,
+                  g_sync_options.port, err->message);
+        g_error_free(err);
+        g_object_unref(group);
+        return -1;
+    }
+    g_socket_set_multicast_loopback(sync_socket, TRUE);
+
+    group_address = g_inet_socket_address_new(group, g_sync_options.port);
+    g_object_unref(group);
+    return 0;
+}
+
+int player_sync_init(void) {
+    if (g_strcmp0(g_sync_options.mode, "none") == 0) {
+        return 0;
+    }
+    if (g_strcmp0(g_sync_options.mode, "master") == 0) {
+        is_master = 1;
+    } else if (g_strcmp0(g_sync_options.mode, "slave") != 0) {
+        LOG_ERROR("Unknown sync mode: %s", g_sync_options.mode);
+        return -1;
+    }
+    if (g_sync_options.delay_ms < 0) {
+        g_sync_options.delay_ms = 0;
+    }
+
+    if (is_master) {
+        sync_clock = gst_system_clock_obtain();
+        provider = gst_net_time_provider_new(sync_clock, NULL, g_sync_options.clock_port);
+        if (!provider) {
+            LOG_ERROR("Failed to publish network clock on port %d", g_sync_options.clock_port);
+            player_sync_deinit();
+            return -1;
+        }
+        LOG_INFO("Sync master: publishing clock on port %d", g_sync_options.clock_port);
+    } else {
+        sync_clock = gst_net_client_clock_new("sync-clock", g_sync_options.master,
+                                              g_sync_options.clock_port, 0);
+        LOG_INFO("Sync slave: following clock of %s:%d", g_sync_options.master,
+                 g_sync_options.clock_port);
+    }
+
+    if (open_socket() != 0) {
+        player_sync_deinit();
+        return -1;
+    }
+    cancellable = g_cancellable_new();
+    receive_thread = g_thread_new("sync-receive", receive_loop, NULL);
+    if (is_master) {
+        heartbeat_id = g_timeout_add_seconds(SYNC_HEARTBEAT_SEC, heartbeat, NULL);
+    }
+    LOG_INFO("Sync group %s:%d, start delay %d ms", g_sync_options.address,
+             g_sync_options.port, g_sync_options.delay_ms);
+    return 0;
+}
+
+void player_sync_deinit(void) {
+    if (heartbeat_id) {
+        g_source_remove(heartbeat_id);
+        heartbeat_id = 0;
+    }
+    if (receive_thread) {
+        g_cancellable_cancel(cancellable);
+        g_thread_join(receive_thread);
+        receive_thread = NULL;
+    }
+    if (cancellable) {
+        g_object_unref(cancellable);
+        cancellable = NULL;
+    }
+    if (group_address) {
+        g_object_unref(group_address);
+        group_address = NULL;
+    }
+    if (sync_socket) {
+        g_socket_close(sync_socket, NULL);
+        g_object_unref(sync_socket);
+        sync_socket = NULL;
+    }
+    if (provider) {
+        gst_object_unref(provider);
+        provider = NULL;
+    }
+    if (sync_clock) {
+        gst_object_unref(sync_clock);
+        sync_clock = NULL;
+    }
+    g_free(last_announce);
+    last_announce = NULL;
+    g_free(last_next);
+    last_next = NULL;
+}
+
+GstClock* player_sync_get_clock(void) {
+    return sync_clock;
+}
+
+gboolean player_sync_wait_clock(void) {
+    if (!sync_clock) return FALSE;
+    return gst_clock_wait_for_sync(sync_clock, SYNC_CLOCK_TIMEOUT);
+}
+
+GstClockTime player_sync_start_time(void) {
+    return gst_clock_get_time(sync_clock) + (GstClockTime)g_sync_options.delay_ms * GST_MSECOND;
+}
+
+player_sync_member_t* player_sync_join(const char *name, player_sync_cb cb, void *userdata) {
+    if (!sync_clock) return NULL;
+
+    player_sync_member_t *m = g_new0(player_sync_member_t, 1);
+    m->name = g_strdup(name);
+    m->cb = cb;
+    m->userdata = userdata;
+
+    g_mutex_lock(&members_lock);
+    m->id = g_strdup_printf("%d.%u", (int)getpid(), ++member_counter);
+    if (is_master && !leader) {
+        m->leader = 1;
+        leader = m;
+    }
+    members = g_list_append(members, m);
+    g_mutex_unlock(&members_lock);
+
+    LOG_INFO("[%s] Joined sync group as %s", name, m->leader ? "leader" : "follower");
+    return m;
+}
+
+void player_sync_leave(player_sync_member_t *member) {
+    if (!member) return;
+    g_mutex_lock(&members_lock);
+    members = g_list_remove(members, member);
+    if (leader == member) {
+        leader = NULL;
+    }
+    g_mutex_unlock(&members_lock);
+    // 等接收线程中可能正在进行的回调结束
+    g_mutex_lock(&dispatch_lock);
+    g_mutex_unlock(&dispatch_lock);
+
+    if (member->leader) {
+        g_mutex_lock(&announce_lock);
+        g_free(last_announce);
+        last_announce = NULL;
+        g_free(last_next);
+        last_next = NULL;
+        g_mutex_unlock(&announce_lock);
+    }
+    g_free(member->last_sender);
+    g_free(member->id);
+    g_free(member->name);
+    g_free(member);
+}
+
+int player_sync_is_leader(player_sync_member_t *member) {
+    return member && member->leader;
+}
+
+void player_sync_announce(player_sync_member_t *member, sync_cmd_t cmd, const char *uri,
+                          gint64 position, GstClockTime base_time) {
+    if (!member || !member->leader) return;
+
+    g_mutex_lock(&announce_lock);
+    gchar *buf = format_message(member->id, cmd, ++seq, base_time, position, 0, uri);
+    size_t len = strlen(buf);
+    if (len >= SYNC_MAX_MSG) {
+        LOG_ERROR("[%s] Sync message too long, uri not shared", member->name);
+        g_free(buf);
+        g_mutex_unlock(&announce_lock);
+        return;
+    }
+    LOG_INFO("[%s] Sync %s at %" GST_TIME_FORMAT " from %" GST_TIME_FORMAT, member->name,
+             cmd_names[cmd], GST_TIME_ARGS(base_time), GST_TIME_ARGS(position));
+    send_message(buf, len);
+    if (cmd == SYNC_CMD_NEXT) {
+        g_free(last_next);
+        last_next = buf;
+        last_next_seq = seq;
+    } else {
+        g_free(last_announce);
+        last_announce = buf;
+        last_announce_seq = seq;
+    }
+    g_mutex_unlock(&announce_lock);
+}
+
+void player_sync_report(player_sync_member_t *member, gint64 offset) {
+    if (!member) return;
+    if (member->leader) {
+        atomic_store(&leader_offset, offset);
+        return;
+    }
+
+    gint64 now = g_get_monotonic_time();
+    if (now - member->last_report < SYNC_REPORT_SEC * G_USEC_PER_SEC) return;
+    member->last_report = now;
+
+    LOG_DEBUG("[%s] Sync offset %+.3f ms, clock %s", member->name, (double)offset / GST_MSECOND,
+              gst_clock_is_synced(sync_clock) ? "synced" : "not synced");
+    gchar *buf = format_message(member->id, SYNC_CMD_REPORT, 0, 0, 0, offset, member->name);
+    send_message(buf, strlen(buf));
+    g_free(buf);
+}
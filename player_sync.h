@@ -0,0 +1,77 @@
+#ifndef PLAYER_SYNC_H
+#define PLAYER_SYNC_H
+
+#include <glib.h>
+#include <gst/gst.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// 多房间同步播放(GStreamer 后端): --sync=master 的进程用 GstNetTimeProvider 发布自己的系统时钟，
+// --sync=slave 的进程用 GstNetClientClock 跟随它，所有管道使用这个共享时钟并且不自动分配 base_time。
+// 主机上第一个实例是组长，它的 Play/Seek/Resume 换算成"在共享时钟 base_time 时刻从 position 开始"，
+// 连同 Pause/Stop/下一首通过 UDP 组播发给组员，base_time 取当前时间加 --sync-delay，
+// 组员在这个时刻之前完成预卷，各房间的第一个采样落在同一时刻。组长每隔几秒重发最近的状态和下一首，
+// 后加入的组员据此从当前位置追上。
+// 组员定期上报自己的播放位置相对共享时钟的偏移，组长和自己的偏移比较后记录各房间的漂移。
+// 同一台机器上可以同时运行主机和多个从机(或在一个进程中用 --zones 配置多个区域)测试
+typedef enum {
+    SYNC_CMD_START,     // 在 base_time 从 position 开始播放 text(uri)
+    SYNC_CMD_PAUSE,
+    SYNC_CMD_STOP,
+    SYNC_CMD_NEXT,      // 无缝播放的下一首 text(uri)，可以为空
+    SYNC_CMD_REPORT     // 组员上报 offset，text 为区域名
+} sync_cmd_t;
+
+typedef struct {
+    sync_cmd_t cmd;
+    guint32 seq;
+    GstClockTime base_time;
+    gint64 position;        // 开始位置(ns)
+    gint64 offset;          // 播放位置减去(共享时钟 - base_time)，单位 ns
+    const char *text;
+} sync_msg_t;
+
+typedef struct player_sync_member player_sync_member_t;
+
+// 组员收到组长命令时在接收线程中回调，回调期间不持有成员锁
+typedef void (*player_sync_cb)(const sync_msg_t *msg, void *userdata);
+
+// 同步相关命令行选项(--sync 等)
+GOptionGroup* player_sync_get_option_group(void);
+
+// 按命令行选项初始化，未启用同步时返回0且不做任何事；需要在 gst_init 之后调用
+int player_sync_init(void);
+
+void player_sync_deinit(void);
+
+// 共享时钟，未启用同步时返回 NULL
+GstClock* player_sync_get_clock(void);
+
+// 等待共享时钟和主机对齐，超时返回 FALSE
+gboolean player_sync_wait_clock(void);
+
+// 组长发出的开始时刻: 共享时钟当前时间加 --sync-delay
+GstClockTime player_sync_start_time(void);
+
+// 管道加入同步组，主机上第一个加入的成为组长；未启用同步时返回 NULL
+player_sync_member_t* player_sync_join(const char *name, player_sync_cb cb, void *userdata);
+
+// 离开后不会再有回调
+void player_sync_leave(player_sync_member_t *member);
+
+int player_sync_is_leader(player_sync_member_t *member);
+
+// 组长广播命令，其他成员调用时什么也不做
+void player_sync_announce(player_sync_member_t *member, sync_cmd_t cmd, const char *uri,
+                          gint64 position, GstClockTime base_time);
+
+// 播放中每秒调用一次，记录或上报当前偏移
+void player_sync_report(player_sync_member_t *member, gint64 offset);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // PLAYER_SYNC_H
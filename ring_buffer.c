@@ -0,0 +1,89 @@
+#include "ring_buffer.h"
+#include <stdlib.h>
+#include <string.h>
+
+static size_t round_up_pow2(size_t v) {
+    size_t p = 1;
+    while (p < v) p <<= 1;
+    return p;
+}
+
+int ring_buffer_init(ring_buffer_t *rb, size_t size, size_t low_watermark, size_t high_watermark) {
+    if (!rb || size == 0) return -1;
+
+    size = round_up_pow2(size);
+    rb->data = malloc(size);
+    if (!rb->data) return -1;
+
+    rb->size = size;
+    rb->mask = size - 1;
+
+    if (high_watermark == 0 || high_watermark > size) high_watermark = size / 4;
+    if (low_watermark == 0 || low_watermark >= high_watermark) low_watermark = high_watermark / 8;
+    rb->low_watermark = low_watermark;
+    rb->high_watermark = high_watermark;
+
+    atomic_init(&rb->head, 0);
+    atomic_init(&rb->tail, 0);
+    return 0;
+}
+
+void ring_buffer_free(ring_buffer_t *rb) {
+    if (!rb) return;
+    free(rb->data);
+    rb->data = NULL;
+    rb->size = 0;
+    rb->mask = 0;
+}
+
+void ring_buffer_reset(ring_buffer_t *rb) {
+    atomic_store_explicit(&rb->head, 0, memory_order_relaxed);
+    atomic_store_explicit(&rb->tail, 0, memory_order_relaxed);
+}
+
+size_t ring_buffer_used(ring_buffer_t *rb) {
+    size_t head = atomic_load_explicit(&rb->head, memory_order_acquire);
+    size_t tail = atomic_load_explicit(&rb->tail, memory_order_acquire);
+    return head - tail;
+}
+
+size_t ring_buffer_space(ring_buffer_t *rb) {
+    return rb->size - ring_buffer_used(rb);
+}
+
+size_t ring_buffer_write(ring_buffer_t *rb, const void *src, size_t len) {
+    size_t head = atomic_load_explicit(&rb->head, memory_order_relaxed);
+    size_t tail = atomic_load_explicit(&rb->tail, memory_order_acquire);
+    size_t space = rb->size - (head - tail);
+    if (len > space) len = space;
+    if (len == 0) return 0;
+
+    // 分两段拷贝，处理回绕
+    size_t off = head & rb->mask;
+    size_t first = rb->size - off;
+    if (first > len) first = len;
+    memcpy(rb->data + off, src, first);
+    memcpy(rb->data, (const unsigned char *)src + first, len - first);
+
+    // release: 数据写完后再发布新的 head
+    atomic_store_explicit(&rb->head, head + len, memory_order_release);
+    return len;
+}
+
+size_t ring_buffer_read(ring_buffer_t *rb, void *dst, size_t len) {
+    size_t tail = atomic_load_explicit(&rb->tail, memory_order_relaxed);
+    size_t head = atomic_load_explicit(&rb->head, memory_order_acquire);
+    size_t used = head - tail;
+    if (len > used) len = used;
+    if (len == 0) return 0;
+
+    size_t off = tail & rb->mask;
+    size_t first = rb->size - off;
+    if (first > len) first = len;
+    memcpy(dst, rb->data + off, first);
+    memcpy((unsigned char *)dst + first, rb->data, len - first);
+
+    // release: 数据读完后再归还空间给生产者
+    atomic_store_explicit(&rb->tail, tail + len, memory_order_release);
+    return len;
+}
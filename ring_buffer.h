@@ -0,0 +1,48 @@
+#ifndef RING_BUFFER_H
+#define RING_BUFFER_H
+
+#include <stddef.h>
+#include <stdatomic.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// 单生产者/单消费者无锁字节环形缓冲区
+// 生产者只修改 head，消费者只修改 tail，两者都是单调递增的计数，
+// 通过 size(2的幂) 取模得到实际下标
+typedef struct {
+    unsigned char *data;
+    size_t size;             // 容量，2的幂
+    size_t mask;
+    size_t low_watermark;    // 数据量低于此值视为欠载，消费者停下来重新缓冲
+    size_t high_watermark;   // 消费者开始/欠载后恢复消费前需要积累的数据量
+    atomic_size_t head;      // 已写入总字节数(生产者)
+    atomic_size_t tail;      // 已读取总字节数(消费者)
+} ring_buffer_t;
+
+// size 会向上取整为2的幂；high 为0时取容量的1/4，low 为0(或不小于high)时取 high 的1/8
+int ring_buffer_init(ring_buffer_t *rb, size_t size, size_t low_watermark, size_t high_watermark);
+
+void ring_buffer_free(ring_buffer_t *rb);
+
+// 清空缓冲区，调用时生产者和消费者都不能在访问缓冲区
+void ring_buffer_reset(ring_buffer_t *rb);
+
+// 尽可能多地写入，返回实际写入字节数(仅生产者调用)
+size_t ring_buffer_write(ring_buffer_t *rb, const void *src, size_t len);
+
+// 尽可能多地读出，返回实际读取字节数(仅消费者调用)
+size_t ring_buffer_read(ring_buffer_t *rb, void *dst, size_t len);
+
+// 当前可读字节数
+size_t ring_buffer_used(ring_buffer_t *rb);
+
+// 当前可写字节数
+size_t ring_buffer_space(ring_buffer_t *rb);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // RING_BUFFER_H
@@ -0,0 +1,307 @@
+#include "soft_volume.h"
+#include <string.h>
+#include <math.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define SOFT_VOLUME_NEON 1
+#endif
+
+#define SOFT_VOLUME_RANGE_DB 50.0f
+#define S32_MAX_FLOAT 2147483520.0f  // 小于 2^31 的最大 float，避免转换溢出
+
+static const size_t sample_bytes[] = { 2, 3, 4, 4 };
+
+void soft_volume_init(soft_volume_t *sv, int dither) {
+    memset(sv, 0, sizeof(*sv));
+    sv->gain = 1.0f;
+    sv->target = 1.0f;
+    sv->dither = dither;
+    sv->ramp_frames = 48000 * SOFT_VOLUME_RAMP_MS / 1000;
+    // xorshift 状态不能为0
+    sv->rng[0] = 0x12345678u;
+    sv->rng[1] = 0x9e3779b9u;
+    sv->rng[2] = 0x7f4a7c15u;
+    sv->rng[3] = 0xdeadbeefu;
+}
+
+void soft_volume_set_rate(soft_volume_t *sv, unsigned int rate) {
+    sv->ramp_frames = rate * SOFT_VOLUME_RAMP_MS / 1000;
+}
+
+void soft_volume_set(soft_volume_t *sv, float target) {
+    if (target == sv->target) return;
+    sv->target = target;
+    if (sv->ramp_frames == 0) {
+        sv->gain = target;
+        sv->ramp_left = 0;
+        return;
+    }
+    sv->ramp_left = sv->ramp_frames;
+    sv->step = (target - sv->gain) / (float)sv->ramp_frames;
+}
+
+int soft_volume_active(soft_volume_t *sv) {
+    return sv->ramp_left > 0 || sv->gain != 1.0f;
+}
+
+float soft_volume_percent_to_gain(int percent) {
+    if (percent <= 0) return 0.0f;
+    if (percent >= 100) return 1.0f;
+    return powf(10.0f, (percent - 100) * (SOFT_VOLUME_RANGE_DB / 100.0f) / 20.0f);
+}
+
+static inline uint32_t xorshift32(uint32_t *state) {
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return x;
+}
+
+// 三角分布噪声，范围(-1, 1) LSB
+static inline float tpdf(uint32_t *state) {
+    uint32_t r = xorshift32(state);
+    return ((float)(r & 0xffff) - (float)(r >> 16)) * (1.0f / 65536.0f);
+}
+
+static inline int32_t round_clip(float v, float min, float max) {
+    if (v >= max) return (int32_t)max;
+    if (v <= min) return (int32_t)min;
+    return (int32_t)(v >= 0.0f ? v + 0.5f : v - 0.5f);
+}
+
+static inline int32_t load_s24(const uint8_t *p) {
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    return (int32_t)((uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8) >> 8;
+#else
+    return (int32_t)((uint32_t)p[2] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[0] << 8) >> 8;
+#endif
+}
+
+static inline void store_s24(uint8_t *p, int32_t v) {
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    p[0] = (uint8_t)(v >> 16); p[1] = (uint8_t)(v >> 8); p[2] = (uint8_t)v;
+#else
+    p[0] = (uint8_t)v; p[1] = (uint8_t)(v >> 8); p[2] = (uint8_t)(v >> 16);
+#endif
+}
+
+// 标量实现，处理渐变、尾部数据以及没有 SIMD 的平台
+static void apply_scalar(soft_volume_t *sv, const void *src, void *dst, size_t n,
+                         soft_volume_format_t format, float gain) {
+    size_t i;
+    switch (format) {
+    case SOFT_VOLUME_S16: {
+        const int16_t *s = src;
+        int16_t *d = dst;
+        for (i = 0; i < n; i++) {
+            float v = s[i] * gain;
+            if (sv->dither) v += tpdf(&sv->rng[0]);
+            d[i] = (int16_t)round_clip(v, -32768.0f, 32767.0f);
+        }
+        break;
+    }
+    case SOFT_VOLUME_S24_3: {
+        const uint8_t *s = src;
+        uint8_t *d = dst;
+        for (i = 0; i < n; i++) {
+            float v = load_s24(s + i * 3) * gain;
+            if (sv->dither) v += tpdf(&sv->rng[0]);
+            store_s24(d + i * 3, round_clip(v, -8388608.0f, 8388607.0f));
+        }
+        break;
+    }
+    case SOFT_VOLUME_S32: {
+        // 32位的 LSB 远低于任何 DAC 的噪底，不加抖动
+        const int32_t *s = src;
+        int32_t *d = dst;
+        for (i = 0; i < n; i++) {
+            d[i] = round_clip((float)s[i] * gain, -2147483648.0f, S32_MAX_FLOAT);
+        }
+        break;
+    }
+    case SOFT_VOLUME_FLOAT: {
+        const float *s = src;
+        float *d = dst;
+        for (i = 0; i < n; i++) {
+            d[i] = s[i] * gain;
+        }
+        break;
+    }
+    }
+}
+
+#if defined(__SSE2__)
+
+static inline __m128 tpdf_sse2(__m128i *state) {
+    __m128i x = *state;
+    x = _mm_xor_si128(x, _mm_slli_epi32(x, 13));
+    x = _mm_xor_si128(x, _mm_srli_epi32(x, 17));
+    x = _mm_xor_si128(x, _mm_slli_epi32(x, 5));
+    *state = x;
+    __m128i a = _mm_and_si128(x, _mm_set1_epi32(0xffff));
+    __m128i b = _mm_srli_epi32(x, 16);
+    return _mm_mul_ps(_mm_cvtepi32_ps(_mm_sub_epi32(a, b)), _mm_set1_ps(1.0f / 65536.0f));
+}
+
+// 恒定增益，返回已处理的样本数，剩余部分由标量代码处理
+static size_t apply_simd(soft_volume_t *sv, const void *src, void *dst, size_t n,
+                         soft_volume_format_t format, float gain) {
+    __m128 g = _mm_set1_ps(gain);
+    size_t i = 0;
+
+    switch (format) {
+    case SOFT_VOLUME_S16: {
+        const int16_t *s = src;
+        int16_t *d = dst;
+        __m128i rng = _mm_loadu_si128((const __m128i *)sv->rng);
+        for (; i + 8 <= n; i += 8) {
+            __m128i x = _mm_loadu_si128((const __m128i *)(s + i));
+            __m128 lo = _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(x, x), 16)), g);
+            __m128 hi = _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(x, x), 16)), g);
+            if (sv->dither) {
+                lo = _mm_add_ps(lo, tpdf_sse2(&rng));
+                hi = _mm_add_ps(hi, tpdf_sse2(&rng));
+            }
+            // 就近舍入，饱和打包回16位
+            _mm_storeu_si128((__m128i *)(d + i), _mm_packs_epi32(_mm_cvtps_epi32(lo), _mm_cvtps_epi32(hi)));
+        }
+        _mm_storeu_si128((__m128i *)sv->rng, rng);
+        break;
+    }
+    case SOFT_VOLUME_S32: {
+        const int32_t *s = src;
+        int32_t *d = dst;
+        __m128 max = _mm_set1_ps(S32_MAX_FLOAT);
+        for (; i + 4 <= n; i += 4) {
+            __m128 v = _mm_mul_ps(_mm_cvtepi32_ps(_mm_loadu_si128((const __m128i *)(s + i))), g);
+            _mm_storeu_si128((__m128i *)(d + i), _mm_cvtps_epi32(_mm_min_ps(v, max)));
+        }
+        break;
+    }
+    case SOFT_VOLUME_FLOAT: {
+        const float *s = src;
+        float *d = dst;
+        for (; i + 4 <= n; i += 4) {
+            _mm_storeu_ps(d + i, _mm_mul_ps(_mm_loadu_ps(s + i), g));
+        }
+        break;
+    }
+    default:
+        break;
+    }
+    return i;
+}
+
+#elif defined(SOFT_VOLUME_NEON)
+
+static inline float32x4_t tpdf_neon(uint32x4_t *state) {
+    uint32x4_t x = *state;
+    x = veorq_u32(x, vshlq_n_u32(x, 13));
+    x = veorq_u32(x, vshrq_n_u32(x, 17));
+    x = veorq_u32(x, vshlq_n_u32(x, 5));
+    *state = x;
+    int32x4_t a = vreinterpretq_s32_u32(vandq_u32(x, vdupq_n_u32(0xffff)));
+    int32x4_t b = vreinterpretq_s32_u32(vshrq_n_u32(x, 16));
+    return vmulq_n_f32(vcvtq_f32_s32(vsubq_s32(a, b)), 1.0f / 65536.0f);
+}
+
+// 就近舍入: vcvtq_s32_f32 向零截断，先加上带符号的 0.5
+static inline int32x4_t round_neon(float32x4_t v) {
+    uint32x4_t sign = vandq_u32(vreinterpretq_u32_f32(v), vdupq_n_u32(0x80000000u));
+    float32x4_t half = vreinterpretq_f32_u32(vorrq_u32(sign, vreinterpretq_u32_f32(vdupq_n_f32(0.5f))));
+    return vcvtq_s32_f32(vaddq_f32(v, half));
+}
+
+static size_t apply_simd(soft_volume_t *sv, const void *src, void *dst, size_t n,
+                         soft_volume_format_t format, float gain) {
+    float32x4_t g = vdupq_n_f32(gain);
+    size_t i = 0;
+
+    switch (format) {
+    case SOFT_VOLUME_S16: {
+        const int16_t *s = src;
+        int16_t *d = dst;
+        uint32x4_t rng = vld1q_u32(sv->rng);
+        for (; i + 8 <= n; i += 8) {
+            int16x8_t x = vld1q_s16(s + i);
+            float32x4_t lo = vmulq_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(x))), g);
+            float32x4_t hi = vmulq_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(x))), g);
+            if (sv->dither) {
+                lo = vaddq_f32(lo, tpdf_neon(&rng));
+                hi = vaddq_f32(hi, tpdf_neon(&rng));
+            }
+            vst1q_s16(d + i, vcombine_s16(vqmovn_s32(round_neon(lo)), vqmovn_s32(round_neon(hi))));
+        }
+        vst1q_u32(sv->rng, rng);
+        break;
+    }
+    case SOFT_VOLUME_S32: {
+        // vcvtq_s32_f32 本身是饱和转换
+        const int32_t *s = src;
+        int32_t *d = dst;
+        for (; i + 4 <= n; i += 4) {
+            vst1q_s32(d + i, round_neon(vmulq_f32(vcvtq_f32_s32(vld1q_s32(s + i)), g)));
+        }
+        break;
+    }
+    case SOFT_VOLUME_FLOAT: {
+        const float *s = src;
+        float *d = dst;
+        for (; i + 4 <= n; i += 4) {
+            vst1q_f32(d + i, vmulq_f32(vld1q_f32(s + i), g));
+        }
+        break;
+    }
+    default:
+        break;
+    }
+    return i;
+}
+
+#else
+
+static size_t apply_simd(soft_volume_t *sv, const void *src, void *dst, size_t n,
+                         soft_volume_format_t format, float gain) {
+    (void)sv; (void)src; (void)dst; (void)n; (void)format; (void)gain;
+    return 0;
+}
+
+#endif
+
+void soft_volume_apply(soft_volume_t *sv, const void *src, void *dst,
+                       size_t frames, int channels, soft_volume_format_t format) {
+    const uint8_t *s = src;
+    uint8_t *d = dst;
+    size_t frame_bytes = sample_bytes[format] * channels;
+
+    // 渐变部分逐帧计算增益
+    while (sv->ramp_left > 0 && frames > 0) {
+        sv->gain += sv->step;
+        if (--sv->ramp_left == 0) {
+            sv->gain = sv->target;
+        }
+        apply_scalar(sv, s, d, channels, format, sv->gain);
+        s += frame_bytes;
+        d += frame_bytes;
+        frames--;
+    }
+    if (frames == 0) return;
+
+    size_t n = frames * channels;
+    if (sv->gain == 1.0f) {
+        // 增益为1时不需要重新量化
+        if (s != d) memcpy(d, s, frames * frame_bytes);
+        return;
+    }
+
+    size_t done = apply_simd(sv, s, d, n, format, sv->gain);
+    if (done < n) {
+        size_t off = done * sample_bytes[format];
+        apply_scalar(sv, s + off, d + off, n - done, format, sv->gain);
+    }
+}
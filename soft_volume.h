@@ -0,0 +1,54 @@
+#ifndef SOFT_VOLUME_H
+#define SOFT_VOLUME_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// 软件音量: 对解码后的 PCM 做增益，增益变化时按帧线性渐变避免爆音，
+// 整数格式可选 TPDF 抖动；恒定增益部分使用 SSE2/NEON 处理
+typedef enum {
+    SOFT_VOLUME_S16 = 0,
+    SOFT_VOLUME_S24_3,      // 3字节打包，本机字节序
+    SOFT_VOLUME_S32,
+    SOFT_VOLUME_FLOAT
+} soft_volume_format_t;
+
+#define SOFT_VOLUME_RAMP_MS 10   // 增益渐变时长
+
+typedef struct {
+    float gain;                 // 当前增益
+    float target;               // 目标增益
+    float step;                 // 渐变中每帧的增益变化量
+    unsigned int ramp_left;     // 剩余渐变帧数
+    unsigned int ramp_frames;   // 一次渐变的帧数
+    int dither;                 // 是否加 TPDF 抖动
+    uint32_t rng[4];            // 抖动用的 xorshift 状态(4路，供 SIMD 使用)
+} soft_volume_t;
+
+void soft_volume_init(soft_volume_t *sv, int dither);
+
+// 按采样率设置渐变帧数
+void soft_volume_set_rate(soft_volume_t *sv, unsigned int rate);
+
+// 设置目标增益(线性)，从当前增益渐变过去
+void soft_volume_set(soft_volume_t *sv, float target);
+
+// 当前是否需要处理(增益不为1或正在渐变)
+int soft_volume_active(soft_volume_t *sv);
+
+// 音量百分比(0-100)转线性增益，0 为静音，其余按 50dB 范围的对数曲线
+float soft_volume_percent_to_gain(int percent);
+
+// 处理 frames 帧，src 与 dst 可以相同(原地处理)
+void soft_volume_apply(soft_volume_t *sv, const void *src, void *dst,
+                       size_t frames, int channels, soft_volume_format_t format);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SOFT_VOLUME_H
@@ -0,0 +1,473 @@
+// SOAP 动作压力测试: 在回环接口上发现渲染器(或用 -l 直接给出描述地址)，N 个控制点线程
+// 按权重混合发送 GetPositionInfo/GetTransportInfo/SetVolume/Play/Stop，结束后以 JSON 输出
+// 吞吐量和 p50/p99/p999 延迟，用来发现 action_handler 的性能回退、估算一个渲染器能承受的控制点数量
+// 编译: gcc -O2 -o upnp_action_bench upnp_action_bench.c -lpthread
+//       $(pkg-config --cflags --libs libupnp)
+// 示例: ./upnp_action_bench -c 32 -d 20 -m GetPositionInfo=80,GetTransportInfo=15,SetVolume=5
+#include <upnp/upnp.h>
+#include <upnp/upnptools.h>
+#include <upnp/ixml.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <time.h>
+#include <errno.h>
+#include <limits.h>
+#include <stdatomic.h>
+
+#define MEDIARENDERER_TYPE "urn:schemas-upnp-org:device:MediaRenderer:1"
+#define AVTRANSPORT_SERVICE "urn:schemas-upnp-org:service:AVTransport:1"
+#define RENDERING_SERVICE "urn:schemas-upnp-org:service:RenderingControl:1"
+
+typedef enum {
+    ACT_GET_POSITION_INFO,
+    ACT_GET_TRANSPORT_INFO,
+    ACT_SET_VOLUME,
+    ACT_PLAY,
+    ACT_STOP,
+    ACT_COUNT
+} action_id_t;
+
+static const char *const action_names[ACT_COUNT] = {
+    "GetPositionInfo", "GetTransportInfo", "SetVolume", "Play", "Stop"
+};
+
+// 默认混合比例接近真实控制点: 以轮询为主，偶尔调音量
+static int weights[ACT_COUNT] = { 70, 20, 10, 0, 0 };
+
+typedef struct {
+    double *samples;        // 成功请求的延迟(us)
+    size_t count, cap;
+    long errors;
+} latency_log_t;
+
+typedef struct {
+    int index;
+    unsigned int seed;
+    latency_log_t log[ACT_COUNT];
+} controller_t;
+
+static UpnpClient_Handle ctrlpt_handle = -1;
+static char avtransport_url[1024];
+static char rendering_url[1024];
+
+// 发现结果
+static pthread_mutex_t found_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t found_cond = PTHREAD_COND_INITIALIZER;
+static char found_location[1024];
+static char found_udn[256];
+static const char *udn_filter = NULL;
+
+static int controllers = 8;
+static double duration = 10.0;     // 秒
+static int think_ms = 0;           // 每个控制点两次请求之间的间隔，0 为闭环压测
+static atomic_int stop_flag = 0;
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int ctrlpt_callback(Upnp_EventType EventType, void *Event, void *Cookie) {
+    (void)Cookie;
+    if (EventType == UPNP_DISCOVERY_ADVERTISEMENT_ALIVE ||
+        EventType == UPNP_DISCOVERY_SEARCH_RESULT) {
+
+        struct Upnp_Discovery *d_event = (struct Upnp_Discovery *)Event;
+        if (d_event->ErrCode != UPNP_E_SUCCESS) {
+            fprintf(stderr, "Discovery error: %d\n", d_event->ErrCode);
+            return 0;
+        }
+        if (udn_filter && !strstr(d_event->DeviceId, udn_filter)) {
+            return 0;
+        }
+
+        pthread_mutex_lock(&found_lock);
+        if (!found_location[0]) {
+            snprintf(found_location, sizeof(found_location), "%s", d_event->Location);
+            snprintf(found_udn, sizeof(found_udn), "%s", d_event->DeviceId);
+            pthread_cond_signal(&found_cond);
+        }
+        pthread_mutex_unlock(&found_lock);
+    }
+    return 0;
+}
+
+static int discover(int timeout) {
+    int rc = UpnpSearchAsync(ctrlpt_handle, timeout, MEDIARENDERER_TYPE, NULL);
+    if (rc != UPNP_E_SUCCESS) {
+        fprintf(stderr, "UpnpSearchAsync failed: %s\n", UpnpGetErrorMessage(rc));
+        return -1;
+    }
+
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += timeout + 1;
+
+    pthread_mutex_lock(&found_lock);
+    while (!found_location[0]) {
+        if (pthread_cond_timedwait(&found_cond, &found_lock, &deadline) == ETIMEDOUT) break;
+    }
+    int found = found_location[0] != '\0';
+    pthread_mutex_unlock(&found_lock);
+
+    if (!found) {
+        fprintf(stderr, "No MediaRenderer found within %d s\n", timeout);
+        return -1;
+    }
+    return 0;
+}
+
+static char* element_text(IXML_Element *parent, const char *tag) {
+    char *text = NULL;
+    IXML_NodeList *nodes = ixmlElement_getElementsByTagName(parent, tag);
+    if (nodes) {
+        IXML_Node *child = ixmlNode_getFirstChild(ixmlNodeList_item(nodes, 0));
+        if (child) text = (char *)ixmlNode_getNodeValue(child);
+        ixmlNodeList_free(nodes);
+    }
+    return text;
+}
+
+// 从设备描述中取出 AVTransport 和 RenderingControl 的控制地址
+static int resolve_control_urls(const char *location) {
+    IXML_Document *desc = NULL;
+    int rc = UpnpDownloadXmlDoc(location, &desc);
+    if (rc != UPNP_E_SUCCESS) {
+        fprintf(stderr, "Failed to download %s: %s\n", location, UpnpGetErrorMessage(rc));
+        return -1;
+    }
+
+    IXML_NodeList *services = ixmlDocument_getElementsByTagName(desc, "service");
+    unsigned long n = services ? ixmlNodeList_length(services) : 0;
+    for (unsigned long i = 0; i < n; i++) {
+        IXML_Element *svc = (IXML_Element *)ixmlNodeList_item(services, i);
+        const char *type = element_text(svc, "serviceType");
+        const char *control = element_text(svc, "controlURL");
+        char *target = NULL;
+        if (!type || !control) continue;
+        if (strcmp(type, AVTRANSPORT_SERVICE) == 0) {
+            target = avtransport_url;
+        } else if (strcmp(type, RENDERING_SERVICE) == 0) {
+            target = rendering_url;
+        }
+        if (target) {
+            char *abs = NULL;
+            if (UpnpResolveURL2(location, control, &abs) == UPNP_E_SUCCESS) {
+                snprintf(target, sizeof(avtransport_url), "%s", abs);
+                free(abs);
+            }
+        }
+    }
+    if (services) ixmlNodeList_free(services);
+    ixmlDocument_free(desc);
+
+    if (!avtransport_url[0] || !rendering_url[0]) {
+        fprintf(stderr, "Renderer description lacks AVTransport or RenderingControl\n");
+        return -1;
+    }
+    return 0;
+}
+
+static IXML_Document* make_action(action_id_t id, unsigned int *seed, const char **url, const char **service) {
+    char volume[8];
+    *url = avtransport_url;
+    *service = AVTRANSPORT_SERVICE;
+
+    switch (id) {
+        case ACT_SET_VOLUME:
+            *url = rendering_url;
+            *service = RENDERING_SERVICE;
+            snprintf(volume, sizeof(volume), "%d", rand_r(seed) % 101);
+            return UpnpMakeAction("SetVolume", RENDERING_SERVICE, 3,
+                                  "InstanceID", "0", "Channel", "Master", "DesiredVolume", volume);
+        case ACT_PLAY:
+            return UpnpMakeAction("Play", AVTRANSPORT_SERVICE, 2, "InstanceID", "0", "Speed", "1");
+        default:
+            return UpnpMakeAction(action_names[id], AVTRANSPORT_SERVICE, 1, "InstanceID", "0");
+    }
+}
+
+static void log_add(latency_log_t *log, double us) {
+    if (log->count == log->cap) {
+        log->cap = log->cap ? log->cap * 2 : 4096;
+        log->samples = realloc(log->samples, log->cap * sizeof(double));
+        if (!log->samples) {
+            fprintf(stderr, "Out of memory\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+    log->samples[log->count++] = us;
+}
+
+static action_id_t pick_action(unsigned int *seed, int total_weight) {
+    int r = rand_r(seed) % total_weight;
+    for (int i = 0; i < ACT_COUNT; i++) {
+        if (r < weights[i]) return (action_id_t)i;
+        r -= weights[i];
+    }
+    return ACT_GET_POSITION_INFO;
+}
+
+// 一个模拟控制点: 同步发送，收到响应后再发下一个
+static void* controller_thread(void *data) {
+    controller_t *c = data;
+    int total_weight = 0;
+    for (int i = 0; i < ACT_COUNT; i++) total_weight += weights[i];
+
+    while (!atomic_load(&stop_flag)) {
+        action_id_t id = pick_action(&c->seed, total_weight);
+        const char *url, *service;
+        IXML_Document *action = make_action(id, &c->seed, &url, &service);
+        IXML_Document *response = NULL;
+
+        double start = now_sec();
+        int rc = UpnpSendAction(ctrlpt_handle, url, service, NULL, action, &response);
+        double elapsed = (now_sec() - start) * 1e6;
+
+        // SOAP 错误(如没有曲目时 Play 返回 701)也是一次完整的往返，但单独计数
+        if (rc == UPNP_E_SUCCESS) {
+            log_add(&c->log[id], elapsed);
+        } else {
+            c->log[id].errors++;
+        }
+        if (response) ixmlDocument_free(response);
+        ixmlDocument_free(action);
+
+        if (think_ms > 0) usleep(think_ms * 1000);
+    }
+    return NULL;
+}
+
+static int compare_double(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+// 最近秩法，samples 已排序
+static double percentile(const double *samples, size_t count, double p) {
+    if (!count) return 0;
+    size_t rank = (size_t)(p * count + 0.999999);
+    if (rank < 1) rank = 1;
+    if (rank > count) rank = count;
+    return samples[rank - 1];
+}
+
+static void print_stats(const char *indent, latency_log_t *log) {
+    double sum = 0;
+    qsort(log->samples, log->count, sizeof(double), compare_double);
+    for (size_t i = 0; i < log->count; i++) sum += log->samples[i];
+
+    printf("%s\"requests\": %zu, \"errors\": %ld, \"throughput_rps\": %.1f,\n",
+           indent, log->count, log->errors, log->count / duration);
+    printf("%s\"latency_us\": { \"mean\": %.1f, \"p50\": %.1f, \"p99\": %.1f, \"p999\": %.1f, \"max\": %.1f }",
+           indent, log->count ? sum / log->count : 0.0,
+           percentile(log->samples, log->count, 0.50),
+           percentile(log->samples, log->count, 0.99),
+           percentile(log->samples, log->count, 0.999),
+           log->count ? log->samples[log->count - 1] : 0.0);
+}
+
+// 合并所有控制点的记录后输出 JSON
+static void report(controller_t *ctl, double elapsed) {
+    latency_log_t total = { 0 };
+    latency_log_t per_action[ACT_COUNT] = { { 0 } };
+
+    duration = elapsed;
+    for (int c = 0; c < controllers; c++) {
+        for (int a = 0; a < ACT_COUNT; a++) {
+            latency_log_t *log = &ctl[c].log[a];
+            for (size_t i = 0; i < log->count; i++) {
+                log_add(&per_action[a], log->samples[i]);
+                log_add(&total, log->samples[i]);
+            }
+            per_action[a].errors += log->errors;
+            total.errors += log->errors;
+        }
+    }
+
+    printf("{\n");
+    printf("  \"renderer\": \"%s\",\n", found_udn);
+    printf("  \"controllers\": %d,\n", controllers);
+    printf("  \"think_ms\": %d,\n", think_ms);
+    printf("  \"duration_s\": %.3f,\n", elapsed);
+    print_stats("  ", &total);
+    printf(",\n  \"actions\": {\n");
+    int first = 1;
+    for (int a = 0; a < ACT_COUNT; a++) {
+        if (!weights[a]) continue;
+        printf("%s    \"%s\": {\n", first ? "" : ",\n", action_names[a]);
+        printf("      \"weight\": %d,\n", weights[a]);
+        print_stats("      ", &per_action[a]);
+        printf("\n    }");
+        first = 0;
+        free(per_action[a].samples);
+    }
+    printf("\n  }\n}\n");
+    free(total.samples);
+}
+
+// -m GetPositionInfo=70,SetVolume=30: 未列出的动作权重为 0
+static int parse_mix(const char *spec) {
+    char *copy = strdup(spec);
+    int total = 0;
+    memset(weights, 0, sizeof(weights));
+    for (char *tok = strtok(copy, ","); tok; tok = strtok(NULL, ",")) {
+        char *eq = strchr(tok, '=');
+        int found = 0;
+        if (!eq) {
+            fprintf(stderr, "Malformed mix entry (expected Action=weight): %s\n", tok);
+            free(copy);
+            return -1;
+        }
+        *eq = '\0';
+        // 权重必须是非负整数，负数会让按权重抽样选错动作
+        char *end = NULL;
+        errno = 0;
+        long weight = strtol(eq + 1, &end, 10);
+        if (end == eq + 1 || *end != '\0' || errno != 0 || weight < 0 || weight > INT_MAX / ACT_COUNT) {
+            fprintf(stderr, "Invalid weight for %s: %s\n", tok, eq + 1);
+            free(copy);
+            return -1;
+        }
+        for (int i = 0; i < ACT_COUNT; i++) {
+            if (strcmp(tok, action_names[i]) == 0) {
+                total -= weights[i];
+                weights[i] = (int)weight;
+                total += weights[i];
+                found = 1;
+            }
+        }
+        if (!found) {
+            fprintf(stderr, "Unknown action in mix: %s\n", tok);
+            free(copy);
+            return -1;
+        }
+    }
+    free(copy);
+    return total > 0 ? 0 : -1;
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr,
+            "Usage: %s [-c controllers] [-d seconds] [-m Action=weight,...] [-p think_ms]\n"
+            "          [-i interface] [-u udn] [-l description_url] [-U uri] [-t search_timeout]\n"
+            "Actions: GetPositionInfo GetTransportInfo SetVolume Play Stop\n", prog);
+}
+
+int main(int argc, char *argv[]) {
+    const char *interface = "lo";
+    const char *location = NULL;
+    const char *uri = NULL;
+    int search_timeout = 5;
+    int opt, rc;
+
+    while ((opt = getopt(argc, argv, "c:d:m:p:i:u:l:U:t:h")) != -1) {
+        switch (opt) {
+            case 'c': controllers = atoi(optarg); break;
+            case 'd': duration = atof(optarg); break;
+            case 'm':
+                if (parse_mix(optarg) != 0) {
+                    fprintf(stderr, "Invalid action mix: %s\n", optarg);
+                    return EXIT_FAILURE;
+                }
+                break;
+            case 'p': think_ms = atoi(optarg); break;
+            case 'i': interface = optarg; break;
+            case 'u': udn_filter = optarg; break;
+            case 'l': location = optarg; break;
+            case 'U': uri = optarg; break;
+            case 't': search_timeout = atoi(optarg); break;
+            default:
+                usage(argv[0]);
+                return opt == 'h' ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+    }
+    if (controllers <= 0 || duration <= 0) {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    // 初始化 libupnp
+    rc = UpnpInit2(interface, 0);
+    if (rc != UPNP_E_SUCCESS) {
+        fprintf(stderr, "UpnpInit2 on %s failed: %s\n", interface, UpnpGetErrorMessage(rc));
+        return EXIT_FAILURE;
+    }
+    // 注册控制点
+    rc = UpnpRegisterClient(ctrlpt_callback, NULL, &ctrlpt_handle);
+    if (rc != UPNP_E_SUCCESS) {
+        fprintf(stderr, "UpnpRegisterClient failed: %s\n", UpnpGetErrorMessage(rc));
+        UpnpFinish();
+        return EXIT_FAILURE;
+    }
+
+    if (location) {
+        snprintf(found_location, sizeof(found_location), "%s", location);
+        snprintf(found_udn, sizeof(found_udn), "%s", location);
+    } else if (discover(search_timeout) != 0) {
+        UpnpUnRegisterClient(ctrlpt_handle);
+        UpnpFinish();
+        return EXIT_FAILURE;
+    }
+    if (resolve_control_urls(found_location) != 0) {
+        UpnpUnRegisterClient(ctrlpt_handle);
+        UpnpFinish();
+        return EXIT_FAILURE;
+    }
+    fprintf(stderr, "Renderer %s\n  AVTransport: %s\n  RenderingControl: %s\n",
+            found_udn, avtransport_url, rendering_url);
+
+    // Play 需要先有曲目
+    if (uri) {
+        IXML_Document *action = UpnpMakeAction("SetAVTransportURI", AVTRANSPORT_SERVICE, 3,
+                                               "InstanceID", "0", "CurrentURI", uri,
+                                               "CurrentURIMetaData", "");
+        IXML_Document *response = NULL;
+        rc = UpnpSendAction(ctrlpt_handle, avtransport_url, AVTRANSPORT_SERVICE, NULL, action, &response);
+        if (rc != UPNP_E_SUCCESS) {
+            fprintf(stderr, "SetAVTransportURI failed: %s\n", UpnpGetErrorMessage(rc));
+        }
+        if (response) ixmlDocument_free(response);
+        ixmlDocument_free(action);
+    }
+
+    controller_t *ctl = calloc(controllers, sizeof(controller_t));
+    pthread_t *threads = calloc(controllers, sizeof(pthread_t));
+    unsigned int base_seed = (unsigned int)time(NULL);
+    int started = 0;
+
+    fprintf(stderr, "Running %d controllers for %.1f s...\n", controllers, duration);
+    double start = now_sec();
+    for (int i = 0; i < controllers; i++) {
+        ctl[i].index = i;
+        ctl[i].seed = base_seed + i * 7919;
+        if (pthread_create(&threads[i], NULL, controller_thread, &ctl[i]) != 0) {
+            fprintf(stderr, "Failed to start controller %d\n", i);
+            break;
+        }
+        started++;
+    }
+    controllers = started;
+
+    usleep((useconds_t)(duration * 1e6));
+    atomic_store(&stop_flag, 1);
+    for (int i = 0; i < started; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    report(ctl, now_sec() - start);
+
+    for (int i = 0; i < started; i++) {
+        for (int a = 0; a < ACT_COUNT; a++) free(ctl[i].log[a].samples);
+    }
+    free(ctl);
+    free(threads);
+
+    // 清理资源
+    UpnpUnRegisterClient(ctrlpt_handle);
+    UpnpFinish();
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,648 @@
+// 由 gen_upnp_actions.py 根据 service/*.xml 生成，不要手工修改
+#include "upnp_actions.h"
+#include "player.h"
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <glib.h>
+#include <upnp/ixml.h>
+
+#define ACTION_TABLE_SIZE 64
+#define ACTION_HASH_SEED 14646u
+#define UPNP_MAX_ARGS 3
+
+static const char *const service_ids[UPNP_SERVICE_COUNT] = {
+    "urn:upnp-org:serviceId:AVTransport",
+    "urn:upnp-org:serviceId:RenderingControl",
+    "urn:upnp-org:serviceId:ConnectionManager",
+};
+
+union upnp_action_args {
+    AVTransport_SetAVTransportURI_args_t AVTransport_SetAVTransportURI;
+    AVTransport_SetNextAVTransportURI_args_t AVTransport_SetNextAVTransportURI;
+    AVTransport_GetMediaInfo_args_t AVTransport_GetMediaInfo;
+    AVTransport_Play_args_t AVTransport_Play;
+    AVTransport_Pause_args_t AVTransport_Pause;
+    AVTransport_Stop_args_t AVTransport_Stop;
+    AVTransport_Seek_args_t AVTransport_Seek;
+    AVTransport_Next_args_t AVTransport_Next;
+    AVTransport_Previous_args_t AVTransport_Previous;
+    AVTransport_GetTransportInfo_args_t AVTransport_GetTransportInfo;
+    AVTransport_GetPositionInfo_args_t AVTransport_GetPositionInfo;
+    AVTransport_GetDeviceCapabilities_args_t AVTransport_GetDeviceCapabilities;
+    AVTransport_GetTransportSettings_args_t AVTransport_GetTransportSettings;
+    AVTransport_GetCurrentTransportActions_args_t AVTransport_GetCurrentTransportActions;
+    RenderingControl_ListPresets_args_t RenderingControl_ListPresets;
+    RenderingControl_SelectPreset_args_t RenderingControl_SelectPreset;
+    RenderingControl_GetBrightness_args_t RenderingControl_GetBrightness;
+    RenderingControl_SetBrightness_args_t RenderingControl_SetBrightness;
+    RenderingControl_GetContrast_args_t RenderingControl_GetContrast;
+    RenderingControl_SetContrast_args_t RenderingControl_SetContrast;
+    RenderingControl_GetSharpness_args_t RenderingControl_GetSharpness;
+    RenderingControl_SetSharpness_args_t RenderingControl_SetSharpness;
+    RenderingControl_GetVolume_args_t RenderingControl_GetVolume;
+    RenderingControl_SetVolume_args_t RenderingControl_SetVolume;
+    RenderingControl_GetVolumeDB_args_t RenderingControl_GetVolumeDB;
+    RenderingControl_SetVolumeDB_args_t RenderingControl_SetVolumeDB;
+    RenderingControl_GetVolumeDBRange_args_t RenderingControl_GetVolumeDBRange;
+    RenderingControl_GetMute_args_t RenderingControl_GetMute;
+    RenderingControl_SetMute_args_t RenderingControl_SetMute;
+    RenderingControl_GetLoudness_args_t RenderingControl_GetLoudness;
+    RenderingControl_SetLoudness_args_t RenderingControl_SetLoudness;
+    ConnectionManager_GetCurrentConnectionInfo_args_t ConnectionManager_GetCurrentConnectionInfo;
+};
+
+typedef enum {
+    UPNP_ARG_STRING = 0,
+    UPNP_ARG_UI4,
+    UPNP_ARG_I4,
+    UPNP_ARG_UI2,
+    UPNP_ARG_I2,
+    UPNP_ARG_BOOLEAN
+} upnp_arg_type_t;
+
+typedef struct {
+    const char *name;
+    upnp_arg_type_t type;
+    size_t offset;
+    const char *const *allowed;     // NULL 结尾，NULL 表示不限
+    long long min, max;             // 数值类型的取值范围
+} upnp_arg_desc_t;
+
+typedef struct {
+    int service;
+    const char *name;
+    const upnp_arg_desc_t *args;
+    int nargs;
+    int (*call)(void *cookie, struct Upnp_Action_Request *request, const void *args);
+} upnp_action_desc_t;
+
+static const char *const allowed_AVTransport_Seek_Unit[] = { "TRACK_NR", "REL_TIME", "ABS_TIME", "ABS_COUNT", "REL_COUNT", NULL };
+
+static const upnp_arg_desc_t args_AVTransport_SetAVTransportURI[] = {
+    { "InstanceID", UPNP_ARG_UI4, offsetof(AVTransport_SetAVTransportURI_args_t, InstanceID), NULL, 0LL, 4294967295LL },
+    { "CurrentURI", UPNP_ARG_STRING, offsetof(AVTransport_SetAVTransportURI_args_t, CurrentURI), NULL, 0LL, 0LL },
+    { "CurrentURIMetaData", UPNP_ARG_STRING, offsetof(AVTransport_SetAVTransportURI_args_t, CurrentURIMetaData), NULL, 0LL, 0LL },
+};
+
+static const upnp_arg_desc_t args_AVTransport_SetNextAVTransportURI[] = {
+    { "InstanceID", UPNP_ARG_UI4, offsetof(AVTransport_SetNextAVTransportURI_args_t, InstanceID), NULL, 0LL, 4294967295LL },
+    { "NextURI", UPNP_ARG_STRING, offsetof(AVTransport_SetNextAVTransportURI_args_t, NextURI), NULL, 0LL, 0LL },
+    { "NextURIMetaData", UPNP_ARG_STRING, offsetof(AVTransport_SetNextAVTransportURI_args_t, NextURIMetaData), NULL, 0LL, 0LL },
+};
+
+static const upnp_arg_desc_t args_AVTransport_GetMediaInfo[] = {
+    { "InstanceID", UPNP_ARG_UI4, offsetof(AVTransport_GetMediaInfo_args_t, InstanceID), NULL, 0LL, 4294967295LL },
+};
+
+static const upnp_arg_desc_t args_AVTransport_Play[] = {
+    { "InstanceID", UPNP_ARG_UI4, offsetof(AVTransport_Play_args_t, InstanceID), NULL, 0LL, 4294967295LL },
+    { "Speed", UPNP_ARG_STRING, offsetof(AVTransport_Play_args_t, Speed), NULL, 0LL, 0LL },
+};
+
+static const upnp_arg_desc_t args_AVTransport_Pause[] = {
+    { "InstanceID", UPNP_ARG_UI4, offsetof(AVTransport_Pause_args_t, InstanceID), NULL, 0LL, 4294967295LL },
+};
+
+static const upnp_arg_desc_t args_AVTransport_Stop[] = {
+    { "InstanceID", UPNP_ARG_UI4, offsetof(AVTransport_Stop_args_t, InstanceID), NULL, 0LL, 4294967295LL },
+};
+
+static const upnp_arg_desc_t args_AVTransport_Seek[] = {
+    { "InstanceID", UPNP_ARG_UI4, offsetof(AVTransport_Seek_args_t, InstanceID), NULL, 0LL, 4294967295LL },
+    { "Unit", UPNP_ARG_STRING, offsetof(AVTransport_Seek_args_t, Unit), allowed_AVTransport_Seek_Unit, 0LL, 0LL },
+    { "Target", UPNP_ARG_STRING, offsetof(AVTransport_Seek_args_t, Target), NULL, 0LL, 0LL },
+};
+
+static const upnp_arg_desc_t args_AVTransport_Next[] = {
+    { "InstanceID", UPNP_ARG_UI4, offsetof(AVTransport_Next_args_t, InstanceID), NULL, 0LL, 4294967295LL },
+};
+
+static const upnp_arg_desc_t args_AVTransport_Previous[] = {
+    { "InstanceID", UPNP_ARG_UI4, offsetof(AVTransport_Previous_args_t, InstanceID), NULL, 0LL, 4294967295LL },
+};
+
+static const upnp_arg_desc_t args_AVTransport_GetTransportInfo[] = {
+    { "InstanceID", UPNP_ARG_UI4, offsetof(AVTransport_GetTransportInfo_args_t, InstanceID), NULL, 0LL, 4294967295LL },
+};
+
+static const upnp_arg_desc_t args_AVTransport_GetPositionInfo[] = {
+    { "InstanceID", UPNP_ARG_UI4, offsetof(AVTransport_GetPositionInfo_args_t, InstanceID), NULL, 0LL, 4294967295LL },
+};
+
+static const upnp_arg_desc_t args_AVTransport_GetDeviceCapabilities[] = {
+    { "InstanceID", UPNP_ARG_UI4, offsetof(AVTransport_GetDeviceCapabilities_args_t, InstanceID), NULL, 0LL, 4294967295LL },
+};
+
+static const upnp_arg_desc_t args_AVTransport_GetTransportSettings[] = {
+    { "InstanceID", UPNP_ARG_UI4, offsetof(AVTransport_GetTransportSettings_args_t, InstanceID), NULL, 0LL, 4294967295LL },
+};
+
+static const upnp_arg_desc_t args_AVTransport_GetCurrentTransportActions[] = {
+    { "InstanceID", UPNP_ARG_UI4, offsetof(AVTransport_GetCurrentTransportActions_args_t, InstanceID), NULL, 0LL, 4294967295LL },
+};
+
+static const upnp_arg_desc_t args_RenderingControl_ListPresets[] = {
+    { "InstanceID", UPNP_ARG_UI4, offsetof(RenderingControl_ListPresets_args_t, InstanceID), NULL, 0LL, 4294967295LL },
+};
+
+static const upnp_arg_desc_t args_RenderingControl_SelectPreset[] = {
+    { "InstanceID", UPNP_ARG_UI4, offsetof(RenderingControl_SelectPreset_args_t, InstanceID), NULL, 0LL, 4294967295LL },
+    { "PresetName", UPNP_ARG_STRING, offsetof(RenderingControl_SelectPreset_args_t, PresetName), NULL, 0LL, 0LL },
+};
+
+static const upnp_arg_desc_t args_RenderingControl_GetBrightness[] = {
+    { "InstanceID", UPNP_ARG_UI4, offsetof(RenderingControl_GetBrightness_args_t, InstanceID), NULL, 0LL, 4294967295LL },
+};
+
+static const upnp_arg_desc_t args_RenderingControl_SetBrightness[] = {
+    { "InstanceID", UPNP_ARG_UI4, offsetof(RenderingControl_SetBrightness_args_t, InstanceID), NULL, 0LL, 4294967295LL },
+    { "DesiredBrightness", UPNP_ARG_UI2, offsetof(RenderingControl_SetBrightness_args_t, DesiredBrightness), NULL, 0LL, 65535LL },
+};
+
+static const upnp_arg_desc_t args_RenderingControl_GetContrast[] = {
+    { "InstanceID", UPNP_ARG_UI4, offsetof(RenderingControl_GetContrast_args_t, InstanceID), NULL, 0LL, 4294967295LL },
+};
+
+static const upnp_arg_desc_t args_RenderingControl_SetContrast[] = {
+    { "InstanceID", UPNP_ARG_UI4, offsetof(RenderingControl_SetContrast_args_t, InstanceID), NULL, 0LL, 4294967295LL },
+    { "DesiredContrast", UPNP_ARG_UI2, offsetof(RenderingControl_SetContrast_args_t, DesiredContrast), NULL, 0LL, 65535LL },
+};
+
+static const upnp_arg_desc_t args_RenderingControl_GetSharpness[] = {
+    { "InstanceID", UPNP_ARG_UI4, offsetof(RenderingControl_GetSharpness_args_t, InstanceID), NULL, 0LL, 4294967295LL },
+};
+
+static const upnp_arg_desc_t args_RenderingControl_SetSharpness[] = {
+    { "InstanceID", UPNP_ARG_UI4, offsetof(RenderingControl_SetSharpness_args_t, InstanceID), NULL, 0LL, 4294967295LL },
+    { "DesiredSharpness", UPNP_ARG_UI2, offsetof(RenderingControl_SetSharpness_args_t, DesiredSharpness), NULL, 0LL, 65535LL },
+};
+
+static const upnp_arg_desc_t args_RenderingControl_GetVolume[] = {
+    { "InstanceID", UPNP_ARG_UI4, offsetof(RenderingControl_GetVolume_args_t, InstanceID), NULL, 0LL, 4294967295LL },
+    { "Channel", UPNP_ARG_STRING, offsetof(RenderingControl_GetVolume_args_t, Channel), NULL, 0LL, 0LL },
+};
+
+static const upnp_arg_desc_t args_RenderingControl_SetVolume[] = {
+    { "InstanceID", UPNP_ARG_UI4, offsetof(RenderingControl_SetVolume_args_t, InstanceID), NULL, 0LL, 4294967295LL },
+    { "Channel", UPNP_ARG_STRING, offsetof(RenderingControl_SetVolume_args_t, Channel), NULL, 0LL, 0LL },
+    { "DesiredVolume", UPNP_ARG_UI2, offsetof(RenderingControl_SetVolume_args_t, DesiredVolume), NULL, 0LL, 100LL },
+};
+
+static const upnp_arg_desc_t args_RenderingControl_GetVolumeDB[] = {
+    { "InstanceID", UPNP_ARG_UI4, offsetof(RenderingControl_GetVolumeDB_args_t, InstanceID), NULL, 0LL, 4294967295LL },
+    { "Channel", UPNP_ARG_STRING, offsetof(RenderingControl_GetVolumeDB_args_t, Channel), NULL, 0LL, 0LL },
+};
+
+static const upnp_arg_desc_t args_RenderingControl_SetVolumeDB[] = {
+    { "InstanceID", UPNP_ARG_UI4, offsetof(RenderingControl_SetVolumeDB_args_t, InstanceID), NULL, 0LL, 4294967295LL },
+    { "Channel", UPNP_ARG_STRING, offsetof(RenderingControl_SetVolumeDB_args_t, Channel), NULL, 0LL, 0LL },
+    { "DesiredVolume", UPNP_ARG_I2, offsetof(RenderingControl_SetVolumeDB_args_t, DesiredVolume), NULL, -32768LL, 32767LL },
+};
+
+static const upnp_arg_desc_t args_RenderingControl_GetVolumeDBRange[] = {
+    { "InstanceID", UPNP_ARG_UI4, offsetof(RenderingControl_GetVolumeDBRange_args_t, InstanceID), NULL, 0LL, 4294967295LL },
+    { "Channel", UPNP_ARG_STRING, offsetof(RenderingControl_GetVolumeDBRange_args_t, Channel), NULL, 0LL, 0LL },
+};
+
+static const upnp_arg_desc_t args_RenderingControl_GetMute[] = {
+    { "InstanceID", UPNP_ARG_UI4, offsetof(RenderingControl_GetMute_args_t, InstanceID), NULL, 0LL, 4294967295LL },
+    { "Channel", UPNP_ARG_STRING, offsetof(RenderingControl_GetMute_args_t, Channel), NULL, 0LL, 0LL },
+};
+
+static const upnp_arg_desc_t args_RenderingControl_SetMute[] = {
+    { "InstanceID", UPNP_ARG_UI4, offsetof(RenderingControl_SetMute_args_t, InstanceID), NULL, 0LL, 4294967295LL },
+    { "Channel", UPNP_ARG_STRING, offsetof(RenderingControl_SetMute_args_t, Channel), NULL, 0LL, 0LL },
+    { "DesiredMute", UPNP_ARG_BOOLEAN, offsetof(RenderingControl_SetMute_args_t, DesiredMute), NULL, 0LL, 0LL },
+};
+
+static const upnp_arg_desc_t args_RenderingControl_GetLoudness[] = {
+    { "InstanceID", UPNP_ARG_UI4, offsetof(RenderingControl_GetLoudness_args_t, InstanceID), NULL, 0LL, 4294967295LL },
+    { "Channel", UPNP_ARG_STRING, offsetof(RenderingControl_GetLoudness_args_t, Channel), NULL, 0LL, 0LL },
+};
+
+static const upnp_arg_desc_t args_RenderingControl_SetLoudness[] = {
+    { "InstanceID", UPNP_ARG_UI4, offsetof(RenderingControl_SetLoudness_args_t, InstanceID), NULL, 0LL, 4294967295LL },
+    { "Channel", UPNP_ARG_STRING, offsetof(RenderingControl_SetLoudness_args_t, Channel), NULL, 0LL, 0LL },
+    { "DesiredLoudness", UPNP_ARG_BOOLEAN, offsetof(RenderingControl_SetLoudness_args_t, DesiredLoudness), NULL, 0LL, 0LL },
+};
+
+static const upnp_arg_desc_t args_ConnectionManager_GetCurrentConnectionInfo[] = {
+    { "ConnectionID", UPNP_ARG_I4, offsetof(ConnectionManager_GetCurrentConnectionInfo_args_t, ConnectionID), NULL, -2147483648LL, 2147483647LL },
+};
+
+static int call_AVTransport_SetAVTransportURI(void *cookie, struct Upnp_Action_Request *request, const void *args) {
+    return handle_AVTransport_SetAVTransportURI(cookie, request, args);
+}
+
+static int call_AVTransport_SetNextAVTransportURI(void *cookie, struct Upnp_Action_Request *request, const void *args) {
+    return handle_AVTransport_SetNextAVTransportURI(cookie, request, args);
+}
+
+static int call_AVTransport_GetMediaInfo(void *cookie, struct Upnp_Action_Request *request, const void *args) {
+    return handle_AVTransport_GetMediaInfo(cookie, request, args);
+}
+
+static int call_AVTransport_Play(void *cookie, struct Upnp_Action_Request *request, const void *args) {
+    return handle_AVTransport_Play(cookie, request, args);
+}
+
+static int call_AVTransport_Pause(void *cookie, struct Upnp_Action_Request *request, const void *args) {
+    return handle_AVTransport_Pause(cookie, request, args);
+}
+
+static int call_AVTransport_Stop(void *cookie, struct Upnp_Action_Request *request, const void *args) {
+    return handle_AVTransport_Stop(cookie, request, args);
+}
+
+static int call_AVTransport_Seek(void *cookie, struct Upnp_Action_Request *request, const void *args) {
+    return handle_AVTransport_Seek(cookie, request, args);
+}
+
+static int call_AVTransport_Next(void *cookie, struct Upnp_Action_Request *request, const void *args) {
+    return handle_AVTransport_Next(cookie, request, args);
+}
+
+static int call_AVTransport_Previous(void *cookie, struct Upnp_Action_Request *request, const void *args) {
+    return handle_AVTransport_Previous(cookie, request, args);
+}
+
+static int call_AVTransport_GetTransportInfo(void *cookie, struct Upnp_Action_Request *request, const void *args) {
+    return handle_AVTransport_GetTransportInfo(cookie, request, args);
+}
+
+static int call_AVTransport_GetPositionInfo(void *cookie, struct Upnp_Action_Request *request, const void *args) {
+    return handle_AVTransport_GetPositionInfo(cookie, request, args);
+}
+
+static int call_AVTransport_GetDeviceCapabilities(void *cookie, struct Upnp_Action_Request *request, const void *args) {
+    return handle_AVTransport_GetDeviceCapabilities(cookie, request, args);
+}
+
+static int call_AVTransport_GetTransportSettings(void *cookie, struct Upnp_Action_Request *request, const void *args) {
+    return handle_AVTransport_GetTransportSettings(cookie, request, args);
+}
+
+static int call_AVTransport_GetCurrentTransportActions(void *cookie, struct Upnp_Action_Request *request, const void *args) {
+    return handle_AVTransport_GetCurrentTransportActions(cookie, request, args);
+}
+
+static int call_RenderingControl_ListPresets(void *cookie, struct Upnp_Action_Request *request, const void *args) {
+    return handle_RenderingControl_ListPresets(cookie, request, args);
+}
+
+static int call_RenderingControl_SelectPreset(void *cookie, struct Upnp_Action_Request *request, const void *args) {
+    return handle_RenderingControl_SelectPreset(cookie, request, args);
+}
+
+static int call_RenderingControl_GetBrightness(void *cookie, struct Upnp_Action_Request *request, const void *args) {
+    return handle_RenderingControl_GetBrightness(cookie, request, args);
+}
+
+static int call_RenderingControl_SetBrightness(void *cookie, struct Upnp_Action_Request *request, const void *args) {
+    return handle_RenderingControl_SetBrightness(cookie, request, args);
+}
+
+static int call_RenderingControl_GetContrast(void *cookie, struct Upnp_Action_Request *request, const void *args) {
+    return handle_RenderingControl_GetContrast(cookie, request, args);
+}
+
+static int call_RenderingControl_SetContrast(void *cookie, struct Upnp_Action_Request *request, const void *args) {
+    return handle_RenderingControl_SetContrast(cookie, request, args);
+}
+
+static int call_RenderingControl_GetSharpness(void *cookie, struct Upnp_Action_Request *request, const void *args) {
+    return handle_RenderingControl_GetSharpness(cookie, request, args);
+}
+
+static int call_RenderingControl_SetSharpness(void *cookie, struct Upnp_Action_Request *request, const void *args) {
+    return handle_RenderingControl_SetSharpness(cookie, request, args);
+}
+
+static int call_RenderingControl_GetVolume(void *cookie, struct Upnp_Action_Request *request, const void *args) {
+    return handle_RenderingControl_GetVolume(cookie, request, args);
+}
+
+static int call_RenderingControl_SetVolume(void *cookie, struct Upnp_Action_Request *request, const void *args) {
+    return handle_RenderingControl_SetVolume(cookie, request, args);
+}
+
+static int call_RenderingControl_GetVolumeDB(void *cookie, struct Upnp_Action_Request *request, const void *args) {
+    return handle_RenderingControl_GetVolumeDB(cookie, request, args);
+}
+
+static int call_RenderingControl_SetVolumeDB(void *cookie, struct Upnp_Action_Request *request, const void *args) {
+    return handle_RenderingControl_SetVolumeDB(cookie, request, args);
+}
+
+static int call_RenderingControl_GetVolumeDBRange(void *cookie, struct Upnp_Action_Request *request, const void *args) {
+    return handle_RenderingControl_GetVolumeDBRange(cookie, request, args);
+}
+
+static int call_RenderingControl_GetMute(void *cookie, struct Upnp_Action_Request *request, const void *args) {
+    return handle_RenderingControl_GetMute(cookie, request, args);
+}
+
+static int call_RenderingControl_SetMute(void *cookie, struct Upnp_Action_Request *request, const void *args) {
+    return handle_RenderingControl_SetMute(cookie, request, args);
+}
+
+static int call_RenderingControl_GetLoudness(void *cookie, struct Upnp_Action_Request *request, const void *args) {
+    return handle_RenderingControl_GetLoudness(cookie, request, args);
+}
+
+static int call_RenderingControl_SetLoudness(void *cookie, struct Upnp_Action_Request *request, const void *args) {
+    return handle_RenderingControl_SetLoudness(cookie, request, args);
+}
+
+static int call_ConnectionManager_GetProtocolInfo(void *cookie, struct Upnp_Action_Request *request, const void *args) {
+    (void)args;
+    return handle_ConnectionManager_GetProtocolInfo(cookie, request);
+}
+
+static int call_ConnectionManager_GetCurrentConnectionIDs(void *cookie, struct Upnp_Action_Request *request, const void *args) {
+    (void)args;
+    return handle_ConnectionManager_GetCurrentConnectionIDs(cookie, request);
+}
+
+static int call_ConnectionManager_GetCurrentConnectionInfo(void *cookie, struct Upnp_Action_Request *request, const void *args) {
+    return handle_ConnectionManager_GetCurrentConnectionInfo(cookie, request, args);
+}
+
+static const upnp_action_desc_t desc_AVTransport_SetAVTransportURI = {
+    UPNP_SERVICE_AVTRANSPORT, "SetAVTransportURI", args_AVTransport_SetAVTransportURI, 3, call_AVTransport_SetAVTransportURI
+};
+static const upnp_action_desc_t desc_AVTransport_SetNextAVTransportURI = {
+    UPNP_SERVICE_AVTRANSPORT, "SetNextAVTransportURI", args_AVTransport_SetNextAVTransportURI, 3, call_AVTransport_SetNextAVTransportURI
+};
+static const upnp_action_desc_t desc_AVTransport_GetMediaInfo = {
+    UPNP_SERVICE_AVTRANSPORT, "GetMediaInfo", args_AVTransport_GetMediaInfo, 1, call_AVTransport_GetMediaInfo
+};
+static const upnp_action_desc_t desc_AVTransport_Play = {
+    UPNP_SERVICE_AVTRANSPORT, "Play", args_AVTransport_Play, 2, call_AVTransport_Play
+};
+static const upnp_action_desc_t desc_AVTransport_Pause = {
+    UPNP_SERVICE_AVTRANSPORT, "Pause", args_AVTransport_Pause, 1, call_AVTransport_Pause
+};
+static const upnp_action_desc_t desc_AVTransport_Stop = {
+    UPNP_SERVICE_AVTRANSPORT, "Stop", args_AVTransport_Stop, 1, call_AVTransport_Stop
+};
+static const upnp_action_desc_t desc_AVTransport_Seek = {
+    UPNP_SERVICE_AVTRANSPORT, "Seek", args_AVTransport_Seek, 3, call_AVTransport_Seek
+};
+static const upnp_action_desc_t desc_AVTransport_Next = {
+    UPNP_SERVICE_AVTRANSPORT, "Next", args_AVTransport_Next, 1, call_AVTransport_Next
+};
+static const upnp_action_desc_t desc_AVTransport_Previous = {
+    UPNP_SERVICE_AVTRANSPORT, "Previous", args_AVTransport_Previous, 1, call_AVTransport_Previous
+};
+static const upnp_action_desc_t desc_AVTransport_GetTransportInfo = {
+    UPNP_SERVICE_AVTRANSPORT, "GetTransportInfo", args_AVTransport_GetTransportInfo, 1, call_AVTransport_GetTransportInfo
+};
+static const upnp_action_desc_t desc_AVTransport_GetPositionInfo = {
+    UPNP_SERVICE_AVTRANSPORT, "GetPositionInfo", args_AVTransport_GetPositionInfo, 1, call_AVTransport_GetPositionInfo
+};
+static const upnp_action_desc_t desc_AVTransport_GetDeviceCapabilities = {
+    UPNP_SERVICE_AVTRANSPORT, "GetDeviceCapabilities", args_AVTransport_GetDeviceCapabilities, 1, call_AVTransport_GetDeviceCapabilities
+};
+static const upnp_action_desc_t desc_AVTransport_GetTransportSettings = {
+    UPNP_SERVICE_AVTRANSPORT, "GetTransportSettings", args_AVTransport_GetTransportSettings, 1, call_AVTransport_GetTransportSettings
+};
+static const upnp_action_desc_t desc_AVTransport_GetCurrentTransportActions = {
+    UPNP_SERVICE_AVTRANSPORT, "GetCurrentTransportActions", args_AVTransport_GetCurrentTransportActions, 1, call_AVTransport_GetCurrentTransportActions
+};
+static const upnp_action_desc_t desc_RenderingControl_ListPresets = {
+    UPNP_SERVICE_RENDERINGCONTROL, "ListPresets", args_RenderingControl_ListPresets, 1, call_RenderingControl_ListPresets
+};
+static const upnp_action_desc_t desc_RenderingControl_SelectPreset = {
+    UPNP_SERVICE_RENDERINGCONTROL, "SelectPreset", args_RenderingControl_SelectPreset, 2, call_RenderingControl_SelectPreset
+};
+static const upnp_action_desc_t desc_RenderingControl_GetBrightness = {
+    UPNP_SERVICE_RENDERINGCONTROL, "GetBrightness", args_RenderingControl_GetBrightness, 1, call_RenderingControl_GetBrightness
+};
+static const upnp_action_desc_t desc_RenderingControl_SetBrightness = {
+    UPNP_SERVICE_RENDERINGCONTROL, "SetBrightness", args_RenderingControl_SetBrightness, 2, call_RenderingControl_SetBrightness
+};
+static const upnp_action_desc_t desc_RenderingControl_GetContrast = {
+    UPNP_SERVICE_RENDERINGCONTROL, "GetContrast", args_RenderingControl_GetContrast, 1, call_RenderingControl_GetContrast
+};
+static const upnp_action_desc_t desc_RenderingControl_SetContrast = {
+    UPNP_SERVICE_RENDERINGCONTROL, "SetContrast", args_RenderingControl_SetContrast, 2, call_RenderingControl_SetContrast
+};
+static const upnp_action_desc_t desc_RenderingControl_GetSharpness = {
+    UPNP_SERVICE_RENDERINGCONTROL, "GetSharpness", args_RenderingControl_GetSharpness, 1, call_RenderingControl_GetSharpness
+};
+static const upnp_action_desc_t desc_RenderingControl_SetSharpness = {
+    UPNP_SERVICE_RENDERINGCONTROL, "SetSharpness", args_RenderingControl_SetSharpness, 2, call_RenderingControl_SetSharpness
+};
+static const upnp_action_desc_t desc_RenderingControl_GetVolume = {
+    UPNP_SERVICE_RENDERINGCONTROL, "GetVolume", args_RenderingControl_GetVolume, 2, call_RenderingControl_GetVolume
+};
+static const upnp_action_desc_t desc_RenderingControl_SetVolume = {
+    UPNP_SERVICE_RENDERINGCONTROL, "SetVolume", args_RenderingControl_SetVolume, 3, call_RenderingControl_SetVolume
+};
+static const upnp_action_desc_t desc_RenderingControl_GetVolumeDB = {
+    UPNP_SERVICE_RENDERINGCONTROL, "GetVolumeDB", args_RenderingControl_GetVolumeDB, 2, call_RenderingControl_GetVolumeDB
+};
+static const upnp_action_desc_t desc_RenderingControl_SetVolumeDB = {
+    UPNP_SERVICE_RENDERINGCONTROL, "SetVolumeDB", args_RenderingControl_SetVolumeDB, 3, call_RenderingControl_SetVolumeDB
+};
+static const upnp_action_desc_t desc_RenderingControl_GetVolumeDBRange = {
+    UPNP_SERVICE_RENDERINGCONTROL, "GetVolumeDBRange", args_RenderingControl_GetVolumeDBRange, 2, call_RenderingControl_GetVolumeDBRange
+};
+static const upnp_action_desc_t desc_RenderingControl_GetMute = {
+    UPNP_SERVICE_RENDERINGCONTROL, "GetMute", args_RenderingControl_GetMute, 2, call_RenderingControl_GetMute
+};
+static const upnp_action_desc_t desc_RenderingControl_SetMute = {
+    UPNP_SERVICE_RENDERINGCONTROL, "SetMute", args_RenderingControl_SetMute, 3, call_RenderingControl_SetMute
+};
+static const upnp_action_desc_t desc_RenderingControl_GetLoudness = {
+    UPNP_SERVICE_RENDERINGCONTROL, "GetLoudness", args_RenderingControl_GetLoudness, 2, call_RenderingControl_GetLoudness
+};
+static const upnp_action_desc_t desc_RenderingControl_SetLoudness = {
+    UPNP_SERVICE_RENDERINGCONTROL, "SetLoudness", args_RenderingControl_SetLoudness, 3, call_RenderingControl_SetLoudness
+};
+static const upnp_action_desc_t desc_ConnectionManager_GetProtocolInfo = {
+    UPNP_SERVICE_CONNECTIONMANAGER, "GetProtocolInfo", NULL, 0, call_ConnectionManager_GetProtocolInfo
+};
+static const upnp_action_desc_t desc_ConnectionManager_GetCurrentConnectionIDs = {
+    UPNP_SERVICE_CONNECTIONMANAGER, "GetCurrentConnectionIDs", NULL, 0, call_ConnectionManager_GetCurrentConnectionIDs
+};
+static const upnp_action_desc_t desc_ConnectionManager_GetCurrentConnectionInfo = {
+    UPNP_SERVICE_CONNECTIONMANAGER, "GetCurrentConnectionInfo", args_ConnectionManager_GetCurrentConnectionInfo, 1, call_ConnectionManager_GetCurrentConnectionInfo
+};
+
+// 完美哈希表，由生成器选取的种子保证没有冲突
+static const upnp_action_desc_t *const action_table[ACTION_TABLE_SIZE] = {
+    [0] = &desc_RenderingControl_SetVolumeDB,
+    [1] = &desc_RenderingControl_GetVolumeDB,
+    [2] = &desc_RenderingControl_GetBrightness,
+    [3] = &desc_RenderingControl_GetMute,
+    [4] = &desc_AVTransport_GetPositionInfo,
+    [5] = &desc_AVTransport_GetMediaInfo,
+    [10] = &desc_ConnectionManager_GetProtocolInfo,
+    [13] = &desc_AVTransport_GetTransportSettings,
+    [14] = &desc_RenderingControl_SelectPreset,
+    [15] = &desc_RenderingControl_SetSharpness,
+    [17] = &desc_AVTransport_Pause,
+    [18] = &desc_RenderingControl_GetVolumeDBRange,
+    [21] = &desc_ConnectionManager_GetCurrentConnectionInfo,
+    [23] = &desc_RenderingControl_SetBrightness,
+    [29] = &desc_RenderingControl_GetContrast,
+    [31] = &desc_RenderingControl_GetVolume,
+    [32] = &desc_RenderingControl_SetContrast,
+    [34] = &desc_RenderingControl_GetSharpness,
+    [35] = &desc_ConnectionManager_GetCurrentConnectionIDs,
+    [36] = &desc_RenderingControl_GetLoudness,
+    [38] = &desc_AVTransport_GetCurrentTransportActions,
+    [41] = &desc_RenderingControl_SetVolume,
+    [42] = &desc_AVTransport_Previous,
+    [43] = &desc_AVTransport_SetAVTransportURI,
+    [44] = &desc_AVTransport_SetNextAVTransportURI,
+    [48] = &desc_RenderingControl_ListPresets,
+    [49] = &desc_AVTransport_GetTransportInfo,
+    [50] = &desc_AVTransport_Stop,
+    [51] = &desc_RenderingControl_SetLoudness,
+    [53] = &desc_AVTransport_GetDeviceCapabilities,
+    [54] = &desc_AVTransport_Next,
+    [59] = &desc_AVTransport_Seek,
+    [61] = &desc_RenderingControl_SetMute,
+    [63] = &desc_AVTransport_Play,
+};
+
+static int action_error(struct Upnp_Action_Request *request, int code, const char *msg, const char *arg) {
+    UpnpActionRequest_set_ErrCode(request, code);
+    if (arg) {
+        snprintf(request->ErrStr, sizeof(request->ErrStr), "%s: %s", msg, arg);
+    } else {
+        snprintf(request->ErrStr, sizeof(request->ErrStr), "%s", msg);
+    }
+    LOG_ERROR("Action %s error [%d]: %s", request->ActionName, code, request->ErrStr);
+    return UPNP_E_SUCCESS;
+}
+
+// 参数错误，设置错误响应后返回-1
+static int arg_error(struct Upnp_Action_Request *request, int code, const char *msg, const char *arg) {
+    action_error(request, code, msg, arg);
+    return -1;
+}
+
+static uint32_t action_hash(uint32_t seed, int service, const char *name) {
+    uint32_t h = 2166136261u ^ seed;
+    h ^= (unsigned char)service;
+    h *= 16777619u;
+    for (const unsigned char *p = (const unsigned char *)name; *p; p++) {
+        h ^= *p;
+        h *= 16777619u;
+    }
+    return h ^ (h >> 16);
+}
+
+static int lookup_service(const char *service_id) {
+    for (int i = 0; i < UPNP_SERVICE_COUNT; i++) {
+        if (strcmp(service_id, service_ids[i]) == 0) return i;
+    }
+    return -1;
+}
+
+static const char* local_name(const char *name) {
+    const char *colon = strchr(name, ':');
+    return colon ? colon + 1 : name;
+}
+
+static int parse_bool(const char *s, int *out) {
+    if (strcmp(s, "1") == 0 || g_ascii_strcasecmp(s, "true") == 0 || g_ascii_strcasecmp(s, "yes") == 0) {
+        *out = 1;
+        return 0;
+    }
+    if (strcmp(s, "0") == 0 || g_ascii_strcasecmp(s, "false") == 0 || g_ascii_strcasecmp(s, "no") == 0) {
+        *out = 0;
+        return 0;
+    }
+    return -1;
+}
+
+// 遍历一次动作元素的子节点取出参数，再逐个转换和校验
+static int parse_args(struct Upnp_Action_Request *request, const upnp_action_desc_t *desc, void *args) {
+    const char *raw[UPNP_MAX_ARGS] = { NULL };
+    IXML_Node *action = ixmlNode_getFirstChild((IXML_Node *)request->ActionRequest);
+    while (action && ixmlNode_getNodeType(action) != eELEMENT_NODE) {
+        action = ixmlNode_getNextSibling(action);
+    }
+
+    for (IXML_Node *node = action ? ixmlNode_getFirstChild(action) : NULL; node;
+         node = ixmlNode_getNextSibling(node)) {
+        if (ixmlNode_getNodeType(node) != eELEMENT_NODE) continue;
+        const char *name = local_name(ixmlNode_getNodeName(node));
+        for (int i = 0; i < desc->nargs; i++) {
+            if (!raw[i] && strcmp(name, desc->args[i].name) == 0) {
+                IXML_Node *value = ixmlNode_getFirstChild(node);
+                raw[i] = value ? ixmlNode_getNodeValue(value) : "";
+                break;
+            }
+        }
+    }
+
+    for (int i = 0; i < desc->nargs; i++) {
+        const upnp_arg_desc_t *arg = &desc->args[i];
+        char *field = (char *)args + arg->offset;
+        const char *s = raw[i];
+
+        // UPnP 动作的输入参数都是必需的；元素存在但内容为空时按空串处理
+        if (!s) return arg_error(request, 402, "Invalid args", arg->name);
+        if (arg->type == UPNP_ARG_STRING) {
+            if (arg->allowed) {
+                const char *const *v = arg->allowed;
+                while (*v && strcmp(*v, s) != 0) v++;
+                if (!*v) return arg_error(request, 600, "Argument value invalid", arg->name);
+            }
+            *(const char **)field = s;
+            continue;
+        }
+
+        if (arg->type == UPNP_ARG_BOOLEAN) {
+            if (parse_bool(s, (int *)field) != 0) {
+                return arg_error(request, 600, "Argument value invalid", arg->name);
+            }
+            continue;
+        }
+
+        char *end = NULL;
+        long long v = strtoll(s, &end, 10);
+        if (end == s || *end != '\0') {
+            return arg_error(request, 600, "Argument value invalid", arg->name);
+        }
+        if (v < arg->min || v > arg->max) {
+            return arg_error(request, 601, "Argument value out of range", arg->name);
+        }
+        switch (arg->type) {
+            case UPNP_ARG_UI4: *(uint32_t *)field = (uint32_t)v; break;
+            case UPNP_ARG_I4:  *(int32_t *)field = (int32_t)v; break;
+            case UPNP_ARG_UI2: *(uint16_t *)field = (uint16_t)v; break;
+            case UPNP_ARG_I2:  *(int16_t *)field = (int16_t)v; break;
+            default: break;
+        }
+    }
+    return 0;
+}
+
+int upnp_dispatch_action(struct Upnp_Action_Request *request, void *cookie) {
+    int service = lookup_service(request->ServiceID);
+    if (service < 0) {
+        return action_error(request, 401, "Invalid action", request->ServiceID);
+    }
+
+    const upnp_action_desc_t *desc =
+        action_table[action_hash(ACTION_HASH_SEED, service, request->ActionName) % ACTION_TABLE_SIZE];
+    if (!desc || desc->service != service || strcmp(desc->name, request->ActionName) != 0) {
+        return action_error(request, 401, "Invalid action", request->ActionName);
+    }
+
+    union upnp_action_args args;
+    memset(&args, 0, sizeof(args));
+    if (parse_args(request, desc, &args) != 0) {
+        return UPNP_E_SUCCESS;
+    }
+    return desc->call(cookie, request, &args);
+}
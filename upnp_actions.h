@@ -0,0 +1,216 @@
+// 由 gen_upnp_actions.py 根据 service/*.xml 生成，不要手工修改
+#ifndef UPNP_ACTIONS_H
+#define UPNP_ACTIONS_H
+
+#include <stdint.h>
+#include <upnp/upnp.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum {
+    UPNP_SERVICE_AVTRANSPORT,
+    UPNP_SERVICE_RENDERINGCONTROL,
+    UPNP_SERVICE_CONNECTIONMANAGER,
+    UPNP_SERVICE_COUNT
+} upnp_service_t;
+
+typedef struct {
+    uint32_t InstanceID;
+    const char *CurrentURI;
+    const char *CurrentURIMetaData;
+} AVTransport_SetAVTransportURI_args_t;
+
+typedef struct {
+    uint32_t InstanceID;
+    const char *NextURI;
+    const char *NextURIMetaData;
+} AVTransport_SetNextAVTransportURI_args_t;
+
+typedef struct {
+    uint32_t InstanceID;
+} AVTransport_GetMediaInfo_args_t;
+
+typedef struct {
+    uint32_t InstanceID;
+    const char *Speed;
+} AVTransport_Play_args_t;
+
+typedef struct {
+    uint32_t InstanceID;
+} AVTransport_Pause_args_t;
+
+typedef struct {
+    uint32_t InstanceID;
+} AVTransport_Stop_args_t;
+
+typedef struct {
+    uint32_t InstanceID;
+    const char *Unit;  // TRACK_NR | REL_TIME | ABS_TIME | ABS_COUNT | REL_COUNT
+    const char *Target;
+} AVTransport_Seek_args_t;
+
+typedef struct {
+    uint32_t InstanceID;
+} AVTransport_Next_args_t;
+
+typedef struct {
+    uint32_t InstanceID;
+} AVTransport_Previous_args_t;
+
+typedef struct {
+    uint32_t InstanceID;
+} AVTransport_GetTransportInfo_args_t;
+
+typedef struct {
+    uint32_t InstanceID;
+} AVTransport_GetPositionInfo_args_t;
+
+typedef struct {
+    uint32_t InstanceID;
+} AVTransport_GetDeviceCapabilities_args_t;
+
+typedef struct {
+    uint32_t InstanceID;
+} AVTransport_GetTransportSettings_args_t;
+
+typedef struct {
+    uint32_t InstanceID;
+} AVTransport_GetCurrentTransportActions_args_t;
+
+typedef struct {
+    uint32_t InstanceID;
+} RenderingControl_ListPresets_args_t;
+
+typedef struct {
+    uint32_t InstanceID;
+    const char *PresetName;
+} RenderingControl_SelectPreset_args_t;
+
+typedef struct {
+    uint32_t InstanceID;
+} RenderingControl_GetBrightness_args_t;
+
+typedef struct {
+    uint32_t InstanceID;
+    uint16_t DesiredBrightness;
+} RenderingControl_SetBrightness_args_t;
+
+typedef struct {
+    uint32_t InstanceID;
+} RenderingControl_GetContrast_args_t;
+
+typedef struct {
+    uint32_t InstanceID;
+    uint16_t DesiredContrast;
+} RenderingControl_SetContrast_args_t;
+
+typedef struct {
+    uint32_t InstanceID;
+} RenderingControl_GetSharpness_args_t;
+
+typedef struct {
+    uint32_t InstanceID;
+    uint16_t DesiredSharpness;
+} RenderingControl_SetSharpness_args_t;
+
+typedef struct {
+    uint32_t InstanceID;
+    const char *Channel;
+} RenderingControl_GetVolume_args_t;
+
+typedef struct {
+    uint32_t InstanceID;
+    const char *Channel;
+    uint16_t DesiredVolume;  // 0 ~ 100
+} RenderingControl_SetVolume_args_t;
+
+typedef struct {
+    uint32_t InstanceID;
+    const char *Channel;
+} RenderingControl_GetVolumeDB_args_t;
+
+typedef struct {
+    uint32_t InstanceID;
+    const char *Channel;
+    int16_t DesiredVolume;
+} RenderingControl_SetVolumeDB_args_t;
+
+typedef struct {
+    uint32_t InstanceID;
+    const char *Channel;
+} RenderingControl_GetVolumeDBRange_args_t;
+
+typedef struct {
+    uint32_t InstanceID;
+    const char *Channel;
+} RenderingControl_GetMute_args_t;
+
+typedef struct {
+    uint32_t InstanceID;
+    const char *Channel;
+    int DesiredMute;
+} RenderingControl_SetMute_args_t;
+
+typedef struct {
+    uint32_t InstanceID;
+    const char *Channel;
+} RenderingControl_GetLoudness_args_t;
+
+typedef struct {
+    uint32_t InstanceID;
+    const char *Channel;
+    int DesiredLoudness;
+} RenderingControl_SetLoudness_args_t;
+
+typedef struct {
+    int32_t ConnectionID;
+} ConnectionManager_GetCurrentConnectionInfo_args_t;
+
+// 动作处理函数，由设备实现。调用时参数已按 SCPD 校验，字符串指向请求 DOM，只在本次调用内有效
+int handle_AVTransport_SetAVTransportURI(void *cookie, struct Upnp_Action_Request *request, const AVTransport_SetAVTransportURI_args_t *args);
+int handle_AVTransport_SetNextAVTransportURI(void *cookie, struct Upnp_Action_Request *request, const AVTransport_SetNextAVTransportURI_args_t *args);
+int handle_AVTransport_GetMediaInfo(void *cookie, struct Upnp_Action_Request *request, const AVTransport_GetMediaInfo_args_t *args);
+int handle_AVTransport_Play(void *cookie, struct Upnp_Action_Request *request, const AVTransport_Play_args_t *args);
+int handle_AVTransport_Pause(void *cookie, struct Upnp_Action_Request *request, const AVTransport_Pause_args_t *args);
+int handle_AVTransport_Stop(void *cookie, struct Upnp_Action_Request *request, const AVTransport_Stop_args_t *args);
+int handle_AVTransport_Seek(void *cookie, struct Upnp_Action_Request *request, const AVTransport_Seek_args_t *args);
+int handle_AVTransport_Next(void *cookie, struct Upnp_Action_Request *request, const AVTransport_Next_args_t *args);
+int handle_AVTransport_Previous(void *cookie, struct Upnp_Action_Request *request, const AVTransport_Previous_args_t *args);
+int handle_AVTransport_GetTransportInfo(void *cookie, struct Upnp_Action_Request *request, const AVTransport_GetTransportInfo_args_t *args);
+int handle_AVTransport_GetPositionInfo(void *cookie, struct Upnp_Action_Request *request, const AVTransport_GetPositionInfo_args_t *args);
+int handle_AVTransport_GetDeviceCapabilities(void *cookie, struct Upnp_Action_Request *request, const AVTransport_GetDeviceCapabilities_args_t *args);
+int handle_AVTransport_GetTransportSettings(void *cookie, struct Upnp_Action_Request *request, const AVTransport_GetTransportSettings_args_t *args);
+int handle_AVTransport_GetCurrentTransportActions(void *cookie, struct Upnp_Action_Request *request, const AVTransport_GetCurrentTransportActions_args_t *args);
+int handle_RenderingControl_ListPresets(void *cookie, struct Upnp_Action_Request *request, const RenderingControl_ListPresets_args_t *args);
+int handle_RenderingControl_SelectPreset(void *cookie, struct Upnp_Action_Request *request, const RenderingControl_SelectPreset_args_t *args);
+int handle_RenderingControl_GetBrightness(void *cookie, struct Upnp_Action_Request *request, const RenderingControl_GetBrightness_args_t *args);
+int handle_RenderingControl_SetBrightness(void *cookie, struct Upnp_Action_Request *request, const RenderingControl_SetBrightness_args_t *args);
+int handle_RenderingControl_GetContrast(void *cookie, struct Upnp_Action_Request *request, const RenderingControl_GetContrast_args_t *args);
+int handle_RenderingControl_SetContrast(void *cookie, struct Upnp_Action_Request *request, const RenderingControl_SetContrast_args_t *args);
+int handle_RenderingControl_GetSharpness(void *cookie, struct Upnp_Action_Request *request, const RenderingControl_GetSharpness_args_t *args);
+int handle_RenderingControl_SetSharpness(void *cookie, struct Upnp_Action_Request *request, const RenderingControl_SetSharpness_args_t *args);
+int handle_RenderingControl_GetVolume(void *cookie, struct Upnp_Action_Request *request, const RenderingControl_GetVolume_args_t *args);
+int handle_RenderingControl_SetVolume(void *cookie, struct Upnp_Action_Request *request, const RenderingControl_SetVolume_args_t *args);
+int handle_RenderingControl_GetVolumeDB(void *cookie, struct Upnp_Action_Request *request, const RenderingControl_GetVolumeDB_args_t *args);
+int handle_RenderingControl_SetVolumeDB(void *cookie, struct Upnp_Action_Request *request, const RenderingControl_SetVolumeDB_args_t *args);
+int handle_RenderingControl_GetVolumeDBRange(void *cookie, struct Upnp_Action_Request *request, const RenderingControl_GetVolumeDBRange_args_t *args);
+int handle_RenderingControl_GetMute(void *cookie, struct Upnp_Action_Request *request, const RenderingControl_GetMute_args_t *args);
+int handle_RenderingControl_SetMute(void *cookie, struct Upnp_Action_Request *request, const RenderingControl_SetMute_args_t *args);
+int handle_RenderingControl_GetLoudness(void *cookie, struct Upnp_Action_Request *request, const RenderingControl_GetLoudness_args_t *args);
+int handle_RenderingControl_SetLoudness(void *cookie, struct Upnp_Action_Request *request, const RenderingControl_SetLoudness_args_t *args);
+int handle_ConnectionManager_GetProtocolInfo(void *cookie, struct Upnp_Action_Request *request);
+int handle_ConnectionManager_GetCurrentConnectionIDs(void *cookie, struct Upnp_Action_Request *request);
+int handle_ConnectionManager_GetCurrentConnectionInfo(void *cookie, struct Upnp_Action_Request *request, const ConnectionManager_GetCurrentConnectionInfo_args_t *args);
+
+// 按 ServiceID/ActionName 查表，一次遍历取出并校验参数后调用处理函数。
+// 未知服务/动作、参数缺失或不合法时设置错误响应，返回 UPNP_E_SUCCESS。
+// cookie 原样传给处理函数(注册设备时的 cookie，用来区分同一进程中的多个设备)
+int upnp_dispatch_action(struct Upnp_Action_Request *request, void *cookie);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // UPNP_ACTIONS_H
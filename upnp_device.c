@@ -5,8 +5,6 @@
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
-#include <fcntl.h>
-#include <sys/stat.h>
 #include <unistd.h>
 #include <time.h>
 #include <uuid/uuid.h>
@@ -15,8 +13,15 @@
 #include <glib.h>
 #include <glib/gprintf.h>
 #include "player.h"
+#include "player_actor.h"
+#include "media_cache.h"
+#include "player_sync.h"
+#include "upnp_events.h"
+#include "upnp_actions.h"
+#include "upnp_response.h"
+#include "xml_builder.h"
+#include "virtual_dir.h"
 
-#define VIRTUAL_DIR "/virtual"
 #define UPNP_DEVICE_TYPE "urn:schemas-upnp-org:device:MediaRenderer:1"
 #define AVTRANSPORT_SERVICE "urn:schemas-upnp-org:service:AVTransport:1"
 #define RENDERING_SERVICE "urn:schemas-upnp-org:service:RenderingControl:1"
@@ -29,13 +34,15 @@ typedef struct {
    const gchar* interface_name;
 	 guint port;
    const gchar* uuid;
+   const gchar* zones_file;
 } AppOptions;
 
 static AppOptions g_options = {
 	.renderer_name = "DLNA MediaRenderer",
 	.interface_name = "eth0",
 	.port = 49494,
-	.uuid = 0
+	.uuid = 0,
+	.zones_file = NULL
 };
 
 static GOptionEntry option_entries[] = {
@@ -47,38 +54,41 @@ static GOptionEntry option_entries[] = {
       "Port number (default: 49494)", "PORT" },
     { "uuid", 'u', 0, G_OPTION_ARG_STRING, &g_options.uuid,
       "Custom device UUID", "UUID" },
+    { "zones", 'z', 0, G_OPTION_ARG_FILENAME, &g_options.zones_file,
+      "Zone config file: one [group] per renderer with name, device, ctrl-card, selem-name, volume, uuid",
+      "FILE" },
     { NULL }
 };
 
-static pthread_mutex_t renderer_mutex = PTHREAD_MUTEX_INITIALIZER;
-
-typedef struct {
-    const char *real_path;
-    const char *virtual_path;
-    const char *content_type;
-} VirtualFileEntry;
-
-typedef struct {
-    off_t pos;
-    const char *data;
-    size_t len;
-} WebServerFile;
-
-struct virtual_file {
-    char *virtual_fname;
-    char *content_type;
-    char *data;
-    size_t len;
-    struct virtual_file *next;
-}*virtual_files = NULL;
-
 typedef struct {
     char current_uri[1024];
+    char next_uri[1024];
+    gchar *current_meta;    // 控制点给的 DIDL-Lite，原样保存，响应和事件中回显
+    gchar *next_meta;
     volatile int playing;
     volatile int paused;
 } renderer_context_t;
 
-static renderer_context_t g_renderer_ctx = {{0}, 0, 0};
+// 一个区域: 一个 ALSA 输出、一个播放器实例、一个 UPnP 根设备。
+// 所有区域共用 libupnp 协议栈(SSDP、web 服务器、线程池)、GLib 主循环和播放后端的全局初始化
+typedef struct {
+    int index;
+    gchar *name;                // friendlyName
+    gchar *device;              // NULL 表示使用 --device
+    gchar *ctrl_card;
+    gchar *selem_name;
+    int volume;                 // 初始音量，0 表示后端默认
+    char udn[64];
+    player_t *player;
+    player_actor_t *actor;
+    upnp_events_t *events;
+    UpnpDevice_Handle device_handle;
+    pthread_mutex_t mutex;      // 保护 ctx
+    renderer_context_t ctx;
+} renderer_zone_t;
+
+static renderer_zone_t *g_zones = NULL;
+static int g_nzones = 0;
 
 void generate_uuid(char *uuid_str) {
     uuid_t uuid;
@@ -86,389 +96,587 @@ void generate_uuid(char *uuid_str) {
     uuid_unparse(uuid, uuid_str);
 }
 
-static char *read_file_to_memory(const char *filepath, size_t *length) {
-    FILE *file = fopen(filepath, "rb");
-    if (!file) {
-        perror("fopen failed");
-        return NULL;
+int set_error_response(struct Upnp_Action_Request* request, int error_code, const char* error_msg) {
+    UpnpActionRequest_set_ErrCode(request, error_code);
+    snprintf(request->ErrStr, sizeof(request->ErrStr), "%s", error_msg);
+    LOG_ERROR( "Action error [%d]: %s", error_code, error_msg);
+    return UPNP_E_SUCCESS;
+}
+
+// 调用者持有 z->mutex
+static const char* transport_state(renderer_zone_t *z)
+{
+    if (z->ctx.playing) {
+        // 网络流缓冲期间还没有声音输出
+        return player_is_buffering(z->player) ? "TRANSITIONING" : "PLAYING";
+    } else if (z->ctx.paused) {
+        return "PAUSED_PLAYBACK";
     }
+    return "STOPPED";
+}
 
-    fseek(file, 0, SEEK_END);
-    long size = ftell(file);
-    fseek(file, 0, SEEK_SET);
+static const char* transport_actions(renderer_zone_t *z)
+{
+    if (z->ctx.playing) return "Pause,Stop,Seek";
+    if (z->ctx.paused) return "Play,Stop,Seek";
+    return z->ctx.current_uri[0] != '\0' ? "Play" : "";
+}
 
-    if (size <= 0) {
-        fclose(file);
-        return NULL;
-    }
+static void format_time(char *buf, size_t size, int sec)
+{
+    if (sec < 0) sec = 0;
+    snprintf(buf, size, "%02d:%02d:%02d", sec / 3600, (sec % 3600) / 60, sec % 60);
+}
 
-    char *buf = malloc(size);
-    if (!buf) {
-        fclose(file);
-        return NULL;
-    }
+// 把 AVTransport 的状态同步到 LastChange，调用者持有 z->mutex
+static void update_transport_events(renderer_zone_t *z)
+{
+    int has_media = z->ctx.current_uri[0] != '\0';
+    int curr = 0, total = 0;
+    char duration[16];
+
+    upnp_events_set(z->events, EVENT_AVTRANSPORT, "TransportState", transport_state(z));
+    upnp_events_set(z->events, EVENT_AVTRANSPORT, "CurrentTransportActions", transport_actions(z));
+    upnp_events_set(z->events, EVENT_AVTRANSPORT, "AVTransportURI", z->ctx.current_uri);
+    upnp_events_set(z->events, EVENT_AVTRANSPORT, "CurrentTrackURI", z->ctx.current_uri);
+    upnp_events_set(z->events, EVENT_AVTRANSPORT, "NextAVTransportURI", z->ctx.next_uri);
+    upnp_events_set(z->events, EVENT_AVTRANSPORT, "AVTransportURIMetaData", z->ctx.current_meta);
+    upnp_events_set(z->events, EVENT_AVTRANSPORT, "CurrentTrackMetaData", z->ctx.current_meta);
+    upnp_events_set(z->events, EVENT_AVTRANSPORT, "NextAVTransportURIMetaData", z->ctx.next_meta);
+    upnp_events_set_int(z->events, EVENT_AVTRANSPORT, "NumberOfTracks", has_media);
+    upnp_events_set_int(z->events, EVENT_AVTRANSPORT, "CurrentTrack", has_media);
+
+    player_get_position(z->player, &curr, &total);
+    format_time(duration, sizeof(duration), total);
+    upnp_events_set(z->events, EVENT_AVTRANSPORT, "CurrentTrackDuration", duration);
+    upnp_events_set(z->events, EVENT_AVTRANSPORT, "CurrentMediaDuration", duration);
+}
 
-    if (fread(buf, 1, size, file) != (size_t)size) {
-        free(buf);
-        fclose(file);
-        return NULL;
+static void update_rendering_events(renderer_zone_t *z)
+{
+    int mute = 0;
+    upnp_events_set_int(z->events, EVENT_RENDERING_CONTROL, "Volume", player_get_volume(z->player));
+    if (player_get_mute(z->player, &mute) == 0) {
+        upnp_events_set_int(z->events, EVENT_RENDERING_CONTROL, "Mute", mute);
     }
-
-    fclose(file);
-    *length = size;
-    return buf;
 }
 
-int create_virtual_file(const char *real_path, const char *virtual_path, const char *content_type) {
-    size_t size;
-    char *data = read_file_to_memory(real_path, &size);
-    if (!data) {
-        LOG_ERROR( "Failed to read file: %s", real_path);
+//构建空响应
+int create_empty_response(IXML_Document **resp, const char *action, const char *service_type)
+{
+    if (!resp || !action || !service_type) {
         return -1;
     }
+    if (*resp) {
+        ixmlDocument_free(*resp);
+        *resp = NULL;
+    }
 
-    struct virtual_file *vf = malloc(sizeof(struct virtual_file));
-    if (!vf) {
-        free(data);
+    *resp = UpnpMakeActionResponse(action, service_type, 0, NULL);
+    if (*resp == NULL) {
         return -1;
     }
 
-    vf->virtual_fname = strdup(virtual_path);
-    vf->content_type = strdup(content_type);
-    vf->data = data;
-    vf->len = size;
-    vf->next = virtual_files;
-    virtual_files = vf;
-
-    LOG_DEBUG("Loaded virtual file: %s -> %s (%zu bytes)",
-           real_path, virtual_path, size);
     return 0;
 }
-int load_virtual_files(const VirtualFileEntry *entries, size_t count) {
-    for (size_t i = 0; i < count; ++i) {
-        if (create_virtual_file(entries[i].real_path,
-                              entries[i].virtual_path,
-                              entries[i].content_type) != 0) {
-            LOG_ERROR( "Failed to load: %s", entries[i].real_path);
-            return -1;
-        }
+
+static void set_action_result(struct Upnp_Action_Request *request, IXML_Document *doc)
+{
+    if (request->ActionResult) {
+        ixmlDocument_free(request->ActionResult);  // 释放旧的 XML 文档
     }
-    return 0;
-}
-void free_virtual_files(void) {
-    struct virtual_file *current = virtual_files;
-    while (current) {
-        struct virtual_file *next = current->next;
-        free(current->virtual_fname);
-        free(current->content_type);
-        free((void*)current->data);
-        free(current);
-        current = next;
-    }
-    virtual_files = NULL;
-    LOG_DEBUG("Freed all virtual files");
-}
-
-static struct virtual_file *get_file_by_name(const char *filename) {
-    struct virtual_file *virtfile = virtual_files;
-    while (virtfile) {
-        if (strcmp(filename, virtfile->virtual_fname) == 0) {
-            return virtfile;
-        }
-        virtfile = virtfile->next;
+    request->ActionResult = doc;
+    if (!doc) {
+        set_error_response(request, 501, "Action Failed");
     }
-    return NULL;
 }
 
-int my_get_info(const char *filename, UpnpFileInfo *info) {
-    struct virtual_file *virtfile = get_file_by_name(filename);
+// 只支持主声道，控制点没有带 Channel 时也按 Master 处理
+static int is_master_channel(const char *channel)
+{
+    return *channel == '\0' || strcmp(channel, "Master") == 0;
+}
 
-    if (virtfile) {
-        UpnpFileInfo_set_FileLength(info, virtfile->len);
-        UpnpFileInfo_set_LastModified(info, time(NULL));
-        UpnpFileInfo_set_IsDirectory(info, 0);
-        UpnpFileInfo_set_IsReadable(info, 1);
+// 提交命令时放在调用者栈上，调用者等待命令完成，回调期间一直有效
+typedef struct {
+    renderer_zone_t *zone;
+    const AVTransport_SetNextAVTransportURI_args_t *next;   // 只有 SET_NEXT_URI 使用
+} player_cmd_ctx_t;
 
-        // 克隆字符串以避免内存问题
-        char *content_type = ixmlCloneDOMString(virtfile->content_type);
-        UpnpFileInfo_set_ContentType(info, content_type);
-        return 0;
+// 播放器命令在执行线程中完成后回调，按执行顺序更新传输状态
+static void on_player_cmd_done(player_cmd_type_t type, int result, void *userdata)
+{
+    const player_cmd_ctx_t *cmd = userdata;
+    renderer_zone_t *z = cmd->zone;
+    const AVTransport_SetNextAVTransportURI_args_t *next = cmd->next;
+    if (result != 0) return;
+
+    pthread_mutex_lock(&z->mutex);
+    switch (type) {
+        case PLAYER_CMD_PLAY:
+        case PLAYER_CMD_RESUME:
+            z->ctx.playing = 1;
+            z->ctx.paused = 0;
+            break;
+        case PLAYER_CMD_PAUSE:
+            z->ctx.playing = 0;
+            z->ctx.paused = 1;
+            break;
+        case PLAYER_CMD_STOP:
+            z->ctx.playing = 0;
+            z->ctx.paused = 0;
+            break;
+        case PLAYER_CMD_SET_NEXT_URI:
+            strncpy(z->ctx.next_uri, next->NextURI, sizeof(z->ctx.next_uri) - 1);
+            z->ctx.next_uri[sizeof(z->ctx.next_uri)-1] = '\0';
+            g_free(z->ctx.next_meta);
+            z->ctx.next_meta = *next->NextURI ? g_strdup(next->NextURIMetaData) : NULL;
+            break;
+        default:
+            break;
     }
-    return -1;
+    update_transport_events(z);
+    pthread_mutex_unlock(&z->mutex);
 }
 
-UpnpWebFileHandle my_open(const char *filename, enum UpnpOpenFileMode mode) {
-    if (mode != UPNP_READ) return NULL;
-
-    struct virtual_file *virtfile = get_file_by_name(filename);
-    if (!virtfile) return NULL;
-
-    WebServerFile *file = malloc(sizeof(WebServerFile));
-    if (!file) return NULL;
+// 提交给该区域的播放器执行线程并等待结果。调用时不能持有 z->mutex，
+// 慢的播放器操作只阻塞当前请求，不影响其他控制点和其他区域的请求
+static int run_player_cmd(renderer_zone_t *z, player_cmd_type_t type, const char *uri, int arg)
+{
+    player_cmd_ctx_t cmd = { z, NULL };
+    return player_future_wait(player_actor_submit(z->actor, type, uri, arg, on_player_cmd_done, &cmd));
+}
 
-    file->pos = 0;
-    file->len = virtfile->len;
-    file->data = virtfile->data;
+// 以下为 upnp_actions.h 声明的动作处理函数，参数已经按 SCPD 校验过。
+// cookie 是注册根设备时传入的区域；访问 z->ctx 时持有 z->mutex，调用改变播放状态的 player_* 时不持有
+int handle_AVTransport_SetAVTransportURI(void *cookie, struct Upnp_Action_Request *request,
+                                         const AVTransport_SetAVTransportURI_args_t *args)
+{
+    renderer_zone_t *z = cookie;
+    if (*args->CurrentURI == '\0') {
+        return set_error_response(request, 701, "Invalid URI");
+    }
 
-    return (UpnpWebFileHandle)file;
+    pthread_mutex_lock(&z->mutex);
+    strncpy(z->ctx.current_uri, args->CurrentURI, sizeof(z->ctx.current_uri) - 1);
+    z->ctx.current_uri[sizeof(z->ctx.current_uri)-1] = '\0';
+    z->ctx.playing = 0;
+    z->ctx.paused = 0;
+    // 新的当前曲目，之前设置的下一首作废
+    z->ctx.next_uri[0] = '\0';
+    g_free(z->ctx.current_meta);
+    z->ctx.current_meta = g_strdup(args->CurrentURIMetaData);
+    g_free(z->ctx.next_meta);
+    z->ctx.next_meta = NULL;
+    LOG_DEBUG("Set URI: %s", z->ctx.current_uri);
+    update_transport_events(z);
+    pthread_mutex_unlock(&z->mutex);
+
+    // 排在之后的 Play 前面执行，不需要等待
+    player_future_release(player_actor_submit(z->actor, PLAYER_CMD_SET_NEXT_URI, NULL, 0, NULL, NULL));
+
+    create_empty_response(&(request->ActionResult), request->ActionName, AVTRANSPORT_SERVICE);
+    return UPNP_E_SUCCESS;
 }
 
-int my_read(UpnpWebFileHandle fileHnd, char *buf, size_t buflen) {
-    WebServerFile *file = (WebServerFile *)fileHnd;
-    if (!file) return -1;
+int handle_AVTransport_SetNextAVTransportURI(void *cookie, struct Upnp_Action_Request *request,
+                                             const AVTransport_SetNextAVTransportURI_args_t *args)
+{
+    renderer_zone_t *z = cookie;
+    player_cmd_ctx_t cmd = { z, args };
+    // NextURI 为空表示清除下一首
+    if (player_future_wait(player_actor_submit(z->actor, PLAYER_CMD_SET_NEXT_URI, args->NextURI, 0,
+                                               on_player_cmd_done, &cmd)) != 0) {
+        return set_error_response(request, 716, "Illegal next URI");
+    }
+    LOG_DEBUG("Set next URI: %s", args->NextURI);
 
-    size_t remaining = file->len - file->pos;
-    if (remaining == 0) return 0;
+    create_empty_response(&(request->ActionResult), request->ActionName, AVTRANSPORT_SERVICE);
+    return UPNP_E_SUCCESS;
+}
 
-    size_t to_read = (buflen < remaining) ? buflen : remaining;
-    memcpy(buf, file->data + file->pos, to_read);
-    file->pos += to_read;
+int handle_AVTransport_Play(void *cookie, struct Upnp_Action_Request *request, const AVTransport_Play_args_t *args)
+{
+    renderer_zone_t *z = cookie;
+    char uri[sizeof(z->ctx.current_uri)];
+    int paused;
+    (void)args;
+
+    pthread_mutex_lock(&z->mutex);
+    memcpy(uri, z->ctx.current_uri, sizeof(uri));
+    paused = z->ctx.paused;
+    pthread_mutex_unlock(&z->mutex);
+
+    if (uri[0] == '\0') {
+        return set_error_response(request, 702, "URI not set");
+    }
+    if (run_player_cmd(z, paused ? PLAYER_CMD_RESUME : PLAYER_CMD_PLAY, uri, 0) != 0) {
+        return set_error_response(request, 703, "Playback failed");
+    }
 
-    return to_read;
+    set_action_result(request, UpnpMakeActionResponse(request->ActionName, AVTRANSPORT_SERVICE, 1,
+                                                       "Speed", "1"));
+    return UPNP_E_SUCCESS;
 }
 
-int my_close(UpnpWebFileHandle fileHnd) {
-    WebServerFile *file = (WebServerFile *)fileHnd;
-    if (file) free(file);
-    return 0;
-}
+int handle_AVTransport_Pause(void *cookie, struct Upnp_Action_Request *request, const AVTransport_Pause_args_t *args)
+{
+    renderer_zone_t *z = cookie;
+    (void)args;
+    if (!player_is_playing(z->player)) {
+        return set_error_response(request, 704, "Not playing");
+    }
 
-int my_write(UpnpWebFileHandle fileHnd, char *buf, size_t buflen) {
-    return -1;
-}
+    run_player_cmd(z, PLAYER_CMD_PAUSE, NULL, 0);
 
-int my_seek(UpnpWebFileHandle fileHnd, off_t offset, int origin) {
-    WebServerFile *file = (WebServerFile *)fileHnd;
-    if (!file) return -1;
+    create_empty_response(&(request->ActionResult), request->ActionName, AVTRANSPORT_SERVICE);
+    return UPNP_E_SUCCESS;
+}
 
-    off_t new_pos;
-    switch (origin) {
-        case SEEK_SET: new_pos = offset; break;
-        case SEEK_CUR: new_pos = file->pos + offset; break;
-        case SEEK_END: new_pos = file->len + offset; break;
-        default: return -1;
+int handle_AVTransport_Stop(void *cookie, struct Upnp_Action_Request *request, const AVTransport_Stop_args_t *args)
+{
+    renderer_zone_t *z = cookie;
+    (void)args;
+    if (run_player_cmd(z, PLAYER_CMD_STOP, NULL, 0) != 0) {
+        LOG_ERROR("Stop failed (not playing?)");
     }
 
-    if (new_pos < 0 || new_pos > (off_t)file->len) return -1;
-
-    file->pos = new_pos;
-    return 0;
+    create_empty_response(&(request->ActionResult), request->ActionName, AVTRANSPORT_SERVICE);
+    return UPNP_E_SUCCESS;
 }
 
-struct UpnpVirtualDirCallbacks virtual_dir_callbacks = {
-    .get_info = my_get_info,
-    .open = my_open,
-    .read = my_read,
-    .close = my_close,
-    .write = my_write,
-    .seek = my_seek,
-};
+int handle_AVTransport_Seek(void *cookie, struct Upnp_Action_Request *request, const AVTransport_Seek_args_t *args)
+{
+    renderer_zone_t *z = cookie;
+    if (strcmp(args->Unit, "REL_TIME") != 0) {
+        return set_error_response(request, 705, "Unsupported seek unit");
+    }
 
-int webserver_register_callbacks(void) {
-    int rc = UpnpSetVirtualDirCallbacks(&virtual_dir_callbacks);
-    if (rc != UPNP_E_SUCCESS) {
-        LOG_ERROR( "UpnpSetVirtualDirCallbacks failed: %s (%d)",
-                UpnpGetErrorMessage(rc), rc);
-        return -1;
+    // 解析时间格式 (HH:MM:SS)
+    int hours = 0, minutes = 0, seconds = 0;
+    if (sscanf(args->Target, "%d:%d:%d", &hours, &minutes, &seconds) < 1) {
+        return set_error_response(request, 707, "Invalid time format");
     }
 
-    rc = UpnpAddVirtualDir(VIRTUAL_DIR);
-    if (rc != UPNP_E_SUCCESS) {
-        LOG_ERROR( "UpnpAddVirtualDir failed: %s (%d)",
-                UpnpGetErrorMessage(rc), rc);
-        return -1;
+    int total_seconds = hours * 3600 + minutes * 60 + seconds;
+
+    if (run_player_cmd(z, PLAYER_CMD_SEEK, NULL, total_seconds) != 0) {
+        return set_error_response(request, 708, "Seek failed");
     }
 
-    LOG_DEBUG("Registered virtual directory callbacks success");
-    return 0;
+    LOG_DEBUG("Seek to %s (%d seconds)", args->Target, total_seconds);
+
+    create_empty_response(&(request->ActionResult), request->ActionName, AVTRANSPORT_SERVICE);
+    return UPNP_E_SUCCESS;
 }
 
-const char* get_action_argument(struct Upnp_Action_Request* request, const char* arg_name) {
-    if (!request || !request->ActionRequest) return NULL;
+// 只有一首曲目，没有上一首/下一首
+int handle_AVTransport_Next(void *cookie, struct Upnp_Action_Request *request, const AVTransport_Next_args_t *args)
+{
+    (void)cookie;
+    (void)args;
+    return set_error_response(request, 701, "Transition not available");
+}
 
-    IXML_NodeList* nodeList = ixmlDocument_getElementsByTagName(request->ActionRequest, arg_name);
-    if (!nodeList) return NULL;
+int handle_AVTransport_Previous(void *cookie, struct Upnp_Action_Request *request, const AVTransport_Previous_args_t *args)
+{
+    (void)cookie;
+    (void)args;
+    return set_error_response(request, 701, "Transition not available");
+}
 
-    IXML_Node* node = ixmlNodeList_item(nodeList, 0);
-    if (!node) {
-        ixmlNodeList_free(nodeList);
-        return NULL;
-    }
+int handle_AVTransport_GetMediaInfo(void *cookie, struct Upnp_Action_Request *request, const AVTransport_GetMediaInfo_args_t *args)
+{
+    renderer_zone_t *z = cookie;
+    int total = 0;
+    char duration[16];
+    (void)args;
+
+    player_get_position(z->player, NULL, &total);
+    format_time(duration, sizeof(duration), total);
+
+    pthread_mutex_lock(&z->mutex);
+    const char *values[] = { duration, z->ctx.current_uri, z->ctx.current_meta,
+                             z->ctx.next_uri, z->ctx.next_meta };
+    set_action_result(request, upnp_response_make(RESPONSE_GET_MEDIA_INFO, values));
+    pthread_mutex_unlock(&z->mutex);
+    return UPNP_E_SUCCESS;
+}
 
-    IXML_Node* textNode = ixmlNode_getFirstChild(node);
-    const char* value = textNode ? ixmlNode_getNodeValue(textNode) : NULL;
+int handle_AVTransport_GetTransportInfo(void *cookie, struct Upnp_Action_Request *request,
+                                        const AVTransport_GetTransportInfo_args_t *args)
+{
+    renderer_zone_t *z = cookie;
+    (void)args;
+    pthread_mutex_lock(&z->mutex);
+    const char *values[] = { transport_state(z) };
+    pthread_mutex_unlock(&z->mutex);
+    set_action_result(request, upnp_response_make(RESPONSE_GET_TRANSPORT_INFO, values));
+    return UPNP_E_SUCCESS;
+}
 
-    ixmlNodeList_free(nodeList);
-    return value;
+int handle_AVTransport_GetPositionInfo(void *cookie, struct Upnp_Action_Request *request,
+                                       const AVTransport_GetPositionInfo_args_t *args)
+{
+    renderer_zone_t *z = cookie;
+    int curr = 0, total = 0;
+    char rel_time[16], duration[16];
+    (void)args;
+
+    player_get_position(z->player, &curr, &total);
+    format_time(rel_time, sizeof(rel_time), curr);
+    format_time(duration, sizeof(duration), total);
+
+    pthread_mutex_lock(&z->mutex);
+    const char *values[] = { duration, z->ctx.current_meta, z->ctx.current_uri,
+                             rel_time, rel_time };
+    set_action_result(request, upnp_response_make(RESPONSE_GET_POSITION_INFO, values));
+    pthread_mutex_unlock(&z->mutex);
+    return UPNP_E_SUCCESS;
 }
 
-int set_error_response(struct Upnp_Action_Request* request, int error_code, const char* error_msg) {
-    UpnpActionRequest_set_ErrCode(request, error_code);
-    snprintf(request->ErrStr, sizeof(request->ErrStr), "%s", error_msg);
-    LOG_ERROR( "Action error [%d]: %s", error_code, error_msg);
+int handle_AVTransport_GetDeviceCapabilities(void *cookie, struct Upnp_Action_Request *request,
+                                             const AVTransport_GetDeviceCapabilities_args_t *args)
+{
+    (void)cookie;
+    (void)args;
+    set_action_result(request, UpnpMakeActionResponse(request->ActionName, AVTRANSPORT_SERVICE, 3,
+                                                       "PlayMedia", "NETWORK",
+                                                       "RecMedia", "NOT_IMPLEMENTED",
+                                                       "RecQualityModes", "NOT_IMPLEMENTED"));
     return UPNP_E_SUCCESS;
 }
 
-static char* escape_xml(const char *input) {
-    if (!input) return NULL;
+int handle_AVTransport_GetTransportSettings(void *cookie, struct Upnp_Action_Request *request,
+                                            const AVTransport_GetTransportSettings_args_t *args)
+{
+    (void)cookie;
+    (void)args;
+    set_action_result(request, UpnpMakeActionResponse(request->ActionName, AVTRANSPORT_SERVICE, 2,
+                                                       "PlayMode", "NORMAL",
+                                                       "RecQualityMode", "NOT_IMPLEMENTED"));
+    return UPNP_E_SUCCESS;
+}
 
-    size_t len = strlen(input);
-    size_t escaped_len = len * 6 + 1; // 最坏情况下每个字符变成6个字符(&quot;)
-    char *output = malloc(escaped_len);
-    if (!output) return NULL;
+int handle_AVTransport_GetCurrentTransportActions(void *cookie, struct Upnp_Action_Request *request,
+                                                  const AVTransport_GetCurrentTransportActions_args_t *args)
+{
+    renderer_zone_t *z = cookie;
+    const char *actions;
+    (void)args;
+    pthread_mutex_lock(&z->mutex);
+    actions = transport_actions(z);
+    pthread_mutex_unlock(&z->mutex);
+    set_action_result(request, upnp_response_make(RESPONSE_GET_CURRENT_TRANSPORT_ACTIONS, &actions));
+    return UPNP_E_SUCCESS;
+}
 
-    size_t j = 0;
-    for (size_t i = 0; i < len; i++) {
-        switch (input[i]) {
-            case '<': strcpy(output + j, "&lt;"); j += 4; break;
-            case '>': strcpy(output + j, "&gt;"); j += 4; break;
-            case '&': strcpy(output + j, "&amp;"); j += 5; break;
-            case '\"': strcpy(output + j, "&quot;"); j += 6; break;
-            case '\'': strcpy(output + j, "&apos;"); j += 6; break;
-            default: output[j++] = input[i]; break;
-        }
+int handle_RenderingControl_ListPresets(void *cookie, struct Upnp_Action_Request *request,
+                                        const RenderingControl_ListPresets_args_t *args)
+{
+    (void)cookie;
+    (void)args;
+    set_action_result(request, UpnpMakeActionResponse(request->ActionName, RENDERING_SERVICE, 1,
+                                                       "CurrentPresetNameList", "FactoryDefaults"));
+    return UPNP_E_SUCCESS;
+}
 
-        // 防止缓冲区溢出
-        if (j >= escaped_len - 6) {
-            output[j] = '\0';
-            break;
-        }
+int handle_RenderingControl_SelectPreset(void *cookie, struct Upnp_Action_Request *request,
+                                         const RenderingControl_SelectPreset_args_t *args)
+{
+    (void)cookie;
+    if (strcmp(args->PresetName, "FactoryDefaults") != 0) {
+        return set_error_response(request, 701, "Invalid name");
     }
-    output[j] = '\0';
-    return output;
+    create_empty_response(&(request->ActionResult), request->ActionName, RENDERING_SERVICE);
+    return UPNP_E_SUCCESS;
 }
 
-//自己实现的响应xml构造函数
-IXML_Document* create_response_document(const char* action_name, const char* service_type, const char* content) {
-    if (!action_name || !service_type || !content) {
-        LOG_ERROR("Invalid argument in create_response_document");
-        return NULL;
+int handle_RenderingControl_GetVolume(void *cookie, struct Upnp_Action_Request *request,
+                                      const RenderingControl_GetVolume_args_t *args)
+{
+    renderer_zone_t *z = cookie;
+    char content[8];
+    if (!is_master_channel(args->Channel)) {
+        return set_error_response(request, 710, "Unsupported channel");
     }
+    snprintf(content, sizeof(content), "%d", player_get_volume(z->player));
+    const char *values[] = { content };
+    set_action_result(request, upnp_response_make(RESPONSE_GET_VOLUME, values));
+    return UPNP_E_SUCCESS;
+}
 
-    // 模板格式：<u:ActionResponse xmlns:u="...">...</u:ActionResponse>
-    const char* fmt = "<u:%sResponse xmlns:u=\"%s\">%s</u:%sResponse>";
-
-    // 计算所需缓冲区长度（+1 是为了 '\0'）
-    int len = snprintf(NULL, 0, fmt, action_name, service_type, content, action_name) + 1;
-    if (len <= 0) {
-        LOG_ERROR("Failed to calculate XML buffer size");
-        return NULL;
+int handle_RenderingControl_SetVolume(void *cookie, struct Upnp_Action_Request *request,
+                                      const RenderingControl_SetVolume_args_t *args)
+{
+    renderer_zone_t *z = cookie;
+    LOG_DEBUG("channel: %s", args->Channel);
+    if (!is_master_channel(args->Channel)) {
+        return set_error_response(request, 713, "Unsupported channel");
     }
-
-    // 分配足够的内存
-    char* resp_buf = (char*)malloc(len);
-    if (!resp_buf) {
-        LOG_ERROR("Out of memory in create_response_document");
-        return NULL;
+    if (player_set_volume(z->player, args->DesiredVolume) != 0) {
+        return set_error_response(request, 714, "Set volume failed");
     }
+    update_rendering_events(z);
 
-    // 生成 XML 字符串
-    snprintf(resp_buf, len, fmt, action_name, service_type, content, action_name);
+    create_empty_response(&(request->ActionResult), request->ActionName, RENDERING_SERVICE);
+    return UPNP_E_SUCCESS;
+}
 
-    // 解析为 IXML_Document
-    IXML_Document* doc = ixmlParseBuffer(resp_buf);
-    if (!doc) {
-        LOG_ERROR("acticon_name: %s Failed to parse response XML\nresp_buf: %s",action_name,resp_buf);
+int handle_RenderingControl_GetMute(void *cookie, struct Upnp_Action_Request *request,
+                                    const RenderingControl_GetMute_args_t *args)
+{
+    renderer_zone_t *z = cookie;
+    char content[8];
+    int mute = 0;
+    if (!is_master_channel(args->Channel)) {
+        return set_error_response(request, 710, "Unsupported channel");
     }
+    player_get_mute(z->player, &mute);
+    snprintf(content, sizeof(content), "%d", mute);
+    const char *values[] = { content };
+    set_action_result(request, upnp_response_make(RESPONSE_GET_MUTE, values));
+    return UPNP_E_SUCCESS;
+}
 
-    // 释放临时缓冲区
-    free(resp_buf);
+int handle_RenderingControl_SetMute(void *cookie, struct Upnp_Action_Request *request,
+                                    const RenderingControl_SetMute_args_t *args)
+{
+    renderer_zone_t *z = cookie;
+    if (!is_master_channel(args->Channel)) {
+        return set_error_response(request, 713, "Unsupported channel");
+    }
+    if (player_set_mute(z->player, args->DesiredMute) != 0) {
+        return set_error_response(request, 717, "Set mute failed");
+    }
+    update_rendering_events(z);
 
-    return doc;
+    create_empty_response(&(request->ActionResult), request->ActionName, RENDERING_SERVICE);
+    return UPNP_E_SUCCESS;
 }
 
-//结合使用libupnp提供的api处理xml文件
-int get_media_info(IXML_Document **resp, const char *action, const char *service_type)
+// 没有对应硬件的可选动作
+int handle_RenderingControl_GetBrightness(void *cookie, struct Upnp_Action_Request *request,
+                                          const RenderingControl_GetBrightness_args_t *args)
 {
-    int curr = 0, total = 0;
-    if (*resp) {
-        ixmlDocument_free(*resp);
-        *resp = NULL;
-    }
+    (void)cookie;
+    (void)args;
+    return set_error_response(request, 602, "Optional action not implemented");
+}
 
-    player_get_position(&curr, &total);
+int handle_RenderingControl_SetBrightness(void *cookie, struct Upnp_Action_Request *request,
+                                          const RenderingControl_SetBrightness_args_t *args)
+{
+    (void)cookie;
+    (void)args;
+    return set_error_response(request, 602, "Optional action not implemented");
+}
 
-    char trackDur[16];
-    snprintf(trackDur, sizeof(trackDur), "%02d:%02d:%02d", total / 3600, (total % 3600) / 60, total % 60);
+int handle_RenderingControl_GetContrast(void *cookie, struct Upnp_Action_Request *request,
+                                        const RenderingControl_GetContrast_args_t *args)
+{
+    (void)cookie;
+    (void)args;
+    return set_error_response(request, 602, "Optional action not implemented");
+}
 
-    int ret = 0;
-    ret |= UpnpAddToActionResponse(resp, action, service_type, "NrTracks", "1");
-    ret |= UpnpAddToActionResponse(resp, action, service_type, "MediaDuration", trackDur);
-    ret |= UpnpAddToActionResponse(resp, action, service_type, "CurrentURI", g_renderer_ctx.current_uri);
-    ret |= UpnpAddToActionResponse(resp, action, service_type, "CurrentURIMetaData", "");
-    ret |= UpnpAddToActionResponse(resp, action, service_type, "NextURI", "");
-    ret |= UpnpAddToActionResponse(resp, action, service_type, "NextURIMetaData", "");
-    ret |= UpnpAddToActionResponse(resp, action, service_type, "PlayMedium", "NETWORK");
-    ret |= UpnpAddToActionResponse(resp, action, service_type, "RecordMedium", "NOT_IMPLEMENTED");
-    ret |= UpnpAddToActionResponse(resp, action, service_type, "WriteStatus", "NOT_IMPLEMENTED");
-    return ret;
+int handle_RenderingControl_SetContrast(void *cookie, struct Upnp_Action_Request *request,
+                                        const RenderingControl_SetContrast_args_t *args)
+{
+    (void)cookie;
+    (void)args;
+    return set_error_response(request, 602, "Optional action not implemented");
 }
 
-int get_position_info(IXML_Document **resp, const char *action, const char *service_type)
+int handle_RenderingControl_GetSharpness(void *cookie, struct Upnp_Action_Request *request,
+                                         const RenderingControl_GetSharpness_args_t *args)
 {
-    int curr = 0, total = 0;
-    if (*resp) {
-        ixmlDocument_free(*resp);
-        *resp = NULL;
-    }
+    (void)cookie;
+    (void)args;
+    return set_error_response(request, 602, "Optional action not implemented");
+}
 
-    player_get_position(&curr, &total);
+int handle_RenderingControl_SetSharpness(void *cookie, struct Upnp_Action_Request *request,
+                                         const RenderingControl_SetSharpness_args_t *args)
+{
+    (void)cookie;
+    (void)args;
+    return set_error_response(request, 602, "Optional action not implemented");
+}
+
+int handle_RenderingControl_GetVolumeDB(void *cookie, struct Upnp_Action_Request *request,
+                                        const RenderingControl_GetVolumeDB_args_t *args)
+{
+    (void)cookie;
+    (void)args;
+    return set_error_response(request, 602, "Optional action not implemented");
+}
 
-    char relTime[16], trackDur[16];
-    snprintf(relTime, sizeof(relTime), "%02d:%02d:%02d", curr / 3600, (curr % 3600) / 60, curr % 60);
-    snprintf(trackDur, sizeof(trackDur), "%02d:%02d:%02d", total / 3600, (total % 3600) / 60, total % 60);
+int handle_RenderingControl_SetVolumeDB(void *cookie, struct Upnp_Action_Request *request,
+                                        const RenderingControl_SetVolumeDB_args_t *args)
+{
+    (void)cookie;
+    (void)args;
+    return set_error_response(request, 602, "Optional action not implemented");
+}
 
-    int ret = 0;
-    ret |= UpnpAddToActionResponse(resp, action, service_type, "Track", "0");
-    ret |= UpnpAddToActionResponse(resp, action, service_type, "TrackDuration", trackDur);
-    ret |= UpnpAddToActionResponse(resp, action, service_type, "TrackMetaData", "");
-    ret |= UpnpAddToActionResponse(resp, action, service_type, "TrackURI", g_renderer_ctx.current_uri);
-    ret |= UpnpAddToActionResponse(resp, action, service_type, "RelTime", relTime);
-    ret |= UpnpAddToActionResponse(resp, action, service_type, "AbsTime", relTime);
-    ret |= UpnpAddToActionResponse(resp, action, service_type, "RelCount", "2147483647");
-    ret |= UpnpAddToActionResponse(resp, action, service_type, "AbsCount", "2147483647");
-    return ret;
+int handle_RenderingControl_GetVolumeDBRange(void *cookie, struct Upnp_Action_Request *request,
+                                             const RenderingControl_GetVolumeDBRange_args_t *args)
+{
+    (void)cookie;
+    (void)args;
+    return set_error_response(request, 602, "Optional action not implemented");
 }
 
-int get_transport_info(IXML_Document **resp, const char *action, const char *service_type)
+int handle_RenderingControl_GetLoudness(void *cookie, struct Upnp_Action_Request *request,
+                                        const RenderingControl_GetLoudness_args_t *args)
 {
-    int ret = 0;
-    const char *transport_state;
-    if (*resp) {
-        ixmlDocument_free(*resp);
-        *resp = NULL;
-    }
+    (void)cookie;
+    (void)args;
+    return set_error_response(request, 602, "Optional action not implemented");
+}
 
-    if (g_renderer_ctx.playing) {
-        transport_state = "PLAYING";
-    } else if (g_renderer_ctx.paused) {
-        transport_state = "PAUSED_PLAYBACK";
-    } else {
-        transport_state = "STOPPED";
-    }
+int handle_RenderingControl_SetLoudness(void *cookie, struct Upnp_Action_Request *request,
+                                        const RenderingControl_SetLoudness_args_t *args)
+{
+    (void)cookie;
+    (void)args;
+    return set_error_response(request, 602, "Optional action not implemented");
+}
 
-    ret |= UpnpAddToActionResponse(resp, action, service_type, "CurrentTransportState", transport_state);
-    ret |= UpnpAddToActionResponse(resp, action, service_type, "CurrentTransportStatus", "OK");
-    ret |= UpnpAddToActionResponse(resp, action, service_type, "CurrentSpeed", "1");
-    return ret;
+int handle_ConnectionManager_GetProtocolInfo(void *cookie, struct Upnp_Action_Request *request)
+{
+    (void)cookie;
+    set_action_result(request, UpnpMakeActionResponse(request->ActionName, CONNECTIONMANAGER_SERVICE, 2,
+                                                       "Source", "",
+                                                       "Sink", SINK_PROTOCOL_INFO));
+    return UPNP_E_SUCCESS;
 }
-//构建空响应
-int create_empty_response(IXML_Document **resp, const char *action, const char *service_type)
+
+int handle_ConnectionManager_GetCurrentConnectionIDs(void *cookie, struct Upnp_Action_Request *request)
 {
-    if (!resp || !action || !service_type) {
-        return -1;
-    }
-    if (*resp) {
-        ixmlDocument_free(*resp);
-        *resp = NULL;
-    }
+    (void)cookie;
+    set_action_result(request, UpnpMakeActionResponse(request->ActionName, CONNECTIONMANAGER_SERVICE, 1,
+                                                       "ConnectionIDs", "0"));
+    return UPNP_E_SUCCESS;
+}
 
-    *resp = UpnpMakeActionResponse(action, service_type, 0, NULL);
-    if (*resp == NULL) {
-        return -1;
+int handle_ConnectionManager_GetCurrentConnectionInfo(void *cookie, struct Upnp_Action_Request *request,
+                                                      const ConnectionManager_GetCurrentConnectionInfo_args_t *args)
+{
+    (void)cookie;
+    if (args->ConnectionID != 0) {
+        return set_error_response(request, 706, "Invalid connection reference");
     }
-
-    return 0;
+    set_action_result(request, UpnpMakeActionResponse(request->ActionName, CONNECTIONMANAGER_SERVICE, 7,
+                                                       "RcsID", "0",
+                                                       "AVTransportID", "0",
+                                                       "ProtocolInfo", "",
+                                                       "PeerConnectionManager", "",
+                                                       "PeerConnectionID", "-1",
+                                                       "Direction", "Input",
+                                                       "Status", "OK"));
+    return UPNP_E_SUCCESS;
 }
 
 int action_handler(Upnp_EventType event_type, void* event, void* cookie) {
@@ -480,227 +688,66 @@ int action_handler(Upnp_EventType event_type, void* event, void* cookie) {
     //LOG_DEBUG("Action request: %s for service: %s",
     //       request->ActionName, request->ServiceID);
 
-    const char* service_type = NULL;
-    int ret = 0;
-
-    if (strcmp(request->ServiceID, "urn:upnp-org:serviceId:AVTransport") == 0) {
-        service_type = AVTRANSPORT_SERVICE;
-    } else if (strcmp(request->ServiceID, "urn:upnp-org:serviceId:RenderingControl") == 0) {
-        service_type = RENDERING_SERVICE;
-    } else if (strcmp(request->ServiceID, "urn:upnp-org:serviceId:ConnectionManager") == 0) {
-        service_type = CONNECTIONMANAGER_SERVICE;
-    } else {
-        LOG_ERROR("Unknown service ID: %s", request->ServiceID);
-        return set_error_response(request, 700, "Unknown service");
-    }
-
-    pthread_mutex_lock(&renderer_mutex);
-
-    // 处理具体动作
-    if (strcmp(request->ActionName, "SetAVTransportURI") == 0) {
-        const char* uri = get_action_argument(request, "CurrentURI");
-        if (!uri || *uri == '\0') {
-            pthread_mutex_unlock(&renderer_mutex);
-            return set_error_response(request, 701, "Invalid URI");
-        }
-
-        strncpy(g_renderer_ctx.current_uri, uri, sizeof(g_renderer_ctx.current_uri) - 1);
-        g_renderer_ctx.current_uri[sizeof(g_renderer_ctx.current_uri)-1] = '\0';
-        g_renderer_ctx.playing = 0;
-        g_renderer_ctx.paused = 0;
-
-        LOG_DEBUG("Set URI: %s", g_renderer_ctx.current_uri);
-
-	create_empty_response(&(request->ActionResult), request->ActionName, service_type);
-    }
-    else if (strcmp(request->ActionName, "Play") == 0) {
-        if (strlen(g_renderer_ctx.current_uri) == 0) {
-            pthread_mutex_unlock(&renderer_mutex);
-            return set_error_response(request, 702, "URI not set");
-        }
-
-        if (g_renderer_ctx.paused) {
-            ret = player_resume();
-            if (ret == 0) {
-                g_renderer_ctx.playing = 1;
-                g_renderer_ctx.paused = 0;
-            }
-        } else {
-            ret = player_play(g_renderer_ctx.current_uri);
-            if (ret == 0) {
-                g_renderer_ctx.playing = 1;
-                g_renderer_ctx.paused = 0;
-            }
-        }
-        if (ret != 0) {
-            pthread_mutex_unlock(&renderer_mutex);
-            return set_error_response(request, 703, "Playback failed");
-        }
-
-	if (request->ActionResult) {
-	    ixmlDocument_free(request->ActionResult);  // 释放旧的 XML 文档
-	}
-        request->ActionResult = UpnpMakeActionResponse(request->ActionName, service_type, 1,
-	"Speed","1");
-    }
-    else if (strcmp(request->ActionName, "Stop") == 0) {
-        if (player_stop() == 0) {
-            g_renderer_ctx.playing = 0;
-            g_renderer_ctx.paused = 0;
-        } else {
-            LOG_ERROR("Stop failed (not playing?)");
-        }
-
-	create_empty_response(&(request->ActionResult), request->ActionName, service_type);
-    }
-    else if (strcmp(request->ActionName, "Pause") == 0) {
-        if (!player_is_playing()) {
-            pthread_mutex_unlock(&renderer_mutex);
-            return set_error_response(request, 704, "Not playing");
-        }
-
-        if (player_pause() == 0) {
-            g_renderer_ctx.playing = 0;
-            g_renderer_ctx.paused = 1;
-        }
-
-	create_empty_response(&(request->ActionResult), request->ActionName, service_type);
-    }
-    else if (strcmp(request->ActionName, "Seek") == 0) {
-        const char* unit = get_action_argument(request, "Unit");
-        const char* target = get_action_argument(request, "Target");
-
-        if (!unit || strcmp(unit, "REL_TIME") != 0) {
-            pthread_mutex_unlock(&renderer_mutex);
-            return set_error_response(request, 705, "Unsupported seek unit");
-        }
-
-        if (!target) {
-            pthread_mutex_unlock(&renderer_mutex);
-            return set_error_response(request, 706, "Missing target");
-        }
-
-        // 解析时间格式 (HH:MM:SS)
-        int hours = 0, minutes = 0, seconds = 0;
-        if (sscanf(target, "%d:%d:%d", &hours, &minutes, &seconds) < 1) {
-            pthread_mutex_unlock(&renderer_mutex);
-            return set_error_response(request, 707, "Invalid time format");
-        }
-
-        int total_seconds = hours * 3600 + minutes * 60 + seconds;
-
-        if (player_seek(total_seconds) != 0) {
-            pthread_mutex_unlock(&renderer_mutex);
-            return set_error_response(request, 708, "Seek failed");
-        }
+    // 处理函数自己管理 z->mutex，播放器命令在区域的执行线程中排队，不同请求之间互不阻塞
+    return upnp_dispatch_action(request, cookie);
+}
 
-        LOG_DEBUG("Seek to %s (%d seconds)", target, total_seconds);
+// 播放器无缝切换到下一首后，同步当前 uri
+static void on_track_changed(player_t *player, const char *uri, void *userdata) {
+    renderer_zone_t *z = userdata;
+    (void)player;
+    pthread_mutex_lock(&z->mutex);
+    strncpy(z->ctx.current_uri, uri, sizeof(z->ctx.current_uri) - 1);
+    z->ctx.current_uri[sizeof(z->ctx.current_uri)-1] = '\0';
+    z->ctx.next_uri[0] = '\0';
+    g_free(z->ctx.current_meta);
+    z->ctx.current_meta = z->ctx.next_meta;
+    z->ctx.next_meta = NULL;
+    update_transport_events(z);
+    pthread_mutex_unlock(&z->mutex);
+    LOG_DEBUG("[%s] Track changed: %s", z->name, uri);
+}
 
-	create_empty_response(&(request->ActionResult), request->ActionName, service_type);
-    }
-    else if (strcmp(request->ActionName, "GetPositionInfo") == 0) {
-	get_position_info(&(request->ActionResult), request->ActionName, service_type);
-    }
-    else if (strcmp(request->ActionName, "GetTransportInfo") == 0) {
-	get_transport_info(&(request->ActionResult), request->ActionName, service_type);
+// 播放器自身引起的状态变化。z->mutex 只在访问 z->ctx 时短暂持有，
+// 持有期间不会等待播放器线程，这里可以直接加锁
+static void on_player_event(player_t *player, player_event_t event, void *userdata)
+{
+    renderer_zone_t *z = userdata;
+    (void)player;
+    if (event == PLAYER_EVENT_VOLUME) {
+        update_rendering_events(z);
+        return;
     }
-    else if (strcmp(request->ActionName, "GetMediaInfo") == 0) {
-	get_media_info(&(request->ActionResult), request->ActionName, service_type);
+    pthread_mutex_lock(&z->mutex);
+    // 多房间同步的组员由组长的命令开始、暂停和停止，控制点的命令之外也会有这些变化
+    switch (event) {
+        case PLAYER_EVENT_STOPPED:
+            LOG_INFO("[%s] Playback finished", z->name);
+            z->ctx.playing = 0;
+            z->ctx.paused = 0;
+            break;
+        case PLAYER_EVENT_PLAYING:
+            z->ctx.playing = 1;
+            z->ctx.paused = 0;
+            break;
+        case PLAYER_EVENT_PAUSED:
+            z->ctx.playing = 0;
+            z->ctx.paused = 1;
+            break;
+        default:
+            break;
     }
-    else if (strcmp(request->ActionName, "GetVolume") == 0) {
-        // 获取声道参数，默认为Master
-        const char* channel = get_action_argument(request, "Channel");
-        if (!channel) {
-            channel = "Master";
-        }
-        // 获取当前音量值
-        int volume = 0;
-        char content[8];
-        if (strcmp(channel, "Master") == 0) {
-            volume = player_get_volume();
-            snprintf(content, sizeof(content),
-                 "%d", volume);
-        } else {
-            pthread_mutex_unlock(&renderer_mutex);
-            return set_error_response(request, 710, "Unsupported channel");
-        }
-	if (request->ActionResult) {
-	    ixmlDocument_free(request->ActionResult);  // 释放旧的 XML 文档
-	}
-        request->ActionResult = UpnpMakeActionResponse(request->ActionName, service_type, 1,
-	"CurrentVolume",content);
-    }
-    else if (strcmp(request->ActionName, "SetVolume") == 0) {
-        // 获取声道参数
-        const char* channel = get_action_argument(request, "Channel");
-	LOG_DEBUG("channel: %s",channel);
-        if (!channel) {
-            channel = "Master";
-        }
-        // 获取音量值
-        const char* desired_volume = get_action_argument(request, "DesiredVolume");
-        if (!desired_volume) {
-            pthread_mutex_unlock(&renderer_mutex);
-            return set_error_response(request, 711, "Missing volume value");
-        }
-
-        int volume = atoi(desired_volume);
-        if (volume < 0 || volume > 100) {
-            pthread_mutex_unlock(&renderer_mutex);
-            return set_error_response(request, 712, "Volume out of range");
-        }
-
-        // 设置音量
-        if (strcmp(channel, "Master") == 0) {
-            ret = player_set_volume(volume);
-        } else {
-            pthread_mutex_unlock(&renderer_mutex);
-            return set_error_response(request, 713, "Unsupported channel");
-        }
-
-        if (ret != 0) {
-            pthread_mutex_unlock(&renderer_mutex);
-            return set_error_response(request, 714, "Set volume failed");
-        }
-
-	create_empty_response(&(request->ActionResult), request->ActionName, service_type);
-    }
-    else if (strcmp(request->ActionName, "GetMute") == 0) {
-        // 构造响应XML体，返回当前静音状态
-        char content[8];
-	int mute = 0;
-	player_get_mute(&mute);
-        snprintf(content, sizeof(content),
-                 "%d", mute);
-	if (request->ActionResult) {
-	    ixmlDocument_free(request->ActionResult);  // 释放旧的 XML 文档
-	}
-        request->ActionResult = UpnpMakeActionResponse(request->ActionName, service_type, 1,
-	"CurrentMute",content);
-    }
-    else if (strcmp(request->ActionName, "SetMute") == 0) {
-	const char* desired_mute = get_action_argument(request, "DesiredMute");
-	if (!desired_mute) {
-	    pthread_mutex_unlock(&renderer_mutex);
-	    return set_error_response(request, 715, "Missing mute value");
-	}
-	int mute = atoi(desired_mute);
-	create_empty_response(&(request->ActionResult), request->ActionName, service_type);
-    }else {
-        LOG_ERROR( "Unhandled action: %s", request->ActionName);
-        pthread_mutex_unlock(&renderer_mutex);
-        return set_error_response(request, 709, "Unsupported action");
-    }
-
-    pthread_mutex_unlock(&renderer_mutex);
-    return UPNP_E_SUCCESS;
+    update_transport_events(z);
+    pthread_mutex_unlock(&z->mutex);
 }
 
+// cookie 是注册时传入的区域，每个根设备一个
 static int device_event_handler(Upnp_EventType event_type, void* event, void* cookie) {
+    renderer_zone_t *z = cookie;
     switch (event_type) {
         case UPNP_EVENT_SUBSCRIPTION_REQUEST:
-            LOG_INFO("[EVENT] Subscription request");
-            break;
+            LOG_INFO("[EVENT] [%s] Subscription request", z->name);
+            return upnp_events_subscribe(z->events, (struct Upnp_Subscription_Request *)event);
         case UPNP_CONTROL_ACTION_REQUEST:
             return action_handler(event_type, event, cookie);
         case UPNP_EVENT_RECEIVED:
@@ -713,7 +760,9 @@ static int device_event_handler(Upnp_EventType event_type, void* event, void* co
     return UPNP_E_SUCCESS;
 }
 
-char* generate_device_description(const char* udn) {
+// 区域的设备描述。控制和事件 URL 带区域前缀: libupnp 按 controlURL 在所有已注册设备中
+// 查找服务，同一进程中的多个根设备不能重复；SCPD 和图标各区域共用。返回值用 g_free 释放
+char* generate_device_description(const renderer_zone_t *z) {
     char hostname[256];
     gethostname(hostname, sizeof(hostname) - 1);
     hostname[sizeof(hostname)-1] = '\0';
@@ -757,39 +806,54 @@ char* generate_device_description(const char* udn) {
         "        <serviceType>%s</serviceType>"
         "        <serviceId>urn:upnp-org:serviceId:AVTransport</serviceId>"
         "        <SCPDURL>/virtual/AVTransport.xml</SCPDURL>"
-        "        <controlURL>/virtual/control/AVTransport</controlURL>"
-        "        <eventSubURL>/virtual/event/AVTransport</eventSubURL>"
+        "        <controlURL>%s/control/AVTransport</controlURL>"
+        "        <eventSubURL>%s/event/AVTransport</eventSubURL>"
         "      </service>"
         "      <service>"
         "        <serviceType>%s</serviceType>"
         "        <serviceId>urn:upnp-org:serviceId:RenderingControl</serviceId>"
         "        <SCPDURL>/virtual/RenderingControl.xml</SCPDURL>"
-        "        <controlURL>/virtual/control/RenderingControl</controlURL>"
-        "        <eventSubURL>/virtual/event/RenderingControl</eventSubURL>"
+        "        <controlURL>%s/control/RenderingControl</controlURL>"
+        "        <eventSubURL>%s/event/RenderingControl</eventSubURL>"
         "      </service>"
 	"     <service>"
 	"       <serviceType>%s</serviceType>"
 	"       <serviceId>urn:upnp-org:serviceId:ConnectionManager</serviceId>"
 	"       <SCPDURL>/virtual/ConnectionManager.xml</SCPDURL>"
-	"       <controlURL>/virtual/control/ConnectionManager</controlURL>"
-	"       <eventSubURL>/virtual/event/ConnectionManager</eventSubURL>"
+	"       <controlURL>%s/control/ConnectionManager</controlURL>"
+	"       <eventSubURL>%s/event/ConnectionManager</eventSubURL>"
 	"     </service>"
         "    </serviceList>"
         "  </device>"
         "</root>";
 
-    // 计算所需空间
-    size_t needed = snprintf(NULL, 0, templ_fmt,
-                           UPNP_DEVICE_TYPE, g_options.renderer_name, hostname, udn,
-                           AVTRANSPORT_SERVICE, RENDERING_SERVICE, CONNECTIONMANAGER_SERVICE) + 1;
-
-    char* desc = malloc(needed);
-    if (!desc) return NULL;
-
-    snprintf(desc, needed, templ_fmt,
-             UPNP_DEVICE_TYPE, g_options.renderer_name, hostname, udn,
-             AVTRANSPORT_SERVICE, RENDERING_SERVICE, CONNECTIONMANAGER_SERVICE);
-
+    // 名称来自命令行和主机名，可能含有 & < 等字符
+    xml_builder_t name, host;
+    xml_builder_init(&name);
+    xml_builder_init(&host);
+    xml_append_escaped_str(&name, z->name);
+    xml_append_escaped_str(&host, hostname);
+    const char *name_xml = xml_builder_str(&name);
+    const char *host_xml = xml_builder_str(&host);
+    char* desc = NULL;
+    char prefix[32];
+    snprintf(prefix, sizeof(prefix), VIRTUAL_DIR "/zone%d", z->index);
+
+    if (name_xml && host_xml) {
+        // 计算所需空间
+        size_t needed = snprintf(NULL, 0, templ_fmt,
+                               UPNP_DEVICE_TYPE, name_xml, host_xml, z->udn,
+                               AVTRANSPORT_SERVICE, prefix, prefix, RENDERING_SERVICE, prefix, prefix,
+                               CONNECTIONMANAGER_SERVICE, prefix, prefix) + 1;
+
+        desc = g_malloc(needed);
+        snprintf(desc, needed, templ_fmt,
+                 UPNP_DEVICE_TYPE, name_xml, host_xml, z->udn,
+                 AVTRANSPORT_SERVICE, prefix, prefix, RENDERING_SERVICE, prefix, prefix,
+                 CONNECTIONMANAGER_SERVICE, prefix, prefix);
+    }
+    xml_builder_free(&name);
+    xml_builder_free(&host);
     return desc;
 }
 
@@ -803,6 +867,8 @@ gboolean parse_command_line(int argc, char **argv) {
     // 添加播放器选项组(模块化设计，允许不同模块管理自己的命令行选项)
     GOptionGroup *player_group = player_get_option_group();
     g_option_context_add_group(context, player_group);
+    g_option_context_add_group(context, media_cache_get_option_group());
+    g_option_context_add_group(context, player_sync_get_option_group());
 
     if (!g_option_context_parse(context, &argc, &argv, &error)) {
         LOG_ERROR("option parsing failed: %s", error->message);
@@ -815,13 +881,163 @@ gboolean parse_command_line(int argc, char **argv) {
     return TRUE;
 }
 
+static void set_zone_udn(renderer_zone_t *z, const char *uuid) {
+    char uuid_str[37];
+    if (uuid && *uuid) {
+        snprintf(uuid_str, sizeof(uuid_str), "%s", uuid);
+    } else {
+        generate_uuid(uuid_str);
+    }
+    snprintf(z->udn, sizeof(z->udn), "uuid:%s", uuid_str);
+}
+
+// 读取 --zones 配置，每个组一个区域，例如:
+//   [living-room]
+//   name=Living Room
+//   device=hw:0,0
+//   ctrl-card=hw:0
+//   selem-name=PCM
+//   volume=40
+//   uuid=...
+// 省略的键使用命令行选项/后端默认值。没有配置文件时按 --name/--uuid 建一个区域
+static int load_zones(void) {
+    if (!g_options.zones_file) {
+        g_nzones = 1;
+        g_zones = g_new0(renderer_zone_t, 1);
+        g_zones[0].name = g_strdup(g_options.renderer_name);
+        set_zone_udn(&g_zones[0], g_options.uuid);
+    } else {
+        GKeyFile *kf = g_key_file_new();
+        GError *error = NULL;
+        gsize ngroups = 0;
+
+        if (!g_key_file_load_from_file(kf, g_options.zones_file, G_KEY_FILE_NONE, &error)) {
+            LOG_ERROR("Failed to load zone config %s: %s", g_options.zones_file, error->message);
+            g_error_free(error);
+            g_key_file_free(kf);
+            return -1;
+        }
+        gchar **groups = g_key_file_get_groups(kf, &ngroups);
+        if (ngroups == 0) {
+            LOG_ERROR("No zones defined in %s", g_options.zones_file);
+            g_strfreev(groups);
+            g_key_file_free(kf);
+            return -1;
+        }
+
+        g_nzones = (int)ngroups;
+        g_zones = g_new0(renderer_zone_t, ngroups);
+        for (gsize i = 0; i < ngroups; i++) {
+            renderer_zone_t *z = &g_zones[i];
+            z->name = g_key_file_get_string(kf, groups[i], "name", NULL);
+            if (!z->name) z->name = g_strdup(groups[i]);
+            z->device = g_key_file_get_string(kf, groups[i], "device", NULL);
+            z->ctrl_card = g_key_file_get_string(kf, groups[i], "ctrl-card", NULL);
+            z->selem_name = g_key_file_get_string(kf, groups[i], "selem-name", NULL);
+            z->volume = g_key_file_get_integer(kf, groups[i], "volume", NULL);
+            gchar *uuid = g_key_file_get_string(kf, groups[i], "uuid", NULL);
+            set_zone_udn(z, uuid);
+            g_free(uuid);
+        }
+        g_strfreev(groups);
+        g_key_file_free(kf);
+    }
+
+    for (int i = 0; i < g_nzones; i++) {
+        g_zones[i].index = i;
+        g_zones[i].device_handle = -1;
+        pthread_mutex_init(&g_zones[i].mutex, NULL);
+    }
+    return 0;
+}
+
+// 创建区域的播放器和事件实例，并把设备描述放入虚拟目录；在 UpnpInit2 之前调用
+static int start_zone(renderer_zone_t *z) {
+    player_config_t config = { z->name, z->device, z->ctrl_card, z->selem_name, z->volume };
+    char path[64];
+
+    z->events = upnp_events_new();
+    z->player = player_new(&config);
+    if (!z->player) {
+        LOG_ERROR("[%s] Failed to create player", z->name);
+        return -1;
+    }
+    player_set_track_changed_callback(z->player, on_track_changed, z);
+    player_set_event_callback(z->player, on_player_event, z);
+    z->actor = player_actor_start(z->player);
+    if (!z->actor) {
+        return -1;
+    }
+    update_transport_events(z);
+    update_rendering_events(z);
+
+    char *desc_xml = generate_device_description(z);
+    if (!desc_xml) {
+        LOG_ERROR("[%s] Failed to generate device description", z->name);
+        return -1;
+    }
+    snprintf(path, sizeof(path), VIRTUAL_DIR "/zone%d/description.xml", z->index);
+    LOG_DEBUG("[%s] Device UDN: %s, description %s", z->name, z->udn, path);
+    return create_virtual_file_from_buffer(path, "text/xml", desc_xml, strlen(desc_xml));
+}
+
+// 注册根设备并发送通告。描述用 URL 注册而不是 UPNPREG_BUF_DESC:
+// 后者固定发布在 /description.xml，同一进程中第二个根设备会覆盖第一个
+static int register_zone(renderer_zone_t *z) {
+    char url[256];
+    int rc;
+
+    snprintf(url, sizeof(url), "http://%s:%d" VIRTUAL_DIR "/zone%d/description.xml",
+             UpnpGetServerIpAddress(), UpnpGetServerPort(), z->index);
+    rc = UpnpRegisterRootDevice(url, device_event_handler, z, &z->device_handle);
+    if (rc != UPNP_E_SUCCESS) {
+        LOG_ERROR("[%s] Device registration failed: %s", z->name, UpnpGetErrorMessage(rc));
+        z->device_handle = -1;
+        return -1;
+    }
+
+    upnp_events_start(z->events, z->device_handle, z->udn);
+
+    rc = UpnpSendAdvertisement(z->device_handle, 1800);
+    if (rc != UPNP_E_SUCCESS) {
+        LOG_ERROR("[%s] Advertisement failed: %s", z->name, UpnpGetErrorMessage(rc));
+        return -1;
+    }
+    LOG_INFO("[%s] Renderer registered at %s", z->name, url);
+    return 0;
+}
+
+// 先注销设备，不再有新的动作请求提交播放器命令，再停止执行线程、释放播放器
+static void stop_zone(renderer_zone_t *z) {
+    if (z->device_handle >= 0) {
+        UpnpUnRegisterRootDevice(z->device_handle);
+        z->device_handle = -1;
+    }
+    player_actor_stop(z->actor);
+    z->actor = NULL;
+    player_free(z->player);
+    z->player = NULL;
+    upnp_events_free(z->events);
+    z->events = NULL;
+
+    // 安全销毁互斥锁
+    pthread_mutex_lock(&z->mutex);
+    pthread_mutex_unlock(&z->mutex);
+    pthread_mutex_destroy(&z->mutex);
+    g_free(z->ctx.current_meta);
+    g_free(z->ctx.next_meta);
+    g_free(z->name);
+    g_free(z->device);
+    g_free(z->ctrl_card);
+    g_free(z->selem_name);
+}
+
 int main(int argc, char *argv[]) {
     int rc;
 
     if(!parse_command_line(argc, argv)){
 	return EXIT_FAILURE;
     }
-    UpnpDevice_Handle device_handle = 0;
 
     LOG_INFO("===== Starting DLNA Media Renderer =====");
 
@@ -830,17 +1046,10 @@ int main(int argc, char *argv[]) {
         LOG_ERROR("Failed to initialize player");
         return EXIT_FAILURE;
     }
-
-    // 生成唯一设备ID
-    char uuid_str[37];
-    if (g_options.uuid) {
-        snprintf(uuid_str, sizeof(uuid_str), "%s", g_options.uuid);
-    } else {
-	generate_uuid(uuid_str);
+    if (load_zones() != 0) {
+        player_deinit();
+        return EXIT_FAILURE;
     }
-    char udn[64];
-    snprintf(udn, sizeof(udn), "uuid:%s", uuid_str);
-    LOG_DEBUG("Device UDN: %s", udn);
 
     VirtualFileEntry vfiles[] = {
         {"./icons/grender-64x64.png", "/virtual/grender-64x64.png", "image/png"},
@@ -850,12 +1059,22 @@ int main(int argc, char *argv[]) {
         {"./service/ConnectionManager.xml", "/virtual/ConnectionManager.xml", "text/xml"},
     };
 
+    if (upnp_response_init() != 0) {
+        goto cleanup;
+    }
+
     // 加载虚拟文件
     if (load_virtual_files(vfiles, sizeof(vfiles)/sizeof(vfiles[0])) != 0) {
         LOG_ERROR("Failed to load virtual files");
         goto cleanup;
     }
 
+    for (int i = 0; i < g_nzones; i++) {
+        if (start_zone(&g_zones[i]) != 0) {
+            goto cleanup;
+        }
+    }
+
     // 初始化UPnP
     rc = UpnpInit2(g_options.interface_name, g_options.port);
     if (rc != UPNP_E_SUCCESS) {
@@ -871,57 +1090,32 @@ int main(int argc, char *argv[]) {
         goto cleanup;
     }
 
-    // 生成设备描述
-    char* desc_xml = generate_device_description(udn);
-    if (!desc_xml) {
-        LOG_ERROR( "Failed to generate device description");
-        goto cleanup;
-    }
-
-    // 注册根设备
-    rc = UpnpRegisterRootDevice2(
-        UPNPREG_BUF_DESC,
-        desc_xml, strlen(desc_xml),
-        TRUE,
-        device_event_handler,
-        NULL,
-        &device_handle
-    );
-    free(desc_xml);
-
-    if (rc != UPNP_E_SUCCESS) {
-        LOG_ERROR( "Device registration failed: %s",
-                UpnpGetErrorMessage(rc));
-        goto cleanup;
-    }
-
-    rc = UpnpSendAdvertisement(device_handle, 1800);
-    if (rc != UPNP_E_SUCCESS) {
-        LOG_ERROR( "Advertisement failed: %s",
-                UpnpGetErrorMessage(rc));
-        goto cleanup;
+    // 注册根设备，每个区域一个
+    for (int i = 0; i < g_nzones; i++) {
+        if (register_zone(&g_zones[i]) != 0) {
+            goto cleanup;
+        }
     }
 
-    LOG_INFO("DLNA Renderer is running. Press Ctrl+C to exit...");
+    LOG_INFO("DLNA Renderer is running with %d zone(s). Press Ctrl+C to exit...", g_nzones);
     run_main_loop();
 
 cleanup:
     LOG_INFO("===== Cleaning up resources =====");
 
     // 释放资源
+    for (int i = 0; i < g_nzones; i++) {
+        stop_zone(&g_zones[i]);
+    }
+    g_free(g_zones);
+    g_zones = NULL;
+    g_nzones = 0;
     player_deinit();
     free_virtual_files();
 
-    if (device_handle) {
-        UpnpUnRegisterRootDevice(device_handle);
-	device_handle = 0;
-    }
+    upnp_response_deinit();
     // 取消虚拟目录回调
     UpnpSetVirtualDirCallbacks(NULL);
-    // 安全销毁互斥锁
-    pthread_mutex_lock(&renderer_mutex);
-    pthread_mutex_unlock(&renderer_mutex);
-    pthread_mutex_destroy(&renderer_mutex);
     UpnpFinish();
 
     LOG_INFO("DLNA Renderer exited cleanly");
@@ -0,0 +1,249 @@
+#include "upnp_events.h"
+#include "player.h"
+#include "xml_builder.h"
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+#include <glib.h>
+
+#define EVENT_MIN_INTERVAL_MS 200   // 每个服务最多 5 Hz
+
+#define EVENT_MAX_VARS 16
+
+typedef struct {
+    const char *name;
+    const char *channel;    // RenderingControl 的 Volume/Mute 带 channel 属性
+    const char *initial;
+} event_var_t;
+
+typedef struct {
+    const char *service_id;
+    const char *xmlns;
+    const event_var_t *vars;
+    int nvars;
+} event_service_def_t;
+
+static const event_var_t avt_vars[] = {
+    { "TransportState", NULL, "STOPPED" },
+    { "TransportStatus", NULL, "OK" },
+    { "TransportPlaySpeed", NULL, "1" },
+    { "PlaybackStorageMedium", NULL, "NETWORK" },
+    { "CurrentPlayMode", NULL, "NORMAL" },
+    { "NumberOfTracks", NULL, "0" },
+    { "CurrentTrack", NULL, "0" },
+    { "AVTransportURI", NULL, "" },
+    { "AVTransportURIMetaData", NULL, "" },
+    { "CurrentTrackURI", NULL, "" },
+    { "CurrentTrackMetaData", NULL, "" },
+    { "NextAVTransportURI", NULL, "" },
+    { "NextAVTransportURIMetaData", NULL, "" },
+    { "CurrentTrackDuration", NULL, "00:00:00" },
+    { "CurrentMediaDuration", NULL, "00:00:00" },
+    { "CurrentTransportActions", NULL, "" },
+};
+
+static const event_var_t rcs_vars[] = {
+    { "PresetNameList", NULL, "FactoryDefaults" },
+    { "Volume", "Master", "0" },
+    { "Mute", "Master", "0" },
+};
+
+static const event_service_def_t service_defs[EVENT_SERVICE_COUNT] = {
+    [EVENT_AVTRANSPORT] = {
+        "urn:upnp-org:serviceId:AVTransport",
+        "urn:schemas-upnp-org:metadata-1-0/AVT/",
+        avt_vars, sizeof(avt_vars) / sizeof(avt_vars[0])
+    },
+    [EVENT_RENDERING_CONTROL] = {
+        "urn:upnp-org:serviceId:RenderingControl",
+        "urn:schemas-upnp-org:metadata-1-0/RCS/",
+        rcs_vars, sizeof(rcs_vars) / sizeof(rcs_vars[0])
+    },
+};
+
+typedef struct {
+    const event_service_def_t *def;
+    upnp_events_t *owner;
+    gchar *values[EVENT_MAX_VARS];  // NULL 表示初始值
+    int dirty[EVENT_MAX_VARS];
+    guint flush_id;         // 待发送的合并通知
+    gint64 last_sent;       // 上一次通知的单调时钟(us)
+} event_service_t;
+
+struct upnp_events {
+    // 保护 services 中的值和定时器；持有时不调用播放器
+    pthread_mutex_t lock;
+    UpnpDevice_Handle device_handle;
+    gchar *device_udn;
+    event_service_t services[EVENT_SERVICE_COUNT];
+    // LastChange 的内层文档和整体转义后的结果，由 lock 保护，每次通知复用
+    xml_builder_t inner_xml;
+    xml_builder_t last_change_xml;
+};
+
+// 生成 LastChange 文档。all 为1时包含全部变量(订阅的初始事件，不清除变化标记)，
+// 否则只包含变化的变量并清除标记。返回的字符串已经整体转义，可以直接作为 GENA 属性值；
+// 调用者持有 lock，结果在下一次调用前有效。元数据(DIDL-Lite)要转义两次，不经过中间拷贝
+static const char* build_last_change(event_service_t *svc, int all) {
+    upnp_events_t *ev = svc->owner;
+    xml_builder_t *xml = &ev->inner_xml;
+    xml_builder_reset(xml);
+    xml_append_str(xml, "<Event xmlns=\"");
+    xml_append_str(xml, svc->def->xmlns);
+    xml_append_str(xml, "\"><InstanceID val=\"0\">");
+    for (int i = 0; i < svc->def->nvars; i++) {
+        const event_var_t *var = &svc->def->vars[i];
+        if (!all && !svc->dirty[i]) continue;
+        xml_append(xml, "<", 1);
+        xml_append_str(xml, var->name);
+        if (var->channel) {
+            xml_append_str(xml, " channel=\"");
+            xml_append_str(xml, var->channel);
+            xml_append(xml, "\"", 1);
+        }
+        xml_append_str(xml, " val=\"");
+        xml_append_escaped_str(xml, svc->values[i] ? svc->values[i] : var->initial);
+        xml_append_str(xml, "\"/>");
+        if (!all) svc->dirty[i] = 0;
+    }
+    xml_append_str(xml, "</InstanceID></Event>");
+
+    xml_builder_reset(&ev->last_change_xml);
+    xml_append_escaped(&ev->last_change_xml, xml->data, xml->len);
+    return xml_builder_str(&ev->last_change_xml);
+}
+
+static gboolean flush_service(gpointer data) {
+    event_service_t *svc = data;
+    upnp_events_t *ev = svc->owner;
+    const char *names[] = { "LastChange" };
+
+    pthread_mutex_lock(&ev->lock);
+    svc->flush_id = 0;
+    svc->last_sent = g_get_monotonic_time();
+    const char *values[] = { build_last_change(svc, 0) };
+    int rc = values[0] ? UpnpNotify(ev->device_handle, ev->device_udn, svc->def->service_id, names, values, 1)
+                       : UPNP_E_OUTOF_MEMORY;
+    pthread_mutex_unlock(&ev->lock);
+
+    if (rc != UPNP_E_SUCCESS) {
+        LOG_ERROR("UpnpNotify(%s) failed: %s", svc->def->service_id, UpnpGetErrorMessage(rc));
+    }
+    return G_SOURCE_REMOVE;
+}
+
+upnp_events_t* upnp_events_new(void) {
+    upnp_events_t *ev = g_new0(upnp_events_t, 1);
+    pthread_mutex_init(&ev->lock, NULL);
+    ev->device_handle = -1;
+    for (int s = 0; s < EVENT_SERVICE_COUNT; s++) {
+        ev->services[s].def = &service_defs[s];
+        ev->services[s].owner = ev;
+    }
+    xml_builder_init(&ev->inner_xml);
+    xml_builder_init(&ev->last_change_xml);
+    return ev;
+}
+
+void upnp_events_start(upnp_events_t *ev, UpnpDevice_Handle handle, const char *udn) {
+    pthread_mutex_lock(&ev->lock);
+    ev->device_handle = handle;
+    g_free(ev->device_udn);
+    ev->device_udn = g_strdup(udn);
+    pthread_mutex_unlock(&ev->lock);
+}
+
+void upnp_events_free(upnp_events_t *ev) {
+    if (!ev) return;
+    for (int s = 0; s < EVENT_SERVICE_COUNT; s++) {
+        event_service_t *svc = &ev->services[s];
+        if (svc->flush_id) {
+            g_source_remove(svc->flush_id);
+            svc->flush_id = 0;
+        }
+        for (int i = 0; i < svc->def->nvars; i++) {
+            g_free(svc->values[i]);
+        }
+    }
+    g_free(ev->device_udn);
+    xml_builder_free(&ev->inner_xml);
+    xml_builder_free(&ev->last_change_xml);
+    pthread_mutex_destroy(&ev->lock);
+    g_free(ev);
+}
+
+int upnp_events_subscribe(upnp_events_t *ev, struct Upnp_Subscription_Request *req) {
+    const char *names[3];
+    const char *values[3];
+    int count = 0;
+    int rc;
+
+    pthread_mutex_lock(&ev->lock);
+    for (int s = 0; s < EVENT_SERVICE_COUNT; s++) {
+        if (strcmp(req->ServiceId, service_defs[s].service_id) != 0) continue;
+        names[0] = "LastChange";
+        values[0] = build_last_change(&ev->services[s], 1);
+        if (!values[0]) {
+            pthread_mutex_unlock(&ev->lock);
+            return UPNP_E_OUTOF_MEMORY;
+        }
+        count = 1;
+        break;
+    }
+    if (count == 0 && strcmp(req->ServiceId, "urn:upnp-org:serviceId:ConnectionManager") == 0) {
+        names[0] = "SourceProtocolInfo";
+        values[0] = "";
+        names[1] = "SinkProtocolInfo";
+        values[1] = SINK_PROTOCOL_INFO;
+        names[2] = "CurrentConnectionIDs";
+        values[2] = "0";
+        count = 3;
+    }
+    if (count == 0) {
+        pthread_mutex_unlock(&ev->lock);
+        LOG_ERROR("[EVENT] Subscription to unknown service: %s", req->ServiceId);
+        return UPNP_E_INVALID_SERVICE;
+    }
+
+    // 持有 lock 接受订阅，保证之后的变化一定会通知到新的订阅者
+    rc = UpnpAcceptSubscription(ev->device_handle, req->UDN, req->ServiceId,
+                                names, values, count, req->Sid);
+    pthread_mutex_unlock(&ev->lock);
+
+    if (rc != UPNP_E_SUCCESS) {
+        LOG_ERROR("[EVENT] UpnpAcceptSubscription(%s) failed: %s", req->ServiceId, UpnpGetErrorMessage(rc));
+        return rc;
+    }
+    LOG_INFO("[EVENT] Accepted subscription %s to %s", req->Sid, req->ServiceId);
+    return UPNP_E_SUCCESS;
+}
+
+void upnp_events_set(upnp_events_t *ev, upnp_event_service_t service, const char *name, const char *value) {
+    event_service_t *svc = &ev->services[service];
+    if (!value) value = "";
+
+    pthread_mutex_lock(&ev->lock);
+    for (int i = 0; i < svc->def->nvars; i++) {
+        const event_var_t *var = &svc->def->vars[i];
+        if (strcmp(var->name, name) != 0) continue;
+        if (strcmp(svc->values[i] ? svc->values[i] : var->initial, value) == 0) break;
+
+        g_free(svc->values[i]);
+        svc->values[i] = g_strdup(value);
+        svc->dirty[i] = 1;
+        // 距离上一次通知不足最小间隔时推迟，期间的变化合并到同一次通知
+        if (!svc->flush_id && ev->device_handle >= 0) {
+            gint64 wait_us = svc->last_sent + EVENT_MIN_INTERVAL_MS * 1000 - g_get_monotonic_time();
+            guint delay = wait_us > 0 ? (guint)(wait_us / 1000) : 0;
+            svc->flush_id = g_timeout_add(delay, flush_service, svc);
+        }
+        break;
+    }
+    pthread_mutex_unlock(&ev->lock);
+}
+
+void upnp_events_set_int(upnp_events_t *ev, upnp_event_service_t service, const char *name, int value) {
+    char buf[16];
+    snprintf(buf, sizeof(buf), "%d", value);
+    upnp_events_set(ev, service, name, buf);
+}
@@ -0,0 +1,48 @@
+#ifndef UPNP_EVENTS_H
+#define UPNP_EVENTS_H
+
+#include <upnp/upnp.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ConnectionManager 的 SinkProtocolInfo，GetProtocolInfo 和订阅的初始事件共用
+#define SINK_PROTOCOL_INFO \
+    "http-get:*:audio/mpeg:*,http-get:*:audio/mp4:*,http-get:*:audio/aac:*," \
+    "http-get:*:audio/flac:*,http-get:*:audio/x-flac:*,http-get:*:audio/wav:*," \
+    "http-get:*:audio/x-wav:*,http-get:*:audio/ogg:*"
+
+// GENA 事件: AVTransport 和 RenderingControl 的状态变量通过 LastChange 推送给订阅者，
+// 控制点不必轮询 GetTransportInfo/GetPositionInfo。同一实例的变化合并成一次通知，
+// 每个服务每秒最多通知 5 次，通知在 GLib 主循环线程中发出。
+// 每个渲染区域(根设备)有一个独立的事件实例
+typedef enum {
+    EVENT_AVTRANSPORT = 0,
+    EVENT_RENDERING_CONTROL,
+    EVENT_SERVICE_COUNT
+} upnp_event_service_t;
+
+typedef struct upnp_events upnp_events_t;
+
+upnp_events_t* upnp_events_new(void);
+
+// 取消待发送的通知并释放；在 GLib 主循环线程或主循环停止后调用
+void upnp_events_free(upnp_events_t *ev);
+
+// 设备注册成功后调用，之后状态变化才会发出通知
+void upnp_events_start(upnp_events_t *ev, UpnpDevice_Handle handle, const char *udn);
+
+// 处理 UPNP_EVENT_SUBSCRIPTION_REQUEST: 接受订阅并附带当前全部状态
+int upnp_events_subscribe(upnp_events_t *ev, struct Upnp_Subscription_Request *req);
+
+// 更新 InstanceID 0 的状态变量，值有变化时安排一次通知；可以在任意线程调用
+void upnp_events_set(upnp_events_t *ev, upnp_event_service_t service, const char *name, const char *value);
+
+void upnp_events_set_int(upnp_events_t *ev, upnp_event_service_t service, const char *name, int value);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // UPNP_EVENTS_H
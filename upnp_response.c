@@ -0,0 +1,144 @@
+#include "upnp_response.h"
+#include "player.h"
+#include <upnp/upnp.h>
+#include <upnp/upnptools.h>
+
+#define AVTRANSPORT_SERVICE "urn:schemas-upnp-org:service:AVTransport:1"
+#define RENDERING_SERVICE "urn:schemas-upnp-org:service:RenderingControl:1"
+#define RESPONSE_MAX_ARGS 9
+
+typedef struct {
+    const char *name;
+    const char *value;      // NULL 表示每次请求填写
+} response_arg_t;
+
+typedef struct {
+    const char *action;
+    const char *service_type;
+    response_arg_t args[RESPONSE_MAX_ARGS];
+    int nargs;
+    IXML_Document *doc;     // 编译好的模板，只读，多个线程同时导入
+} response_template_t;
+
+// 输出参数按 SCPD 顺序排列
+static response_template_t templates[RESPONSE_TEMPLATE_COUNT] = {
+    [RESPONSE_GET_POSITION_INFO] = { "GetPositionInfo", AVTRANSPORT_SERVICE, {
+        { "Track", "0" },
+        { "TrackDuration", NULL },
+        { "TrackMetaData", NULL },
+        { "TrackURI", NULL },
+        { "RelTime", NULL },
+        { "AbsTime", NULL },
+        { "RelCount", "2147483647" },
+        { "AbsCount", "2147483647" },
+    }, 8 },
+    [RESPONSE_GET_TRANSPORT_INFO] = { "GetTransportInfo", AVTRANSPORT_SERVICE, {
+        { "CurrentTransportState", NULL },
+        { "CurrentTransportStatus", "OK" },
+        { "CurrentSpeed", "1" },
+    }, 3 },
+    [RESPONSE_GET_MEDIA_INFO] = { "GetMediaInfo", AVTRANSPORT_SERVICE, {
+        { "NrTracks", "1" },
+        { "MediaDuration", NULL },
+        { "CurrentURI", NULL },
+        { "CurrentURIMetaData", NULL },
+        { "NextURI", NULL },
+        { "NextURIMetaData", NULL },
+        { "PlayMedium", "NETWORK" },
+        { "RecordMedium", "NOT_IMPLEMENTED" },
+        { "WriteStatus", "NOT_IMPLEMENTED" },
+    }, 9 },
+    [RESPONSE_GET_CURRENT_TRANSPORT_ACTIONS] = { "GetCurrentTransportActions", AVTRANSPORT_SERVICE, {
+        { "Actions", NULL },
+    }, 1 },
+    [RESPONSE_GET_VOLUME] = { "GetVolume", RENDERING_SERVICE, {
+        { "CurrentVolume", NULL },
+    }, 1 },
+    [RESPONSE_GET_MUTE] = { "GetMute", RENDERING_SERVICE, {
+        { "CurrentMute", NULL },
+    }, 1 },
+};
+
+static IXML_Node* response_root(IXML_Document *doc) {
+    IXML_Node *node = ixmlNode_getFirstChild((IXML_Node *)doc);
+    while (node && ixmlNode_getNodeType(node) != eELEMENT_NODE) {
+        node = ixmlNode_getNextSibling(node);
+    }
+    return node;
+}
+
+// 把元素的文本改成 value，模板中的空值可能没有文本节点
+static int set_element_text(IXML_Document *doc, IXML_Node *elem, const char *value) {
+    IXML_Node *text = ixmlNode_getFirstChild(elem);
+    if (text && ixmlNode_getNodeType(text) == eTEXT_NODE) {
+        return ixmlNode_setNodeValue(text, value);
+    }
+    text = (IXML_Node *)ixmlDocument_createTextNode(doc, value);
+    if (!text) return IXML_INSUFFICIENT_MEMORY;
+    return ixmlNode_appendChild(elem, text);
+}
+
+int upnp_response_init(void) {
+    for (int i = 0; i < RESPONSE_TEMPLATE_COUNT; i++) {
+        response_template_t *t = &templates[i];
+        if (t->doc) continue;
+
+        t->doc = UpnpMakeActionResponse(t->action, t->service_type, 0, NULL);
+        for (int a = 0; t->doc && a < t->nargs; a++) {
+            if (UpnpAddToActionResponse(&t->doc, t->action, t->service_type, t->args[a].name,
+                                        t->args[a].value ? t->args[a].value : "") != UPNP_E_SUCCESS) {
+                ixmlDocument_free(t->doc);
+                t->doc = NULL;
+            }
+        }
+        if (!t->doc) {
+            LOG_ERROR("Failed to compile %s response template", t->action);
+            upnp_response_deinit();
+            return -1;
+        }
+    }
+    return 0;
+}
+
+void upnp_response_deinit(void) {
+    for (int i = 0; i < RESPONSE_TEMPLATE_COUNT; i++) {
+        if (templates[i].doc) {
+            ixmlDocument_free(templates[i].doc);
+            templates[i].doc = NULL;
+        }
+    }
+}
+
+IXML_Document* upnp_response_make(upnp_response_id_t id, const char **values) {
+    response_template_t *t = &templates[id];
+    IXML_Document *doc = NULL;
+    IXML_Node *root = NULL;
+
+    if (!t->doc || ixmlDocument_createDocumentEx(&doc) != IXML_SUCCESS) {
+        return NULL;
+    }
+    if (ixmlDocument_importNode(doc, response_root(t->doc), TRUE, &root) != IXML_SUCCESS) {
+        ixmlDocument_free(doc);
+        return NULL;
+    }
+    if (ixmlNode_appendChild((IXML_Node *)doc, root) != IXML_SUCCESS) {
+        ixmlNode_free(root);
+        ixmlDocument_free(doc);
+        return NULL;
+    }
+
+    // 子元素和 args 一一对应，只改写可变参数
+    IXML_Node *elem = ixmlNode_getFirstChild(root);
+    int a = 0, v = 0;
+    for (; elem && a < t->nargs; elem = ixmlNode_getNextSibling(elem)) {
+        if (ixmlNode_getNodeType(elem) != eELEMENT_NODE) continue;
+        if (!t->args[a++].value) {
+            const char *value = values[v++];
+            if (set_element_text(doc, elem, value ? value : "") != IXML_SUCCESS) {
+                ixmlDocument_free(doc);
+                return NULL;
+            }
+        }
+    }
+    return doc;
+}
@@ -0,0 +1,36 @@
+#ifndef UPNP_RESPONSE_H
+#define UPNP_RESPONSE_H
+
+#include <upnp/ixml.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// 预编译的动作响应: 启动时为频繁轮询的查询动作各建一份响应 DOM 模板，固定的输出参数
+// 已经填好；每次请求只导入模板并改写可变参数的文本节点，不再逐个 UpnpAddToActionResponse
+// 查找动作节点、创建元素，也不经过 snprintf + ixmlParseBuffer
+typedef enum {
+    RESPONSE_GET_POSITION_INFO = 0,     // TrackDuration, TrackMetaData, TrackURI, RelTime, AbsTime
+    RESPONSE_GET_TRANSPORT_INFO,        // CurrentTransportState
+    RESPONSE_GET_MEDIA_INFO,            // MediaDuration, CurrentURI, CurrentURIMetaData,
+                                        // NextURI, NextURIMetaData
+    RESPONSE_GET_CURRENT_TRANSPORT_ACTIONS, // Actions
+    RESPONSE_GET_VOLUME,                // CurrentVolume
+    RESPONSE_GET_MUTE,                  // CurrentMute
+    RESPONSE_TEMPLATE_COUNT
+} upnp_response_id_t;
+
+int upnp_response_init(void);
+
+void upnp_response_deinit(void);
+
+// values 按注释中的顺序给出可变参数，NULL 视为空串。元数据原样传入，序列化时由 ixml 转义。
+// 返回新文档，设置到 ActionResult 后由 libupnp 发送并释放；失败返回 NULL
+IXML_Document* upnp_response_make(upnp_response_id_t id, const char **values);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // UPNP_RESPONSE_H
@@ -0,0 +1,110 @@
+// GetPositionInfo 响应构造的 CPU 开销对比: 逐个 UpnpAddToActionResponse 与预编译模板
+// 编译: gcc -O2 -o upnp_response_bench upnp_response_bench.c upnp_response.c
+//       $(pkg-config --cflags --libs libupnp gstreamer-1.0 alsa)
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <upnp/upnp.h>
+#include <upnp/upnptools.h>
+#include <upnp/ixml.h>
+#include "player.h"
+#include "upnp_response.h"
+
+#define AVTRANSPORT_SERVICE "urn:schemas-upnp-org:service:AVTransport:1"
+#define TRACK_URI "http://192.168.1.10:8200/MediaItems/1234.flac"
+
+int CURRENT_LOG_LEVEL = LOG_LEVEL_ERROR;
+
+static double cpu_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void format_time(char *buf, size_t size, int sec) {
+    snprintf(buf, size, "%02d:%02d:%02d", sec / 3600, (sec % 3600) / 60, sec % 60);
+}
+
+// 模板之前 get_position_info 的做法
+static IXML_Document* build_legacy(int curr, int total) {
+    IXML_Document *resp = NULL;
+    char rel_time[16], duration[16];
+    format_time(rel_time, sizeof(rel_time), curr);
+    format_time(duration, sizeof(duration), total);
+
+    UpnpAddToActionResponse(&resp, "GetPositionInfo", AVTRANSPORT_SERVICE, "Track", "0");
+    UpnpAddToActionResponse(&resp, "GetPositionInfo", AVTRANSPORT_SERVICE, "TrackDuration", duration);
+    UpnpAddToActionResponse(&resp, "GetPositionInfo", AVTRANSPORT_SERVICE, "TrackMetaData", "");
+    UpnpAddToActionResponse(&resp, "GetPositionInfo", AVTRANSPORT_SERVICE, "TrackURI", TRACK_URI);
+    UpnpAddToActionResponse(&resp, "GetPositionInfo", AVTRANSPORT_SERVICE, "RelTime", rel_time);
+    UpnpAddToActionResponse(&resp, "GetPositionInfo", AVTRANSPORT_SERVICE, "AbsTime", rel_time);
+    UpnpAddToActionResponse(&resp, "GetPositionInfo", AVTRANSPORT_SERVICE, "RelCount", "2147483647");
+    UpnpAddToActionResponse(&resp, "GetPositionInfo", AVTRANSPORT_SERVICE, "AbsCount", "2147483647");
+    return resp;
+}
+
+static IXML_Document* build_template(int curr, int total) {
+    char rel_time[16], duration[16];
+    format_time(rel_time, sizeof(rel_time), curr);
+    format_time(duration, sizeof(duration), total);
+
+    const char *values[] = { duration, "", TRACK_URI, rel_time, rel_time };
+    return upnp_response_make(RESPONSE_GET_POSITION_INFO, values);
+}
+
+// serialize 为1时同时计入 libupnp 发送前的序列化开销
+static double run(IXML_Document* (*build)(int, int), int iterations, int serialize) {
+    double start = cpu_now();
+    for (int i = 0; i < iterations; i++) {
+        IXML_Document *doc = build(i % 3600, 3600);
+        if (!doc) {
+            fprintf(stderr, "build failed\n");
+            exit(EXIT_FAILURE);
+        }
+        if (serialize) {
+            DOMString xml = ixmlPrintDocument(doc);
+            ixmlFreeDOMString(xml);
+        }
+        ixmlDocument_free(doc);
+    }
+    return (cpu_now() - start) / iterations * 1e9;
+}
+
+int main(int argc, char *argv[]) {
+    int iterations = argc > 1 ? atoi(argv[1]) : 200000;
+    if (iterations <= 0) iterations = 200000;
+
+    if (upnp_response_init() != 0) {
+        return EXIT_FAILURE;
+    }
+
+    // 两种方式的输出必须一致
+    IXML_Document *a = build_legacy(61, 3600);
+    IXML_Document *b = build_template(61, 3600);
+    DOMString xa = ixmlPrintDocument(a);
+    DOMString xb = ixmlPrintDocument(b);
+    if (strcmp(xa, xb) != 0) {
+        fprintf(stderr, "Responses differ:\n%s\n%s\n", xa, xb);
+        return EXIT_FAILURE;
+    }
+    ixmlFreeDOMString(xa);
+    ixmlFreeDOMString(xb);
+    ixmlDocument_free(a);
+    ixmlDocument_free(b);
+
+    // 预热
+    run(build_legacy, iterations / 10 + 1, 1);
+    run(build_template, iterations / 10 + 1, 1);
+
+    printf("GetPositionInfo, %d iterations (CPU ns/request)\n", iterations);
+    for (int serialize = 0; serialize <= 1; serialize++) {
+        double legacy = run(build_legacy, iterations, serialize);
+        double templ = run(build_template, iterations, serialize);
+        printf("  %-18s legacy %8.0f  template %8.0f  (-%.0f%%)\n",
+               serialize ? "build+serialize:" : "build:", legacy, templ,
+               legacy > 0 ? (legacy - templ) * 100.0 / legacy : 0.0);
+    }
+
+    upnp_response_deinit();
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,284 @@
+#include "virtual_dir.h"
+#include "player.h"
+#include <upnp/upnp.h>
+#include <upnp/ixml.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// libupnp 1.8.4 起 get_info 可以读到请求头，并通过 ExtraHeadersList 添加响应头
+#if defined(UPNP_VERSION) && UPNP_VERSION > 10803
+#define VIRTUAL_DIR_EXTRA_HEADERS 1
+#endif
+
+#define VIRTUAL_DIR_MAX_AGE 86400   // 运行期间文件不会变化
+
+struct virtual_file {
+    char *virtual_fname;
+    char *content_type;
+    const char *data;       // 只读映射，空文件为 NULL
+    size_t len;
+    int heap;               // data 是 g_malloc 分配的(运行时生成的文件)，不是映射
+    time_t last_modified;
+    char etag[40];          // 由内容计算，带引号
+};
+
+typedef struct {
+    off_t pos;
+    const char *data;
+    size_t len;
+} WebServerFile;
+
+// 虚拟路径 -> struct virtual_file，加载完成后只读
+static GHashTable *virtual_files = NULL;
+
+static void free_virtual_file(gpointer data) {
+    struct virtual_file *vf = data;
+    if (vf->heap) {
+        g_free((void *)vf->data);
+    } else if (vf->data) {
+        munmap((void *)vf->data, vf->len);
+    }
+    g_free(vf->virtual_fname);
+    g_free(vf->content_type);
+    g_free(vf);
+}
+
+// 映射整个文件，映射建立后描述符可以立即关闭
+static int map_file(const char *path, const char **data, size_t *len, time_t *mtime) {
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        LOG_ERROR("open %s failed: %s", path, strerror(errno));
+        return -1;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+        LOG_ERROR("%s is not a regular file", path);
+        close(fd);
+        return -1;
+    }
+
+    void *map = NULL;
+    if (st.st_size > 0) {
+        map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map == MAP_FAILED) {
+            LOG_ERROR("mmap %s failed: %s", path, strerror(errno));
+            close(fd);
+            return -1;
+        }
+        // 文件都很小，每次发现都会被整体读取
+        madvise(map, (size_t)st.st_size, MADV_WILLNEED);
+    }
+    close(fd);
+
+    *data = map;
+    *len = (size_t)st.st_size;
+    *mtime = st.st_mtime;
+    return 0;
+}
+
+// 内容的 FNV-1a 64位哈希加长度作为强校验 ETag，文件不变时重启后也保持不变
+static void compute_etag(struct virtual_file *vf) {
+    guint64 h = 14695981039346656037ULL;
+    for (size_t i = 0; i < vf->len; i++) {
+        h ^= (unsigned char)vf->data[i];
+        h *= 1099511628211ULL;
+    }
+    snprintf(vf->etag, sizeof(vf->etag), "\"%016" G_GINT64_MODIFIER "x-%zx\"", h, vf->len);
+}
+
+// 计算 ETag 并加入索引
+static void add_virtual_file(struct virtual_file *vf, const char *virtual_path, const char *content_type) {
+    vf->virtual_fname = g_strdup(virtual_path);
+    vf->content_type = g_strdup(content_type);
+    compute_etag(vf);
+
+    if (!virtual_files) {
+        virtual_files = g_hash_table_new_full(g_str_hash, g_str_equal, NULL, free_virtual_file);
+    }
+    // 同名文件后加载的覆盖先加载的
+    g_hash_table_replace(virtual_files, vf->virtual_fname, vf);
+}
+
+int create_virtual_file(const char *real_path, const char *virtual_path, const char *content_type) {
+    struct virtual_file *vf = g_new0(struct virtual_file, 1);
+    if (map_file(real_path, &vf->data, &vf->len, &vf->last_modified) != 0) {
+        LOG_ERROR( "Failed to read file: %s", real_path);
+        g_free(vf);
+        return -1;
+    }
+    add_virtual_file(vf, virtual_path, content_type);
+
+    LOG_DEBUG("Loaded virtual file: %s -> %s (%zu bytes, etag %s)",
+           real_path, virtual_path, vf->len, vf->etag);
+    return 0;
+}
+
+int create_virtual_file_from_buffer(const char *virtual_path, const char *content_type, char *data, size_t len) {
+    struct virtual_file *vf = g_new0(struct virtual_file, 1);
+    vf->data = data;
+    vf->len = len;
+    vf->heap = 1;
+    vf->last_modified = time(NULL);
+    add_virtual_file(vf, virtual_path, content_type);
+
+    LOG_DEBUG("Added virtual file: %s (%zu bytes, etag %s)",
+           virtual_path, vf->len, vf->etag);
+    return 0;
+}
+
+int load_virtual_files(const VirtualFileEntry *entries, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        if (create_virtual_file(entries[i].real_path,
+                              entries[i].virtual_path,
+                              entries[i].content_type) != 0) {
+            LOG_ERROR( "Failed to load: %s", entries[i].real_path);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+void free_virtual_files(void) {
+    if (virtual_files) {
+        g_hash_table_destroy(virtual_files);
+        virtual_files = NULL;
+    }
+    LOG_DEBUG("Freed all virtual files");
+}
+
+static const struct virtual_file *get_file_by_name(const char *filename) {
+    return virtual_files ? g_hash_table_lookup(virtual_files, filename) : NULL;
+}
+
+#ifdef VIRTUAL_DIR_EXTRA_HEADERS
+static void add_response_header(UpnpListHead *headers, const char *name, const char *value) {
+    gchar *line = g_strdup_printf("%s: %s", name, value);
+    UpnpExtraHeaders *h = UpnpExtraHeaders_new();
+    UpnpExtraHeaders_set_resp(h, line);
+    UpnpListInsert(headers, UpnpListEnd(headers), (UpnpListHead *)UpnpExtraHeaders_get_node(h));
+    g_free(line);
+}
+
+// 附加缓存校验头。libupnp 的虚拟目录回调无法回复 304，条件请求仍然得到完整响应；
+// ETag 和 Cache-Control 让控制点在有效期内不再请求
+static void add_cache_headers(const struct virtual_file *vf, UpnpFileInfo *info) {
+    UpnpListHead *headers = (UpnpListHead *)UpnpFileInfo_get_ExtraHeadersList(info);
+    char max_age[32];
+
+    snprintf(max_age, sizeof(max_age), "max-age=%d", VIRTUAL_DIR_MAX_AGE);
+    add_response_header(headers, "ETag", vf->etag);
+    add_response_header(headers, "Cache-Control", max_age);
+}
+#endif
+
+static int my_get_info(const char *filename, UpnpFileInfo *info) {
+    const struct virtual_file *virtfile = get_file_by_name(filename);
+
+    if (virtfile) {
+#ifdef VIRTUAL_DIR_EXTRA_HEADERS
+        add_cache_headers(virtfile, info);
+#endif
+        UpnpFileInfo_set_FileLength(info, virtfile->len);
+        UpnpFileInfo_set_LastModified(info, virtfile->last_modified);
+        UpnpFileInfo_set_IsDirectory(info, 0);
+        UpnpFileInfo_set_IsReadable(info, 1);
+
+        // 克隆字符串以避免内存问题
+        char *content_type = ixmlCloneDOMString(virtfile->content_type);
+        UpnpFileInfo_set_ContentType(info, content_type);
+        return 0;
+    }
+    return -1;
+}
+
+static UpnpWebFileHandle my_open(const char *filename, enum UpnpOpenFileMode mode) {
+    if (mode != UPNP_READ) return NULL;
+
+    const struct virtual_file *virtfile = get_file_by_name(filename);
+    if (!virtfile) return NULL;
+
+    WebServerFile *file = malloc(sizeof(WebServerFile));
+    if (!file) return NULL;
+
+    file->pos = 0;
+    file->data = virtfile->data;
+    file->len = virtfile->len;
+
+    return (UpnpWebFileHandle)file;
+}
+
+// 直接从映射区复制到 libupnp 的缓冲区
+static int my_read(UpnpWebFileHandle fileHnd, char *buf, size_t buflen) {
+    WebServerFile *file = (WebServerFile *)fileHnd;
+    if (!file) return -1;
+
+    size_t remaining = file->len - file->pos;
+    if (remaining == 0) return 0;
+
+    size_t to_read = (buflen < remaining) ? buflen : remaining;
+    memcpy(buf, file->data + file->pos, to_read);
+    file->pos += to_read;
+
+    return to_read;
+}
+
+static int my_close(UpnpWebFileHandle fileHnd) {
+    WebServerFile *file = (WebServerFile *)fileHnd;
+    if (file) free(file);
+    return 0;
+}
+
+static int my_write(UpnpWebFileHandle fileHnd, char *buf, size_t buflen) {
+    (void)fileHnd; (void)buf; (void)buflen;
+    return -1;
+}
+
+static int my_seek(UpnpWebFileHandle fileHnd, off_t offset, int origin) {
+    WebServerFile *file = (WebServerFile *)fileHnd;
+    if (!file) return -1;
+
+    off_t new_pos;
+    switch (origin) {
+        case SEEK_SET: new_pos = offset; break;
+        case SEEK_CUR: new_pos = file->pos + offset; break;
+        case SEEK_END: new_pos = file->len + offset; break;
+        default: return -1;
+    }
+
+    if (new_pos < 0 || new_pos > (off_t)file->len) return -1;
+
+    file->pos = new_pos;
+    return 0;
+}
+
+static struct UpnpVirtualDirCallbacks virtual_dir_callbacks = {
+    .get_info = my_get_info,
+    .open = my_open,
+    .read = my_read,
+    .close = my_close,
+    .write = my_write,
+    .seek = my_seek,
+};
+
+int webserver_register_callbacks(void) {
+    int rc = UpnpSetVirtualDirCallbacks(&virtual_dir_callbacks);
+    if (rc != UPNP_E_SUCCESS) {
+        LOG_ERROR( "UpnpSetVirtualDirCallbacks failed: %s (%d)",
+                UpnpGetErrorMessage(rc), rc);
+        return -1;
+    }
+
+    rc = UpnpAddVirtualDir(VIRTUAL_DIR);
+    if (rc != UPNP_E_SUCCESS) {
+        LOG_ERROR( "UpnpAddVirtualDir failed: %s (%d)",
+                UpnpGetErrorMessage(rc), rc);
+        return -1;
+    }
+
+    LOG_DEBUG("Registered virtual directory callbacks success");
+    return 0;
+}
@@ -0,0 +1,38 @@
+#ifndef VIRTUAL_DIR_H
+#define VIRTUAL_DIR_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define VIRTUAL_DIR "/virtual"
+
+typedef struct {
+    const char *real_path;
+    const char *virtual_path;
+    const char *content_type;
+} VirtualFileEntry;
+
+// libupnp 虚拟目录下的静态文件(图标、SCPD): 启动时 mmap 只读映射，按虚拟路径建哈希索引，
+// 请求时 O(1) 查找，读取直接从映射区复制到 libupnp 的发送缓冲区，不在堆上保留副本。
+// 加载必须在 UpnpInit2 之前完成，之后索引只读，多个 web 线程并发查找不需要加锁。
+// Last-Modified 取文件修改时间，ETag 由内容计算；libupnp 支持额外头部时附带 ETag/Cache-Control
+int create_virtual_file(const char *real_path, const char *virtual_path, const char *content_type);
+
+// 运行时生成的文件(如每个区域的设备描述)，接管 g_malloc 分配的 data，同样需要在 UpnpInit2 之前添加
+int create_virtual_file_from_buffer(const char *virtual_path, const char *content_type, char *data, size_t len);
+
+int load_virtual_files(const VirtualFileEntry *entries, size_t count);
+
+void free_virtual_files(void);
+
+// 注册虚拟目录回调并添加 VIRTUAL_DIR
+int webserver_register_callbacks(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // VIRTUAL_DIR_H
@@ -0,0 +1,135 @@
+#include "xml_builder.h"
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+#define XML_BUILDER_MIN_CAP  256
+#define XML_BUILDER_KEEP_CAP (64 * 1024)    // reset 时超过这个大小的缓冲区释放掉
+
+static const unsigned char escapable[256] = {
+    ['<'] = 1, ['>'] = 1, ['&'] = 1, ['"'] = 1, ['\''] = 1,
+};
+
+void xml_builder_init(xml_builder_t *b) {
+    memset(b, 0, sizeof(*b));
+}
+
+void xml_builder_free(xml_builder_t *b) {
+    free(b->data);
+    memset(b, 0, sizeof(*b));
+}
+
+void xml_builder_reset(xml_builder_t *b) {
+    if (b->cap > XML_BUILDER_KEEP_CAP) {
+        free(b->data);
+        b->data = NULL;
+        b->cap = 0;
+    }
+    b->len = 0;
+    b->failed = 0;
+    if (b->data) b->data[0] = '\0';
+}
+
+// 保证还能追加 extra 字节和结尾的 '\0'
+static int reserve(xml_builder_t *b, size_t extra) {
+    if (b->failed) return -1;
+    size_t need = b->len + extra + 1;
+    if (need <= b->cap) return 0;
+
+    size_t cap = b->cap ? b->cap : XML_BUILDER_MIN_CAP;
+    while (cap < need) cap *= 2;
+    char *data = realloc(b->data, cap);
+    if (!data) {
+        b->failed = 1;
+        return -1;
+    }
+    b->data = data;
+    b->cap = cap;
+    return 0;
+}
+
+void xml_append(xml_builder_t *b, const char *s, size_t len) {
+    if (reserve(b, len) != 0) return;
+    memcpy(b->data + b->len, s, len);
+    b->len += len;
+    b->data[b->len] = '\0';
+}
+
+void xml_append_str(xml_builder_t *b, const char *s) {
+    xml_append(b, s, strlen(s));
+}
+
+// 返回第一个需要转义的字符的偏移，没有时返回 len
+static size_t find_escapable(const char *s, size_t len) {
+    size_t i = 0;
+#if defined(__SSE2__)
+    const __m128i lt = _mm_set1_epi8('<');
+    const __m128i gt = _mm_set1_epi8('>');
+    const __m128i amp = _mm_set1_epi8('&');
+    const __m128i quot = _mm_set1_epi8('"');
+    const __m128i apos = _mm_set1_epi8('\'');
+    for (; i + 16 <= len; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(s + i));
+        __m128i m = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, lt), _mm_cmpeq_epi8(v, gt)),
+                                 _mm_or_si128(_mm_cmpeq_epi8(v, amp), _mm_cmpeq_epi8(v, quot)));
+        m = _mm_or_si128(m, _mm_cmpeq_epi8(v, apos));
+        int mask = _mm_movemask_epi8(m);
+        if (mask) return i + (size_t)__builtin_ctz(mask);
+    }
+#elif defined(__ARM_NEON)
+    const uint8x16_t lt = vdupq_n_u8('<');
+    const uint8x16_t gt = vdupq_n_u8('>');
+    const uint8x16_t amp = vdupq_n_u8('&');
+    const uint8x16_t quot = vdupq_n_u8('"');
+    const uint8x16_t apos = vdupq_n_u8('\'');
+    for (; i + 16 <= len; i += 16) {
+        uint8x16_t v = vld1q_u8((const uint8_t *)(s + i));
+        uint8x16_t m = vorrq_u8(vorrq_u8(vceqq_u8(v, lt), vceqq_u8(v, gt)),
+                                vorrq_u8(vceqq_u8(v, amp), vceqq_u8(v, quot)));
+        m = vorrq_u8(m, vceqq_u8(v, apos));
+        // 每个字节压成4位，得到64位掩码
+        uint64_t mask = vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(m), 4)), 0);
+        if (mask) return i + (size_t)(__builtin_ctzll(mask) >> 2);
+    }
+#endif
+    for (; i < len; i++) {
+        if (escapable[(unsigned char)s[i]]) return i;
+    }
+    return len;
+}
+
+void xml_append_escaped(xml_builder_t *b, const char *s, size_t len) {
+    // 大部分内容不需要转义，先按原长度预留
+    if (reserve(b, len) != 0) return;
+
+    while (len > 0) {
+        size_t n = find_escapable(s, len);
+        xml_append(b, s, n);
+        if (n == len) break;
+
+        switch (s[n]) {
+            case '<':  xml_append(b, "&lt;", 4); break;
+            case '>':  xml_append(b, "&gt;", 4); break;
+            case '&':  xml_append(b, "&amp;", 5); break;
+            case '"':  xml_append(b, "&quot;", 6); break;
+            default:   xml_append(b, "&apos;", 6); break;
+        }
+        s += n + 1;
+        len -= n + 1;
+    }
+}
+
+void xml_append_escaped_str(xml_builder_t *b, const char *s) {
+    xml_append_escaped(b, s, strlen(s));
+}
+
+const char* xml_builder_str(xml_builder_t *b) {
+    if (reserve(b, 0) != 0) return NULL;
+    b->data[b->len] = '\0';
+    return b->data;
+}
@@ -0,0 +1,43 @@
+#ifndef XML_BUILDER_H
+#define XML_BUILDER_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// 追加式 XML 字符串构造器。缓冲区在 reset 后保留下来给下一次请求复用，
+// 稳定后不再分配内存；偶尔出现的大文档(几十KB的 DIDL-Lite)用完后缩回常规大小
+typedef struct {
+    char *data;
+    size_t len;
+    size_t cap;
+    int failed;         // 内存不足，之后的追加都被忽略
+} xml_builder_t;
+
+void xml_builder_init(xml_builder_t *b);
+
+void xml_builder_free(xml_builder_t *b);
+
+// 清空内容，保留缓冲区
+void xml_builder_reset(xml_builder_t *b);
+
+void xml_append(xml_builder_t *b, const char *s, size_t len);
+
+void xml_append_str(xml_builder_t *b, const char *s);
+
+// 按 XML 规则转义 < > & " '，可以用于文本和属性值。
+// 用 SSE2/NEON 一次检查16字节，不需要转义的片段整段复制
+void xml_append_escaped(xml_builder_t *b, const char *s, size_t len);
+
+void xml_append_escaped_str(xml_builder_t *b, const char *s);
+
+// 以 '\0' 结尾的内容，失败时返回 NULL；下一次修改前有效
+const char* xml_builder_str(xml_builder_t *b);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // XML_BUILDER_H